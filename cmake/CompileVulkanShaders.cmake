@@ -0,0 +1,67 @@
+# Copyright (C) 2013
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+# Compiles the Vulkan shaders of libgls-vulkan to SPIR-V at build time, like
+# StringifyShaders does for the OpenGL shaders. Each output is a C header that
+# defines a uint32_t array with the SPIR-V code.
+#
+# compile_vulkan_vertex_shader(<input> <output> <name>)
+#   compiles a vertex shader as is.
+# compile_vulkan_composition_shaders(<input> <output_dir> <mode>...)
+#   compiles one variant of the composition shader gls.glsl per mode to
+#   <output_dir>/gls-vulkan-<mode>.frag.h with the array gls_vulkan_<mode>.
+#   The variant has ghostbusting enabled, linear upsampling, and neither LUTs
+#   nor an overlay, since libgls-vulkan does not support these.
+
+macro(COMPILE_VULKAN_VERTEX_SHADER INPUT OUTPUT NAME)
+  add_custom_command(OUTPUT ${OUTPUT}
+    COMMAND ${GLSLANG_VALIDATOR} -V -S vert --vn ${NAME} -o ${OUTPUT} ${INPUT}
+    DEPENDS ${INPUT}
+    COMMENT "Compiling Vulkan vertex shader"
+    VERBATIM
+  )
+endmacro()
+
+macro(COMPILE_VULKAN_COMPOSITION_SHADERS INPUT OUTPUT_DIR)
+  foreach(MODE ${ARGN})
+    add_custom_command(OUTPUT ${OUTPUT_DIR}/gls-vulkan-${MODE}.frag.h
+      COMMAND ${CMAKE_COMMAND} -DCOMPILE_VULKAN_SHADERS_PROCESSING_MODE=ON
+        -DINPUT=${INPUT} -DOUTPUT_DIR=${OUTPUT_DIR} -DMODE=${MODE}
+        -DGLSLANG_VALIDATOR=${GLSLANG_VALIDATOR}
+        -P ${CMAKE_SOURCE_DIR}/cmake/CompileVulkanShaders.cmake
+      DEPENDS ${INPUT}
+      COMMENT "Compiling Vulkan composition shader for ${MODE}"
+      VERBATIM
+    )
+  endforeach()
+endmacro()
+
+if(NOT COMPILE_VULKAN_SHADERS_PROCESSING_MODE)
+  return()
+endif()
+
+#
+
+file(READ ${INPUT} SOURCE)
+string(REPLACE "#version 110" "#version 450\n#define VULKAN 1" SOURCE "${SOURCE}")
+string(REPLACE "$mode" "mode_${MODE}" SOURCE "${SOURCE}")
+string(REPLACE "$ghostbust" "ghostbust_enabled" SOURCE "${SOURCE}")
+string(REPLACE "$upsample" "upsample_linear" SOURCE "${SOURCE}")
+string(REPLACE "$lut_left" "lut_left_disabled" SOURCE "${SOURCE}")
+string(REPLACE "$lut_right" "lut_right_disabled" SOURCE "${SOURCE}")
+string(REPLACE "$lut_output" "lut_output_disabled" SOURCE "${SOURCE}")
+string(REPLACE "$overlay" "overlay_none" SOURCE "${SOURCE}")
+set(VARIANT ${OUTPUT_DIR}/gls-vulkan-${MODE}.frag)
+file(WRITE ${VARIANT} "${SOURCE}")
+
+execute_process(
+  COMMAND ${GLSLANG_VALIDATOR} -V -S frag --vn gls_vulkan_${MODE}
+    -o ${VARIANT}.h ${VARIANT}
+  RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+  message(FATAL_ERROR "Cannot compile ${VARIANT}")
+endif()
@@ -0,0 +1,90 @@
+# Copyright (C) 2013
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+# Tests of the CPU path of gls-convert against reference images.
+#
+# add_convert_test(<name> <options>)
+#   adds the test gls-convert-<name>, which composes the views
+#   test/convert/left.ppm and test/convert/right.ppm with
+#   gls-convert --cpu <options> and compares the result with
+#   test/convert/<name>.ppm. The references were made with the OpenGL path
+#   of gls-convert, so each channel may differ by one.
+
+macro(ADD_CONVERT_TEST NAME)
+  add_test(NAME gls-convert-${NAME}
+    COMMAND ${CMAKE_COMMAND} -DTEST_CONVERT_PROCESSING_MODE=ON
+      -DCONVERT=$<TARGET_FILE:convert_program>
+      -DLEFT=${CMAKE_SOURCE_DIR}/test/convert/left.ppm
+      -DRIGHT=${CMAKE_SOURCE_DIR}/test/convert/right.ppm
+      -DREFERENCE=${CMAKE_SOURCE_DIR}/test/convert/${NAME}.ppm
+      -DOUTPUT=${CMAKE_BINARY_DIR}/gls-convert-${NAME}.ppm
+      "-DOPTIONS=${ARGN}"
+      -P ${CMAKE_SOURCE_DIR}/cmake/TestConvert.cmake
+  )
+endmacro()
+
+if(NOT TEST_CONVERT_PROCESSING_MODE)
+  return()
+endif()
+
+if(POLICY CMP0053)
+  cmake_policy(SET CMP0053 NEW)
+endif()
+
+#
+# Runs gls-convert and compares its output with the reference.
+#
+
+execute_process(COMMAND ${CONVERT} --cpu ${OPTIONS}
+  --left ${LEFT} --right ${RIGHT} --output ${OUTPUT}
+  RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+  message(FATAL_ERROR "gls-convert failed: ${RESULT}")
+endif()
+
+# The headers must be identical
+file(READ ${REFERENCE} HEADER LIMIT 32)
+string(REGEX MATCH "^P6[ \t\r\n]+[0-9]+[ \t\r\n]+[0-9]+[ \t\r\n]+255[ \t\r\n]" HEADER "${HEADER}")
+if(NOT HEADER)
+  message(FATAL_ERROR "${REFERENCE} is not a binary PPM")
+endif()
+string(LENGTH "${HEADER}" HEADER_LENGTH)
+file(READ ${OUTPUT} OUTPUT_HEX HEX)
+file(READ ${REFERENCE} REFERENCE_HEX HEX)
+string(LENGTH "${OUTPUT_HEX}" LENGTH)
+string(LENGTH "${REFERENCE_HEX}" REFERENCE_LENGTH)
+math(EXPR HEADER_LENGTH "2 * ${HEADER_LENGTH}")
+string(SUBSTRING "${OUTPUT_HEX}" 0 ${HEADER_LENGTH} OUTPUT_HEADER)
+string(SUBSTRING "${REFERENCE_HEX}" 0 ${HEADER_LENGTH} REFERENCE_HEADER)
+if(NOT LENGTH EQUAL REFERENCE_LENGTH OR NOT OUTPUT_HEADER STREQUAL REFERENCE_HEADER)
+  message(FATAL_ERROR "${OUTPUT} and ${REFERENCE} differ in size")
+endif()
+
+# Each byte of the pixels may differ by one
+set(DIGITS "0123456789abcdef")
+set(ERRORS 0)
+math(EXPR LAST "${LENGTH} - 2")
+foreach(I RANGE ${HEADER_LENGTH} ${LAST} 2)
+  string(SUBSTRING "${OUTPUT_HEX}" ${I} 2 A)
+  string(SUBSTRING "${REFERENCE_HEX}" ${I} 2 B)
+  if(NOT A STREQUAL B)
+    foreach(V A B)
+      string(SUBSTRING "${${V}}" 0 1 HI)
+      string(SUBSTRING "${${V}}" 1 1 LO)
+      string(FIND "${DIGITS}" "${HI}" HI)
+      string(FIND "${DIGITS}" "${LO}" LO)
+      math(EXPR ${V} "16 * ${HI} + ${LO}")
+    endforeach()
+    math(EXPR D "${A} - ${B}")
+    if(D GREATER 1 OR D LESS -1)
+      math(EXPR ERRORS "${ERRORS} + 1")
+    endif()
+  endif()
+endforeach()
+if(ERRORS GREATER 0)
+  message(FATAL_ERROR "${ERRORS} bytes of ${OUTPUT} differ from ${REFERENCE}")
+endif()
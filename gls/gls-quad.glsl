@@ -0,0 +1,70 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Vertex shader of the composition for OpenGL ES, which has no fixed function
+ * pipeline: it draws the full-viewport quad from a vertex buffer and computes
+ * the texture coordinates that draw_quad() sets on desktop OpenGL. For the
+ * HMD mode, it passes on the texture coordinates of the lens distortion mesh.
+ */
+
+#version 110
+
+// quad_vertices
+// mesh_vertices
+#define $vertices
+
+#if defined(GL_ES)
+precision highp float;
+#endif
+
+attribute vec2 position;
+#if defined(mesh_vertices)
+attribute vec2 texcoord_red;
+attribute vec2 texcoord_green;
+attribute vec2 texcoord_blue;
+#else
+uniform vec2 mask_scale;   // half of the viewport size
+#endif
+
+varying vec2 texcoord_l;
+varying vec2 texcoord_r;
+varying vec2 texcoord_mask;
+
+void main()
+{
+#if defined(mesh_vertices)
+    // The fragment shader of the HMD mode expects them in this order
+    texcoord_l = texcoord_red;
+    texcoord_r = texcoord_green;
+    texcoord_mask = texcoord_blue;
+#else
+    vec2 texcoord = position * 0.5 + 0.5;
+    texcoord_l = texcoord;
+    texcoord_r = texcoord;
+    // The 2x2 mask texture repeats over the viewport
+    texcoord_mask = texcoord * mask_scale;
+#endif
+    gl_Position = vec4(position, 0.0, 1.0);
+}
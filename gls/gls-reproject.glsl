@@ -0,0 +1,96 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Reprojection: warp a view to new camera matrices, using its depth buffer.
+ *
+ * The view is drawn as a grid with one vertex every few pixels. Each vertex
+ * is moved from its clip space position under the old matrices to its clip
+ * space position under the new matrices; this is a single matrix
+ * multiplication. The depth test resolves overlaps. Regions that were
+ * hidden in the old view are covered by triangles stretched between the
+ * foreground and the background; we fill them with the background.
+ */
+
+#version 110
+
+#define $stage
+
+uniform sampler2D rgb;                  // the old view
+uniform sampler2D depth;                // its depth buffer
+uniform vec2 rgb_scale;                 // used part of the textures
+uniform vec2 depth_scale;
+uniform vec2 pixel_size;                // size of a pixel
+uniform mat4 reprojection;              // new matrix * inverse of old matrix
+
+// The textures have unused texels beyond the view; replicate the edge instead
+vec2 clamp_texcoord(vec2 texcoord)
+{
+    return clamp(texcoord, 0.5 * pixel_size, 1.0 - 0.5 * pixel_size);
+}
+
+#if defined(vertex_stage)
+
+void main()
+{
+    vec2 texcoord = gl_Vertex.xy;
+    float d = texture2DLod(depth, clamp_texcoord(texcoord) * depth_scale, 0.0).r;
+    gl_TexCoord[0] = vec4(texcoord, 0.0, 1.0);
+    gl_Position = reprojection * vec4(2.0 * texcoord - 1.0, 2.0 * d - 1.0, 1.0);
+}
+
+#else
+
+// Nearest texel of the old view and its depth
+vec4 texel(vec2 p)
+{
+    vec2 texcoord = clamp_texcoord((floor(p) + 0.5) * pixel_size);
+    return vec4(texture2D(rgb, texcoord * rgb_scale).rgb,
+            texture2D(depth, texcoord * depth_scale).r);
+}
+
+void main()
+{
+    vec2 texcoord = clamp_texcoord(gl_TexCoord[0].xy);
+    vec2 p = texcoord / pixel_size;     // in pixels of the old view
+    vec2 magnification = fwidth(p);
+    vec3 result;
+
+    if (min(magnification.x, magnification.y) < 0.5) {
+        // A triangle that is stretched over a region that was hidden in the
+        // old view. Fill it with the background, not with the foreground.
+        vec4 t0 = texel(p + vec2(-1.0, -1.0));
+        vec4 t1 = texel(p + vec2(+1.0, -1.0));
+        vec4 t2 = texel(p + vec2(-1.0, +1.0));
+        vec4 t3 = texel(p + vec2(+1.0, +1.0));
+        vec4 t01 = (t0.a > t1.a ? t0 : t1);
+        vec4 t23 = (t2.a > t3.a ? t2 : t3);
+        result = (t01.a > t23.a ? t01 : t23).rgb;
+    } else {
+        result = texture2D(rgb, texcoord * rgb_scale).rgb;
+    }
+    gl_FragColor = vec4(result, 1.0);
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Depth-image-based rendering: synthesize the view of one eye from the view
+ * and depth buffer of the other eye.
+ *
+ * A point at distance z appears shifted horizontally by
+ *   disparity(z) = disparity_factor * (1 / focal_length - 1 / z)
+ * in the other view. For each pixel of the synthesized view, we search the
+ * row of the source view for the pixels that land on it, and take the
+ * nearest one. Pixels that nothing lands on were hidden in the source view;
+ * we fill them by stretching the background next to them.
+ */
+
+#version 110
+
+uniform sampler2D rgb;                  // the source view
+uniform sampler2D depth;                // its depth buffer
+uniform vec2 rgb_scale;                 // used part of the textures
+uniform vec2 depth_scale;
+uniform vec2 pixel_size;                // size of a pixel
+uniform vec2 depth_range;               // near and far plane
+uniform float disparity_factor;         // negative to synthesize the left view
+uniform float inv_focal_length;
+uniform vec2 disparity_range;           // smallest and largest disparity
+
+#define TAPS 32
+
+// The view textures have a black border; replicate the edge instead
+vec3 color(float x, float y)
+{
+    vec2 texcoord = clamp(vec2(x, y), 0.5 * pixel_size, 1.0 - 0.5 * pixel_size);
+    return texture2D(rgb, texcoord * rgb_scale).rgb;
+}
+
+float disparity(vec2 texcoord)
+{
+    float d = texture2D(depth, texcoord * depth_scale).r;
+    float z = depth_range.x * depth_range.y / (depth_range.y - d * (depth_range.y - depth_range.x));
+    return disparity_factor * (inv_focal_length - 1.0 / z);
+}
+
+void main()
+{
+    vec2 texcoord = gl_TexCoord[0].xy;
+    float search_step = (disparity_range.y - disparity_range.x) / float(TAPS - 1);
+    float tolerance = 0.5 * max(search_step, pixel_size.x);
+    // Farther points have larger keys
+    float direction = sign(disparity_factor);
+    float hit_x = -1.0;
+    float hit_key = 1e30;
+    float near_key = 1e30;
+    float far_key = -1e30;
+    vec3 result;
+
+    for (int i = 0; i < TAPS; i++) {
+        float x = texcoord.x - (disparity_range.x + float(i) * search_step);
+        if (x >= 0.0 && x <= 1.0) {
+            float d = disparity(vec2(x, texcoord.y));
+            float key = direction * d;
+            if (abs(x + d - texcoord.x) <= tolerance && key < hit_key) {
+                hit_x = x;
+                hit_key = key;
+            }
+            near_key = min(near_key, key);
+            far_key = max(far_key, key);
+        }
+    }
+
+    if (hit_x >= 0.0) {
+        result = color(hit_x, texcoord.y);
+    } else {
+        // Disocclusion: stretch the background pixel that lands nearest,
+        // slightly blurred
+        float threshold = 0.5 * (near_key + far_key);
+        float fill_x = clamp(texcoord.x, 0.0, 1.0);
+        float fill_distance = 1e30;
+        for (int i = 0; i < TAPS; i++) {
+            float x = texcoord.x - (disparity_range.x + float(i) * search_step);
+            if (x >= 0.0 && x <= 1.0) {
+                float d = disparity(vec2(x, texcoord.y));
+                float distance = abs(x + d - texcoord.x);
+                if (direction * d >= threshold && distance < fill_distance) {
+                    fill_x = x;
+                    fill_distance = distance;
+                }
+            }
+        }
+        result = (color(fill_x, texcoord.y - pixel_size.y)
+                + 2.0 * color(fill_x, texcoord.y)
+                + color(fill_x, texcoord.y + pixel_size.y)) / 4.0;
+    }
+    gl_FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,636 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vulkan/vulkan.h>
+
+#define GLS_BUILD
+#include "gls/gls-vulkan.h"
+
+/* SPIR-V code, compiled from gls-vulkan.vert and gls.glsl at build time */
+#include "gls-vulkan.vert.h"
+#include "gls-vulkan-onechannel.frag.h"
+#include "gls-vulkan-even_odd_rows.frag.h"
+#include "gls-vulkan-even_odd_columns.frag.h"
+#include "gls-vulkan-checkerboard.frag.h"
+#include "gls-vulkan-red_cyan_monochrome.frag.h"
+#include "gls-vulkan-red_cyan_half_color.frag.h"
+#include "gls-vulkan-red_cyan_full_color.frag.h"
+#include "gls-vulkan-red_cyan_dubois.frag.h"
+#include "gls-vulkan-green_magenta_monochrome.frag.h"
+#include "gls-vulkan-green_magenta_half_color.frag.h"
+#include "gls-vulkan-green_magenta_full_color.frag.h"
+#include "gls-vulkan-green_magenta_dubois.frag.h"
+#include "gls-vulkan-amber_blue_monochrome.frag.h"
+#include "gls-vulkan-amber_blue_half_color.frag.h"
+#include "gls-vulkan-amber_blue_full_color.frag.h"
+#include "gls-vulkan-amber_blue_dubois.frag.h"
+#include "gls-vulkan-red_green_monochrome.frag.h"
+#include "gls-vulkan-red_blue_monochrome.frag.h"
+
+
+/*
+ * Pipelines
+ */
+
+/* One pipeline per shader variant. The modes that show the views separately
+ * share the onechannel pipeline and select the view with a push constant. */
+enum {
+    GLS_VK_ONECHANNEL,
+    GLS_VK_EVEN_ODD_ROWS,
+    GLS_VK_EVEN_ODD_COLUMNS,
+    GLS_VK_CHECKERBOARD,
+    GLS_VK_RED_CYAN_MONOCHROME,
+    GLS_VK_RED_CYAN_HALF_COLOR,
+    GLS_VK_RED_CYAN_FULL_COLOR,
+    GLS_VK_RED_CYAN_DUBOIS,
+    GLS_VK_GREEN_MAGENTA_MONOCHROME,
+    GLS_VK_GREEN_MAGENTA_HALF_COLOR,
+    GLS_VK_GREEN_MAGENTA_FULL_COLOR,
+    GLS_VK_GREEN_MAGENTA_DUBOIS,
+    GLS_VK_AMBER_BLUE_MONOCHROME,
+    GLS_VK_AMBER_BLUE_HALF_COLOR,
+    GLS_VK_AMBER_BLUE_FULL_COLOR,
+    GLS_VK_AMBER_BLUE_DUBOIS,
+    GLS_VK_RED_GREEN_MONOCHROME,
+    GLS_VK_RED_BLUE_MONOCHROME,
+    GLS_VK_PIPELINES
+};
+
+static const struct {
+    const uint32_t* code;
+    size_t size;
+} fragment_shaders[GLS_VK_PIPELINES] = {
+    { gls_vulkan_onechannel, sizeof(gls_vulkan_onechannel) },
+    { gls_vulkan_even_odd_rows, sizeof(gls_vulkan_even_odd_rows) },
+    { gls_vulkan_even_odd_columns, sizeof(gls_vulkan_even_odd_columns) },
+    { gls_vulkan_checkerboard, sizeof(gls_vulkan_checkerboard) },
+    { gls_vulkan_red_cyan_monochrome, sizeof(gls_vulkan_red_cyan_monochrome) },
+    { gls_vulkan_red_cyan_half_color, sizeof(gls_vulkan_red_cyan_half_color) },
+    { gls_vulkan_red_cyan_full_color, sizeof(gls_vulkan_red_cyan_full_color) },
+    { gls_vulkan_red_cyan_dubois, sizeof(gls_vulkan_red_cyan_dubois) },
+    { gls_vulkan_green_magenta_monochrome, sizeof(gls_vulkan_green_magenta_monochrome) },
+    { gls_vulkan_green_magenta_half_color, sizeof(gls_vulkan_green_magenta_half_color) },
+    { gls_vulkan_green_magenta_full_color, sizeof(gls_vulkan_green_magenta_full_color) },
+    { gls_vulkan_green_magenta_dubois, sizeof(gls_vulkan_green_magenta_dubois) },
+    { gls_vulkan_amber_blue_monochrome, sizeof(gls_vulkan_amber_blue_monochrome) },
+    { gls_vulkan_amber_blue_half_color, sizeof(gls_vulkan_amber_blue_half_color) },
+    { gls_vulkan_amber_blue_full_color, sizeof(gls_vulkan_amber_blue_full_color) },
+    { gls_vulkan_amber_blue_dubois, sizeof(gls_vulkan_amber_blue_dubois) },
+    { gls_vulkan_red_green_monochrome, sizeof(gls_vulkan_red_green_monochrome) },
+    { gls_vulkan_red_blue_monochrome, sizeof(gls_vulkan_red_blue_monochrome) }
+};
+
+static int pipeline_index(GLSmode mode)
+{
+    switch (mode) {
+    case GLS_MODE_EVEN_ODD_ROWS:
+        return GLS_VK_EVEN_ODD_ROWS;
+    case GLS_MODE_EVEN_ODD_COLUMNS:
+        return GLS_VK_EVEN_ODD_COLUMNS;
+    case GLS_MODE_CHECKERBOARD:
+        return GLS_VK_CHECKERBOARD;
+    case GLS_MODE_RED_CYAN_MONOCHROME:
+        return GLS_VK_RED_CYAN_MONOCHROME;
+    case GLS_MODE_RED_CYAN_HALF_COLOR:
+        return GLS_VK_RED_CYAN_HALF_COLOR;
+    case GLS_MODE_RED_CYAN_FULL_COLOR:
+        return GLS_VK_RED_CYAN_FULL_COLOR;
+    case GLS_MODE_RED_CYAN_DUBOIS:
+        return GLS_VK_RED_CYAN_DUBOIS;
+    case GLS_MODE_GREEN_MAGENTA_MONOCHROME:
+        return GLS_VK_GREEN_MAGENTA_MONOCHROME;
+    case GLS_MODE_GREEN_MAGENTA_HALF_COLOR:
+        return GLS_VK_GREEN_MAGENTA_HALF_COLOR;
+    case GLS_MODE_GREEN_MAGENTA_FULL_COLOR:
+        return GLS_VK_GREEN_MAGENTA_FULL_COLOR;
+    case GLS_MODE_GREEN_MAGENTA_DUBOIS:
+        return GLS_VK_GREEN_MAGENTA_DUBOIS;
+    case GLS_MODE_AMBER_BLUE_MONOCHROME:
+        return GLS_VK_AMBER_BLUE_MONOCHROME;
+    case GLS_MODE_AMBER_BLUE_HALF_COLOR:
+        return GLS_VK_AMBER_BLUE_HALF_COLOR;
+    case GLS_MODE_AMBER_BLUE_FULL_COLOR:
+        return GLS_VK_AMBER_BLUE_FULL_COLOR;
+    case GLS_MODE_AMBER_BLUE_DUBOIS:
+        return GLS_VK_AMBER_BLUE_DUBOIS;
+    case GLS_MODE_RED_GREEN_MONOCHROME:
+        return GLS_VK_RED_GREEN_MONOCHROME;
+    case GLS_MODE_RED_BLUE_MONOCHROME:
+        return GLS_VK_RED_BLUE_MONOCHROME;
+    default:
+        return GLS_VK_ONECHANNEL;
+    }
+}
+
+/* The push constants of the fragment shader; see the VULKAN branch of
+ * gls.glsl for the layout */
+typedef struct {
+    float rgb_l_scale[2];
+    float rgb_r_scale[2];
+    float step_l[2];
+    float step_r[2];
+    float crosstalk[3];
+    float parallax_adjust;
+    float channel;
+} GLS_vk_parameters;
+
+
+/*
+ * GLS Vulkan context
+ */
+
+struct GLS_vk_context
+{
+    VkDevice device;
+    VkSampler sampler;
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipelines[GLS_VK_PIPELINES];
+    // Descriptor sets, allocated once: GLS_VK_MAX_VIEW_PAIRS for each frame
+    // in flight, each kept for the pair of views that it was last updated for
+    VkDescriptorPool pool;
+    uint32_t frames;
+    VkDescriptorSet* sets;
+    VkImageView (*set_views)[2];
+    VkDescriptorSet* frame_sets;        // the sets of the current frame
+    VkImageView (*frame_set_views)[2];
+    int frame_set_count;                // the sets used in the current frame
+    // Settings
+    int32_t screen_x;
+    int32_t screen_y;
+    float crosstalk[3];
+    float ghostbust;
+    unsigned long alternating_counter;
+};
+
+static VkShaderModule create_shader_module(VkDevice device, const uint32_t* code, size_t size)
+{
+    VkShaderModuleCreateInfo info = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    VkShaderModule module = VK_NULL_HANDLE;
+
+    info.codeSize = size;
+    info.pCode = code;
+    if (vkCreateShaderModule(device, &info, NULL, &module) != VK_SUCCESS)
+        return VK_NULL_HANDLE;
+    return module;
+}
+
+static VkResult create_pipelines(GLSvkContext* ctx,
+        VkRenderPass render_pass, uint32_t subpass, VkPipelineCache cache)
+{
+    VkShaderModule vertex_module;
+    VkShaderModule fragment_modules[GLS_VK_PIPELINES];
+    VkPipelineShaderStageCreateInfo stages[GLS_VK_PIPELINES][2];
+    VkGraphicsPipelineCreateInfo infos[GLS_VK_PIPELINES];
+    VkPipelineVertexInputStateCreateInfo vertex_input = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    VkPipelineViewportStateCreateInfo viewport = { VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+    VkPipelineRasterizationStateCreateInfo rasterization = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    VkPipelineMultisampleStateCreateInfo multisample = { VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    VkPipelineDepthStencilStateCreateInfo depth_stencil = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    VkPipelineColorBlendAttachmentState blend_attachment = { VK_FALSE };
+    VkPipelineColorBlendStateCreateInfo blend = { VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+    const VkDynamicState dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    int i;
+
+    // The state that all pipelines share: a triangle covering the viewport
+    // and scissor rectangle, which are set for each draw, without depth,
+    // stencil, and blending
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+        | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blend.attachmentCount = 1;
+    blend.pAttachments = &blend_attachment;
+    dynamic.dynamicStateCount = 2;
+    dynamic.pDynamicStates = dynamic_states;
+
+    vertex_module = create_shader_module(ctx->device, gls_vulkan_vert, sizeof(gls_vulkan_vert));
+    for (i = 0; i < GLS_VK_PIPELINES; i++) {
+        fragment_modules[i] = create_shader_module(ctx->device,
+                fragment_shaders[i].code, fragment_shaders[i].size);
+    }
+    for (i = 0; i < GLS_VK_PIPELINES; i++) {
+        if (vertex_module == VK_NULL_HANDLE || fragment_modules[i] == VK_NULL_HANDLE)
+            goto done;
+        memset(stages[i], 0, sizeof(stages[i]));
+        stages[i][0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[i][0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[i][0].module = vertex_module;
+        stages[i][0].pName = "main";
+        stages[i][1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[i][1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[i][1].module = fragment_modules[i];
+        stages[i][1].pName = "main";
+        memset(&infos[i], 0, sizeof(infos[i]));
+        infos[i].sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        infos[i].stageCount = 2;
+        infos[i].pStages = stages[i];
+        infos[i].pVertexInputState = &vertex_input;
+        infos[i].pInputAssemblyState = &input_assembly;
+        infos[i].pViewportState = &viewport;
+        infos[i].pRasterizationState = &rasterization;
+        infos[i].pMultisampleState = &multisample;
+        infos[i].pDepthStencilState = &depth_stencil;
+        infos[i].pColorBlendState = &blend;
+        infos[i].pDynamicState = &dynamic;
+        infos[i].layout = ctx->pipeline_layout;
+        infos[i].renderPass = render_pass;
+        infos[i].subpass = subpass;
+        infos[i].basePipelineIndex = -1;
+    }
+    // All pipelines are built now, in one call, so that the driver can
+    // compile them in parallel and the application's pipeline cache makes
+    // later runs cheap
+    result = vkCreateGraphicsPipelines(ctx->device, cache,
+            GLS_VK_PIPELINES, infos, NULL, ctx->pipelines);
+
+done:
+    vkDestroyShaderModule(ctx->device, vertex_module, NULL);
+    for (i = 0; i < GLS_VK_PIPELINES; i++)
+        vkDestroyShaderModule(ctx->device, fragment_modules[i], NULL);
+    return result;
+}
+
+GLSvkContext* glsVkCreateContext(VkDevice device,
+        VkRenderPass renderPass, uint32_t subpass, VkPipelineCache pipelineCache,
+        uint32_t framesInFlight)
+{
+    GLSvkContext* ctx = calloc(1, sizeof(GLSvkContext));
+    VkSamplerCreateInfo sampler_info = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    VkDescriptorSetLayoutBinding bindings[2];
+    VkSampler immutable_samplers[2];
+    VkDescriptorSetLayoutCreateInfo set_layout_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    VkPushConstantRange push_constants;
+    VkPipelineLayoutCreateInfo pipeline_layout_info = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    VkDescriptorPoolSize pool_size;
+    VkDescriptorPoolCreateInfo pool_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    VkDescriptorSetLayout* set_layouts = NULL;
+    VkDescriptorSetAllocateInfo set_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    uint32_t set_count;
+    uint32_t i;
+
+    if (!ctx)
+        return NULL;
+    if (framesInFlight < 1)
+        framesInFlight = 1;
+    set_count = framesInFlight * GLS_VK_MAX_VIEW_PAIRS;
+    ctx->device = device;
+    ctx->sampler = VK_NULL_HANDLE;
+    ctx->set_layout = VK_NULL_HANDLE;
+    ctx->pipeline_layout = VK_NULL_HANDLE;
+    for (i = 0; i < GLS_VK_PIPELINES; i++)
+        ctx->pipelines[i] = VK_NULL_HANDLE;
+    ctx->pool = VK_NULL_HANDLE;
+    ctx->frames = framesInFlight;
+    ctx->sets = calloc(set_count, sizeof(VkDescriptorSet));
+    ctx->set_views = calloc(set_count, sizeof(ctx->set_views[0]));
+    set_layouts = malloc(set_count * sizeof(VkDescriptorSetLayout));
+    if (!ctx->sets || !ctx->set_views || !set_layouts)
+        goto error;
+    for (i = 0; i < set_count; i++) {
+        ctx->sets[i] = VK_NULL_HANDLE;
+        ctx->set_views[i][0] = VK_NULL_HANDLE;
+        ctx->set_views[i][1] = VK_NULL_HANDLE;
+    }
+    ctx->frame_sets = ctx->sets;
+    ctx->frame_set_views = ctx->set_views;
+    ctx->frame_set_count = 0;
+    ctx->screen_x = 0;
+    ctx->screen_y = 0;
+    ctx->crosstalk[0] = 0.0f;
+    ctx->crosstalk[1] = 0.0f;
+    ctx->crosstalk[2] = 0.0f;
+    ctx->ghostbust = 0.0f;
+    ctx->alternating_counter = 0;
+
+    // The views are sampled like the view textures of libgls
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxLod = 0.0f;
+    if (vkCreateSampler(device, &sampler_info, NULL, &ctx->sampler) != VK_SUCCESS)
+        goto error;
+
+    // Binding 0 is the left view, binding 1 the right view
+    immutable_samplers[0] = ctx->sampler;
+    immutable_samplers[1] = ctx->sampler;
+    for (i = 0; i < 2; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[i].pImmutableSamplers = &immutable_samplers[i];
+    }
+    set_layout_info.bindingCount = 2;
+    set_layout_info.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &set_layout_info, NULL, &ctx->set_layout) != VK_SUCCESS)
+        goto error;
+
+    push_constants.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    push_constants.offset = 0;
+    push_constants.size = sizeof(GLS_vk_parameters);
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &ctx->set_layout;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constants;
+    if (vkCreatePipelineLayout(device, &pipeline_layout_info, NULL, &ctx->pipeline_layout) != VK_SUCCESS)
+        goto error;
+
+    if (create_pipelines(ctx, renderPass, subpass, pipelineCache) != VK_SUCCESS)
+        goto error;
+
+    // All descriptor sets are allocated here; glsVkCmdDrawViews() only
+    // updates the sets of the current frame for new pairs of views
+    pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_size.descriptorCount = 2 * set_count;
+    pool_info.maxSets = set_count;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    if (vkCreateDescriptorPool(device, &pool_info, NULL, &ctx->pool) != VK_SUCCESS)
+        goto error;
+    for (i = 0; i < set_count; i++)
+        set_layouts[i] = ctx->set_layout;
+    set_info.descriptorPool = ctx->pool;
+    set_info.descriptorSetCount = set_count;
+    set_info.pSetLayouts = set_layouts;
+    if (vkAllocateDescriptorSets(device, &set_info, ctx->sets) != VK_SUCCESS)
+        goto error;
+
+    free(set_layouts);
+    return ctx;
+
+error:
+    free(set_layouts);
+    glsVkDestroyContext(ctx);
+    return NULL;
+}
+
+void glsVkDestroyContext(GLSvkContext* ctx)
+{
+    int i;
+
+    if (!ctx)
+        return;
+    // This frees the descriptor sets, too
+    vkDestroyDescriptorPool(ctx->device, ctx->pool, NULL);
+    for (i = 0; i < GLS_VK_PIPELINES; i++)
+        vkDestroyPipeline(ctx->device, ctx->pipelines[i], NULL);
+    vkDestroyPipelineLayout(ctx->device, ctx->pipeline_layout, NULL);
+    vkDestroyDescriptorSetLayout(ctx->device, ctx->set_layout, NULL);
+    vkDestroySampler(ctx->device, ctx->sampler, NULL);
+    free(ctx->sets);
+    free(ctx->set_views);
+    free(ctx);
+}
+
+
+/*
+ * Set GLS options
+ */
+
+void glsVkSetFramebufferScreenCoords(GLSvkContext* ctx, int32_t x, int32_t y)
+{
+    ctx->screen_x = x;
+    ctx->screen_y = y;
+}
+
+void glsVkSetCrosstalkGhostbusting(GLSvkContext* ctx, float r, float g, float b, float ghostbust)
+{
+    ctx->crosstalk[0] = r;
+    ctx->crosstalk[1] = g;
+    ctx->crosstalk[2] = b;
+    ctx->ghostbust = ghostbust;
+}
+
+
+/*
+ * Composition
+ */
+
+void glsVkBeginFrame(GLSvkContext* ctx, uint32_t frame)
+{
+    frame %= ctx->frames;
+    ctx->frame_sets = ctx->sets + frame * GLS_VK_MAX_VIEW_PAIRS;
+    ctx->frame_set_views = ctx->set_views + frame * GLS_VK_MAX_VIEW_PAIRS;
+    ctx->frame_set_count = 0;
+}
+
+/* Get a descriptor set of the current frame for a pair of views. A set that
+ * was bound since glsVkBeginFrame() may be in use by a command buffer that is
+ * pending execution, so it is never updated for another pair. Returns
+ * VK_NULL_HANDLE if all sets of the frame are in use. */
+static VkDescriptorSet get_descriptor_set(GLSvkContext* ctx, VkImageView left, VkImageView right)
+{
+    VkDescriptorImageInfo images[2];
+    VkWriteDescriptorSet writes[2];
+    int i, set;
+
+    // Reuse a set that this frame already bound for the pair of views
+    for (i = 0; i < ctx->frame_set_count; i++) {
+        if (ctx->frame_set_views[i][0] == left && ctx->frame_set_views[i][1] == right)
+            return ctx->frame_sets[i];
+    }
+    if (ctx->frame_set_count == GLS_VK_MAX_VIEW_PAIRS)
+        return VK_NULL_HANDLE;
+    // The next unused set is only updated if it was last used for another
+    // pair, so that a fixed pair of views costs no updates
+    set = ctx->frame_set_count++;
+    if (ctx->frame_set_views[set][0] == left && ctx->frame_set_views[set][1] == right)
+        return ctx->frame_sets[set];
+    for (i = 0; i < 2; i++) {
+        images[i].sampler = VK_NULL_HANDLE;
+        images[i].imageView = (i == 0 ? left : right);
+        images[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        memset(&writes[i], 0, sizeof(writes[i]));
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = ctx->frame_sets[set];
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[i].pImageInfo = &images[i];
+    }
+    vkUpdateDescriptorSets(ctx->device, 2, writes, 0, NULL);
+    ctx->frame_set_views[set][0] = left;
+    ctx->frame_set_views[set][1] = right;
+    return ctx->frame_sets[set];
+}
+
+static void draw(VkCommandBuffer cmd, VkPipelineLayout layout,
+        float channel, int32_t x, int32_t y, uint32_t w, uint32_t h)
+{
+    VkViewport viewport;
+    VkRect2D scissor;
+
+    viewport.x = x;
+    viewport.y = y;
+    viewport.width = w;
+    viewport.height = h;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    scissor.offset.x = x;
+    scissor.offset.y = y;
+    scissor.extent.width = w;
+    scissor.extent.height = h;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+            offsetof(GLS_vk_parameters, channel), sizeof(float), &channel);
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+VkBool32 glsVkCmdDrawViews(GLSvkContext* ctx, VkCommandBuffer commandBuffer,
+        GLSmode mode, VkBool32 swapViews,
+        VkImageView leftView, VkImageView rightView, const VkRect2D* area)
+{
+    const VkImageView views[2] = { leftView, rightView };
+    const int32_t x = area->offset.x;
+    const int32_t y = area->offset.y;
+    const uint32_t w = area->extent.width;
+    const uint32_t h = area->extent.height;
+    GLS_vk_parameters parameters;
+    VkDescriptorSet set;
+    int left, right;
+    int swap;
+
+    // There is no lens distortion mesh here
+    if (mode == GLS_MODE_HMD)
+        return VK_FALSE;
+    if (w == 0 || h == 0 || (leftView == VK_NULL_HANDLE && rightView == VK_NULL_HANDLE))
+        return VK_TRUE;
+
+    /* Determine left and right view indices */
+    left = (views[0] == VK_NULL_HANDLE ? 1 : 0);
+    right = (left == 0 ? 1 : 0);
+    if (views[right] == VK_NULL_HANDLE)
+        right = left;
+    // The masked shaders put the left view on even framebuffer rows and
+    // columns; swap the views if these are odd on the screen
+    swap = (swapViews != VK_FALSE);
+    if (mode == GLS_MODE_EVEN_ODD_ROWS)
+        swap ^= (ctx->screen_y & 1);
+    else if (mode == GLS_MODE_EVEN_ODD_COLUMNS)
+        swap ^= (ctx->screen_x & 1);
+    else if (mode == GLS_MODE_CHECKERBOARD)
+        swap ^= ((ctx->screen_x + ctx->screen_y) & 1);
+    if (swap) {
+        int tmp = left;
+        left = right;
+        right = tmp;
+    }
+
+    /* Bind the pipeline, the views, and the parameters */
+    set = get_descriptor_set(ctx, views[left], views[right]);
+    if (set == VK_NULL_HANDLE)
+        return VK_FALSE;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            ctx->pipelines[pipeline_index(mode)]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            ctx->pipeline_layout, 0, 1, &set, 0, NULL);
+    parameters.rgb_l_scale[0] = 1.0f;
+    parameters.rgb_l_scale[1] = 1.0f;
+    parameters.rgb_r_scale[0] = 1.0f;
+    parameters.rgb_r_scale[1] = 1.0f;
+    parameters.step_l[0] = 1.0f / w;
+    parameters.step_l[1] = 1.0f / h;
+    parameters.step_r[0] = 1.0f / w;
+    parameters.step_r[1] = 1.0f / h;
+    // The shaders always ghostbust; zero crosstalk disables it
+    parameters.crosstalk[0] = ctx->crosstalk[0] * ctx->ghostbust;
+    parameters.crosstalk[1] = ctx->crosstalk[1] * ctx->ghostbust;
+    parameters.crosstalk[2] = ctx->crosstalk[2] * ctx->ghostbust;
+    parameters.parallax_adjust = 0.0f;
+    parameters.channel = 0.0f;
+    vkCmdPushConstants(commandBuffer, ctx->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+            0, sizeof(parameters), &parameters);
+
+    /* Render */
+    if (mode == GLS_MODE_MONO_LEFT || mode == GLS_MODE_QUAD_BUFFER_STEREO
+            || (mode == GLS_MODE_ALTERNATING && ctx->alternating_counter % 2 == 0)) {
+        draw(commandBuffer, ctx->pipeline_layout, 0.0f, x, y, w, h);
+    } else if (mode == GLS_MODE_MONO_RIGHT
+            || (mode == GLS_MODE_ALTERNATING && ctx->alternating_counter % 2 == 1)) {
+        draw(commandBuffer, ctx->pipeline_layout, 1.0f, x, y, w, h);
+    } else if (mode == GLS_MODE_LEFT_RIGHT) {
+        uint32_t hw = w / 2;
+        draw(commandBuffer, ctx->pipeline_layout, 0.0f, x, y, hw, h);
+        draw(commandBuffer, ctx->pipeline_layout, 1.0f, x + hw, y, w - hw, h);
+    } else if (mode == GLS_MODE_TOP_BOTTOM) {
+        // Vulkan counts lines from the top
+        uint32_t hh = h / 2;
+        draw(commandBuffer, ctx->pipeline_layout, 0.0f, x, y, w, h - hh);
+        draw(commandBuffer, ctx->pipeline_layout, 1.0f, x, y + (h - hh), w, hh);
+    } else if (mode == GLS_MODE_HDMI_FRAME_PACK) {
+        // See glsDrawViews() for the size of the blank area
+        uint32_t blank_lines = h / 49;
+        uint32_t hh = (h - blank_lines) / 2;
+        VkClearAttachment clear;
+        VkClearRect clear_rect;
+        clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        clear.colorAttachment = 0;
+        memset(&clear.clearValue, 0, sizeof(clear.clearValue));
+        clear_rect.rect.offset.x = x;
+        clear_rect.rect.offset.y = y + (h - hh - blank_lines);
+        clear_rect.rect.extent.width = w;
+        clear_rect.rect.extent.height = blank_lines;
+        clear_rect.baseArrayLayer = 0;
+        clear_rect.layerCount = 1;
+        if (blank_lines > 0)
+            vkCmdClearAttachments(commandBuffer, 1, &clear, 1, &clear_rect);
+        draw(commandBuffer, ctx->pipeline_layout, 0.0f, x, y, w, h - hh - blank_lines);
+        draw(commandBuffer, ctx->pipeline_layout, 1.0f, x, y + (h - hh), w, hh);
+    } else {
+        // Masked and anaglyph modes combine both views in one pass
+        VkViewport viewport;
+        viewport.x = x;
+        viewport.y = y;
+        viewport.width = w;
+        viewport.height = h;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, area);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
+    if (mode == GLS_MODE_ALTERNATING)
+        ctx->alternating_counter++;
+    return VK_TRUE;
+}
@@ -0,0 +1,221 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+/**
+ * \file gls-vulkan.h
+ * \brief The libgls-vulkan interface.
+ *
+ * libgls-vulkan composes two views with Vulkan, in the same modes as
+ * glsDrawViews() except \a GLS_MODE_HMD. It records the composition into a
+ * command buffer of the application, inside a render pass that the
+ * application began, so that the views never leave the GPU memory of the
+ * Vulkan renderer.
+ *
+ * Create a context for a subpass and the number of frames in flight, once:
+ * \code
+ * GLSvkContext* vk = glsVkCreateContext(device, renderPass, 0, pipelineCache, 2);
+ * \endcode
+ *
+ * Compose each frame, after waiting for the fence of the frame that last
+ * used the same frame index:
+ * \code
+ * glsVkBeginFrame(vk, frameIndex);
+ * vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+ * glsVkCmdDrawViews(vk, cmd, GLS_MODE_RED_CYAN_DUBOIS, VK_FALSE,
+ *         leftImageView, rightImageView, &beginInfo.renderArea);
+ * vkCmdEndRenderPass(cmd);
+ * \endcode
+ *
+ * Link with libgls-vulkan, for example with the pkg-config file
+ * gls-vulkan.pc. It does not need OpenGL.
+ */
+
+#ifndef GLS_VULKAN_H
+#define GLS_VULKAN_H
+
+#include <vulkan/vulkan.h>
+
+/* GLSmode, without any OpenGL header */
+#include <gls/gls_mode.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief      The GLS Vulkan context.
+ *
+ * See glsVkCreateContext() and glsVkDestroyContext().
+ */
+typedef struct GLS_vk_context GLSvkContext;
+
+/**
+ * \brief               The number of view pairs that can be composed in one frame.
+ *
+ * libgls-vulkan allocates this many descriptor sets for each frame in flight,
+ * and keeps each one for a pair of image views. A descriptor set is only
+ * updated in glsVkCmdDrawViews() after glsVkBeginFrame() for its frame, when
+ * no command buffer that uses it is pending execution anymore.
+ */
+#define GLS_VK_MAX_VIEW_PAIRS 16
+
+/**
+ * \name Vulkan context management
+ */
+
+/*@{*/
+
+/**
+ * \brief               Create a new GLS Vulkan context.
+ * \param device        The Vulkan device.
+ * \param renderPass    The render pass that the composition is recorded in.
+ * \param subpass       The subpass of the render pass.
+ * \param pipelineCache A pipeline cache, or VK_NULL_HANDLE.
+ * \param framesInFlight The number of frames that the application records
+ *                      while the command buffers of earlier frames may still
+ *                      be pending execution, at least 1.
+ * \return              The GLS Vulkan context.
+ *
+ * Creates the pipelines for all modes, through the given pipeline cache, and
+ * the descriptor sets of all frames in flight. The composition can then be
+ * recorded into any render pass that is compatible with \a renderPass. The
+ * subpass must have a single color attachment that is not multisampled; a
+ * depth and stencil attachment is ignored. If something goes wrong, this
+ * function returns a NULL pointer.
+ */
+extern GLS_EXPORT
+GLSvkContext* glsVkCreateContext(VkDevice device,
+        VkRenderPass renderPass, uint32_t subpass, VkPipelineCache pipelineCache,
+        uint32_t framesInFlight);
+
+/**
+ * \brief               Destroy a GLS Vulkan context.
+ * \param ctx           The GLS Vulkan context.
+ *
+ * The device must not use the context anymore, e.g. after vkDeviceWaitIdle().
+ */
+extern GLS_EXPORT
+void glsVkDestroyContext(GLSvkContext* ctx);
+
+/*@}*/
+
+/**
+ * \name Vulkan composition
+ */
+
+/*@{*/
+
+/**
+ * \brief               Begin the compositions of a frame.
+ * \param ctx           The GLS Vulkan context.
+ * \param frame         The index of the frame in flight, from 0 to
+ *                      framesInFlight - 1 (see glsVkCreateContext()).
+ *
+ * Call this before glsVkCmdDrawViews() for each frame, once all command
+ * buffers that were recorded after the last call with the same \a frame have
+ * completed execution, e.g. after waiting for the fence of that frame. The
+ * compositions of the frame then use the descriptor sets of \a frame.
+ */
+extern GLS_EXPORT
+void glsVkBeginFrame(GLSvkContext* ctx, uint32_t frame);
+
+/**
+ * \brief               Set the screen coordinates of the framebuffer.
+ * \param ctx           The GLS Vulkan context.
+ * \param x             The x coordinate of the top left corner.
+ * \param y             The y coordinate of the top left corner.
+ *
+ * The Vulkan counterpart of glsSetViewportScreenCoords(), used by the modes
+ * \a GLS_MODE_EVEN_ODD_ROWS, \a GLS_MODE_EVEN_ODD_COLUMNS, and
+ * \a GLS_MODE_CHECKERBOARD. Unlike in OpenGL, lines are counted from top to
+ * bottom, and the coordinates are those of the framebuffer, not of the
+ * render area: the left view is on the even rows and columns of the
+ * screen, counted from the top left, and on the black fields of a
+ * checkerboard with a black field in the top left corner.
+ */
+extern GLS_EXPORT
+void glsVkSetFramebufferScreenCoords(GLSvkContext* ctx, int32_t x, int32_t y);
+
+/**
+ * \brief               Set crosstalk and ghostbusting levels.
+ * \param ctx           The GLS Vulkan context.
+ * \param r             Red crosstalk level.
+ * \param g             Green crosstalk level.
+ * \param b             Blue crosstalk level.
+ * \param ghostbust     Amount of ghostbusting.
+ *
+ * See glsSetCrosstalkGhostbusting().
+ */
+extern GLS_EXPORT
+void glsVkSetCrosstalkGhostbusting(GLSvkContext* ctx, float r, float g, float b, float ghostbust);
+
+/**
+ * \brief               Record the composition of two views.
+ * \param ctx           The GLS Vulkan context.
+ * \param commandBuffer The command buffer.
+ * \param mode          The stereoscopic display mode.
+ * \param swapViews     Whether to swap left and right view.
+ * \param leftView      The image view of the left view.
+ * \param rightView     The image view of the right view.
+ * \param area          The part of the framebuffer to compose into.
+ * \return              VK_FALSE if the mode is not supported, or if more
+ *                      than \a GLS_VK_MAX_VIEW_PAIRS pairs of views were
+ *                      composed since glsVkBeginFrame().
+ *
+ * Records the composition into \a commandBuffer, which must be inside a
+ * render pass instance of a render pass that is compatible with the one of
+ * glsVkCreateContext(), in its subpass. If a view is not available, its
+ * image view can be VK_NULL_HANDLE; the other one is then used for both
+ * views where the mode needs two. The images must be in the layout
+ * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, and they are sampled over their
+ * full extent. The views are assumed to have the size of \a area, which
+ * determines the filter steps of the masked modes.
+ *
+ * The viewport, the scissor rectangle, the pipeline, the descriptor set, and
+ * the push constants of the command buffer are changed. For
+ * \a GLS_MODE_HDMI_FRAME_PACK, the blank lines are cleared with
+ * vkCmdClearAttachments().
+ *
+ * \a GLS_MODE_QUAD_BUFFER_STEREO composes the left view only. For stereo
+ * swapchains, record one composition per image layer in
+ * \a GLS_MODE_MONO_LEFT and \a GLS_MODE_MONO_RIGHT instead.
+ * \a GLS_MODE_ALTERNATING switches between the views with each call.
+ * \a GLS_MODE_HMD is not supported, since there is no lens distortion mesh;
+ * nothing is recorded for it. Nothing is recorded either if the descriptor
+ * sets of the frame are used up.
+ */
+extern GLS_EXPORT
+VkBool32 glsVkCmdDrawViews(GLSvkContext* ctx, VkCommandBuffer commandBuffer,
+        GLSmode mode, VkBool32 swapViews,
+        VkImageView leftView, VkImageView rightView, const VkRect2D* area);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,45 +24,310 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifndef M_PI
 # define M_PI           3.14159265358979323846  /* pi */
 #endif
 
-#ifndef GLEW_MX
-# define GLEW_MX
+#ifdef _WIN32
+# include <windows.h>
+#endif
+#if GLS_USE_GLES
+/* OpenGL ES builds use EGL instead of GLX, and have no compositor thread,
+ * which needs sync objects */
+# undef GLS_USE_GLX
+# define GLS_USE_GLX 0
+# undef GLS_USE_THREADS
+# define GLS_USE_THREADS 0
+# include <GLES2/gl2.h>
+# include <GLES2/gl2ext.h>
+# include <EGL/egl.h>
+#else
+# include <GL/gl.h>
+# include <GL/glext.h>
 #endif
-#include <GL/glew.h>
 #if GLS_USE_GLX
-# include <GL/glxew.h>
+# include <GL/glx.h>
+# include <GL/glxext.h>
+#elif !defined(_WIN32) && !GLS_USE_GLES
+# include <dlfcn.h>
+#endif
+#ifdef GLS_STUB_GL
+/* Built against the recording OpenGL stub of the profiling harness */
+# include "gls-stub-gl.h"
+#endif
+#if GLS_USE_THREADS
+# include <pthread.h>
+# include <semaphore.h>
+# include <stdatomic.h>
 #endif
 
 #define GLS_BUILD
 #include "gls/gls.h"
 
 #include "gls.glsl.h"
+#include "gls-quad.glsl.h"
+#include "gls-synth.glsl.h"
+#include "gls-reproject.glsl.h"
+
+
+/*
+ * OpenGL ES
+ */
+
+#if GLS_USE_GLES
+/* OpenGL ES 2.0 has none of the optional desktop features that libgls checks
+ * for; the code that needs them is left out with #if !GLS_USE_GLES. It has a
+ * single framebuffer binding point for reading and drawing. */
+# define gl_have(ctx, feature) ((void)(ctx), GL_FALSE)
+# define GL_DRAW_FRAMEBUFFER GL_FRAMEBUFFER
+# define GL_DRAW_FRAMEBUFFER_BINDING GL_FRAMEBUFFER_BINDING
+# define GL_READ_FRAMEBUFFER GL_FRAMEBUFFER
+# define GL_READ_FRAMEBUFFER_BINDING GL_FRAMEBUFFER_BINDING
+#endif
+
+/* Formats of the view and composition textures. Desktop OpenGL stores them in
+ * the order that copies from the framebuffer fastest, OpenGL ES 2.0 only has
+ * RGBA, and no border color. */
+#if GLS_USE_GLES
+# define GLS_RGBA_INTERNAL_FORMAT GL_RGBA
+# define GLS_RGBA_FORMAT GL_RGBA
+# define GLS_RGBA_TYPE GL_UNSIGNED_BYTE
+# define GLS_CLAMP_TO_BORDER GL_CLAMP_TO_EDGE
+# define GLS_LUMINANCE_INTERNAL_FORMAT GL_LUMINANCE
+#else
+# define GLS_RGBA_INTERNAL_FORMAT GL_RGBA8
+# define GLS_RGBA_FORMAT GL_BGRA
+# define GLS_RGBA_TYPE GL_UNSIGNED_INT_8_8_8_8_REV
+# define GLS_CLAMP_TO_BORDER GL_CLAMP_TO_BORDER
+# define GLS_LUMINANCE_INTERNAL_FORMAT GL_LUMINANCE8
+#endif
 
 
 /*
  * Internal Types
  */
 
+/* Everything that influences the result of a composition. All members are
+ * 32 bit wide, so that keys can be compared with memcmp(). */
+typedef struct
+{
+    GLint mode;
+    GLint left;
+    GLint right;
+    GLuint view_tex[2];
+    GLuint view_generation[2];
+    GLint width;
+    GLint height;
+    GLfloat parallax_adjust;
+    GLfloat crosstalk[3];
+    GLfloat ghostbust;
+    GLuint lut_tex[3];
+    GLuint overlay_tex;
+    GLint overlay_alpha_mode;
+    GLfloat overlay_rect[4];
+    GLfloat overlay_disparity;
+} GLS_composition_key;
+
+/* How a composition pipeline draws */
+typedef enum
+{
+    GLS_DRAW_FULL,              /* one pass over the viewport */
+    GLS_DRAW_QUAD_BUFFER,       /* one pass into each back buffer */
+    GLS_DRAW_ALTERNATING,       /* one view per display frame */
+    GLS_DRAW_LEFT_RIGHT,        /* one pass into each half */
+    GLS_DRAW_TOP_BOTTOM,
+    GLS_DRAW_HDMI_FRAME_PACK,
+    GLS_DRAW_HMD                /* the lens distortion mesh into each half */
+} GLS_draw_path;
+
+/* A composition pipeline: what the composition does in a mode, decided once
+ * per mode instead of in each frame. Its program is rebuilt only when the
+ * settings that select the shader variant change. */
+struct GLS_pipeline
+{
+    GLSmode mode;
+    GLboolean swap_views;
+    GLbitfield flags;
+    GLS_draw_path path;
+    GLfloat channel;                    /* for GLS_DRAW_FULL; -1 for two views */
+    GLboolean masked;
+    GLboolean ghostbust_mode;           /* the shader can ghostbust */
+    GLboolean screen_parity_x;          /* views follow the screen columns */
+    GLboolean screen_parity_y;          /* views follow the screen rows */
+    GLuint mask_tex;
+    const char* mode_define;
+    /* The program, the settings it was built for, and its uniforms: */
+    GLuint prg;
+    const char* prg_mode_define;
+    GLint prg_ghostbust;
+    GLboolean prg_upsample;
+    GLint prg_luts;                     /* bit i: lut_tex[i] is used */
+    GLint prg_overlay;                  /* 0, or 1 + overlay_alpha_mode */
+    GLint loc_rgb_scale[2];
+    GLint loc_rgb_size[2];
+    GLint loc_parallax_adjust;
+    GLint loc_crosstalk;
+    GLint loc_channel;
+    GLint loc_step[2];
+    GLint loc_lut_range[3];
+    GLint loc_overlay_rect;
+    GLint loc_overlay_shift;
+    GLint loc_mask_scale;
+};
+
+/* The state that glsBeginView() changes, for glsEndView() to restore. With
+ * desktop OpenGL, the attribute stack holds it instead. */
+typedef struct
+{
+    GLboolean masked;                   /* the stencil test was changed */
+#if GLS_USE_GLES
+    GLint viewport[4];
+    GLint scissor_box[4];
+    GLboolean scissor_test;
+    GLboolean stencil_test;
+    GLint stencil_func;
+    GLint stencil_ref;
+    GLint stencil_value_mask;
+    GLint stencil_fail;
+    GLint stencil_pass_depth_fail;
+    GLint stencil_pass_depth_pass;
+#endif
+} GLS_view_state;
+
+/* Maximum number of frames that can wait for the compositor thread */
+#define GLS_MAX_COMPOSITOR_DEPTH 8
+
+/* Maximum number of view texture pairs that a context cycles through */
+#define GLS_MAX_VIEW_RING 4
+
+/* A pair of view textures while it is not the current one of a context */
+typedef struct
+{
+    GLboolean have_view[2];
+    GLuint view_tex[2];
+    GLint view_tex_width[2];
+    GLint view_tex_height[2];
+    GLint view_tex_alloc_width[2];
+    GLint view_tex_alloc_height[2];
+    GLsync released;            /* the GPU is done reading the textures */
+} GLS_views;
+
+/* A copy of the depth buffer of a view */
+typedef struct
+{
+    GLuint tex;
+    GLenum format;
+    GLint alloc_width;
+    GLint alloc_height;
+} GLS_depth;
+
+/* Largest disparity that view synthesis searches for, relative to the view width */
+#define GLS_SYNTH_MAX_DISPARITY 0.08f
+
+/* Spacing of the vertices of the reprojection grid, in pixels */
+#define GLS_REPROJECT_CELL 2
+
+/* Cells of the lens distortion mesh in each direction of each eye. The
+ * distortion is smooth, so linear interpolation in between is exact enough. */
+#define GLS_HMD_MESH_CELLS 32
+
+/* The last submission of a view, kept for reprojection */
+typedef struct
+{
+    GLboolean valid;
+    GLuint tex;
+    GLint width;
+    GLint height;
+    GLint alloc_width;
+    GLint alloc_height;
+    GLS_depth depth;
+    GLSdouble matrix[16];       /* projection * modelview */
+} GLS_history;
+
+/* Number of frames whose GPU timestamps can be in flight */
+#define GLS_TIMER_FRAMES 4
+
+/* GPU timestamps of a frame: its start, the submissions of the left and the
+ * right view, and the end of the composition */
+typedef struct
+{
+    GLuint queries[4];
+    GLboolean issued[4];
+    GLfloat scale[2];           /* render scales that the frame used */
+} GLS_timer;
+
+/* The dynamic resolution controller aims at this fraction of the frame budget,
+ * and leaves the render scales alone while the GPU time of a frame stays
+ * between the low and the high fraction. */
+#define GLS_DYNRES_TARGET 0.8
+#define GLS_DYNRES_LOW 0.7
+#define GLS_DYNRES_HIGH 0.9
+
+/* Largest increase of a render scale per frame */
+#define GLS_DYNRES_MAX_STEP_UP 1.05
+
+/* Number of pixel buffer objects for uploads from client memory */
+#define GLS_UPLOAD_RING 4
+
+/* A pixel buffer object for uploads from client memory */
+typedef struct
+{
+    GLuint pbo;
+    GLsizeiptr size;
+    GLboolean persistent;       /* created with glBufferStorage() */
+    void* ptr;                  /* mapped memory, or NULL */
+    GLsync fence;               /* the last upload from the buffer is done */
+} GLS_upload;
+
+typedef struct GLS_gl GLS_gl;
+typedef struct GLS_compositor GLS_compositor;
+
 struct GLS_context
 {
-    /* GLEW context: */
-    GLEWContext glewctx;
-#if GLS_USE_GLX
-    GLXEWContext glxewctx;
+#if !GLS_USE_GLES
+    /* OpenGL functions, shared with other contexts on the same driver: */
+    GLS_gl* gl;
+    GLuint gl_checked;                  /* feature groups that were looked up */
+    GLuint gl_available;                /* feature groups that can be used */
 #endif
 
     /* The views: */
     GLboolean have_view[2];
     GLuint view_tex[2];
-    GLint view_tex_width[2];
+    GLint view_tex_width[2];            /* used size */
     GLint view_tex_height[2];
+    GLint view_tex_alloc_width[2];      /* allocated size */
+    GLint view_tex_alloc_height[2];
+    GLuint view_fbo;                    /* for resolving multisampled views */
+    GLint read_fbo;                     /* read framebuffer of the last submission, or -1 */
+    GLint read_fbo_width;               /* viewport size of the last submission */
+    GLint read_fbo_height;
+    GLboolean read_fbo_multisampled;
+    GLuint depth_fbo;                   /* for resolving multisampled depth */
+    GLuint view_generation[2];
+    GLint view_dirty[2][4];     /* x0, y0, x1, y1; changes since last composition */
+    GLboolean view_stale[2];            /* content is older than the last submission */
+    GLsync view_released;               /* the GPU is done reading the views */
+    GLS_views view_ring[GLS_MAX_VIEW_RING - 1];
+    GLint view_ring_size;
+    GLint view_ring_pos;
+
+    /* Uploads from client memory: */
+    GLS_upload upload_ring[GLS_UPLOAD_RING];
+    GLint upload_ring_pos;
+    GLint upload_map_slot[2];           /* mapped by glsMapView(), or -1 */
+    GLint upload_map_width[2];
+    GLint upload_map_height[2];
+    GLenum upload_map_format[2];
+    void* upload_staging[2];            /* without pixel buffer objects */
+    size_t upload_staging_size[2];
 
     /* For masking modes: */
     GLuint even_odd_rows_mask_tex;
@@ -72,7 +337,19 @@ struct GLS_context
     GLint viewport_screen_y;
 
     /* For alternating mode: */
-    GLulong display_frame_counter;
+    unsigned long display_frame_counter;
+
+    /* Frame pacing (GLX_OML_sync_control): */
+#if GLS_USE_GLX
+    GLboolean pacing_valid;
+    GLXDrawable pacing_drawable;
+    int64_t pacing_base_sbc;
+    int64_t pacing_frames;
+    int64_t pacing_last_msc;
+    int64_t pacing_last_sbc;
+#endif
+    GLSframePacingCallback pacing_callback;
+    void* pacing_callback_data;
 
     /* Parallax adjustment: */
     GLfloat parallax_adjust;
@@ -83,19 +360,530 @@ struct GLS_context
     GLfloat crosstalk_b;
     GLfloat ghostbust;
 
-    /* The render program: */
-    GLuint prg;
-    GLSmode prg_mode;
-    GLint prg_ghostbust;
+    /* Color lookup tables of the left view, the right view, and the output: */
+    GLuint lut_tex[3];
+    GLint lut_size[3];
+
+    /* Overlay: */
+    GLuint overlay_tex;
+    GLSalphaMode overlay_alpha_mode;
+    GLfloat overlay_rect[4];
+    GLfloat overlay_disparity;
+
+    /* View synthesis from depth: */
+    GLuint synth_prg;
+    GLS_depth synth_depth;
+    GLfloat synth_near;
+    GLfloat synth_far;
+    GLfloat synth_focal_length;
+    GLfloat synth_disparity_factor;     /* near * eye separation / frustum width */
+
+    /* Reprojection of late views in alternating mode: */
+    GLboolean reproj_enabled;
+    GLSdouble view_matrix[2][16];       /* projection * modelview of each view */
+    GLS_history history[2];
+    GLuint reproj_prg;
+    GLuint reproj_grid_vbo;
+    GLuint reproj_grid_ibo;
+    GLint reproj_grid_width;            /* view size that the grid is for */
+    GLint reproj_grid_height;
+    GLsizei reproj_grid_indices;
+    GLuint reproj_tex;
+    GLint reproj_tex_width;
+    GLint reproj_tex_height;
+    GLint reproj_tex_alloc_width;
+    GLint reproj_tex_alloc_height;
+    GLuint reproj_depth_rb;
+    GLuint reproj_fbo;
 
-    /* For DLP 3D Ready Sync: */
-    unsigned int* dlp_3d_ready_sync_buf;
-    size_t dlp_3d_ready_sync_buf_size;
+    /* Dynamic resolution: */
+    GLfloat dynres_budget;              /* GPU time per frame in seconds, or 0 */
+    GLfloat dynres_min_scale;
+    GLfloat dynres_scale[2];            /* recommended render scale of each view */
+    GLS_timer timer[GLS_TIMER_FRAMES];
+    GLint timer_pos;                    /* timestamps of the current frame, or -1 */
+    GLboolean upsample;                 /* compose with bicubic upsampling */
+
+    /* Asymmetric resolution: */
+    GLSview asym_view;                  /* the reduced view */
+    GLfloat asym_scale;                 /* its render scale, or 1 */
+    GLint asym_period;                  /* frames until the reduced view alternates, or 0 */
+    GLuint asym_frame;
+
+    /* The pipeline of glsDrawViews(), for the mode of the last call: */
+    GLSpipeline draw_pipeline;
+
+    /* Head-mounted display mode: */
+    GLfloat hmd_distortion[4];          /* k0 + k1 r^2 + k2 r^4 + k3 r^6 */
+    GLfloat hmd_chromatic_aberration[2]; /* red and blue scale */
+    GLfloat hmd_lens_offset;
+    GLuint hmd_mesh_vbo;
+    GLuint hmd_mesh_ibo;
+    GLint hmd_mesh_width;               /* viewport size that the mesh is for */
+    GLint hmd_mesh_height;
+
+    /* Direct rendering with glsBeginView(): */
+    GLuint view_stencil_bit;            /* for the masked modes, or 0 */
+    GLSpipeline stencil_pipeline;       /* writes the masks into the stencil buffer */
+    GLboolean view_begun;
+    GLS_view_state view_state_bak;
+#if GLS_USE_GLES
+    GLuint quad_vbo;                    /* the vertices of draw_quad() */
+    PFNGLDISCARDFRAMEBUFFEREXTPROC discard_framebuffer; /* or NULL */
+#endif
+
+    /* Composition cache: */
+    GLboolean cache_enabled;
+    GLboolean cache_valid;
+    GLS_composition_key cache_key;
+    GLuint cache_tex;
+    GLuint cache_fbo;
+    GLint cache_tex_alloc_width;
+    GLint cache_tex_alloc_height;
+
+    /* Tracing and debugging: */
+    GLboolean debug_labels;             /* GL_KHR_debug groups and labels */
+    GLStraceCallback trace_callback;
+    void* trace_callback_data;
+    FILE* trace_file;                   /* Chrome trace event format */
+    unsigned long trace_events;
+
+    /* Asynchronous composition: */
+    GLS_compositor* compositor;
+    GLint compositor_depth;
+    GLboolean compositor_latest_only;
+};
+
+#if GLS_USE_THREADS
+/* A frame on its way to the compositor thread: the view textures, and
+ * everything needed to compose them. */
+typedef struct
+{
+    GLS_views views;            /* released: the compositor is done with them */
+    GLsync ready;               /* the views are complete */
+    GLSmode mode;
+    GLboolean swap_views;
+    GLboolean dlp_marker;
+    GLSmode dlp_mode;
+    GLint viewport[4];
+    GLint viewport_screen[2];
+    GLfloat parallax_adjust;
+    GLfloat crosstalk[3];
+    GLfloat ghostbust;
+    GLboolean upsample;
+    GLuint lut_tex[3];
+    GLint lut_size[3];
+    GLuint overlay_tex;
+    GLSalphaMode overlay_alpha_mode;
+    GLfloat overlay_rect[4];
+    GLfloat overlay_disparity;
+} GLS_frame;
+
+typedef struct
+{
+    GLint frames[GLS_MAX_COMPOSITOR_DEPTH + 1];
+    atomic_uint head;           /* written only by the producer */
+    atomic_uint tail;           /* written only by the consumer */
+} GLS_queue;
+
+struct GLS_compositor
+{
+    GLScontext* ctx;            /* the application's context */
+    GLScontext* comp;           /* the compositor thread's context */
+    GLSmakeCurrentCallback make_current;
+    GLSswapBuffersCallback swap_buffers;
+    void* user_data;
+    GLboolean latest_only;
+    pthread_t thread;
+    atomic_int stop;
+    sem_t started;
+    GLS_frame frames[GLS_MAX_COMPOSITOR_DEPTH + 1];
+    GLint frame_count;
+    GLS_queue free_queue;       /* application thread <- compositor thread */
+    sem_t free_count;
+    GLS_queue filled_queue;     /* application thread -> compositor thread */
+    sem_t filled_count;
+    GLboolean dlp_marker;       /* requested for the next frame */
+    GLSmode dlp_mode;
+};
+#endif
+
+
+/*
+ * OpenGL function loader
+ */
+
+#if !GLS_USE_GLES
+/* libgls resolves only the OpenGL functions that it uses, one feature group
+ * at a time when the group is first needed. The functions belong to the
+ * OpenGL implementation, not to an OpenGL context, so all contexts on the same
+ * driver share one table. Functions of OpenGL 1.1 are called directly. */
+
+typedef void (*GLS_gl_proc)(void);
+
+#ifndef GLS_GL_GET_PROC_ADDRESS
+# if GLS_USE_GLX
+#  define GLS_GL_GET_PROC_ADDRESS(name) glXGetProcAddressARB((const GLubyte*)(name))
+# elif defined(_WIN32)
+#  define GLS_GL_GET_PROC_ADDRESS(name) ((GLS_gl_proc)wglGetProcAddress(name))
+# else
+#  define GLS_GL_GET_PROC_ADDRESS(name) ((GLS_gl_proc)dlsym(RTLD_DEFAULT, (name)))
+# endif
+#endif
+
+/* Feature groups */
+enum
+{
+    GLS_GL_CORE,                        /* OpenGL 2.0 */
+    GLS_GL_PIXEL_BUFFER_OBJECT,
+    GLS_GL_FRAMEBUFFER_OBJECT,
+    GLS_GL_SYNC,
+    GLS_GL_TIMER_QUERY,
+    GLS_GL_DEBUG,
+    GLS_GL_BUFFER_STORAGE,
+    GLS_GL_GLX_OML_SYNC_CONTROL,
+    GLS_GL_GLX_SGI_VIDEO_SYNC,
+    GLS_GL_FEATURES
+};
+
+/* The OpenGL version that a feature group is core in, and the extension that
+ * provides it otherwise */
+static const struct
+{
+    GLint version;                      /* major * 10 + minor, or 0 */
+    const char* extension;
+} gl_features[GLS_GL_FEATURES] =
+{
+    { 20, NULL },
+    { 21, "GL_ARB_pixel_buffer_object" },
+    { 30, "GL_ARB_framebuffer_object" },
+    { 32, "GL_ARB_sync" },
+    { 33, "GL_ARB_timer_query" },
+    { 43, "GL_KHR_debug" },
+    { 44, "GL_ARB_buffer_storage" },
+    { 0, "GLX_OML_sync_control" },
+    { 0, "GLX_SGI_video_sync" }
+};
+
+/* The functions of each feature group */
+#define GLS_GL_FUNCTIONS(F) \
+    F(CORE, glActiveTexture) \
+    F(CORE, glAttachShader) \
+    F(CORE, glBindBuffer) \
+    F(CORE, glBufferData) \
+    F(CORE, glClientActiveTexture) \
+    F(CORE, glCompileShader) \
+    F(CORE, glCreateProgram) \
+    F(CORE, glCreateShader) \
+    F(CORE, glDeleteBuffers) \
+    F(CORE, glDeleteProgram) \
+    F(CORE, glDeleteQueries) \
+    F(CORE, glDeleteShader) \
+    F(CORE, glGenBuffers) \
+    F(CORE, glGenQueries) \
+    F(CORE, glGetAttachedShaders) \
+    F(CORE, glGetProgramInfoLog) \
+    F(CORE, glGetProgramiv) \
+    F(CORE, glGetQueryObjectiv) \
+    F(CORE, glGetShaderInfoLog) \
+    F(CORE, glGetShaderiv) \
+    F(CORE, glGetUniformLocation) \
+    F(CORE, glIsProgram) \
+    F(CORE, glLinkProgram) \
+    F(CORE, glMapBuffer) \
+    F(CORE, glMultiTexCoord2f) \
+    F(CORE, glShaderSource) \
+    F(CORE, glUniform1f) \
+    F(CORE, glUniform1i) \
+    F(CORE, glUniform2f) \
+    F(CORE, glUniform3f) \
+    F(CORE, glUniform4f) \
+    F(CORE, glUniformMatrix4fv) \
+    F(CORE, glUnmapBuffer) \
+    F(CORE, glUseProgram) \
+    F(FRAMEBUFFER_OBJECT, glBindFramebuffer) \
+    F(FRAMEBUFFER_OBJECT, glBindRenderbuffer) \
+    F(FRAMEBUFFER_OBJECT, glBlitFramebuffer) \
+    F(FRAMEBUFFER_OBJECT, glDeleteFramebuffers) \
+    F(FRAMEBUFFER_OBJECT, glDeleteRenderbuffers) \
+    F(FRAMEBUFFER_OBJECT, glFramebufferRenderbuffer) \
+    F(FRAMEBUFFER_OBJECT, glFramebufferTexture2D) \
+    F(FRAMEBUFFER_OBJECT, glGenFramebuffers) \
+    F(FRAMEBUFFER_OBJECT, glGenRenderbuffers) \
+    F(FRAMEBUFFER_OBJECT, glRenderbufferStorage) \
+    F(SYNC, glClientWaitSync) \
+    F(SYNC, glDeleteSync) \
+    F(SYNC, glFenceSync) \
+    F(SYNC, glWaitSync) \
+    F(TIMER_QUERY, glGetQueryObjectui64v) \
+    F(TIMER_QUERY, glQueryCounter) \
+    F(DEBUG, glObjectLabel) \
+    F(DEBUG, glPopDebugGroup) \
+    F(DEBUG, glPushDebugGroup) \
+    F(BUFFER_STORAGE, glBufferStorage) \
+    F(BUFFER_STORAGE, glMapBufferRange) \
+    GLS_GLX_FUNCTIONS(F)
+#if GLS_USE_GLX
+# define GLS_GLX_FUNCTIONS(F) \
+    F(GLX_OML_SYNC_CONTROL, glXGetSyncValuesOML) \
+    F(GLX_SGI_VIDEO_SYNC, glXGetVideoSyncSGI)
+#else
+# define GLS_GLX_FUNCTIONS(F)
+#endif
+
+enum
+{
+#define GLS_GL_FUNCTION(feature, name) GLS_GL_##name,
+    GLS_GL_FUNCTIONS(GLS_GL_FUNCTION)
+#undef GLS_GL_FUNCTION
+    GLS_GL_FUNCTION_COUNT
+};
+
+static const struct
+{
+    GLint feature;
+    const char* name;
+} gl_functions[GLS_GL_FUNCTION_COUNT] =
+{
+#define GLS_GL_FUNCTION(feature, name) { GLS_GL_##feature, #name },
+    GLS_GL_FUNCTIONS(GLS_GL_FUNCTION)
+#undef GLS_GL_FUNCTION
+};
+
+/* The function table of one driver */
+struct GLS_gl
+{
+    GLS_gl* next;
+    int refs;
+    char* driver;                       /* vendor, renderer, and version */
+    GLint version;                      /* major * 10 + minor */
+    GLuint checked;                     /* feature groups that were looked up */
+    GLuint available;                   /* feature groups that can be used */
+    GLS_gl_proc functions[GLS_GL_FUNCTION_COUNT];
 };
 
-#define glewGetContext() (&(ctx->glewctx))
+static GLS_gl* gl_tables = NULL;
+#if GLS_USE_THREADS
+static pthread_mutex_t gl_tables_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void gl_lock(void)
+{
+#if GLS_USE_THREADS
+    pthread_mutex_lock(&gl_tables_mutex);
+#endif
+}
+
+static void gl_unlock(void)
+{
+#if GLS_USE_THREADS
+    pthread_mutex_unlock(&gl_tables_mutex);
+#endif
+}
+
+/* Whether a space-separated list contains the given word */
+static GLboolean list_contains(const char* list, const char* word)
+{
+    size_t len = strlen(word);
+    const char* p = list;
+
+    while (p && (p = strstr(p, word))) {
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+            return GL_TRUE;
+        p += len;
+    }
+    return GL_FALSE;
+}
+
+static GLboolean gl_extension(const GLS_gl* gl, const char* extension)
+{
+    if (strncmp(extension, "GLX_", 4) == 0) {
+#if GLS_USE_GLX
+        Display* dpy = glXGetCurrentDisplay();
+        return (dpy && list_contains(glXQueryExtensionsString(dpy, DefaultScreen(dpy)), extension));
+#else
+        return GL_FALSE;
+#endif
+    } else if (gl->version >= 30) {
+        // Core profiles have no extension string, only a list
+        PFNGLGETSTRINGIPROC get_stringi = (PFNGLGETSTRINGIPROC)
+            GLS_GL_GET_PROC_ADDRESS("glGetStringi");
+        GLint n = 0;
+        GLint i;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (i = 0; get_stringi && i < n; i++) {
+            const char* e = (const char*)get_stringi(GL_EXTENSIONS, i);
+            if (e && strcmp(e, extension) == 0)
+                return GL_TRUE;
+        }
+        return GL_FALSE;
+    } else {
+        return list_contains((const char*)glGetString(GL_EXTENSIONS), extension);
+    }
+}
+
+/* Look up the functions of a feature group. Called with the lock held. */
+static GLboolean gl_resolve(GLS_gl* gl, GLint feature)
+{
+    GLint i;
+
+    // Many implementations return stubs for unsupported functions, so the
+    // version and extensions decide, not the function pointers alone.
+    if (!((gl_features[feature].version > 0 && gl->version >= gl_features[feature].version)
+                || (gl_features[feature].extension
+                    && gl_extension(gl, gl_features[feature].extension))))
+        return GL_FALSE;
+    for (i = 0; i < GLS_GL_FUNCTION_COUNT; i++) {
+        if (gl_functions[i].feature == feature) {
+            gl->functions[i] = GLS_GL_GET_PROC_ADDRESS(gl_functions[i].name);
+            if (!gl->functions[i])
+                return GL_FALSE;
+        }
+    }
+    return GL_TRUE;
+}
+
+/* Get the function table for the driver of the current OpenGL context */
+static GLS_gl* gl_acquire(void)
+{
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    char* driver;
+    GLS_gl* gl;
+    GLint major = 0, minor = 0;
+
+    if (!vendor || !renderer || !version)
+        return NULL;
+    driver = malloc(strlen(vendor) + strlen(renderer) + strlen(version) + 3);
+    if (!driver)
+        return NULL;
+    sprintf(driver, "%s\n%s\n%s", vendor, renderer, version);
+    gl_lock();
+    for (gl = gl_tables; gl; gl = gl->next)
+        if (strcmp(gl->driver, driver) == 0)
+            break;
+    if (gl) {
+        free(driver);
+        gl->refs++;
+    } else if ((gl = malloc(sizeof(GLS_gl)))) {
+        sscanf(version, "%d.%d", &major, &minor);
+        gl->next = gl_tables;
+        gl->refs = 1;
+        gl->driver = driver;
+        gl->version = major * 10 + minor;
+        gl->checked = 0;
+        gl->available = 0;
+        memset(gl->functions, 0, sizeof(gl->functions));
+        gl_tables = gl;
+    } else {
+        free(driver);
+    }
+    gl_unlock();
+    return gl;
+}
+
+static void gl_release(GLS_gl* gl)
+{
+    GLS_gl** p;
+
+    gl_lock();
+    if (--gl->refs == 0) {
+        for (p = &gl_tables; *p != gl; p = &(*p)->next)
+            ;
+        *p = gl->next;
+        free(gl->driver);
+        free(gl);
+    }
+    gl_unlock();
+}
+
+/* Whether a feature group can be used. The answer is cached in the context,
+ * so that only the first check of each group takes the lock. */
+static GLboolean gl_have(GLScontext* ctx, GLint feature)
+{
+    const GLuint bit = 1u << feature;
+
+    if (!(ctx->gl_checked & bit)) {
+        gl_lock();
+        if (!(ctx->gl->checked & bit)) {
+            if (gl_resolve(ctx->gl, feature))
+                ctx->gl->available |= bit;
+            ctx->gl->checked |= bit;
+        }
+        ctx->gl_available |= (ctx->gl->available & bit);
+        gl_unlock();
+        ctx->gl_checked |= bit;
+    }
+    return (ctx->gl_available & bit ? GL_TRUE : GL_FALSE);
+}
+
+/* Mesa's gl.h covers OpenGL 1.3 but lacks some of its function types, and
+ * then glext.h skips them */
+typedef void (APIENTRYP GLS_PFNGLCLIENTACTIVETEXTUREPROC)(GLenum texture);
+typedef void (APIENTRYP GLS_PFNGLMULTITEXCOORD2FPROC)(GLenum target, GLfloat s, GLfloat t);
+
+/* Calls go through the table of the context, like with GLEW MX */
+#define GLS_GL(type, name) ((type)ctx->gl->functions[GLS_GL_##name])
+#define glActiveTexture GLS_GL(PFNGLACTIVETEXTUREPROC, glActiveTexture)
+#define glAttachShader GLS_GL(PFNGLATTACHSHADERPROC, glAttachShader)
+#define glBindBuffer GLS_GL(PFNGLBINDBUFFERPROC, glBindBuffer)
+#define glBufferData GLS_GL(PFNGLBUFFERDATAPROC, glBufferData)
+#define glClientActiveTexture GLS_GL(GLS_PFNGLCLIENTACTIVETEXTUREPROC, glClientActiveTexture)
+#define glCompileShader GLS_GL(PFNGLCOMPILESHADERPROC, glCompileShader)
+#define glCreateProgram GLS_GL(PFNGLCREATEPROGRAMPROC, glCreateProgram)
+#define glCreateShader GLS_GL(PFNGLCREATESHADERPROC, glCreateShader)
+#define glDeleteBuffers GLS_GL(PFNGLDELETEBUFFERSPROC, glDeleteBuffers)
+#define glDeleteProgram GLS_GL(PFNGLDELETEPROGRAMPROC, glDeleteProgram)
+#define glDeleteQueries GLS_GL(PFNGLDELETEQUERIESPROC, glDeleteQueries)
+#define glDeleteShader GLS_GL(PFNGLDELETESHADERPROC, glDeleteShader)
+#define glGenBuffers GLS_GL(PFNGLGENBUFFERSPROC, glGenBuffers)
+#define glGenQueries GLS_GL(PFNGLGENQUERIESPROC, glGenQueries)
+#define glGetAttachedShaders GLS_GL(PFNGLGETATTACHEDSHADERSPROC, glGetAttachedShaders)
+#define glGetProgramInfoLog GLS_GL(PFNGLGETPROGRAMINFOLOGPROC, glGetProgramInfoLog)
+#define glGetProgramiv GLS_GL(PFNGLGETPROGRAMIVPROC, glGetProgramiv)
+#define glGetQueryObjectiv GLS_GL(PFNGLGETQUERYOBJECTIVPROC, glGetQueryObjectiv)
+#define glGetShaderInfoLog GLS_GL(PFNGLGETSHADERINFOLOGPROC, glGetShaderInfoLog)
+#define glGetShaderiv GLS_GL(PFNGLGETSHADERIVPROC, glGetShaderiv)
+#define glGetUniformLocation GLS_GL(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation)
+#define glIsProgram GLS_GL(PFNGLISPROGRAMPROC, glIsProgram)
+#define glLinkProgram GLS_GL(PFNGLLINKPROGRAMPROC, glLinkProgram)
+#define glMapBuffer GLS_GL(PFNGLMAPBUFFERPROC, glMapBuffer)
+#define glMultiTexCoord2f GLS_GL(GLS_PFNGLMULTITEXCOORD2FPROC, glMultiTexCoord2f)
+#define glShaderSource GLS_GL(PFNGLSHADERSOURCEPROC, glShaderSource)
+#define glUniform1f GLS_GL(PFNGLUNIFORM1FPROC, glUniform1f)
+#define glUniform1i GLS_GL(PFNGLUNIFORM1IPROC, glUniform1i)
+#define glUniform2f GLS_GL(PFNGLUNIFORM2FPROC, glUniform2f)
+#define glUniform3f GLS_GL(PFNGLUNIFORM3FPROC, glUniform3f)
+#define glUniform4f GLS_GL(PFNGLUNIFORM4FPROC, glUniform4f)
+#define glUniformMatrix4fv GLS_GL(PFNGLUNIFORMMATRIX4FVPROC, glUniformMatrix4fv)
+#define glUnmapBuffer GLS_GL(PFNGLUNMAPBUFFERPROC, glUnmapBuffer)
+#define glUseProgram GLS_GL(PFNGLUSEPROGRAMPROC, glUseProgram)
+#define glBindFramebuffer GLS_GL(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer)
+#define glBindRenderbuffer GLS_GL(PFNGLBINDRENDERBUFFERPROC, glBindRenderbuffer)
+#define glBlitFramebuffer GLS_GL(PFNGLBLITFRAMEBUFFERPROC, glBlitFramebuffer)
+#define glDeleteFramebuffers GLS_GL(PFNGLDELETEFRAMEBUFFERSPROC, glDeleteFramebuffers)
+#define glDeleteRenderbuffers GLS_GL(PFNGLDELETERENDERBUFFERSPROC, glDeleteRenderbuffers)
+#define glFramebufferRenderbuffer GLS_GL(PFNGLFRAMEBUFFERRENDERBUFFERPROC, glFramebufferRenderbuffer)
+#define glFramebufferTexture2D GLS_GL(PFNGLFRAMEBUFFERTEXTURE2DPROC, glFramebufferTexture2D)
+#define glGenFramebuffers GLS_GL(PFNGLGENFRAMEBUFFERSPROC, glGenFramebuffers)
+#define glGenRenderbuffers GLS_GL(PFNGLGENRENDERBUFFERSPROC, glGenRenderbuffers)
+#define glRenderbufferStorage GLS_GL(PFNGLRENDERBUFFERSTORAGEPROC, glRenderbufferStorage)
+#define glClientWaitSync GLS_GL(PFNGLCLIENTWAITSYNCPROC, glClientWaitSync)
+#define glDeleteSync GLS_GL(PFNGLDELETESYNCPROC, glDeleteSync)
+#define glFenceSync GLS_GL(PFNGLFENCESYNCPROC, glFenceSync)
+#define glWaitSync GLS_GL(PFNGLWAITSYNCPROC, glWaitSync)
+#define glGetQueryObjectui64v GLS_GL(PFNGLGETQUERYOBJECTUI64VPROC, glGetQueryObjectui64v)
+#define glQueryCounter GLS_GL(PFNGLQUERYCOUNTERPROC, glQueryCounter)
+#define glObjectLabel GLS_GL(PFNGLOBJECTLABELPROC, glObjectLabel)
+#define glPopDebugGroup GLS_GL(PFNGLPOPDEBUGGROUPPROC, glPopDebugGroup)
+#define glPushDebugGroup GLS_GL(PFNGLPUSHDEBUGGROUPPROC, glPushDebugGroup)
+#define glBufferStorage GLS_GL(PFNGLBUFFERSTORAGEPROC, glBufferStorage)
+#define glMapBufferRange GLS_GL(PFNGLMAPBUFFERRANGEPROC, glMapBufferRange)
 #if GLS_USE_GLX
-# define glxewGetContext() (&(ctx->glxewctx))
+# define glXGetSyncValuesOML GLS_GL(PFNGLXGETSYNCVALUESOMLPROC, glXGetSyncValuesOML)
+# define glXGetVideoSyncSGI GLS_GL(PFNGLXGETVIDEOSYNCSGIPROC, glXGetVideoSyncSGI)
+#endif
 #endif
 
 
@@ -159,15 +947,28 @@ static void kill_crlf(char* str)
         str[l - 1] = '\0';
 }
 
-static GLuint compile_fragment_shader(GLScontext* ctx, const char* src)
+static GLuint compile_shader(GLScontext* ctx, GLenum type, const char* src)
 {
     char* log = NULL;
     GLint e, l;
     GLuint shader;
+#if GLS_USE_GLES
+    // The shaders are written in GLSL 1.10, which differs from GLSL ES 1.00
+    // only in the version line and in what the shaders handle with GL_ES.
+    char* es_src = strdup(src);
+    (void)ctx;
+    if (!es_src)
+        oom_abort();
+    str_replace(&es_src, "#version 110", "#version 100");
+    src = es_src;
+#endif
 
-    shader = glCreateShader(GL_FRAGMENT_SHADER);
+    shader = glCreateShader(type);
     glShaderSource(shader, 1, (const GLchar**)(&src), NULL);
     glCompileShader(shader);
+#if GLS_USE_GLES
+    free(es_src);
+#endif
     glGetShaderiv(shader, GL_COMPILE_STATUS, &e);
     glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &l);
     if (l > 0) {
@@ -200,6 +1001,7 @@ static void link_program(GLScontext* ctx, GLuint prg)
     char* log = NULL;
     GLint e, l;
 
+    (void)ctx;
     glLinkProgram(prg);
     glGetProgramiv(prg, GL_LINK_STATUS, &e);
     glGetProgramiv(prg, GL_INFO_LOG_LENGTH, &l);
@@ -227,7 +1029,30 @@ static void link_program(GLScontext* ctx, GLuint prg)
     free(log);
 }
 
-static void draw_quad(GLScontext* ctx, GLint viewport_width, GLint viewport_height)
+#if GLS_USE_GLES
+/* Draw the full-viewport quad with the vertex shader gls-quad.glsl, which is
+ * part of the composition program, with its mask_scale uniform at the given
+ * location. The vertices live in a buffer object, so that nothing is
+ * transferred per draw. */
+static void draw_quad(GLScontext* ctx, GLint mask_scale, GLint viewport_width, GLint viewport_height)
+{
+    static const GLfloat vertices[4][2] = {
+        { -1.0f, -1.0f }, { 1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }
+    };
+    if (ctx->quad_vbo == 0) {
+        glGenBuffers(1, &ctx->quad_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, ctx->quad_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, ctx->quad_vbo);
+    }
+    glUniform2f(mask_scale, viewport_width / 2.0f, viewport_height / 2.0f);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+#else
+static void draw_quad(GLScontext* ctx, GLint mask_scale, GLint viewport_width, GLint viewport_height)
 {
     const float x = -1.0f;
     const float y = -1.0f;
@@ -245,6 +1070,7 @@ static void draw_quad(GLScontext* ctx, GLint viewport_width, GLint viewport_heig
         { viewport_width / 2.0f, viewport_height / 2.0f },
         { 0.0f, viewport_height / 2.0f }
     };
+    (void)mask_scale;   // the mask coordinates are texture coordinates here
     glBegin(GL_QUADS);
     glTexCoord2f(tex_coords0[0][0], tex_coords0[0][1]);
     glMultiTexCoord2f(GL_TEXTURE1, tex_coords1[0][0], tex_coords1[0][1]);
@@ -264,297 +1090,3302 @@ static void draw_quad(GLScontext* ctx, GLint viewport_width, GLint viewport_heig
     glVertex2f(x, y + h);
     glEnd();
 }
+#endif
 
-static void crossproduct(
-        GLfloat ax, GLfloat ay, GLfloat az,
-        GLfloat bx, GLfloat by, GLfloat bz,
-        GLfloat *cx, GLfloat *cy, GLfloat *cz)
+/* Texture sizes are rounded up to coarse buckets with some headroom, so that
+ * textures can be reused while the viewport size changes. */
+static GLint pool_size(GLint size)
 {
-    *cx = ay * bz - az * by;
-    *cy = az * bx - ax * bz;
-    *cz = ax * by - ay * bx;
+    return (size + size / 8 + 127) / 128 * 128;
 }
 
-
-/*
- * Manage contexts
- */
-
-GLScontext* glsCreateContext()
+static void view_tex_scale(GLScontext* ctx, GLuint tex, GLfloat scale[2])
 {
-    GLScontext* ctx = malloc(sizeof(GLScontext));
-    if (ctx) {
-        glewInit();
-#if GLS_USE_GLX
-        glxewInit();
-#endif
-        ctx->have_view[0] = GL_FALSE;
-        ctx->have_view[1] = GL_FALSE;
-        ctx->view_tex[0] = 0;
-        ctx->view_tex[1] = 0;
-        ctx->even_odd_rows_mask_tex = 0;
-        ctx->even_odd_columns_mask_tex = 0;
-        ctx->checkerboard_mask_tex = 0;
-        ctx->viewport_screen_x = 0;
-        ctx->viewport_screen_y = 0;
-        ctx->display_frame_counter = 0;
-        ctx->parallax_adjust = 0.0f;
-        ctx->crosstalk_r = 0.0f;
-        ctx->crosstalk_g = 0.0f;
-        ctx->crosstalk_b = 0.0f;
-        ctx->ghostbust = 0.0f;
-        ctx->prg = 0;
-        ctx->dlp_3d_ready_sync_buf = NULL;
-        ctx->dlp_3d_ready_sync_buf_size = 0;
+    int i;
+    scale[0] = 1.0f;
+    scale[1] = 1.0f;
+    for (i = 0; i < 2; i++) {
+        if (tex != 0 && tex == ctx->view_tex[i]) {
+            scale[0] = (GLfloat)ctx->view_tex_width[i] / ctx->view_tex_alloc_width[i];
+            scale[1] = (GLfloat)ctx->view_tex_height[i] / ctx->view_tex_alloc_height[i];
+        }
+    }
+    if (tex != 0 && tex == ctx->reproj_tex) {
+        scale[0] = (GLfloat)ctx->reproj_tex_width / ctx->reproj_tex_alloc_width;
+        scale[1] = (GLfloat)ctx->reproj_tex_height / ctx->reproj_tex_alloc_height;
     }
-    return ctx;
 }
 
-void glsDestroyContext(GLScontext* ctx)
+/* Get the allocated size of a view texture in texels. Foreign textures must
+ * be bound to GL_TEXTURE_2D. */
+static void view_tex_size(GLScontext* ctx, GLuint tex, const GLint* viewport, GLfloat size[2])
 {
-    if (ctx) {
-        glDeleteTextures(2, ctx->view_tex);
-        glDeleteTextures(1, &ctx->even_odd_rows_mask_tex);
-        glDeleteTextures(1, &ctx->even_odd_columns_mask_tex);
-        glDeleteTextures(1, &ctx->checkerboard_mask_tex);
-        if (glIsProgram(ctx->prg)) {
-            GLint shader_count;
-            glGetProgramiv(ctx->prg, GL_ATTACHED_SHADERS, &shader_count);
-            if (shader_count > 0) {
-                GLint i;
-                GLuint *shaders = malloc(shader_count * sizeof(GLuint));
-                if (!shaders)
-                    oom_abort();
-                glGetAttachedShaders(ctx->prg, shader_count, NULL, shaders);
-                for (i = 0; i < shader_count; i++)
-                    glDeleteShader(shaders[i]);
-                free(shaders);
-            }
-            glDeleteProgram(ctx->prg);
+    GLint w = 0, h = 0;
+    int i;
+    for (i = 0; i < 2; i++) {
+        if (tex != 0 && tex == ctx->view_tex[i]) {
+            w = ctx->view_tex_alloc_width[i];
+            h = ctx->view_tex_alloc_height[i];
         }
-        free(ctx->dlp_3d_ready_sync_buf);
-        free(ctx);
     }
+    if (tex != 0 && tex == ctx->reproj_tex) {
+        w = ctx->reproj_tex_alloc_width;
+        h = ctx->reproj_tex_alloc_height;
+    }
+    if (w == 0) {
+#if GLS_USE_GLES
+        // OpenGL ES 2.0 cannot query the size of a texture. Assume that the
+        // application renders its views at the size of the viewport.
+        w = viewport[2];
+        h = viewport[3];
+#else
+        (void)viewport;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+#endif
+    }
+    size[0] = (w > 0 ? w : 1);
+    size[1] = (h > 0 ? h : 1);
 }
 
+/* Microseconds from a monotonic clock, for trace files */
+static double trace_timestamp()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart * 1e6 / frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+#endif
+}
 
-/**
- * Set GLS options
- */
-
-void glsSetViewportScreenCoords(GLScontext* ctx, GLint x, GLint y)
+static void trace_write(GLScontext* ctx, const char* name, char phase)
 {
-    ctx->viewport_screen_x = x;
-    ctx->viewport_screen_y = y;
+    fprintf(ctx->trace_file,
+            "%s\n{\"name\":\"%s\",\"cat\":\"gls\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1}",
+            ctx->trace_events > 0 ? "," : "", name, phase, trace_timestamp());
+    ctx->trace_events++;
 }
 
-void glsSetCrosstalkGhostbusting(GLScontext* ctx,
-        GLfloat r, GLfloat g, GLfloat b, GLfloat ghostbust)
+/* Mark the beginning and end of a piece of work, for the trace callback and
+ * file and as a GL_KHR_debug group. Names must be string literals. */
+static void trace_begin(GLScontext* ctx, const char* name)
 {
-    ctx->crosstalk_r = r;
-    ctx->crosstalk_g = g;
-    ctx->crosstalk_b = b;
-    ctx->ghostbust = ghostbust;
+    if (ctx->trace_file)
+        trace_write(ctx, name, 'B');
+    if (ctx->trace_callback)
+        ctx->trace_callback(ctx, name, GL_TRUE, ctx->trace_callback_data);
+#if !GLS_USE_GLES
+    if (ctx->debug_labels)
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+#endif
 }
 
+static void trace_end(GLScontext* ctx, const char* name)
+{
+#if !GLS_USE_GLES
+    if (ctx->debug_labels)
+        glPopDebugGroup();
+#endif
+    if (ctx->trace_callback)
+        ctx->trace_callback(ctx, name, GL_FALSE, ctx->trace_callback_data);
+    if (ctx->trace_file)
+        trace_write(ctx, name, 'E');
+}
 
-/**
- * Stereoscopic Setup
- */
+/* Name an object for debuggers. The object must have been bound before.
+ * OpenGL ES 2.0 has no object labels. */
+#if GLS_USE_GLES
+# define label_object(ctx, identifier, name, label) ((void)(ctx), (void)(label))
+#else
+static void label_object(GLScontext* ctx, GLenum identifier, GLuint name, const char* label)
+{
+    if (ctx->debug_labels)
+        glObjectLabel(identifier, name, -1, label);
+}
+#endif
 
-void glsFrustum(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
-        GLdouble nearVal, GLdouble farVal,
-        GLdouble focalLength, GLdouble eyeSeparation, GLSview view)
+#if !GLS_USE_GLES
+/* Exchange the current view textures of a context with a parked pair. This
+ * hands the textures over without copying them. */
+static void exchange_views(GLScontext* ctx, GLS_views* views)
 {
-    // Shift left/right according to view and eye separation
-    GLdouble d = eyeSeparation / 2.0 * nearVal / focalLength;
-    if (view == GLS_VIEW_LEFT) {
-        left += d;
-        right += d;
-    } else {
-        left -= d;
-        right -= d;
+    GLsync released = ctx->view_released;
+    int i;
+    for (i = 0; i < 2; i++) {
+        GLboolean have_view = ctx->have_view[i];
+        GLuint view_tex = ctx->view_tex[i];
+        GLint view_tex_width = ctx->view_tex_width[i];
+        GLint view_tex_height = ctx->view_tex_height[i];
+        GLint view_tex_alloc_width = ctx->view_tex_alloc_width[i];
+        GLint view_tex_alloc_height = ctx->view_tex_alloc_height[i];
+        ctx->have_view[i] = views->have_view[i];
+        ctx->view_tex[i] = views->view_tex[i];
+        ctx->view_tex_width[i] = views->view_tex_width[i];
+        ctx->view_tex_height[i] = views->view_tex_height[i];
+        ctx->view_tex_alloc_width[i] = views->view_tex_alloc_width[i];
+        ctx->view_tex_alloc_height[i] = views->view_tex_alloc_height[i];
+        views->have_view[i] = have_view;
+        views->view_tex[i] = view_tex;
+        views->view_tex_width[i] = view_tex_width;
+        views->view_tex_height[i] = view_tex_height;
+        views->view_tex_alloc_width[i] = view_tex_alloc_width;
+        views->view_tex_alloc_height[i] = view_tex_alloc_height;
+        // The parked textures do not contain the latest submission
+        ctx->view_stale[i] = GL_TRUE;
     }
-    glFrustum(left, right, bottom, top, nearVal, farVal);
+    ctx->view_released = views->released;
+    views->released = released;
+}
+#endif
 
-    /* We could shift the eye here:
-     *
-     * if (view == GLS_VIEW_LEFT)
-     *   glTranslatef(eyeSeparationf / 2.0f, 0.0f, 0.0f);
-     * else
-     *   glTranslatef(-eyeSeparation / 2.0f, 0.0f, 0.0f);
-     *
-     * However, then a translation is part of the projection matrix, and the
-     * OpenGL camera is not in (0,0,0) anymore, which would probably cause a
-     * lot of trouble for applications. Therefore it is better to require the
-     * user to add this translation to the modelview matrix instead.
-     */
+static void delete_views(GLScontext* ctx, GLS_views* views)
+{
+    glDeleteTextures(2, views->view_tex);
+#if !GLS_USE_GLES
+    if (views->released)
+        glDeleteSync(views->released);
+#else
+    (void)ctx;
+#endif
+    memset(views, 0, sizeof(GLS_views));
 }
 
-void glsPerspective(GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdouble zFar,
-        GLdouble focalLength, GLdouble eyeSeparation, GLSview view)
+/* Delete a pixel buffer object for uploads; this also unmaps it */
+static void delete_upload(GLScontext* ctx, GLS_upload* upload)
 {
-    GLdouble t = tan(fovy / 180.0 * M_PI / 2.0);
-    // Compute symmetric frustum
-    GLdouble top = zNear * t;
-    GLdouble bottom = -top;
-    GLdouble right = top * aspect;
-    GLdouble left = -right;
-    // Use glsFrustum to adjust for stereoscopic view
-    glsFrustum(left, right, bottom, top, zNear, zFar,
-            focalLength, eyeSeparation, view);
+    if (upload->pbo != 0)
+        glDeleteBuffers(1, &upload->pbo);
+#if !GLS_USE_GLES
+    if (upload->fence)
+        glDeleteSync(upload->fence);
+#else
+    (void)ctx;
+#endif
+    memset(upload, 0, sizeof(GLS_upload));
 }
 
-void glsLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ,
-        GLdouble centerX, GLdouble centerY, GLdouble centerZ,
-        GLdouble upX, GLdouble upY, GLdouble upZ,
-        GLdouble eyeSeparation, GLSview view)
-{
-    GLfloat viewX, viewY, viewZ, viewLen;
-    GLfloat sX, sY, sZ, sLen;
-    GLfloat uX, uY, uZ;
-    GLfloat M[16];
-    GLfloat ef;
-
-    // Compute the view direction and normalize it
-    viewX = centerX - eyeX;
-    viewY = centerY - eyeY;
-    viewZ = centerZ - eyeZ;
-    viewLen = sqrtf(viewX * viewX + viewY * viewY + viewZ * viewZ);
-    viewX /= viewLen;
-    viewY /= viewLen;
-    viewZ /= viewLen;
-    // Compute right side direction
-    crossproduct(viewX, viewY, viewZ, upX, upY, upZ, &sX, &sY, &sZ);
-    sLen = sqrtf(sX * sX + sY * sY + sZ * sZ);
-    sX /= sLen;
-    sY /= sLen;
-    sZ /= sLen;
-    // Perform the equivalent of gluLookAt()
-    crossproduct(sX, sY, sZ, viewX, viewY, viewZ, &uX, &uY, &uZ);
-    M[0 * 4 + 0] = sX;
-    M[0 * 4 + 1] = uX;
-    M[0 * 4 + 2] = -viewX;
-    M[0 * 4 + 3] = 0.0f;
-    M[1 * 4 + 0] = sY;
-    M[1 * 4 + 1] = uY;
-    M[1 * 4 + 2] = -viewY;
-    M[1 * 4 + 3] = 0.0f;
-    M[2 * 4 + 0] = sZ;
-    M[2 * 4 + 1] = uZ;
-    M[2 * 4 + 2] = -viewZ;
-    M[2 * 4 + 3] = 0.0f;
-    M[3 * 4 + 0] = 0.0f;
-    M[3 * 4 + 1] = 0.0f;
-    M[3 * 4 + 2] = 0.0f;
-    M[3 * 4 + 3] = 1.0f;
-    glMultMatrixf(M);
-    // Shift eye position according to eye separation and view.
-    // Note that this is the only difference to gluLookAt()!
-    ef = eyeSeparation / 2.0;
-    if (view == GLS_VIEW_LEFT)
-        glTranslated(-(eyeX - sX * ef), -(eyeY - sY * ef), -(eyeZ - sZ * ef));
-    else
-        glTranslated(-(eyeX + sX * ef), -(eyeY + sY * ef), -(eyeZ + sZ * ef));
+/* Delete a program and its shaders */
+static void delete_program(GLScontext* ctx, GLuint prg)
+{
+    (void)ctx;
+    if (glIsProgram(prg)) {
+        GLint shader_count;
+        glGetProgramiv(prg, GL_ATTACHED_SHADERS, &shader_count);
+        if (shader_count > 0) {
+            GLint i;
+            GLuint *shaders = malloc(shader_count * sizeof(GLuint));
+            if (!shaders)
+                oom_abort();
+            glGetAttachedShaders(prg, shader_count, NULL, shaders);
+            for (i = 0; i < shader_count; i++)
+                glDeleteShader(shaders[i]);
+            free(shaders);
+        }
+        glDeleteProgram(prg);
+    }
+}
+
+/* Delete the copies of the last views and everything else that reprojection
+ * needs, except for the program */
+static void delete_reprojection(GLScontext* ctx)
+{
+    int i;
+    for (i = 0; i < 2; i++) {
+        glDeleteTextures(1, &ctx->history[i].tex);
+        glDeleteTextures(1, &ctx->history[i].depth.tex);
+        memset(&ctx->history[i], 0, sizeof(GLS_history));
+    }
+    if (ctx->reproj_grid_vbo != 0) {
+        glDeleteBuffers(1, &ctx->reproj_grid_vbo);
+        glDeleteBuffers(1, &ctx->reproj_grid_ibo);
+        ctx->reproj_grid_vbo = 0;
+        ctx->reproj_grid_ibo = 0;
+    }
+    ctx->reproj_grid_width = -1;
+    ctx->reproj_grid_height = -1;
+    glDeleteTextures(1, &ctx->reproj_tex);
+    ctx->reproj_tex = 0;
+    if (ctx->reproj_depth_rb != 0) {
+        glDeleteRenderbuffers(1, &ctx->reproj_depth_rb);
+        ctx->reproj_depth_rb = 0;
+    }
+    if (ctx->reproj_fbo != 0) {
+        glDeleteFramebuffers(1, &ctx->reproj_fbo);
+        ctx->reproj_fbo = 0;
+    }
+}
+
+/* Delete the timestamp queries for dynamic resolution */
+static void delete_timers(GLScontext* ctx)
+{
+#if !GLS_USE_GLES
+    int i;
+    for (i = 0; i < GLS_TIMER_FRAMES; i++) {
+        if (ctx->timer[i].queries[0] != 0)
+            glDeleteQueries(4, ctx->timer[i].queries);
+    }
+#endif
+    memset(ctx->timer, 0, sizeof(ctx->timer));
+    ctx->timer_pos = -1;
+}
+
+static void crossproduct(const GLSdouble a[3], const GLSdouble b[3], GLSdouble c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void normalize(GLSdouble v[3])
+{
+    GLSdouble len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+}
+
+/* 4x4 matrices in OpenGL's column-major order */
+static void mat4_identity(GLSdouble* m)
+{
+    int i;
+    for (i = 0; i < 16; i++)
+        m[i] = (i % 5 == 0 ? 1.0 : 0.0);
+}
+
+static void mat4_mult(const GLSdouble* a, const GLSdouble* b, GLSdouble* r)
+{
+    int i, j, k;
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            GLSdouble x = 0.0;
+            for (k = 0; k < 4; k++)
+                x += a[k * 4 + i] * b[j * 4 + k];
+            r[j * 4 + i] = x;
+        }
+    }
+}
+
+#if !GLS_USE_GLES
+/* Invert a matrix with Gauss-Jordan elimination. Returns GL_FALSE if it is
+ * singular. */
+static GLboolean mat4_invert(const GLSdouble* m, GLSdouble* r)
+{
+    GLSdouble a[4][8];
+    int i, j, k;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            a[i][j] = m[j * 4 + i];
+            a[i][j + 4] = (i == j ? 1.0 : 0.0);
+        }
+    }
+    for (j = 0; j < 4; j++) {
+        int p = j;
+        for (i = j + 1; i < 4; i++)
+            if (fabs(a[i][j]) > fabs(a[p][j]))
+                p = i;
+        if (a[p][j] == 0.0)
+            return GL_FALSE;
+        for (k = 0; k < 8; k++) {
+            GLSdouble t = a[j][k];
+            a[j][k] = a[p][k];
+            a[p][k] = t;
+        }
+        for (k = 7; k >= j; k--)
+            a[j][k] /= a[j][j];
+        for (i = 0; i < 4; i++) {
+            if (i != j) {
+                GLSdouble f = a[i][j];
+                for (k = j; k < 8; k++)
+                    a[i][k] -= f * a[j][k];
+            }
+        }
+    }
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++)
+            r[j * 4 + i] = a[i][j + 4];
+    return GL_TRUE;
+}
+#endif
+
+
+/*
+ * Manage contexts
+ */
+
+GLScontext* glsCreateContext()
+{
+    GLScontext* ctx = malloc(sizeof(GLScontext));
+    if (ctx) {
+#if GLS_USE_GLES
+        const char* version = (const char*)glGetString(GL_VERSION);
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+#else
+        ctx->gl = gl_acquire();
+        ctx->gl_checked = 0;
+        ctx->gl_available = 0;
+        if (!ctx->gl) {
+            free(ctx);
+            return NULL;
+        }
+        if (!gl_have(ctx, GLS_GL_CORE)) {
+            gl_release(ctx->gl);
+            free(ctx);
+            return NULL;
+        }
+#endif
+        ctx->have_view[0] = GL_FALSE;
+        ctx->have_view[1] = GL_FALSE;
+        ctx->view_tex[0] = 0;
+        ctx->view_tex[1] = 0;
+        ctx->view_generation[0] = 0;
+        ctx->view_generation[1] = 0;
+        memset(ctx->view_dirty, 0, sizeof(ctx->view_dirty));
+        ctx->view_stale[0] = GL_FALSE;
+        ctx->view_stale[1] = GL_FALSE;
+        ctx->view_released = 0;
+        memset(ctx->view_ring, 0, sizeof(ctx->view_ring));
+        ctx->view_ring_size = 1;
+        ctx->view_ring_pos = 0;
+        memset(ctx->upload_ring, 0, sizeof(ctx->upload_ring));
+        ctx->upload_ring_pos = 0;
+        ctx->upload_map_slot[0] = -1;
+        ctx->upload_map_slot[1] = -1;
+        ctx->upload_staging[0] = NULL;
+        ctx->upload_staging[1] = NULL;
+        ctx->upload_staging_size[0] = 0;
+        ctx->upload_staging_size[1] = 0;
+        ctx->view_fbo = 0;
+        ctx->read_fbo = -1;
+        ctx->read_fbo_width = 0;
+        ctx->read_fbo_height = 0;
+        ctx->read_fbo_multisampled = GL_FALSE;
+        ctx->depth_fbo = 0;
+        ctx->even_odd_rows_mask_tex = 0;
+        ctx->even_odd_columns_mask_tex = 0;
+        ctx->checkerboard_mask_tex = 0;
+        ctx->viewport_screen_x = 0;
+        ctx->viewport_screen_y = 0;
+        ctx->display_frame_counter = 0;
+#if GLS_USE_GLX
+        ctx->pacing_valid = GL_FALSE;
+#endif
+        ctx->pacing_callback = NULL;
+        ctx->pacing_callback_data = NULL;
+        ctx->parallax_adjust = 0.0f;
+        ctx->crosstalk_r = 0.0f;
+        ctx->crosstalk_g = 0.0f;
+        ctx->crosstalk_b = 0.0f;
+        ctx->ghostbust = 0.0f;
+        ctx->synth_prg = 0;
+        memset(&ctx->synth_depth, 0, sizeof(ctx->synth_depth));
+        ctx->synth_near = 1.0f;
+        ctx->synth_far = 100.0f;
+        ctx->synth_focal_length = 1.0f;
+        ctx->synth_disparity_factor = 0.0f;
+        ctx->reproj_enabled = GL_FALSE;
+        mat4_identity(ctx->view_matrix[0]);
+        mat4_identity(ctx->view_matrix[1]);
+        memset(ctx->history, 0, sizeof(ctx->history));
+        ctx->reproj_prg = 0;
+        ctx->reproj_grid_vbo = 0;
+        ctx->reproj_grid_ibo = 0;
+        ctx->reproj_grid_width = -1;
+        ctx->reproj_grid_height = -1;
+        ctx->reproj_tex = 0;
+        ctx->reproj_depth_rb = 0;
+        ctx->reproj_fbo = 0;
+        ctx->dynres_budget = 0.0f;
+        ctx->dynres_min_scale = 0.5f;
+        ctx->dynres_scale[0] = 1.0f;
+        ctx->dynres_scale[1] = 1.0f;
+        memset(ctx->timer, 0, sizeof(ctx->timer));
+        ctx->timer_pos = -1;
+        ctx->upsample = GL_FALSE;
+        ctx->asym_view = GLS_VIEW_RIGHT;
+        ctx->asym_scale = 1.0f;
+        ctx->asym_period = 0;
+        ctx->asym_frame = 0;
+        memset(ctx->lut_tex, 0, sizeof(ctx->lut_tex));
+        memset(ctx->lut_size, 0, sizeof(ctx->lut_size));
+        ctx->overlay_tex = 0;
+        ctx->overlay_alpha_mode = GLS_ALPHA_STRAIGHT;
+        memset(ctx->overlay_rect, 0, sizeof(ctx->overlay_rect));
+        ctx->overlay_disparity = 0.0f;
+        // No mode yet; the first glsDrawViews() sets up the pipeline
+        memset(&ctx->draw_pipeline, 0, sizeof(ctx->draw_pipeline));
+        ctx->draw_pipeline.mode = (GLSmode)-1;
+        ctx->hmd_distortion[0] = 1.0f;
+        ctx->hmd_distortion[1] = 0.0f;
+        ctx->hmd_distortion[2] = 0.0f;
+        ctx->hmd_distortion[3] = 0.0f;
+        ctx->hmd_chromatic_aberration[0] = 1.0f;
+        ctx->hmd_chromatic_aberration[1] = 1.0f;
+        ctx->hmd_lens_offset = 0.0f;
+        ctx->hmd_mesh_vbo = 0;
+        ctx->hmd_mesh_ibo = 0;
+        ctx->hmd_mesh_width = -1;
+        ctx->hmd_mesh_height = -1;
+        ctx->view_stencil_bit = 0;
+        memset(&ctx->stencil_pipeline, 0, sizeof(ctx->stencil_pipeline));
+        ctx->view_begun = GL_FALSE;
+#if GLS_USE_GLES
+        ctx->quad_vbo = 0;
+        // glInvalidateFramebuffer() of OpenGL ES 3.0 has the same signature
+        // and attachment names as glDiscardFramebufferEXT().
+        if (version && strncmp(version, "OpenGL ES ", 10) == 0 && atoi(version + 10) >= 3)
+            ctx->discard_framebuffer = (PFNGLDISCARDFRAMEBUFFEREXTPROC)
+                eglGetProcAddress("glInvalidateFramebuffer");
+        else if (extensions && strstr(extensions, "GL_EXT_discard_framebuffer"))
+            ctx->discard_framebuffer = (PFNGLDISCARDFRAMEBUFFEREXTPROC)
+                eglGetProcAddress("glDiscardFramebufferEXT");
+        else
+            ctx->discard_framebuffer = NULL;
+#endif
+        ctx->cache_enabled = GL_FALSE;
+        ctx->cache_valid = GL_FALSE;
+        ctx->cache_tex = 0;
+        ctx->cache_fbo = 0;
+        ctx->debug_labels = GL_FALSE;
+        ctx->trace_callback = NULL;
+        ctx->trace_callback_data = NULL;
+        ctx->trace_file = NULL;
+        ctx->trace_events = 0;
+        ctx->compositor = NULL;
+        ctx->compositor_depth = 1;
+        ctx->compositor_latest_only = GL_FALSE;
+    }
+    return ctx;
+}
+
+void glsDestroyContext(GLScontext* ctx)
+{
+    int i;
+
+    if (ctx) {
+        glsStopCompositor(ctx);
+        glsSetViewTextureRing(ctx, 1);
+        glDeleteTextures(2, ctx->view_tex);
+#if !GLS_USE_GLES
+        if (ctx->view_released)
+            glDeleteSync(ctx->view_released);
+#endif
+        for (i = 0; i < GLS_UPLOAD_RING; i++)
+            delete_upload(ctx, &ctx->upload_ring[i]);
+        free(ctx->upload_staging[0]);
+        free(ctx->upload_staging[1]);
+        glDeleteTextures(1, &ctx->even_odd_rows_mask_tex);
+        glDeleteTextures(1, &ctx->even_odd_columns_mask_tex);
+        glDeleteTextures(1, &ctx->checkerboard_mask_tex);
+        delete_program(ctx, ctx->draw_pipeline.prg);
+        delete_program(ctx, ctx->stencil_pipeline.prg);
+        if (ctx->hmd_mesh_vbo != 0) {
+            glDeleteBuffers(1, &ctx->hmd_mesh_vbo);
+            glDeleteBuffers(1, &ctx->hmd_mesh_ibo);
+        }
+#if GLS_USE_GLES
+        if (ctx->quad_vbo != 0)
+            glDeleteBuffers(1, &ctx->quad_vbo);
+#endif
+        delete_program(ctx, ctx->synth_prg);
+        glDeleteTextures(1, &ctx->synth_depth.tex);
+        if (ctx->depth_fbo != 0)
+            glDeleteFramebuffers(1, &ctx->depth_fbo);
+        delete_reprojection(ctx);
+        delete_program(ctx, ctx->reproj_prg);
+        delete_timers(ctx);
+        if (ctx->view_fbo != 0)
+            glDeleteFramebuffers(1, &ctx->view_fbo);
+        glDeleteTextures(1, &ctx->cache_tex);
+        if (ctx->cache_fbo != 0)
+            glDeleteFramebuffers(1, &ctx->cache_fbo);
+        glsSetTraceFile(ctx, NULL);
+#if !GLS_USE_GLES
+        gl_release(ctx->gl);
+#endif
+        free(ctx);
+    }
 }
 
 
 /**
- * Stereoscopic Display
+ * Set GLS options
  */
 
-void glsClear(GLScontext* ctx)
+void glsSetViewportScreenCoords(GLScontext* ctx, GLint x, GLint y)
 {
-    ctx->have_view[0] = 0;
-    ctx->have_view[1] = 0;
+    ctx->viewport_screen_x = x;
+    ctx->viewport_screen_y = y;
+}
 
-    /* Get display frame counter */
-#if GLS_USE_GLX
-    GLuint display_frame_counter;
-    if (GLXEW_SGI_video_sync && glXGetVideoSyncSGI(&display_frame_counter) == 0)
-        ctx->display_frame_counter = display_frame_counter;
-    else
-        ctx->display_frame_counter++;
-#else
-    ctx->display_frame_counter++;
+void glsSetCrosstalkGhostbusting(GLScontext* ctx,
+        GLfloat r, GLfloat g, GLfloat b, GLfloat ghostbust)
+{
+    ctx->crosstalk_r = r;
+    ctx->crosstalk_g = g;
+    ctx->crosstalk_b = b;
+    ctx->ghostbust = ghostbust;
+}
+
+void glsSetColorLUT(GLScontext* ctx, GLuint lut, GLint size)
+{
+#if GLS_USE_GLES
+    // OpenGL ES 2.0 has no 3D textures
+    size = 0;
 #endif
+    ctx->lut_tex[2] = (size > 1 ? lut : 0);
+    ctx->lut_size[2] = size;
+    ctx->cache_valid = GL_FALSE;
 }
 
-GLboolean glsIsViewRequired(GLScontext* ctx, GLSmode mode, GLboolean swap_views, GLSview view)
+void glsSetViewColorLUT(GLScontext* ctx, GLSview view, GLuint lut, GLint size)
 {
-    if (mode == GLS_MODE_MONO_LEFT
-            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 0))
-        return (!swap_views && view == GLS_VIEW_LEFT) || (swap_views && view == GLS_VIEW_RIGHT);
-    else if (mode == GLS_MODE_MONO_RIGHT
-            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 1))
-        return (!swap_views && view == GLS_VIEW_RIGHT) || (swap_views && view == GLS_VIEW_LEFT);
-    else
-        return GL_TRUE;
+#if GLS_USE_GLES
+    size = 0;
+#endif
+    ctx->lut_tex[view] = (size > 1 ? lut : 0);
+    ctx->lut_size[view] = size;
+    ctx->cache_valid = GL_FALSE;
 }
 
-void glsSubmitView(GLScontext* ctx, GLSview view)
+void glsSetOverlay(GLScontext* ctx, GLuint tex, const GLfloat rect[4],
+        GLfloat disparity, GLSalphaMode alphaMode)
+{
+    ctx->overlay_tex = (rect && rect[2] > 0.0f && rect[3] > 0.0f ? tex : 0);
+    if (ctx->overlay_tex != 0)
+        memcpy(ctx->overlay_rect, rect, sizeof(ctx->overlay_rect));
+    ctx->overlay_disparity = disparity;
+    ctx->overlay_alpha_mode = alphaMode;
+    ctx->cache_valid = GL_FALSE;
+}
+
+void glsSetHMDLens(GLScontext* ctx, const GLfloat distortion[4],
+        const GLfloat chromaticAberration[2], GLfloat lensCenterOffset)
+{
+    memcpy(ctx->hmd_distortion, distortion, sizeof(ctx->hmd_distortion));
+    memcpy(ctx->hmd_chromatic_aberration, chromaticAberration,
+            sizeof(ctx->hmd_chromatic_aberration));
+    ctx->hmd_lens_offset = lensCenterOffset;
+    ctx->hmd_mesh_width = -1;   // rebuild the mesh in the next composition
+    ctx->hmd_mesh_height = -1;
+    ctx->cache_valid = GL_FALSE;
+}
+
+void glsSetViewSynthesisFrustum(GLScontext* ctx,
+        GLSdouble left, GLSdouble right, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation)
+{
+    ctx->synth_near = zNear;
+    ctx->synth_far = zFar;
+    ctx->synth_focal_length = focalLength;
+    ctx->synth_disparity_factor = zNear * eyeSeparation / (right - left);
+}
+
+void glsSetViewSynthesisPerspective(GLScontext* ctx,
+        GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation)
+{
+    // Same frustum as glsPerspective()
+    GLSdouble right = zNear * tan(fovy / 180.0 * M_PI / 2.0) * aspect;
+    glsSetViewSynthesisFrustum(ctx, -right, right, zNear, zFar,
+            focalLength, eyeSeparation);
+}
+
+void glsSetReprojection(GLScontext* ctx, GLboolean enable)
+{
+    ctx->reproj_enabled = (enable && gl_have(ctx, GLS_GL_FRAMEBUFFER_OBJECT));
+    if (!ctx->reproj_enabled)
+        delete_reprojection(ctx);
+}
+
+void glsSetDynamicResolution(GLScontext* ctx, GLfloat frameBudget, GLfloat minScale)
+{
+    if (!gl_have(ctx, GLS_GL_TIMER_QUERY))
+        frameBudget = 0.0f;
+    ctx->dynres_budget = (frameBudget > 0.0f ? frameBudget : 0.0f);
+    ctx->dynres_min_scale = (minScale < 0.1f ? 0.1f : minScale > 1.0f ? 1.0f : minScale);
+    ctx->dynres_scale[0] = 1.0f;
+    ctx->dynres_scale[1] = 1.0f;
+    ctx->upsample = (ctx->dynres_budget > 0.0f || ctx->asym_scale < 1.0f);
+    ctx->cache_valid = GL_FALSE;
+    delete_timers(ctx);
+}
+
+void glsSetAsymmetricResolution(GLScontext* ctx, GLSview reducedView, GLfloat scale,
+        GLint alternateFrames)
+{
+    ctx->asym_view = reducedView;
+    ctx->asym_scale = (scale < 0.25f ? 0.25f : scale > 1.0f ? 1.0f : scale);
+    ctx->asym_period = (alternateFrames > 0 ? alternateFrames : 0);
+    ctx->asym_frame = 0;
+    ctx->upsample = (ctx->dynres_budget > 0.0f || ctx->asym_scale < 1.0f);
+    ctx->cache_valid = GL_FALSE;
+}
+
+GLfloat glsGetRenderScale(GLScontext* ctx, GLSview view)
+{
+    GLfloat scale = ctx->dynres_scale[view];
+    if (ctx->asym_scale < 1.0f) {
+        GLSview reduced = ctx->asym_view;
+        if (ctx->asym_period > 0 && (ctx->asym_frame / ctx->asym_period) % 2 == 1)
+            reduced = (reduced == GLS_VIEW_LEFT ? GLS_VIEW_RIGHT : GLS_VIEW_LEFT);
+        if (view == reduced)
+            scale *= ctx->asym_scale;
+    }
+    return scale;
+}
+
+void glsSetCompositionCaching(GLScontext* ctx, GLboolean enable)
+{
+    ctx->cache_enabled = enable;
+    ctx->cache_valid = GL_FALSE;
+}
+
+void glsTrim(GLScontext* ctx)
 {
     GLint texture_binding_2d_bak;
-    GLint viewport[4];
+    int i;
 
-    /* Backup GL state */
+    trace_begin(ctx, "glsTrim");
     glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_binding_2d_bak);
+    for (i = 0; i < 2; i++) {
+        if (ctx->view_tex[i] != 0
+                && (ctx->view_tex_alloc_width[i] != ctx->view_tex_width[i]
+                    || ctx->view_tex_alloc_height[i] != ctx->view_tex_height[i])) {
+            glBindTexture(GL_TEXTURE_2D, ctx->view_tex[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT,
+                    ctx->view_tex_width[i], ctx->view_tex_height[i], 0,
+                    GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+            ctx->view_tex_alloc_width[i] = ctx->view_tex_width[i];
+            ctx->view_tex_alloc_height[i] = ctx->view_tex_height[i];
+            // The content is lost; force a full submission next time.
+            ctx->view_tex_width[i] = -1;
+            ctx->view_tex_height[i] = -1;
+            ctx->have_view[i] = GL_FALSE;
+        }
+    }
+    if (ctx->cache_tex != 0 && ctx->cache_valid
+            && (ctx->cache_tex_alloc_width != ctx->cache_key.width
+                || ctx->cache_tex_alloc_height != ctx->cache_key.height)) {
+        glBindTexture(GL_TEXTURE_2D, ctx->cache_tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT,
+                ctx->cache_key.width, ctx->cache_key.height, 0,
+                GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+        ctx->cache_tex_alloc_width = ctx->cache_key.width;
+        ctx->cache_tex_alloc_height = ctx->cache_key.height;
+        ctx->cache_valid = GL_FALSE;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
+    delete_reprojection(ctx);
+    for (i = 0; i < GLS_UPLOAD_RING; i++) {
+        if (i != ctx->upload_map_slot[0] && i != ctx->upload_map_slot[1])
+            delete_upload(ctx, &ctx->upload_ring[i]);
+    }
+    for (i = 0; i < 2; i++) {
+        if (ctx->upload_map_slot[i] < 0) {
+            free(ctx->upload_staging[i]);
+            ctx->upload_staging[i] = NULL;
+            ctx->upload_staging_size[i] = 0;
+        }
+    }
+    trace_end(ctx, "glsTrim");
+}
 
-    /* Get current viewport */
-    glGetIntegerv(GL_VIEWPORT, viewport);
+void glsSetViewTextureRing(GLScontext* ctx, GLint size)
+{
+    GLint i;
 
-    /* Make sure our view texture is valid and has the right size */
-    if (ctx->view_tex[view] == 0) {
-        glGenTextures(1, &(ctx->view_tex[view]));
-        ctx->view_tex_width[view] = -1;
-        ctx->view_tex_height[view] = -1;
+    for (i = 0; i < ctx->view_ring_size - 1; i++)
+        delete_views(ctx, &ctx->view_ring[i]);
+    ctx->view_ring_size = (size < 1 ? 1
+            : size > GLS_MAX_VIEW_RING ? GLS_MAX_VIEW_RING
+            : size);
+    if (!gl_have(ctx, GLS_GL_SYNC))
+        ctx->view_ring_size = 1;
+    ctx->view_ring_pos = 0;
+}
+
+void glsSetFramePacingCallback(GLScontext* ctx,
+        GLSframePacingCallback callback, void* userData)
+{
+    ctx->pacing_callback = callback;
+    ctx->pacing_callback_data = userData;
+}
+
+void glsSetDebugLabels(GLScontext* ctx, GLboolean enable)
+{
+    ctx->debug_labels = (enable && gl_have(ctx, GLS_GL_DEBUG));
+}
+
+void glsSetTraceCallback(GLScontext* ctx,
+        GLStraceCallback callback, void* userData)
+{
+    ctx->trace_callback = callback;
+    ctx->trace_callback_data = userData;
+}
+
+GLboolean glsSetTraceFile(GLScontext* ctx, const char* filename)
+{
+    if (ctx->trace_file) {
+        fputs("\n]\n", ctx->trace_file);
+        fclose(ctx->trace_file);
+        ctx->trace_file = NULL;
+    }
+    if (filename) {
+        ctx->trace_file = fopen(filename, "w");
+        if (!ctx->trace_file)
+            return GL_FALSE;
+        fputs("[", ctx->trace_file);
+        ctx->trace_events = 0;
+    }
+    return GL_TRUE;
+}
+
+
+/**
+ * Stereoscopic Setup
+ */
+
+/* Compute the projection matrices of glsFrustum() for the left and the
+ * right view */
+static void frustum_matrices(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSdouble m[32])
+{
+    GLSdouble d = eyeSeparation / 2.0 * zNear / focalLength;
+    GLSdouble w = right - left;
+    GLSdouble h = top - bottom;
+    GLSdouble depth = zFar - zNear;
+    memset(m, 0, 32 * sizeof(GLSdouble));
+    m[0] = m[16 + 0] = 2.0 * zNear / w;
+    m[5] = m[16 + 5] = 2.0 * zNear / h;
+    m[8] = (right + left + 2.0 * d) / w;
+    m[16 + 8] = (right + left - 2.0 * d) / w;
+    m[9] = m[16 + 9] = (top + bottom) / h;
+    m[10] = m[16 + 10] = -(zFar + zNear) / depth;
+    m[11] = m[16 + 11] = -1.0;
+    m[14] = m[16 + 14] = -2.0 * zFar * zNear / depth;
+}
+
+/* Compute the symmetric frustum of gluPerspective() */
+static void perspective_frustum(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear,
+        GLSdouble* left, GLSdouble* right, GLSdouble* bottom, GLSdouble* top)
+{
+    GLSdouble t = tan(fovy / 180.0 * M_PI / 2.0);
+    *top = zNear * t;
+    *bottom = -*top;
+    *right = *top * aspect;
+    *left = -*right;
+}
+
+/* Compute the modelview matrices of glsLookAt() for the left and the right
+ * view. They differ only in the shift along the right side direction. */
+static void lookat_matrices(const GLSdouble eye[3], const GLSdouble center[3],
+        const GLSdouble up[3], GLSdouble eyeSeparation, GLSdouble m[32])
+{
+    GLSdouble f[3], s[3], u[3];
+    GLSdouble ef = eyeSeparation / 2.0;
+
+    // Compute the view direction, the right side direction, and the up direction
+    f[0] = center[0] - eye[0];
+    f[1] = center[1] - eye[1];
+    f[2] = center[2] - eye[2];
+    normalize(f);
+    crossproduct(f, up, s);
+    normalize(s);
+    crossproduct(s, f, u);
+    // Perform the equivalent of gluLookAt()
+    m[0] = s[0];
+    m[1] = u[0];
+    m[2] = -f[0];
+    m[3] = 0.0;
+    m[4] = s[1];
+    m[5] = u[1];
+    m[6] = -f[1];
+    m[7] = 0.0;
+    m[8] = s[2];
+    m[9] = u[2];
+    m[10] = -f[2];
+    m[11] = 0.0;
+    m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    m[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    m[15] = 1.0;
+    memcpy(m + 16, m, 16 * sizeof(GLSdouble));
+    // Shift eye position according to eye separation and view.
+    // Note that this is the only difference to gluLookAt()!
+    m[12] += ef;
+    m[16 + 12] -= ef;
+}
+
+static void matrices_to_float(const GLSdouble* md, GLfloat* mf)
+{
+    int i;
+    for (i = 0; i < 32; i++)
+        mf[i] = md[i];
+}
+
+#if !GLS_USE_GLES
+/* The matrix stack functions; OpenGL ES 2.0 has no matrix stack */
+
+void glsFrustum(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble nearVal, GLSdouble farVal,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSview view)
+{
+    // Shift left/right according to view and eye separation
+    GLSdouble d = eyeSeparation / 2.0 * nearVal / focalLength;
+    if (view == GLS_VIEW_LEFT) {
+        left += d;
+        right += d;
+    } else {
+        left -= d;
+        right -= d;
+    }
+    glFrustum(left, right, bottom, top, nearVal, farVal);
+
+    /* We could shift the eye here:
+     *
+     * if (view == GLS_VIEW_LEFT)
+     *   glTranslatef(eyeSeparationf / 2.0f, 0.0f, 0.0f);
+     * else
+     *   glTranslatef(-eyeSeparation / 2.0f, 0.0f, 0.0f);
+     *
+     * However, then a translation is part of the projection matrix, and the
+     * OpenGL camera is not in (0,0,0) anymore, which would probably cause a
+     * lot of trouble for applications. Therefore it is better to require the
+     * user to add this translation to the modelview matrix instead.
+     */
+}
+
+void glsPerspective(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSview view)
+{
+    GLSdouble left, right, bottom, top;
+    // Compute symmetric frustum
+    perspective_frustum(fovy, aspect, zNear, &left, &right, &bottom, &top);
+    // Use glsFrustum to adjust for stereoscopic view
+    glsFrustum(left, right, bottom, top, zNear, zFar,
+            focalLength, eyeSeparation, view);
+}
+
+void glsLookAt(GLSdouble eyeX, GLSdouble eyeY, GLSdouble eyeZ,
+        GLSdouble centerX, GLSdouble centerY, GLSdouble centerZ,
+        GLSdouble upX, GLSdouble upY, GLSdouble upZ,
+        GLSdouble eyeSeparation, GLSview view)
+{
+    const GLSdouble eye[3] = { eyeX, eyeY, eyeZ };
+    const GLSdouble center[3] = { centerX, centerY, centerZ };
+    const GLSdouble up[3] = { upX, upY, upZ };
+    GLSdouble m[32];
+
+    lookat_matrices(eye, center, up, eyeSeparation, m);
+    glMultMatrixd(m + (view == GLS_VIEW_LEFT ? 0 : 16));
+}
+#endif
+
+void glsFrustumMatricesd(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSdouble matrices[32])
+{
+    frustum_matrices(left, right, bottom, top, zNear, zFar,
+            focalLength, eyeSeparation, matrices);
+}
+
+void glsFrustumMatricesf(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLfloat matrices[32])
+{
+    GLSdouble m[32];
+    frustum_matrices(left, right, bottom, top, zNear, zFar,
+            focalLength, eyeSeparation, m);
+    matrices_to_float(m, matrices);
+}
+
+void glsPerspectiveMatricesd(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSdouble matrices[32])
+{
+    GLSdouble left, right, bottom, top;
+    perspective_frustum(fovy, aspect, zNear, &left, &right, &bottom, &top);
+    frustum_matrices(left, right, bottom, top, zNear, zFar,
+            focalLength, eyeSeparation, matrices);
+}
+
+void glsPerspectiveMatricesf(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLfloat matrices[32])
+{
+    GLSdouble m[32];
+    glsPerspectiveMatricesd(fovy, aspect, zNear, zFar, focalLength, eyeSeparation, m);
+    matrices_to_float(m, matrices);
+}
+
+void glsLookAtMatricesd(const GLSdouble eye[3], const GLSdouble center[3],
+        const GLSdouble up[3], GLSdouble eyeSeparation, GLSdouble matrices[32])
+{
+    lookat_matrices(eye, center, up, eyeSeparation, matrices);
+}
+
+void glsLookAtMatricesf(const GLfloat eye[3], const GLfloat center[3],
+        const GLfloat up[3], GLfloat eyeSeparation, GLfloat matrices[32])
+{
+    const GLSdouble e[3] = { eye[0], eye[1], eye[2] };
+    const GLSdouble c[3] = { center[0], center[1], center[2] };
+    const GLSdouble u[3] = { up[0], up[1], up[2] };
+    GLSdouble m[32];
+    lookat_matrices(e, c, u, eyeSeparation, m);
+    matrices_to_float(m, matrices);
+}
+
+void glsFrustumMatricesArrayf(GLsizei count,
+        const GLfloat* left, const GLfloat* right,
+        const GLfloat* bottom, const GLfloat* top,
+        const GLfloat* zNear, const GLfloat* zFar,
+        const GLfloat* focalLength, const GLfloat* eyeSeparation,
+        GLfloat* matrices)
+{
+    GLsizei i;
+    // No branches and no calls, so that the compiler can vectorize this loop
+    for (i = 0; i < count; i++) {
+        GLfloat* m = matrices + 32 * i;
+        GLfloat n = zNear[i];
+        GLfloat f = zFar[i];
+        GLfloat w = right[i] - left[i];
+        GLfloat h = top[i] - bottom[i];
+        GLfloat d = eyeSeparation[i] * n / focalLength[i];
+        GLfloat x = 2.0f * n / w;
+        GLfloat y = 2.0f * n / h;
+        GLfloat a = (right[i] + left[i]) / w;
+        GLfloat b = (top[i] + bottom[i]) / h;
+        GLfloat c = -(f + n) / (f - n);
+        GLfloat e = -2.0f * f * n / (f - n);
+        m[0] = x;  m[1] = 0.0f;  m[2] = 0.0f;  m[3] = 0.0f;
+        m[4] = 0.0f;  m[5] = y;  m[6] = 0.0f;  m[7] = 0.0f;
+        m[8] = a + d / w;  m[9] = b;  m[10] = c;  m[11] = -1.0f;
+        m[12] = 0.0f;  m[13] = 0.0f;  m[14] = e;  m[15] = 0.0f;
+        m[16] = x;  m[17] = 0.0f;  m[18] = 0.0f;  m[19] = 0.0f;
+        m[20] = 0.0f;  m[21] = y;  m[22] = 0.0f;  m[23] = 0.0f;
+        m[24] = a - d / w;  m[25] = b;  m[26] = c;  m[27] = -1.0f;
+        m[28] = 0.0f;  m[29] = 0.0f;  m[30] = e;  m[31] = 0.0f;
+    }
+}
+
+void glsLookAtMatricesArrayf(GLsizei count, const GLfloat* eye, const GLfloat* center,
+        const GLfloat* up, const GLfloat* eyeSeparation, GLfloat* matrices)
+{
+    GLsizei i;
+    for (i = 0; i < count; i++) {
+        glsLookAtMatricesf(eye + 3 * i, center + 3 * i, up + 3 * i,
+                eyeSeparation[i], matrices + 32 * i);
+    }
+}
+
+
+/**
+ * Asynchronous Composition
+ */
+
+#if GLS_USE_THREADS
+
+/* Lock-free single-producer/single-consumer queue of frame indices. The
+ * release store of head publishes the slot to the consumer; the number of
+ * entries is bounded by the number of frames, so it never overflows. */
+static void queue_push(GLS_queue* q, GLint frame)
+{
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    q->frames[head % (GLS_MAX_COMPOSITOR_DEPTH + 1)] = frame;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+static GLint queue_pop(GLS_queue* q)
+{
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    GLint frame;
+    if (tail == atomic_load_explicit(&q->head, memory_order_acquire))
+        return -1;
+    frame = q->frames[tail % (GLS_MAX_COMPOSITOR_DEPTH + 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return frame;
+}
+
+static int compositor_stopping(GLS_compositor* c)
+{
+    return atomic_load_explicit(&c->stop, memory_order_acquire);
+}
+
+static void destroy_compositor(GLS_compositor* c)
+{
+    sem_destroy(&c->free_count);
+    sem_destroy(&c->filled_count);
+    sem_destroy(&c->started);
+    free(c);
+}
+
+static void* compositor_thread(void* arg)
+{
+    GLS_compositor* c = arg;
+    GLScontext* ctx;
+
+    if (!c->make_current(GL_TRUE, c->user_data)) {
+        sem_post(&c->started);
+        return NULL;
+    }
+    ctx = glsCreateContext();
+    if (ctx && !gl_have(ctx, GLS_GL_SYNC)) {
+        // The thread's OpenGL context may be on a different driver
+        glsDestroyContext(ctx);
+        ctx = NULL;
+    }
+    if (!ctx) {
+        c->make_current(GL_FALSE, c->user_data);
+        sem_post(&c->started);
+        return NULL;
+    }
+    c->comp = ctx;
+    ctx->cache_enabled = c->ctx->cache_enabled;
+    glsSetDebugLabels(ctx, c->ctx->debug_labels);
+    // The trace file is not shared, so that the application thread can
+    // write to it without locking
+    ctx->trace_callback = c->ctx->trace_callback;
+    ctx->trace_callback_data = c->ctx->trace_callback_data;
+    sem_post(&c->started);
+
+    for (;;) {
+        GLS_frame* frame;
+        GLint f;
+
+        sem_wait(&c->filled_count);
+        if (compositor_stopping(c))
+            break;
+        f = queue_pop(&c->filled_queue);
+        if (c->latest_only) {
+            // Skip frames that are already superseded by a newer one
+            while (sem_trywait(&c->filled_count) == 0) {
+                GLint newer = queue_pop(&c->filled_queue);
+                if (newer < 0) {
+                    // This was the stop request; handle it next time
+                    sem_post(&c->filled_count);
+                    break;
+                }
+                glDeleteSync(c->frames[f].ready);
+                c->frames[f].ready = 0;
+                queue_push(&c->free_queue, f);
+                sem_post(&c->free_count);
+                f = newer;
+            }
+        }
+        frame = &c->frames[f];
+
+        trace_begin(ctx, "compose frame");
+        glWaitSync(frame->ready, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(frame->ready);
+        frame->ready = 0;
+        glsClear(ctx);
+        ctx->parallax_adjust = frame->parallax_adjust;
+        ctx->crosstalk_r = frame->crosstalk[0];
+        ctx->crosstalk_g = frame->crosstalk[1];
+        ctx->crosstalk_b = frame->crosstalk[2];
+        ctx->ghostbust = frame->ghostbust;
+        ctx->upsample = frame->upsample;
+        memcpy(ctx->lut_tex, frame->lut_tex, sizeof(ctx->lut_tex));
+        memcpy(ctx->lut_size, frame->lut_size, sizeof(ctx->lut_size));
+        ctx->overlay_tex = frame->overlay_tex;
+        ctx->overlay_alpha_mode = frame->overlay_alpha_mode;
+        memcpy(ctx->overlay_rect, frame->overlay_rect, sizeof(ctx->overlay_rect));
+        ctx->overlay_disparity = frame->overlay_disparity;
+        ctx->viewport_screen_x = frame->viewport_screen[0];
+        ctx->viewport_screen_y = frame->viewport_screen[1];
+        exchange_views(ctx, &frame->views);
+        glViewport(frame->viewport[0], frame->viewport[1], frame->viewport[2], frame->viewport[3]);
+        glsDrawSubmittedViews(ctx, frame->mode, frame->swap_views);
+        if (frame->dlp_marker)
+            glsDrawDLP3dReadySyncMarker(ctx, frame->dlp_mode);
+        exchange_views(ctx, &frame->views);
+        frame->views.released = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence must reach the GPU before the other context waits for it
+        glFlush();
+        trace_end(ctx, "compose frame");
+        c->swap_buffers(c->user_data);
+
+        queue_push(&c->free_queue, f);
+        sem_post(&c->free_count);
+    }
+
+    glsDestroyContext(ctx);
+    c->make_current(GL_FALSE, c->user_data);
+    return NULL;
+}
+
+/* Hand the submitted views over to the compositor thread. */
+static void enqueue_frame(GLScontext* ctx, GLSmode mode, GLboolean swap_views)
+{
+    GLS_compositor* c = ctx->compositor;
+    GLS_frame* frame;
+    GLint f;
+
+    trace_begin(ctx, "enqueue frame");
+    // Wait until a frame is free; this bounds the latency
+    while (sem_wait(&c->free_count) != 0)
+        ;
+    f = queue_pop(&c->free_queue);
+    frame = &c->frames[f];
+    exchange_views(ctx, &frame->views);
+    // We get back the textures of this frame. Copies into them must wait
+    // until the compositor has finished reading them, but we can let the
+    // GPU do the waiting.
+    if (ctx->view_released) {
+        glWaitSync(ctx->view_released, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(ctx->view_released);
+        ctx->view_released = 0;
+    }
+    frame->mode = mode;
+    frame->swap_views = swap_views;
+    frame->dlp_marker = c->dlp_marker;
+    frame->dlp_mode = c->dlp_mode;
+    c->dlp_marker = GL_FALSE;
+    glGetIntegerv(GL_VIEWPORT, frame->viewport);
+    frame->viewport_screen[0] = ctx->viewport_screen_x;
+    frame->viewport_screen[1] = ctx->viewport_screen_y;
+    frame->parallax_adjust = ctx->parallax_adjust;
+    frame->crosstalk[0] = ctx->crosstalk_r;
+    frame->crosstalk[1] = ctx->crosstalk_g;
+    frame->crosstalk[2] = ctx->crosstalk_b;
+    frame->ghostbust = ctx->ghostbust;
+    frame->upsample = ctx->upsample;
+    memcpy(frame->lut_tex, ctx->lut_tex, sizeof(frame->lut_tex));
+    memcpy(frame->lut_size, ctx->lut_size, sizeof(frame->lut_size));
+    frame->overlay_tex = ctx->overlay_tex;
+    frame->overlay_alpha_mode = ctx->overlay_alpha_mode;
+    memcpy(frame->overlay_rect, ctx->overlay_rect, sizeof(frame->overlay_rect));
+    frame->overlay_disparity = ctx->overlay_disparity;
+    frame->ready = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // The fence must reach the GPU before the other context waits for it
+    glFlush();
+    queue_push(&c->filled_queue, f);
+    sem_post(&c->filled_count);
+    trace_end(ctx, "enqueue frame");
+}
+
+#endif
+
+void glsSetCompositorQueue(GLScontext* ctx, GLint depth, GLboolean latestOnly)
+{
+    ctx->compositor_depth = (depth < 1 ? 1
+            : depth > GLS_MAX_COMPOSITOR_DEPTH ? GLS_MAX_COMPOSITOR_DEPTH
+            : depth);
+    ctx->compositor_latest_only = latestOnly;
+}
+
+GLboolean glsStartCompositor(GLScontext* ctx,
+        GLSmakeCurrentCallback makeCurrent, GLSswapBuffersCallback swapBuffers,
+        void* userData)
+{
+#if GLS_USE_THREADS
+    GLS_compositor* c;
+    GLint i;
+
+    if (ctx->compositor || !gl_have(ctx, GLS_GL_SYNC))
+        return GL_FALSE;
+    c = malloc(sizeof(GLS_compositor));
+    if (!c)
+        oom_abort();
+    memset(c, 0, sizeof(GLS_compositor));
+    c->ctx = ctx;
+    c->make_current = makeCurrent;
+    c->swap_buffers = swapBuffers;
+    c->user_data = userData;
+    c->latest_only = ctx->compositor_latest_only;
+    // One frame can be composed while the others wait in the queue
+    c->frame_count = ctx->compositor_depth + 1;
+    for (i = 0; i < c->frame_count; i++)
+        queue_push(&c->free_queue, i);
+    sem_init(&c->free_count, 0, c->frame_count);
+    sem_init(&c->filled_count, 0, 0);
+    sem_init(&c->started, 0, 0);
+    if (pthread_create(&c->thread, NULL, compositor_thread, c) != 0) {
+        destroy_compositor(c);
+        return GL_FALSE;
+    }
+    sem_wait(&c->started);
+    if (!c->comp) {
+        pthread_join(c->thread, NULL);
+        destroy_compositor(c);
+        return GL_FALSE;
+    }
+    ctx->compositor = c;
+    return GL_TRUE;
+#else
+    (void)ctx;
+    (void)makeCurrent;
+    (void)swapBuffers;
+    (void)userData;
+    return GL_FALSE;
+#endif
+}
+
+void glsStopCompositor(GLScontext* ctx)
+{
+#if GLS_USE_THREADS
+    GLS_compositor* c = ctx->compositor;
+    GLint i;
+
+    if (!c)
+        return;
+    atomic_store_explicit(&c->stop, 1, memory_order_release);
+    sem_post(&c->filled_count);
+    pthread_join(c->thread, NULL);
+    for (i = 0; i < c->frame_count; i++) {
+        delete_views(ctx, &c->frames[i].views);
+        if (c->frames[i].ready)
+            glDeleteSync(c->frames[i].ready);
+    }
+    destroy_compositor(c);
+    ctx->compositor = NULL;
+#else
+    (void)ctx;
+#endif
+}
+
+
+/**
+ * Stereoscopic Display
+ */
+
+#if GLS_USE_GLX
+static GLboolean update_frame_pacing(GLScontext* ctx)
+{
+    Display* dpy = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    int64_t ust, msc, sbc, pending;
+
+    if (!dpy || !drawable || !glXGetSyncValuesOML(dpy, drawable, &ust, &msc, &sbc))
+        return GL_FALSE;
+
+    if (!ctx->pacing_valid || ctx->pacing_drawable != drawable
+            || sbc < ctx->pacing_last_sbc || msc < ctx->pacing_last_msc) {
+        // (Re)start counting, e.g. for the first frame or after the
+        // application switched drawables.
+        ctx->pacing_valid = GL_TRUE;
+        ctx->pacing_drawable = drawable;
+        ctx->pacing_base_sbc = sbc;
+        ctx->pacing_frames = 0;
+    } else if (ctx->pacing_callback) {
+        // Every completed swap increments SBC and takes effect at a vblank,
+        // which increments MSC. Vblanks without a completed swap showed the
+        // previous image again; more swaps than vblanks means that images
+        // were replaced before they were ever scanned out.
+        int64_t d = (msc - ctx->pacing_last_msc) - (sbc - ctx->pacing_last_sbc);
+        if (d != 0) {
+            ctx->pacing_callback(ctx, d < 0 ? -d : 0, d > 0 ? d : 0,
+                    ctx->pacing_callback_data);
+        }
+    }
+    ctx->pacing_last_msc = msc;
+    ctx->pacing_last_sbc = sbc;
+
+    // Swaps that were issued for previous frames but have not completed yet
+    // are still queued, and each of them will take one vblank. The swap for
+    // the frame we are starting now will therefore land after them.
+    pending = ctx->pacing_frames - (sbc - ctx->pacing_base_sbc);
+    if (pending < 0)
+        pending = 0;
+    ctx->display_frame_counter = msc + 1 + pending;
+    ctx->pacing_frames++;
+    return GL_TRUE;
+}
+#endif
+
+#if GLS_USE_GLX
+/* Predict the display frame of the current frame again, without counting a
+ * new frame: rendering may have taken longer than expected since glsClear(). */
+static void refresh_frame_pacing(GLScontext* ctx)
+{
+    Display* dpy = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    int64_t ust, msc, sbc, pending;
+
+    if (!ctx->pacing_valid || !dpy || drawable != ctx->pacing_drawable
+            || !glXGetSyncValuesOML(dpy, drawable, &ust, &msc, &sbc))
+        return;
+    // glsClear() already counted the current frame
+    pending = (ctx->pacing_frames - 1) - (sbc - ctx->pacing_base_sbc);
+    if (pending < 0)
+        pending = 0;
+    if ((unsigned long)(msc + 1 + pending) > ctx->display_frame_counter)
+        ctx->display_frame_counter = msc + 1 + pending;
+}
+#endif
+
+static void update_display_frame_counter(GLScontext* ctx)
+{
+#if GLS_USE_GLX
+    GLuint display_frame_counter;
+    if (gl_have(ctx, GLS_GL_GLX_OML_SYNC_CONTROL) && update_frame_pacing(ctx))
+        return;
+    if (gl_have(ctx, GLS_GL_GLX_SGI_VIDEO_SYNC) && glXGetVideoSyncSGI(&display_frame_counter) == 0)
+        ctx->display_frame_counter = display_frame_counter;
+    else
+        ctx->display_frame_counter++;
+#else
+    ctx->display_frame_counter++;
+#endif
+}
+
+#if !GLS_USE_GLES
+/* Record a GPU timestamp for the current frame of the dynamic resolution
+ * controller. Marker 0 is the start of the frame, 1 + view the submission of
+ * a view, and 3 the end of the composition. */
+static void timestamp(GLScontext* ctx, int marker)
+{
+    GLS_timer* timer;
+    if (ctx->timer_pos < 0)
+        return;
+    timer = &ctx->timer[ctx->timer_pos];
+    glQueryCounter(timer->queries[marker], GL_TIMESTAMP);
+    timer->issued[marker] = GL_TRUE;
+}
+
+/* Adjust the render scales from the GPU timestamps of an earlier frame. The
+ * frame is skipped if its results are not available yet, so that we never
+ * wait for the GPU. */
+static void update_render_scale(GLScontext* ctx, const GLS_timer* timer)
+{
+    GLuint64 t[4];
+    GLint available;
+    double render[2] = { 0.0, 0.0 };
+    double render_sum, fixed, budget, factor;
+    GLuint64 last;
+    int i;
+
+    if (!timer->issued[0] || !(timer->issued[1] || timer->issued[2]))
+        return;
+    for (i = 0; i < 4; i++) {
+        if (!timer->issued[i])
+            continue;
+        glGetQueryObjectiv(timer->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        glGetQueryObjectui64v(timer->queries[i], GL_QUERY_RESULT, &t[i]);
+    }
+
+    /* A view's rendering time is the time since the previous marker,
+     * converted to the current render scale: it is roughly proportional to
+     * the number of pixels. */
+    last = t[0];
+    for (i = 0; i < 2; i++) {
+        const int v = (timer->issued[1] && timer->issued[2] && t[2] < t[1] ? 1 - i : i);
+        double s;
+        if (!timer->issued[1 + v])
+            continue;
+        s = glsGetRenderScale(ctx, v) / timer->scale[v];
+        render[v] = (t[1 + v] > last ? (t[1 + v] - last) * 1e-9 : 0.0) * s * s;
+        last = (t[1 + v] > last ? t[1 + v] : last);
+    }
+    render_sum = render[0] + render[1];
+    fixed = (timer->issued[3] && t[3] > last ? (t[3] - last) * 1e-9 : 0.0);
+    budget = ctx->dynres_budget;
+    if (render_sum <= 0.0
+            || (render_sum + fixed >= GLS_DYNRES_LOW * budget
+                && render_sum + fixed <= GLS_DYNRES_HIGH * budget))
+        return;
+
+    /* Scale the pixel count so that the frame meets the target */
+    factor = (GLS_DYNRES_TARGET * budget - fixed) / render_sum;
+    factor = (factor > 0.0 ? sqrt(factor) : 0.0);
+    if (factor > GLS_DYNRES_MAX_STEP_UP)
+        factor = GLS_DYNRES_MAX_STEP_UP;
+    for (i = 0; i < 2; i++) {
+        GLfloat scale;
+        if (!timer->issued[1 + i])
+            continue;
+        scale = ctx->dynres_scale[i] * (GLfloat)factor;
+        scale = (scale < ctx->dynres_min_scale ? ctx->dynres_min_scale
+                : scale > 1.0f ? 1.0f : scale);
+        ctx->dynres_scale[i] = scale;
+    }
+}
+
+/* Start the GPU timestamps of a new frame, and evaluate the oldest frame */
+static void begin_frame_timing(GLScontext* ctx)
+{
+    GLS_timer* timer;
+    ctx->timer_pos = (ctx->timer_pos + 1) % GLS_TIMER_FRAMES;
+    timer = &ctx->timer[ctx->timer_pos];
+    if (timer->queries[0] == 0)
+        glGenQueries(4, timer->queries);
+    else
+        update_render_scale(ctx, timer);
+    timer->issued[0] = GL_FALSE;
+    timer->issued[1] = GL_FALSE;
+    timer->issued[2] = GL_FALSE;
+    timer->issued[3] = GL_FALSE;
+    timer->scale[0] = glsGetRenderScale(ctx, GLS_VIEW_LEFT);
+    timer->scale[1] = glsGetRenderScale(ctx, GLS_VIEW_RIGHT);
+    timestamp(ctx, 0);
+}
+#endif
+
+void glsClear(GLScontext* ctx)
+{
+    trace_begin(ctx, "glsClear");
+    ctx->have_view[0] = 0;
+    ctx->have_view[1] = 0;
+    ctx->asym_frame++;
+#if !GLS_USE_GLES
+    if (ctx->dynres_budget > 0.0f)
+        begin_frame_timing(ctx);
+#endif
+
+    /* Get display frame counter */
+    update_display_frame_counter(ctx);
+    trace_end(ctx, "glsClear");
+}
+
+GLboolean glsIsViewRequired(GLScontext* ctx, GLSmode mode, GLboolean swap_views, GLSview view)
+{
+    if (ctx->compositor && mode == GLS_MODE_ALTERNATING)
+        // Only the compositor thread knows which view will be displayed
+        return GL_TRUE;
+    else if (mode == GLS_MODE_MONO_LEFT
+            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 0))
+        return (!swap_views && view == GLS_VIEW_LEFT) || (swap_views && view == GLS_VIEW_RIGHT);
+    else if (mode == GLS_MODE_MONO_RIGHT
+            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 1))
+        return (!swap_views && view == GLS_VIEW_RIGHT) || (swap_views && view == GLS_VIEW_LEFT);
+    else
+        return GL_TRUE;
+}
+
+void glsSetViewMatrices(GLScontext* ctx, GLSview view,
+        const GLfloat* projection, const GLfloat* modelview)
+{
+#if !GLS_USE_GLES
+    GLfloat projection_matrix[16];
+    GLfloat modelview_matrix[16];
+#endif
+    GLSdouble p[16], m[16];
+    int i;
+
+#if GLS_USE_GLES
+    // OpenGL ES has no matrix stack to take the matrices from
+    if (!projection || !modelview)
+        return;
+#else
+    if (!projection) {
+        glGetFloatv(GL_PROJECTION_MATRIX, projection_matrix);
+        projection = projection_matrix;
+    }
+    if (!modelview) {
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview_matrix);
+        modelview = modelview_matrix;
+    }
+#endif
+    for (i = 0; i < 16; i++) {
+        p[i] = projection[i];
+        m[i] = modelview[i];
+    }
+    mat4_mult(p, m, ctx->view_matrix[view]);
+}
+
+static void add_dirty_region(GLScontext* ctx, GLSview view,
+        GLint x, GLint y, GLint w, GLint h)
+{
+    GLint* r = ctx->view_dirty[view];
+    if (r[0] >= r[2] || r[1] >= r[3]) {
+        r[0] = x;
+        r[1] = y;
+        r[2] = x + w;
+        r[3] = y + h;
+    } else {
+        r[0] = (x < r[0] ? x : r[0]);
+        r[1] = (y < r[1] ? y : r[1]);
+        r[2] = (x + w > r[2] ? x + w : r[2]);
+        r[3] = (y + h > r[3] ? y + h : r[3]);
+    }
+}
+
+/* Make sure the GPU is done with the last composition that read our view
+ * textures, and that the texture of the given view exists, is bound, and has
+ * the given size. Returns whether the whole view needs to be updated. */
+static GLboolean prepare_view_tex(GLScontext* ctx, GLSview view, GLint width, GLint height)
+{
+    GLboolean full = GL_FALSE;
+
+#if !GLS_USE_GLES
+    // With a ring of view textures, the last composition that read them was
+    // some frames ago, so that we do not have to wait here.
+    if (ctx->view_released) {
+        while (glClientWaitSync(ctx->view_released, GL_SYNC_FLUSH_COMMANDS_BIT,
+                    1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(ctx->view_released);
+        ctx->view_released = 0;
+    }
+#endif
+
+    if (ctx->view_tex[view] == 0) {
+        glGenTextures(1, &(ctx->view_tex[view]));
+        ctx->view_tex_width[view] = -1;
+        ctx->view_tex_height[view] = -1;
+        ctx->view_tex_alloc_width[view] = -1;
+        ctx->view_tex_alloc_height[view] = -1;
+    }
+    glBindTexture(GL_TEXTURE_2D, ctx->view_tex[view]);
+    if (ctx->view_tex_alloc_width[view] < width
+            || ctx->view_tex_alloc_height[view] < height) {
+        GLint w = pool_size(width);
+        GLint h = pool_size(height);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT, w, h, 0,
+                GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLS_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLS_CLAMP_TO_BORDER);
+        label_object(ctx, GL_TEXTURE, ctx->view_tex[view],
+                view == GLS_VIEW_LEFT ? "gls left view" : "gls right view");
+        ctx->view_tex_alloc_width[view] = w;
+        ctx->view_tex_alloc_height[view] = h;
+    }
+    if (ctx->view_tex_width[view] != width
+            || ctx->view_tex_height[view] != height) {
+        ctx->view_tex_width[view] = width;
+        ctx->view_tex_height[view] = height;
+        // The previous content does not fit anymore, so we need the whole view.
+        full = GL_TRUE;
+    }
+    if (ctx->view_stale[view]) {
+        // The previous content is outdated, so we need the whole view.
+        ctx->view_stale[view] = GL_FALSE;
+        full = GL_TRUE;
+    }
+    return full;
+}
+
+#if !GLS_USE_GLES
+/* Copy the depth buffer of the current viewport into a depth texture */
+static void submit_depth(GLScontext* ctx, GLS_depth* depth, GLboolean resolve,
+        const char* label)
+{
+    GLenum format = (resolve ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24);
+    GLint texture_binding_2d_bak;
+    GLint viewport[4];
+
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_binding_2d_bak);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    if (depth->tex == 0) {
+        glGenTextures(1, &depth->tex);
+        depth->alloc_width = -1;
+        depth->alloc_height = -1;
+    }
+    glBindTexture(GL_TEXTURE_2D, depth->tex);
+    if (depth->alloc_width < viewport[2]
+            || depth->alloc_height < viewport[3]
+            || depth->format != format) {
+        GLint w = pool_size(viewport[2]);
+        GLint h = pool_size(viewport[3]);
+        // Blitting depth requires the format of the read framebuffer;
+        // a packed depth/stencil buffer is the most common one.
+        glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0,
+                resolve ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT,
+                resolve ? GL_UNSIGNED_INT_24_8 : GL_UNSIGNED_INT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        label_object(ctx, GL_TEXTURE, depth->tex, label);
+        depth->format = format;
+        depth->alloc_width = w;
+        depth->alloc_height = h;
+    }
+
+    trace_begin(ctx, resolve ? "resolve depth" : "copy depth");
+    if (resolve) {
+        GLint draw_framebuffer_bak;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer_bak);
+        if (ctx->depth_fbo == 0) {
+            glGenFramebuffers(1, &ctx->depth_fbo);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->depth_fbo);
+            label_object(ctx, GL_FRAMEBUFFER, ctx->depth_fbo, "gls depth resolve");
+            glDrawBuffer(GL_NONE);
+        } else {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->depth_fbo);
+        }
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                GL_TEXTURE_2D, depth->tex, 0);
+        glPushAttrib(GL_SCISSOR_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        glBlitFramebuffer(viewport[0], viewport[1],
+                viewport[0] + viewport[2], viewport[1] + viewport[3],
+                0, 0, viewport[2], viewport[3], GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glPopAttrib();
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_bak);
+    } else {
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+    trace_end(ctx, resolve ? "resolve depth" : "copy depth");
+
+    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
+}
+
+/* Keep a copy of the submitted view, the depth buffer of the current
+ * viewport, and the matrices of the view for reprojection */
+static void store_history(GLScontext* ctx, GLSview view, GLboolean resolve)
+{
+    GLS_history* history = &ctx->history[view];
+    GLint width = ctx->view_tex_width[view];
+    GLint height = ctx->view_tex_height[view];
+    GLint texture_binding_2d_bak;
+    GLint read_framebuffer_bak;
+
+    trace_begin(ctx, "store view for reprojection");
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_binding_2d_bak);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer_bak);
+
+    if (history->tex == 0) {
+        glGenTextures(1, &history->tex);
+        history->alloc_width = -1;
+        history->alloc_height = -1;
+    }
+    glBindTexture(GL_TEXTURE_2D, history->tex);
+    if (history->alloc_width < width || history->alloc_height < height) {
+        GLint w = pool_size(width);
+        GLint h = pool_size(height);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT, w, h, 0,
+                GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        label_object(ctx, GL_TEXTURE, history->tex,
+                view == GLS_VIEW_LEFT ? "gls last left view" : "gls last right view");
+        history->alloc_width = w;
+        history->alloc_height = h;
+    }
+    // The view texture may be parked in the view texture ring before the
+    // view is needed again, so copy it.
+    if (ctx->view_fbo == 0) {
+        glGenFramebuffers(1, &ctx->view_fbo);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx->view_fbo);
+        label_object(ctx, GL_FRAMEBUFFER, ctx->view_fbo, "gls view resolve");
+    } else {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx->view_fbo);
+    }
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, ctx->view_tex[view], 0);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_bak);
+    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
+
+    submit_depth(ctx, &history->depth, resolve,
+            view == GLS_VIEW_LEFT ? "gls last left depth" : "gls last right depth");
+    memcpy(history->matrix, ctx->view_matrix[view], sizeof(history->matrix));
+    history->width = width;
+    history->height = height;
+    history->valid = GL_TRUE;
+    trace_end(ctx, "store view for reprojection");
+}
+#endif
+
+/* Copy the current viewport into a view texture. Returns whether the read
+ * framebuffer is multisampled. */
+static GLboolean submit_view(GLScontext* ctx, GLSview view, const GLint* region)
+{
+    GLint texture_binding_2d_bak;
+    GLboolean resolve = GL_FALSE;
+    GLint viewport[4];
+    GLint x, y, w, h;
+
+    /* Backup GL state */
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_binding_2d_bak);
+
+    /* Get current viewport */
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    /* Check if the read framebuffer is multisampled. In this case we cannot
+     * copy from it, but we can resolve it directly into our view texture.
+     * Applications submit from the same framebuffer frame after frame, so
+     * this is only looked up when the binding changes. A framebuffer that is
+     * recreated, e.g. after a resize, often gets the same name again, so a
+     * new viewport size also triggers the lookup. */
+#if !GLS_USE_GLES
+    if (gl_have(ctx, GLS_GL_FRAMEBUFFER_OBJECT)) {
+        GLint read_framebuffer;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+        if (read_framebuffer != ctx->read_fbo
+                || viewport[2] != ctx->read_fbo_width || viewport[3] != ctx->read_fbo_height) {
+            GLint draw_framebuffer;
+            GLint sample_buffers;
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+            // GL_SAMPLE_BUFFERS refers to the draw framebuffer
+            if (read_framebuffer != draw_framebuffer)
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, read_framebuffer);
+            glGetIntegerv(GL_SAMPLE_BUFFERS, &sample_buffers);
+            if (read_framebuffer != draw_framebuffer)
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+            ctx->read_fbo = read_framebuffer;
+            ctx->read_fbo_width = viewport[2];
+            ctx->read_fbo_height = viewport[3];
+            ctx->read_fbo_multisampled = (sample_buffers > 0);
+        }
+        resolve = ctx->read_fbo_multisampled;
+    }
+#endif
+
+    /* Make sure our view texture can take the viewport content */
+    if (prepare_view_tex(ctx, view, viewport[2], viewport[3]))
+        region = NULL;
+
+    /* Determine the region to copy, in viewport coordinates */
+    x = 0;
+    y = 0;
+    w = viewport[2];
+    h = viewport[3];
+    if (region) {
+        x = (region[0] < 0 ? 0 : region[0]);
+        y = (region[1] < 0 ? 0 : region[1]);
+        w = (region[0] + region[2] > viewport[2] ? viewport[2] : region[0] + region[2]) - x;
+        h = (region[1] + region[3] > viewport[3] ? viewport[3] : region[1] + region[3]) - y;
+    }
+
+    /* Copy the GL_READ_BUFFER content to our view texture */
+    //glPixelTransferf(GL_RED_SCALE, 1.0f);
+    //glPixelTransferf(GL_GREEN_SCALE, 1.0f);
+    //glPixelTransferf(GL_BLUE_SCALE, 1.0f);
+    //glPixelTransferf(GL_RED_BIAS, 0.0f);
+    //glPixelTransferf(GL_GREEN_BIAS, 0.0f);
+    //glPixelTransferf(GL_BLUE_BIAS, 0.0f);
+#if !GLS_USE_GLES
+    if (w > 0 && h > 0 && resolve) {
+        GLboolean new_fbo = (ctx->view_fbo == 0);
+        GLint draw_framebuffer;
+        trace_begin(ctx, view == GLS_VIEW_LEFT ? "resolve left view" : "resolve right view");
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+        if (new_fbo)
+            glGenFramebuffers(1, &ctx->view_fbo);
+        glPushAttrib(GL_SCISSOR_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->view_fbo);
+        if (new_fbo)
+            label_object(ctx, GL_FRAMEBUFFER, ctx->view_fbo, "gls view resolve");
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                GL_TEXTURE_2D, ctx->view_tex[view], 0);
+        glBlitFramebuffer(viewport[0] + x, viewport[1] + y,
+                viewport[0] + x + w, viewport[1] + y + h,
+                x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+        glPopAttrib();
+        add_dirty_region(ctx, view, x, y, w, h);
+        trace_end(ctx, view == GLS_VIEW_LEFT ? "resolve left view" : "resolve right view");
+    } else
+#endif
+    if (w > 0 && h > 0) {
+        trace_begin(ctx, view == GLS_VIEW_LEFT ? "copy left view" : "copy right view");
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
+                viewport[0] + x, viewport[1] + y, w, h);
+        add_dirty_region(ctx, view, x, y, w, h);
+        trace_end(ctx, view == GLS_VIEW_LEFT ? "copy left view" : "copy right view");
+    }
+
+    /* Restore GL state */
+    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
+
+#if !GLS_USE_GLES
+    if (ctx->reproj_enabled)
+        store_history(ctx, view, resolve);
+    timestamp(ctx, 1 + view);
+#endif
+
+    ctx->have_view[view] = 1;
+    ctx->view_generation[view]++;
+    return resolve;
+}
+
+void glsSubmitView(GLScontext* ctx, GLSview view)
+{
+    trace_begin(ctx, "glsSubmitView");
+    submit_view(ctx, view, NULL);
+    trace_end(ctx, "glsSubmitView");
+}
+
+void glsSubmitViewRegion(GLScontext* ctx, GLSview view,
+        GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    const GLint region[4] = { x, y, width, height };
+    trace_begin(ctx, "glsSubmitViewRegion");
+    submit_view(ctx, view, region);
+    trace_end(ctx, "glsSubmitViewRegion");
+}
+
+#if !GLS_USE_GLES
+/* Render the other view from the given view and the depth texture */
+static void synthesize_view(GLScontext* ctx, GLSview view)
+{
+    GLSview target = (view == GLS_VIEW_LEFT ? GLS_VIEW_RIGHT : GLS_VIEW_LEFT);
+    GLint width = ctx->view_tex_width[view];
+    GLint height = ctx->view_tex_height[view];
+    GLfloat factor = (view == GLS_VIEW_LEFT
+            ? ctx->synth_disparity_factor : -ctx->synth_disparity_factor);
+    GLfloat inv_focal_length = 1.0f / ctx->synth_focal_length;
+    GLfloat disparity_near = factor * (inv_focal_length - 1.0f / ctx->synth_near);
+    GLfloat disparity_far = factor * (inv_focal_length - 1.0f / ctx->synth_far);
+    GLfloat disparity_min = (disparity_near < disparity_far ? disparity_near : disparity_far);
+    GLfloat disparity_max = (disparity_near < disparity_far ? disparity_far : disparity_near);
+    GLint current_program_bak;
+    GLint active_texture_bak;
+    GLint draw_framebuffer_bak;
+
+    trace_begin(ctx, "synthesize view");
+
+    /* Backup GL state */
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture_bak);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer_bak);
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+
+    if (ctx->synth_prg == 0) {
+        GLuint shader;
+        trace_begin(ctx, "compile shader");
+        shader = compile_shader(ctx, GL_FRAGMENT_SHADER, GLS_SYNTH_GLSL_STR);
+        ctx->synth_prg = glCreateProgram();
+        glAttachShader(ctx->synth_prg, shader);
+        link_program(ctx, ctx->synth_prg);
+        label_object(ctx, GL_SHADER, shader, "gls view synthesis shader");
+        label_object(ctx, GL_PROGRAM, ctx->synth_prg, "gls view synthesis program");
+        trace_end(ctx, "compile shader");
+    }
+
+    /* Render into the view texture of the other view */
+    prepare_view_tex(ctx, target, width, height);
+    if (ctx->view_fbo == 0) {
+        glGenFramebuffers(1, &ctx->view_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->view_fbo);
+        label_object(ctx, GL_FRAMEBUFFER, ctx->view_fbo, "gls view resolve");
+    } else {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->view_fbo);
+    }
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, ctx->view_tex[target], 0);
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_ALPHA_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glUseProgram(ctx->synth_prg);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ctx->view_tex[view]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, ctx->synth_depth.tex);
+    glUniform1i(glGetUniformLocation(ctx->synth_prg, "rgb"), 0);
+    glUniform1i(glGetUniformLocation(ctx->synth_prg, "depth"), 1);
+    glUniform2f(glGetUniformLocation(ctx->synth_prg, "rgb_scale"),
+            (GLfloat)width / ctx->view_tex_alloc_width[view],
+            (GLfloat)height / ctx->view_tex_alloc_height[view]);
+    glUniform2f(glGetUniformLocation(ctx->synth_prg, "depth_scale"),
+            (GLfloat)width / ctx->synth_depth.alloc_width,
+            (GLfloat)height / ctx->synth_depth.alloc_height);
+    glUniform2f(glGetUniformLocation(ctx->synth_prg, "pixel_size"),
+            1.0f / width, 1.0f / height);
+    glUniform2f(glGetUniformLocation(ctx->synth_prg, "depth_range"),
+            ctx->synth_near, ctx->synth_far);
+    glUniform1f(glGetUniformLocation(ctx->synth_prg, "disparity_factor"), factor);
+    glUniform1f(glGetUniformLocation(ctx->synth_prg, "inv_focal_length"), inv_focal_length);
+    // Objects near the near plane would need a very wide search; limit it
+    // to the disparities of comfortable stereo. Both ends are clamped, so
+    // that the range stays ordered even if it lies outside of the limit,
+    // e.g. for a focal length beyond the far plane.
+    if (disparity_min < -GLS_SYNTH_MAX_DISPARITY)
+        disparity_min = -GLS_SYNTH_MAX_DISPARITY;
+    else if (disparity_min > GLS_SYNTH_MAX_DISPARITY)
+        disparity_min = GLS_SYNTH_MAX_DISPARITY;
+    if (disparity_max < -GLS_SYNTH_MAX_DISPARITY)
+        disparity_max = -GLS_SYNTH_MAX_DISPARITY;
+    else if (disparity_max > GLS_SYNTH_MAX_DISPARITY)
+        disparity_max = GLS_SYNTH_MAX_DISPARITY;
+    glUniform2f(glGetUniformLocation(ctx->synth_prg, "disparity_range"),
+            disparity_min, disparity_max);
+    draw_quad(ctx, -1, width, height);
+
+    /* Restore GL state */
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+    glActiveTexture(active_texture_bak);
+    glUseProgram(current_program_bak);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_bak);
+
+    add_dirty_region(ctx, target, 0, 0, width, height);
+    ctx->have_view[target] = GL_TRUE;
+    ctx->view_generation[target]++;
+    trace_end(ctx, "synthesize view");
+}
+#endif
+
+void glsSubmitViewWithDepth(GLScontext* ctx, GLSview view)
+{
+    GLboolean resolve;
+
+    trace_begin(ctx, "glsSubmitViewWithDepth");
+    resolve = submit_view(ctx, view, NULL);
+#if !GLS_USE_GLES
+    if (gl_have(ctx, GLS_GL_FRAMEBUFFER_OBJECT)) {
+        submit_depth(ctx, &ctx->synth_depth, resolve, "gls depth");
+        synthesize_view(ctx, view);
+    }
+#else
+    (void)resolve;
+#endif
+    trace_end(ctx, "glsSubmitViewWithDepth");
+}
+
+void glsMarkViewDirty(GLScontext* ctx, GLSview view)
+{
+    // We do not know which part of the texture changed.
+    add_dirty_region(ctx, view, 0, 0, INT_MAX / 2, INT_MAX / 2);
+    ctx->view_generation[view]++;
+}
+
+/* OpenGL ES 2.0 can update our RGBA textures from RGBA pixels only */
+static GLint bytes_per_pixel(GLenum format)
+{
+    switch (format) {
+#if !GLS_USE_GLES
+    case GL_RGB:
+    case GL_BGR:
+        return 3;
+    case GL_BGRA:
+#endif
+    case GL_RGBA:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+/* Update a view texture from client memory, or from a pixel buffer object of
+ * the upload ring that was filled after map_upload(). */
+static void upload_view(GLScontext* ctx, GLSview view,
+        GLint width, GLint height, GLenum format, GLint stride,
+        GLS_upload* upload, const GLubyte* pixels)
+{
+    GLint texture_binding_2d_bak;
+#if GLS_USE_GLES
+    GLint unpack_alignment_bak;
+#else
+    GLint pixel_unpack_buffer_bak = 0;
+#endif
+    GLint bpp = bytes_per_pixel(format);
+
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture_binding_2d_bak);
+#if !GLS_USE_GLES
+    if (gl_have(ctx, GLS_GL_PIXEL_BUFFER_OBJECT)) {
+        // A bound pixel unpack buffer would be read by glTexImage2D()
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &pixel_unpack_buffer_bak);
+        if (pixel_unpack_buffer_bak != 0)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+#endif
+    prepare_view_tex(ctx, view, width, height);
+
+    trace_begin(ctx, view == GLS_VIEW_LEFT ? "upload left view" : "upload right view");
+#if GLS_USE_GLES
+    // OpenGL ES 2.0 has no pixel buffer objects, so upload is always NULL.
+    // It can only skip the alignment padding at the end of rows
+    (void)upload;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment_bak);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (stride == width * bpp) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                format, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        GLint y;
+        for (y = 0; y < height; y++)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1,
+                    format, GL_UNSIGNED_BYTE, pixels + (ptrdiff_t)y * stride);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment_bak);
+#else
+    if (upload) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+        if (!upload->persistent) {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            upload->ptr = NULL;
+        }
+    }
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    if (stride > 0 && stride % bpp == 0) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / bpp);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                format, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        // Rows that GL_UNPACK_ROW_LENGTH cannot describe
+        GLint y;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        for (y = 0; y < height; y++)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1,
+                    format, GL_UNSIGNED_BYTE, pixels + (ptrdiff_t)y * stride);
+    }
+    glPopClientAttrib();
+    if (upload && upload->persistent) {
+        // We must not write to the buffer until the GPU has read it
+        upload->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#endif
+    trace_end(ctx, view == GLS_VIEW_LEFT ? "upload left view" : "upload right view");
+
+#if !GLS_USE_GLES
+    if (upload || pixel_unpack_buffer_bak != 0)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_unpack_buffer_bak);
+#endif
+    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
+
+    add_dirty_region(ctx, view, 0, 0, width, height);
+    ctx->have_view[view] = GL_TRUE;
+    ctx->view_generation[view]++;
+}
+
+/* Map the next pixel buffer object of the upload ring for writing at least
+ * size bytes. Returns the slot, or -1 if pixel buffer objects are not
+ * available. */
+static GLint map_upload(GLScontext* ctx, GLsizeiptr size)
+{
+#if GLS_USE_GLES
+    (void)ctx;
+    (void)size;
+    return -1;
+#else
+    GLint pixel_unpack_buffer_bak;
+    GLS_upload* upload;
+    GLint slot;
+
+    if (!gl_have(ctx, GLS_GL_PIXEL_BUFFER_OBJECT))
+        return -1;
+
+    // Skip buffers that are mapped by glsMapView()
+    do {
+        slot = ctx->upload_ring_pos;
+        ctx->upload_ring_pos = (ctx->upload_ring_pos + 1) % GLS_UPLOAD_RING;
+    } while (slot == ctx->upload_map_slot[0] || slot == ctx->upload_map_slot[1]);
+    upload = &ctx->upload_ring[slot];
+
+    // With a ring of buffers, the upload from this buffer was some views
+    // ago, so that we do not have to wait here.
+    if (upload->fence) {
+        while (glClientWaitSync(upload->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                    1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(upload->fence);
+        upload->fence = 0;
+    }
+
+    if (upload->persistent && upload->size >= size) {
+        // The buffer is still mapped from the last upload
+        return slot;
+    }
+
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &pixel_unpack_buffer_bak);
+    if (gl_have(ctx, GLS_GL_BUFFER_STORAGE) && gl_have(ctx, GLS_GL_SYNC)) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        // Buffer storage is immutable, so a larger buffer is a new buffer.
+        delete_upload(ctx, upload);
+        upload->size = size + size / 8;
+        glGenBuffers(1, &upload->pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+        label_object(ctx, GL_BUFFER, upload->pbo, "gls upload");
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, upload->size, NULL, flags);
+        upload->ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, upload->size, flags);
+        upload->persistent = GL_TRUE;
+    } else {
+        if (upload->pbo == 0) {
+            glGenBuffers(1, &upload->pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+            label_object(ctx, GL_BUFFER, upload->pbo, "gls upload");
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+        }
+        if (upload->size < size)
+            upload->size = size + size / 8;
+        // Orphan the buffer, so that the driver does not wait for the
+        // GPU to finish the last upload from it.
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, upload->size, NULL, GL_STREAM_DRAW);
+        upload->ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_unpack_buffer_bak);
+    if (!upload->ptr) {
+        delete_upload(ctx, upload);
+        return -1;
+    }
+    return slot;
+#endif
+}
+
+GLboolean glsUploadView(GLScontext* ctx, GLSview view,
+        GLsizei width, GLsizei height, GLenum format, GLsizei stride,
+        const void* pixels)
+{
+    const GLubyte* src = pixels;
+    GLint bpp = bytes_per_pixel(format);
+    GLint row_size = width * bpp;
+    GLint slot;
+
+    if (bpp == 0 || width < 1 || height < 1 || ctx->upload_map_slot[view] >= 0)
+        return GL_FALSE;
+    if (stride == 0)
+        stride = row_size;
+
+    trace_begin(ctx, "glsUploadView");
+    slot = map_upload(ctx, (GLsizeiptr)row_size * height);
+    if (slot < 0) {
+        upload_view(ctx, view, width, height, format, stride, NULL, src);
+    } else {
+        GLubyte* dst = ctx->upload_ring[slot].ptr;
+        if (stride == row_size) {
+            memcpy(dst, src, (size_t)row_size * height);
+        } else {
+            GLint y;
+            for (y = 0; y < height; y++)
+                memcpy(dst + (size_t)y * row_size, src + (ptrdiff_t)y * stride, row_size);
+        }
+        upload_view(ctx, view, width, height, format, row_size, &ctx->upload_ring[slot], NULL);
+    }
+    trace_end(ctx, "glsUploadView");
+    return GL_TRUE;
+}
+
+void* glsMapView(GLScontext* ctx, GLSview view,
+        GLsizei width, GLsizei height, GLenum format, GLsizei* stride)
+{
+    GLint bpp = bytes_per_pixel(format);
+    size_t size = (size_t)width * height * bpp;
+    void* ptr;
+    GLint slot;
+
+    if (bpp == 0 || width < 1 || height < 1 || ctx->upload_map_slot[view] >= 0)
+        return NULL;
+
+    trace_begin(ctx, "glsMapView");
+    slot = map_upload(ctx, size);
+    if (slot >= 0) {
+        ptr = ctx->upload_ring[slot].ptr;
+    } else {
+        // Without pixel buffer objects, the view is written to client memory
+        if (ctx->upload_staging_size[view] < size) {
+            free(ctx->upload_staging[view]);
+            ctx->upload_staging[view] = malloc(size);
+            if (!ctx->upload_staging[view])
+                oom_abort();
+            ctx->upload_staging_size[view] = size;
+        }
+        ptr = ctx->upload_staging[view];
+        slot = GLS_UPLOAD_RING;
+    }
+    ctx->upload_map_slot[view] = slot;
+    ctx->upload_map_width[view] = width;
+    ctx->upload_map_height[view] = height;
+    ctx->upload_map_format[view] = format;
+    if (stride)
+        *stride = width * bpp;
+    trace_end(ctx, "glsMapView");
+    return ptr;
+}
+
+void glsUnmapView(GLScontext* ctx, GLSview view)
+{
+    GLint slot = ctx->upload_map_slot[view];
+    GLint width = ctx->upload_map_width[view];
+    GLint height = ctx->upload_map_height[view];
+    GLenum format = ctx->upload_map_format[view];
+
+    if (slot < 0)
+        return;
+    trace_begin(ctx, "glsUnmapView");
+    ctx->upload_map_slot[view] = -1;
+    if (slot == GLS_UPLOAD_RING) {
+        upload_view(ctx, view, width, height, format, width * bytes_per_pixel(format),
+                NULL, ctx->upload_staging[view]);
+    } else {
+        upload_view(ctx, view, width, height, format, width * bytes_per_pixel(format),
+                &ctx->upload_ring[slot], NULL);
+    }
+    trace_end(ctx, "glsUnmapView");
+}
+
+#if !GLS_USE_GLES
+/* Create the grid of vertices that reprojection draws for a view of the given
+ * size, with texture coordinates as positions */
+static void create_reprojection_grid(GLScontext* ctx, GLint width, GLint height)
+{
+    GLint cells_x = (width + GLS_REPROJECT_CELL - 1) / GLS_REPROJECT_CELL;
+    GLint cells_y = (height + GLS_REPROJECT_CELL - 1) / GLS_REPROJECT_CELL;
+    GLint vertices_x = cells_x + 1;
+    GLfloat* vertices;
+    GLuint* indices;
+    GLint x, y;
+
+    vertices = malloc(vertices_x * (cells_y + 1) * 2 * sizeof(GLfloat));
+    indices = malloc(cells_x * cells_y * 6 * sizeof(GLuint));
+    if (!vertices || !indices)
+        oom_abort();
+    for (y = 0; y <= cells_y; y++) {
+        for (x = 0; x <= cells_x; x++) {
+            GLfloat* v = vertices + 2 * (y * vertices_x + x);
+            GLint px = x * GLS_REPROJECT_CELL;
+            GLint py = y * GLS_REPROJECT_CELL;
+            v[0] = (GLfloat)(px < width ? px : width) / width;
+            v[1] = (GLfloat)(py < height ? py : height) / height;
+        }
+    }
+    for (y = 0; y < cells_y; y++) {
+        for (x = 0; x < cells_x; x++) {
+            GLuint* i = indices + 6 * (y * cells_x + x);
+            GLuint a = y * vertices_x + x;
+            i[0] = a;
+            i[1] = a + 1;
+            i[2] = a + vertices_x + 1;
+            i[3] = a;
+            i[4] = a + vertices_x + 1;
+            i[5] = a + vertices_x;
+        }
+    }
+
+    if (ctx->reproj_grid_vbo == 0) {
+        glGenBuffers(1, &ctx->reproj_grid_vbo);
+        glGenBuffers(1, &ctx->reproj_grid_ibo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, ctx->reproj_grid_vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices_x * (cells_y + 1) * 2 * sizeof(GLfloat),
+            vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->reproj_grid_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cells_x * cells_y * 6 * sizeof(GLuint),
+            indices, GL_STATIC_DRAW);
+    free(vertices);
+    free(indices);
+    ctx->reproj_grid_width = width;
+    ctx->reproj_grid_height = height;
+    ctx->reproj_grid_indices = cells_x * cells_y * 6;
+}
+
+/* Render the last view of the given eye as seen with the current matrices of
+ * that eye. Returns the texture that contains the result. */
+static GLuint reproject_view(GLScontext* ctx, GLSview view)
+{
+    const GLS_history* history = &ctx->history[view];
+    GLint width = history->width;
+    GLint height = history->height;
+    GLSdouble inverse[16], reprojection[16];
+    GLfloat reprojection_f[16];
+    GLint current_program_bak;
+    GLint active_texture_bak;
+    GLint draw_framebuffer_bak;
+    GLint array_buffer_bak;
+    GLint element_array_buffer_bak;
+    int i;
+
+    trace_begin(ctx, "reproject view");
+
+    /* Map clip space of the old matrices to clip space of the new ones */
+    if (mat4_invert(history->matrix, inverse))
+        mat4_mult(ctx->view_matrix[view], inverse, reprojection);
+    else
+        mat4_identity(reprojection);
+    for (i = 0; i < 16; i++)
+        reprojection_f[i] = reprojection[i];
+
+    /* Backup GL state */
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture_bak);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer_bak);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &array_buffer_bak);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_array_buffer_bak);
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
+
+    if (ctx->reproj_prg == 0) {
+        GLuint shaders[2];
+        trace_begin(ctx, "compile shader");
+        ctx->reproj_prg = glCreateProgram();
+        for (i = 0; i < 2; i++) {
+            char* shader_src = strdup(GLS_REPROJECT_GLSL_STR);
+            if (shader_src)
+                str_replace(&shader_src, "$stage", i == 0 ? "vertex_stage" : "fragment_stage");
+            if (!shader_src)
+                oom_abort();
+            shaders[i] = compile_shader(ctx,
+                    i == 0 ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER, shader_src);
+            free(shader_src);
+            glAttachShader(ctx->reproj_prg, shaders[i]);
+        }
+        link_program(ctx, ctx->reproj_prg);
+        label_object(ctx, GL_SHADER, shaders[0], "gls reprojection vertex shader");
+        label_object(ctx, GL_SHADER, shaders[1], "gls reprojection fragment shader");
+        label_object(ctx, GL_PROGRAM, ctx->reproj_prg, "gls reprojection program");
+        trace_end(ctx, "compile shader");
+    }
+    if (ctx->reproj_grid_width != width || ctx->reproj_grid_height != height)
+        create_reprojection_grid(ctx, width, height);
+
+    /* Render into a texture of our own, with a depth buffer */
+    if (ctx->reproj_fbo == 0) {
+        glGenTextures(1, &ctx->reproj_tex);
+        glGenRenderbuffers(1, &ctx->reproj_depth_rb);
+        glGenFramebuffers(1, &ctx->reproj_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->reproj_fbo);
+        label_object(ctx, GL_FRAMEBUFFER, ctx->reproj_fbo, "gls reprojection");
+        ctx->reproj_tex_alloc_width = -1;
+        ctx->reproj_tex_alloc_height = -1;
+    } else {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->reproj_fbo);
+    }
+    if (ctx->reproj_tex_alloc_width < width || ctx->reproj_tex_alloc_height < height) {
+        GLint w = pool_size(width);
+        GLint h = pool_size(height);
+        glBindTexture(GL_TEXTURE_2D, ctx->reproj_tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT, w, h, 0,
+                GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GLS_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GLS_CLAMP_TO_BORDER);
+        label_object(ctx, GL_TEXTURE, ctx->reproj_tex, "gls reprojected view");
+        glBindRenderbuffer(GL_RENDERBUFFER, ctx->reproj_depth_rb);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                GL_TEXTURE_2D, ctx->reproj_tex, 0);
+        glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                GL_RENDERBUFFER, ctx->reproj_depth_rb);
+        ctx->reproj_tex_alloc_width = w;
+        ctx->reproj_tex_alloc_height = h;
+    }
+    ctx->reproj_tex_width = width;
+    ctx->reproj_tex_height = height;
+
+    /* Render the grid */
+    glViewport(0, 0, width, height);
+    glDisable(GL_ALPHA_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClearDepth(1.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(ctx->reproj_prg);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, history->tex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, history->depth.tex);
+    glUniform1i(glGetUniformLocation(ctx->reproj_prg, "rgb"), 0);
+    glUniform1i(glGetUniformLocation(ctx->reproj_prg, "depth"), 1);
+    glUniform2f(glGetUniformLocation(ctx->reproj_prg, "rgb_scale"),
+            (GLfloat)width / history->alloc_width,
+            (GLfloat)height / history->alloc_height);
+    glUniform2f(glGetUniformLocation(ctx->reproj_prg, "depth_scale"),
+            (GLfloat)width / history->depth.alloc_width,
+            (GLfloat)height / history->depth.alloc_height);
+    glUniform2f(glGetUniformLocation(ctx->reproj_prg, "pixel_size"),
+            1.0f / width, 1.0f / height);
+    glUniformMatrix4fv(glGetUniformLocation(ctx->reproj_prg, "reprojection"),
+            1, GL_FALSE, reprojection_f);
+    glBindBuffer(GL_ARRAY_BUFFER, ctx->reproj_grid_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->reproj_grid_ibo);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, NULL);
+    glDrawElements(GL_TRIANGLES, ctx->reproj_grid_indices, GL_UNSIGNED_INT, NULL);
+
+    /* Restore GL state */
+    glPopClientAttrib();
+    glPopAttrib();
+    glBindBuffer(GL_ARRAY_BUFFER, array_buffer_bak);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_bak);
+    glActiveTexture(active_texture_bak);
+    glUseProgram(current_program_bak);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_bak);
+
+    trace_end(ctx, "reproject view");
+    return ctx->reproj_tex;
+}
+#endif
+
+#if GLS_USE_GLES
+/* OpenGL ES has no attribute stacks, so the composition saves the state that
+ * it changes itself. Only state that can be read without waiting for the GPU
+ * is involved. */
+typedef struct
+{
+    GLboolean enabled[5];
+    GLint texture_binding_2d[4];
+    GLint array_buffer_binding;
+    GLint element_array_buffer_binding;
+    GLint attribs;                      /* the number of attributes saved */
+    GLint attrib_enabled[4];
+    GLint attrib_buffer_binding[4];
+    GLint attrib_size[4];
+    GLint attrib_type[4];
+    GLint attrib_normalized[4];
+    GLint attrib_stride[4];
+    GLvoid* attrib_pointer[4];
+    GLint unpack_alignment;
+} GLS_state;
+
+static const GLenum state_caps[5] = {
+    GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_STENCIL_TEST
+};
+
+/* The texture units that the composition uses for 2D textures */
+static const GLenum state_units[4] = {
+    GL_TEXTURE0, GL_TEXTURE1, GL_TEXTURE2, GL_TEXTURE6
+};
+
+/* Save the state, including the given number of vertex attributes; the lens
+ * distortion mesh uses four, everything else one */
+static void save_state(GLS_state* state, GLint attribs)
+{
+    int i;
+    for (i = 0; i < 5; i++)
+        state->enabled[i] = glIsEnabled(state_caps[i]);
+    for (i = 0; i < 4; i++) {
+        glActiveTexture(state_units[i]);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &state->texture_binding_2d[i]);
+    }
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &state->array_buffer_binding);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &state->element_array_buffer_binding);
+    state->attribs = attribs;
+    for (i = 0; i < attribs; i++) {
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &state->attrib_enabled[i]);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &state->attrib_buffer_binding[i]);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &state->attrib_size[i]);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &state->attrib_type[i]);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &state->attrib_normalized[i]);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &state->attrib_stride[i]);
+        glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &state->attrib_pointer[i]);
+    }
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &state->unpack_alignment);
+}
+
+static void restore_state(const GLS_state* state)
+{
+    int i;
+    for (i = 0; i < 5; i++) {
+        if (state->enabled[i])
+            glEnable(state_caps[i]);
+        else
+            glDisable(state_caps[i]);
+    }
+    for (i = 0; i < 4; i++) {
+        glActiveTexture(state_units[i]);
+        glBindTexture(GL_TEXTURE_2D, state->texture_binding_2d[i]);
+    }
+    for (i = 0; i < state->attribs; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, state->attrib_buffer_binding[i]);
+        glVertexAttribPointer(i, state->attrib_size[i], state->attrib_type[i],
+                state->attrib_normalized[i], state->attrib_stride[i], state->attrib_pointer[i]);
+        if (!state->attrib_enabled[i])
+            glDisableVertexAttribArray(i);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, state->array_buffer_binding);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state->element_array_buffer_binding);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, state->unpack_alignment);
+}
+
+/* Get the size of the window that the default framebuffer belongs to */
+static GLboolean surface_size(EGLint* width, EGLint* height)
+{
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    return (surface != EGL_NO_SURFACE
+            && eglQuerySurface(display, surface, EGL_WIDTH, width)
+            && eglQuerySurface(display, surface, EGL_HEIGHT, height));
+}
+
+/* Tell tiled GPUs which contents of the default framebuffer the composition
+ * does not need, so that they are neither loaded into tile memory before it
+ * nor stored after it. The color buffer is only discarded if the composition
+ * overwrites all of it. */
+static void discard_framebuffer(GLScontext* ctx, const GLint* viewport, GLboolean depth_stencil)
+{
+    GLenum attachments[3];
+    GLsizei n = 0;
+    GLint framebuffer;
+    EGLint width, height;
+
+    if (!ctx->discard_framebuffer)
+        return;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    if (framebuffer != 0)
+        return;
+    if (viewport && viewport[0] <= 0 && viewport[1] <= 0
+            && surface_size(&width, &height)
+            && viewport[0] + viewport[2] >= width
+            && viewport[1] + viewport[3] >= height)
+        attachments[n++] = GL_COLOR_EXT;
+    if (depth_stencil) {
+        attachments[n++] = GL_DEPTH_EXT;
+        attachments[n++] = GL_STENCIL_EXT;
+    }
+    if (n > 0)
+        ctx->discard_framebuffer(GL_FRAMEBUFFER, n, attachments);
+}
+#endif
+
+void glsDrawSubmittedViews(GLScontext* ctx, GLSmode mode, GLboolean swap_views)
+{
+    GLuint left_tex = 0, right_tex = 0;
+    if (ctx->have_view[0])
+        left_tex = ctx->view_tex[0];
+    if (ctx->have_view[1])
+        right_tex = ctx->view_tex[1];
+    trace_begin(ctx, "glsDrawSubmittedViews");
+#if GLS_USE_THREADS
+    if (ctx->compositor)
+        enqueue_frame(ctx, mode, swap_views);
+    else
+#endif
+    {
+#if !GLS_USE_GLES
+        if (mode == GLS_MODE_ALTERNATING && ctx->reproj_enabled) {
+            // If the view that is due was not submitted, e.g. because the
+            // frame is late, reproject the last submission of it.
+            GLSview view;
+#if GLS_USE_GLX
+            refresh_frame_pacing(ctx);
+#endif
+            view = ((ctx->display_frame_counter % 2 == 0) != (swap_views != GL_FALSE)
+                    ? GLS_VIEW_LEFT : GLS_VIEW_RIGHT);
+            if (!ctx->have_view[view] && ctx->history[view].valid) {
+                if (view == GLS_VIEW_LEFT)
+                    left_tex = reproject_view(ctx, view);
+                else
+                    right_tex = reproject_view(ctx, view);
+            }
+        }
+#else
+        // The depth and stencil buffers hold what the application rendered
+        // for the submitted views, which is of no use anymore.
+        discard_framebuffer(ctx, NULL, GL_TRUE);
+#endif
+        glsDrawViews(ctx, mode, swap_views, left_tex, right_tex);
+#if !GLS_USE_GLES
+        timestamp(ctx, 3);
+        if (ctx->view_ring_size > 1) {
+            // Park our views until the GPU is done with this composition,
+            // and continue with the pair that was parked longest ago.
+            GLS_views* views = &ctx->view_ring[ctx->view_ring_pos];
+            if (ctx->view_released)
+                glDeleteSync(ctx->view_released);
+            ctx->view_released = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            exchange_views(ctx, views);
+            ctx->view_ring_pos = (ctx->view_ring_pos + 1) % (ctx->view_ring_size - 1);
+        }
+#endif
+    }
+    trace_end(ctx, "glsDrawSubmittedViews");
+}
+
+#if !GLS_USE_GLES
+/* Compute the regions of the composed frame that need to be updated if only
+ * the contents of the views changed since the cached composition. Returns the
+ * number of regions (x, y, w, h), or 0 if the whole frame needs to be updated. */
+static int dirty_output_regions(GLScontext* ctx, GLSmode mode,
+        const GLint viewport[4], GLint regions[2][4])
+{
+    const GLint width = viewport[2];
+    const GLint height = viewport[3];
+    GLint halves[2][4];
+    GLint d[4] = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+    GLint tex_width = 0, tex_height = 0;
+    GLint margin, n, i;
+
+    // The lens distortion moves every part of a view
+    if (mode == GLS_MODE_HMD)
+        return 0;
+
+    /* Get the union of the dirty view regions, in view texture coordinates */
+    for (i = 0; i < 2; i++) {
+        const GLint* r = ctx->view_dirty[i];
+        if (ctx->view_generation[i] == ctx->cache_key.view_generation[i])
+            continue;
+        if (ctx->cache_key.view_tex[i] != ctx->view_tex[i])
+            return 0;   // not our texture; we do not know what changed
+        if (tex_width != 0 && (tex_width != ctx->view_tex_width[i]
+                    || tex_height != ctx->view_tex_height[i]))
+            return 0;
+        tex_width = ctx->view_tex_width[i];
+        tex_height = ctx->view_tex_height[i];
+        d[0] = (r[0] < d[0] ? r[0] : d[0]);
+        d[1] = (r[1] < d[1] ? r[1] : d[1]);
+        d[2] = (r[2] > d[2] ? r[2] : d[2]);
+        d[3] = (r[3] > d[3] ? r[3] : d[3]);
+    }
+    if (tex_width <= 0 || tex_height <= 0 || d[0] >= d[2] || d[1] >= d[3])
+        return 0;
+
+    /* The masked modes filter over one neighboring texel, and linear
+     * interpolation reaches one texel further. Parallax adjustment shifts
+     * the views horizontally. */
+    margin = (mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_EVEN_ODD_COLUMNS
+            || mode == GLS_MODE_CHECKERBOARD ? 2 : 1);
+    if (ctx->upsample)
+        margin++;   // the bicubic filter reaches one texel further
+    d[0] -= margin + (GLint)ceilf(fabsf(ctx->parallax_adjust) * tex_width);
+    d[1] -= margin;
+    d[2] += margin + (GLint)ceilf(fabsf(ctx->parallax_adjust) * tex_width);
+    d[3] += margin;
+
+    /* Determine the output areas into which views are drawn */
+    n = 1;
+    halves[0][0] = 0;
+    halves[0][1] = 0;
+    halves[0][2] = width;
+    halves[0][3] = height;
+    if (mode == GLS_MODE_LEFT_RIGHT) {
+        GLint hw = width / 2;
+        n = 2;
+        halves[0][2] = hw;
+        halves[1][0] = hw;
+        halves[1][1] = 0;
+        halves[1][2] = width - hw;
+        halves[1][3] = height;
+    } else if (mode == GLS_MODE_TOP_BOTTOM || mode == GLS_MODE_HDMI_FRAME_PACK) {
+        GLint blank_lines = (mode == GLS_MODE_HDMI_FRAME_PACK ? height / 49 : 0);
+        GLint hh = (height - blank_lines) / 2;
+        n = 2;
+        halves[0][1] = hh + blank_lines;
+        halves[0][3] = height - hh - blank_lines;
+        halves[1][0] = 0;
+        halves[1][1] = 0;
+        halves[1][2] = width;
+        halves[1][3] = hh;
+    }
+
+    /* Map the dirty region into each output area. We do not distinguish
+     * between the views here, since the view placement depends on view
+     * swapping. */
+    for (i = 0; i < n; i++) {
+        const GLint* a = halves[i];
+        GLint x0 = a[0] + (GLint)floor((double)d[0] * a[2] / tex_width) - 1;
+        GLint y0 = a[1] + (GLint)floor((double)d[1] * a[3] / tex_height) - 1;
+        GLint x1 = a[0] + (GLint)ceil((double)d[2] * a[2] / tex_width) + 1;
+        GLint y1 = a[1] + (GLint)ceil((double)d[3] * a[3] / tex_height) + 1;
+        x0 = (x0 < a[0] ? a[0] : x0);
+        y0 = (y0 < a[1] ? a[1] : y0);
+        x1 = (x1 > a[0] + a[2] ? a[0] + a[2] : x1);
+        y1 = (y1 > a[1] + a[3] ? a[1] + a[3] : y1);
+        regions[i][0] = x0;
+        regions[i][1] = y0;
+        regions[i][2] = (x1 > x0 ? x1 - x0 : 0);
+        regions[i][3] = (y1 > y0 ? y1 - y0 : 0);
+    }
+    return n;
+}
+#endif
+
+/* The shader variant of each mode */
+static const char* const mode_defines[] = {
+    "mode_onechannel",                  // GLS_MODE_QUAD_BUFFER_STEREO
+    "mode_onechannel",                  // GLS_MODE_ALTERNATING
+    "mode_onechannel",                  // GLS_MODE_MONO_LEFT
+    "mode_onechannel",                  // GLS_MODE_MONO_RIGHT
+    "mode_onechannel",                  // GLS_MODE_LEFT_RIGHT
+    "mode_onechannel",                  // GLS_MODE_TOP_BOTTOM
+    "mode_onechannel",                  // GLS_MODE_HDMI_FRAME_PACK
+    "mode_even_odd_rows",
+    "mode_even_odd_columns",
+    "mode_checkerboard",
+    "mode_red_cyan_monochrome",
+    "mode_red_cyan_half_color",
+    "mode_red_cyan_full_color",
+    "mode_red_cyan_dubois",
+    "mode_green_magenta_monochrome",
+    "mode_green_magenta_half_color",
+    "mode_green_magenta_full_color",
+    "mode_green_magenta_dubois",
+    "mode_amber_blue_monochrome",
+    "mode_amber_blue_half_color",
+    "mode_amber_blue_full_color",
+    "mode_amber_blue_dubois",
+    "mode_red_green_monochrome",
+    "mode_red_blue_monochrome",
+    "mode_hmd"
+};
+
+/* Decide everything that depends only on the mode. This makes no OpenGL
+ * calls, and leaves the program of the pipeline alone. */
+static void init_pipeline(GLSpipeline* pipe, GLSmode mode, GLboolean swap_views, GLbitfield flags)
+{
+    pipe->mode = mode;
+    pipe->swap_views = swap_views;
+    pipe->flags = flags;
+    pipe->masked = (mode == GLS_MODE_EVEN_ODD_ROWS
+            || mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD);
+    pipe->screen_parity_x = (mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD);
+    pipe->screen_parity_y = (mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_CHECKERBOARD);
+    pipe->mask_tex = 0;
+    pipe->mode_define = ((int)mode >= 0 && (size_t)mode < sizeof(mode_defines) / sizeof(mode_defines[0])
+            ? mode_defines[mode] : mode_defines[0]);
+    pipe->ghostbust_mode = (pipe->masked || pipe->mode_define == mode_defines[0]
+            || mode == GLS_MODE_HMD);
+    pipe->channel = -1.0f;
+    switch (mode) {
+    case GLS_MODE_QUAD_BUFFER_STEREO:
+        pipe->path = GLS_DRAW_QUAD_BUFFER;
+        break;
+    case GLS_MODE_ALTERNATING:
+        pipe->path = GLS_DRAW_ALTERNATING;
+        break;
+    case GLS_MODE_LEFT_RIGHT:
+        pipe->path = GLS_DRAW_LEFT_RIGHT;
+        break;
+    case GLS_MODE_TOP_BOTTOM:
+        pipe->path = GLS_DRAW_TOP_BOTTOM;
+        break;
+    case GLS_MODE_HDMI_FRAME_PACK:
+        pipe->path = GLS_DRAW_HDMI_FRAME_PACK;
+        break;
+    case GLS_MODE_HMD:
+        pipe->path = GLS_DRAW_HMD;
+        break;
+    case GLS_MODE_MONO_RIGHT:
+        pipe->path = GLS_DRAW_FULL;
+        pipe->channel = 1.0f;
+        break;
+    case GLS_MODE_MONO_LEFT:
+        pipe->path = GLS_DRAW_FULL;
+        pipe->channel = 0.0f;
+        break;
+    default:
+        pipe->path = GLS_DRAW_FULL;
+        break;
+    }
+}
+
+/* Get the mask texture of a masked mode, and create it on first use */
+static GLuint mask_texture(GLScontext* ctx, GLSmode mode)
+{
+    static const GLubyte masks[3][4] = {
+        { 0xff, 0xff, 0x00, 0x00 },     // even/odd rows
+        { 0xff, 0x00, 0xff, 0x00 },     // even/odd columns
+        { 0xff, 0x00, 0x00, 0xff }      // checkerboard
+    };
+    static const char* const labels[3] = {
+        "gls even/odd rows mask", "gls even/odd columns mask", "gls checkerboard mask"
+    };
+    GLuint* tex;
+    int i;
+
+    if (mode == GLS_MODE_EVEN_ODD_ROWS) {
+        tex = &ctx->even_odd_rows_mask_tex;
+        i = 0;
+    } else if (mode == GLS_MODE_EVEN_ODD_COLUMNS) {
+        tex = &ctx->even_odd_columns_mask_tex;
+        i = 1;
+    } else {
+        tex = &ctx->checkerboard_mask_tex;
+        i = 2;
+    }
+    if (*tex == 0) {
+        trace_begin(ctx, "create mask texture");
+        glGenTextures(1, tex);
+        glBindTexture(GL_TEXTURE_2D, *tex);
+        label_object(ctx, GL_TEXTURE, *tex, labels[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+#if !GLS_USE_GLES
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GLS_LUMINANCE_INTERNAL_FORMAT, 2, 2, 0,
+                GL_LUMINANCE, GL_UNSIGNED_BYTE, masks[i]);
+        trace_end(ctx, "create mask texture");
+    }
+    return *tex;
+}
+
+/* The lookup tables that the program of a pipeline needs. The view lookup
+ * tables follow the views when they are swapped. */
+static GLint pipeline_luts(GLScontext* ctx, GLint left, GLint right)
+{
+    return (ctx->lut_tex[left] != 0 ? 1 : 0)
+        | (ctx->lut_tex[right] != 0 ? 2 : 0)
+        | (ctx->lut_tex[2] != 0 ? 4 : 0);
+}
+
+/* Build the program of a pipeline for the given shader variant, replacing
+ * its old program, and look up its uniforms. The program is left in use. */
+static void build_pipeline_program(GLScontext* ctx, GLSpipeline* pipe,
+        GLint ghostbust, GLint luts, GLint overlay)
+{
+    static const char* const lut_tex_names[3] = { "lut_l_tex", "lut_r_tex", "lut_output_tex" };
+    static const char* const lut_range_names[3] = { "lut_l_range", "lut_r_range", "lut_output_range" };
+    char* shader_src;
+    GLuint shader;
+    int i;
+
+    trace_begin(ctx, "compile shader");
+    if (pipe->prg != 0)
+        delete_program(ctx, pipe->prg);
+    shader_src = strdup(GLS_GLSL_STR);
+    if (shader_src)
+        str_replace(&shader_src, "$ghostbust",
+                ghostbust ? "ghostbust_enabled" : "ghostbust_disabled");
+    if (shader_src)
+        str_replace(&shader_src, "$mode", pipe->mode_define);
+    if (shader_src)
+        str_replace(&shader_src, "$upsample",
+                ctx->upsample ? "upsample_bicubic" : "upsample_linear");
+    if (shader_src)
+        str_replace(&shader_src, "$lut_left",
+                luts & 1 ? "lut_left_enabled" : "lut_left_disabled");
+    if (shader_src)
+        str_replace(&shader_src, "$lut_right",
+                luts & 2 ? "lut_right_enabled" : "lut_right_disabled");
+    if (shader_src)
+        str_replace(&shader_src, "$lut_output",
+                luts & 4 ? "lut_output_enabled" : "lut_output_disabled");
+    if (shader_src)
+        str_replace(&shader_src, "$overlay",
+                overlay == 0 ? "overlay_none"
+                : overlay == 1 + GLS_ALPHA_STRAIGHT ? "overlay_straight"
+                : "overlay_premultiplied");
+    if (!shader_src)
+        oom_abort();
+    shader = compile_shader(ctx, GL_FRAGMENT_SHADER, shader_src);
+    free(shader_src);
+    pipe->prg = glCreateProgram();
+    glAttachShader(pipe->prg, shader);
+#if GLS_USE_GLES
+    shader_src = strdup(GLS_QUAD_GLSL_STR);
+    if (shader_src)
+        str_replace(&shader_src, "$vertices",
+                pipe->path == GLS_DRAW_HMD ? "mesh_vertices" : "quad_vertices");
+    if (!shader_src)
+        oom_abort();
+    glAttachShader(pipe->prg, compile_shader(ctx, GL_VERTEX_SHADER, shader_src));
+    free(shader_src);
+    glBindAttribLocation(pipe->prg, 0, "position");
+    glBindAttribLocation(pipe->prg, 1, "texcoord_red");
+    glBindAttribLocation(pipe->prg, 2, "texcoord_green");
+    glBindAttribLocation(pipe->prg, 3, "texcoord_blue");
+#endif
+    link_program(ctx, pipe->prg);
+    label_object(ctx, GL_SHADER, shader, "gls composition shader");
+    label_object(ctx, GL_PROGRAM, pipe->prg, "gls composition program");
+    pipe->prg_mode_define = pipe->mode_define;
+    pipe->prg_ghostbust = ghostbust;
+    pipe->prg_upsample = ctx->upsample;
+    pipe->prg_luts = luts;
+    pipe->prg_overlay = overlay;
+
+    // Uniforms that change between frames are looked up once; texture units
+    // never change, so they are set once
+    pipe->loc_rgb_scale[0] = glGetUniformLocation(pipe->prg, "rgb_l_scale");
+    pipe->loc_rgb_scale[1] = glGetUniformLocation(pipe->prg, "rgb_r_scale");
+    pipe->loc_rgb_size[0] = glGetUniformLocation(pipe->prg, "rgb_l_size");
+    pipe->loc_rgb_size[1] = glGetUniformLocation(pipe->prg, "rgb_r_size");
+    pipe->loc_parallax_adjust = glGetUniformLocation(pipe->prg, "parallax_adjust");
+    pipe->loc_crosstalk = glGetUniformLocation(pipe->prg, "crosstalk");
+    pipe->loc_channel = glGetUniformLocation(pipe->prg, "channel");
+    pipe->loc_step[0] = glGetUniformLocation(pipe->prg, "step_l");
+    pipe->loc_step[1] = glGetUniformLocation(pipe->prg, "step_r");
+    for (i = 0; i < 3; i++) {
+        pipe->loc_lut_range[i] = (luts & (1 << i)
+                ? glGetUniformLocation(pipe->prg, lut_range_names[i]) : -1);
+    }
+    pipe->loc_overlay_rect = (overlay ? glGetUniformLocation(pipe->prg, "overlay_rect") : -1);
+    pipe->loc_overlay_shift = (overlay ? glGetUniformLocation(pipe->prg, "overlay_shift") : -1);
+#if GLS_USE_GLES
+    pipe->loc_mask_scale = glGetUniformLocation(pipe->prg, "mask_scale");
+#else
+    pipe->loc_mask_scale = -1;
+#endif
+    glUseProgram(pipe->prg);
+    glUniform1i(glGetUniformLocation(pipe->prg, "rgb_l"), 0);
+    glUniform1i(glGetUniformLocation(pipe->prg, "rgb_r"), 1);
+    if (pipe->masked)
+        glUniform1i(glGetUniformLocation(pipe->prg, "mask_tex"), 2);
+    for (i = 0; i < 3; i++) {
+        if (luts & (1 << i))
+            glUniform1i(glGetUniformLocation(pipe->prg, lut_tex_names[i]), 3 + i);
+    }
+    if (overlay)
+        glUniform1i(glGetUniformLocation(pipe->prg, "overlay_tex"), 6);
+    trace_end(ctx, "compile shader");
+}
+
+/* Create the lens distortion mesh of the HMD mode for a viewport of the given
+ * size. Each vertex has its position in the half of its eye, followed by the
+ * view texture coordinates of the red, green, and blue channel. The vertices
+ * and indices of the left half come first. */
+static void create_hmd_mesh(GLScontext* ctx, GLint width, GLint height)
+{
+    const GLint n = GLS_HMD_MESH_CELLS + 1;     // vertices in each direction
+    const GLsizei eye_indices = GLS_HMD_MESH_CELLS * GLS_HMD_MESH_CELLS * 6;
+    const GLfloat* k = ctx->hmd_distortion;
+    const GLfloat* ca = ctx->hmd_chromatic_aberration;
+    // Distances are measured in units of half the height of a half
+    const GLfloat aspect = (height > 0 && width > 1 ? (GLfloat)(width / 2) / height : 1.0f);
+    GLfloat* vertices;
+    GLushort* indices;
+    GLint eye, x, y, c;
+
+    trace_begin(ctx, "create lens distortion mesh");
+    vertices = malloc(2 * n * n * 8 * sizeof(GLfloat));
+    indices = malloc(2 * eye_indices * sizeof(GLushort));
+    if (!vertices || !indices)
+        oom_abort();
+    for (eye = 0; eye < 2; eye++) {
+        // The lens centers are offset toward the center of the display
+        GLfloat center = (eye == 0 ? ctx->hmd_lens_offset : -ctx->hmd_lens_offset);
+        for (y = 0; y < n; y++) {
+            for (x = 0; x < n; x++) {
+                GLfloat* v = vertices + 8 * ((eye * n + y) * n + x);
+                GLfloat px = -1.0f + 2.0f * x / GLS_HMD_MESH_CELLS;
+                GLfloat py = -1.0f + 2.0f * y / GLS_HMD_MESH_CELLS;
+                GLfloat dx = (px - center) * aspect;
+                GLfloat r2 = dx * dx + py * py;
+                GLfloat f = k[0] + r2 * (k[1] + r2 * (k[2] + r2 * k[3]));
+                v[0] = px;
+                v[1] = py;
+                for (c = 0; c < 3; c++) {
+                    GLfloat s = f * (c == 0 ? ca[0] : c == 2 ? ca[1] : 1.0f);
+                    v[2 + 2 * c] = ((px - center) * s + 1.0f) / 2.0f;
+                    v[3 + 2 * c] = (py * s + 1.0f) / 2.0f;
+                }
+            }
+        }
+        for (y = 0; y < GLS_HMD_MESH_CELLS; y++) {
+            for (x = 0; x < GLS_HMD_MESH_CELLS; x++) {
+                GLushort* i = indices + eye * eye_indices + 6 * (y * GLS_HMD_MESH_CELLS + x);
+                GLushort a = (GLushort)((eye * n + y) * n + x);
+                i[0] = a;
+                i[1] = a + 1;
+                i[2] = a + n + 1;
+                i[3] = a;
+                i[4] = a + n + 1;
+                i[5] = a + n;
+            }
+        }
+    }
+
+    if (ctx->hmd_mesh_vbo == 0) {
+        glGenBuffers(1, &ctx->hmd_mesh_vbo);
+        glGenBuffers(1, &ctx->hmd_mesh_ibo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, ctx->hmd_mesh_vbo);
+    glBufferData(GL_ARRAY_BUFFER, 2 * n * n * 8 * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->hmd_mesh_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * eye_indices * sizeof(GLushort),
+            indices, GL_STATIC_DRAW);
+    free(vertices);
+    free(indices);
+    ctx->hmd_mesh_width = width;
+    ctx->hmd_mesh_height = height;
+    trace_end(ctx, "create lens distortion mesh");
+}
+
+/* Draw the half of the lens distortion mesh that belongs to the given eye
+ * into the current viewport */
+static void draw_hmd_mesh(GLScontext* ctx, GLint eye)
+{
+    const GLsizei stride = 8 * sizeof(GLfloat);
+    const GLsizei eye_indices = GLS_HMD_MESH_CELLS * GLS_HMD_MESH_CELLS * 6;
+    int i;
+
+    glBindBuffer(GL_ARRAY_BUFFER, ctx->hmd_mesh_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx->hmd_mesh_ibo);
+#if GLS_USE_GLES
+    // Attribute 0 is the position, 1 to 3 are the texture coordinates
+    for (i = 0; i < 4; i++) {
+        glVertexAttribPointer(i, 2, GL_FLOAT, GL_FALSE, stride,
+                (const GLvoid*)(2 * i * sizeof(GLfloat)));
+        glEnableVertexAttribArray(i);
+    }
+#else
+    // Texture coordinate sets 0 to 2 become texcoord_l, texcoord_r, and
+    // texcoord_mask in the shader
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, NULL);
+    for (i = 0; i < 3; i++) {
+        glClientActiveTexture(GL_TEXTURE0 + i);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, (const GLvoid*)(2 * (i + 1) * sizeof(GLfloat)));
+    }
+    glClientActiveTexture(GL_TEXTURE0);
+#endif
+    glDrawElements(GL_TRIANGLES, eye_indices, GL_UNSIGNED_SHORT,
+            (const GLvoid*)(eye * eye_indices * sizeof(GLushort)));
+}
+
+static void draw_views(GLScontext* ctx, GLSpipeline* pipe,
+        const GLuint view_textures[2], GLint left, GLint right,
+        const GLint viewport[4])
+{
+    GLfloat scale[2][2];        // used part of the left and right view textures
+    GLfloat size[2][2];         // their size in texels
+    GLint ghostbust;
+    GLint luts;
+    GLint overlay;
+    int i;
+
+    /* Check the shader variant; this is all that depends on the settings */
+    if (pipe->masked && pipe->mask_tex == 0)
+        pipe->mask_tex = mask_texture(ctx, pipe->mode);
+    ghostbust = (pipe->ghostbust_mode && ctx->ghostbust > 0.0f);
+    luts = pipeline_luts(ctx, left, right);
+    overlay = (ctx->overlay_tex != 0 ? 1 + ctx->overlay_alpha_mode : 0);
+    if (pipe->prg == 0 || pipe->prg_mode_define != pipe->mode_define
+            || pipe->prg_ghostbust != ghostbust
+            || pipe->prg_upsample != ctx->upsample
+            || pipe->prg_luts != luts
+            || pipe->prg_overlay != overlay) {
+        build_pipeline_program(ctx, pipe, ghostbust, luts, overlay);
+    } else {
+        glUseProgram(pipe->prg);
+    }
+
+    /* Per-frame inputs */
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, view_textures[left]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, view_textures[right]);
+    glUniform1f(pipe->loc_parallax_adjust, ctx->parallax_adjust);
+    view_tex_scale(ctx, view_textures[left], scale[0]);
+    glUniform2f(pipe->loc_rgb_scale[0], scale[0][0], scale[0][1]);
+    view_tex_scale(ctx, view_textures[right], scale[1]);
+    glUniform2f(pipe->loc_rgb_scale[1], scale[1][0], scale[1][1]);
+    // the right view texture is still bound to unit 1
+    view_tex_size(ctx, view_textures[right], viewport, size[1]);
+    glActiveTexture(GL_TEXTURE0);
+    view_tex_size(ctx, view_textures[left], viewport, size[0]);
+    glUniform2f(pipe->loc_rgb_size[0], size[0][0], size[0][1]);
+    glUniform2f(pipe->loc_rgb_size[1], size[1][0], size[1][1]);
+    for (i = 0; i < 3; i++) {
+        GLint lut = (i == 0 ? left : i == 1 ? right : 2);
+        GLfloat n = ctx->lut_size[lut];
+        if (!(luts & (1 << i)))
+            continue;
+        glActiveTexture(GL_TEXTURE3 + i);
+        glBindTexture(GL_TEXTURE_3D, ctx->lut_tex[lut]);
+        glUniform2f(pipe->loc_lut_range[i], (n - 1.0f) / n, 0.5f / n);
     }
-    glBindTexture(GL_TEXTURE_2D, ctx->view_tex[view]);
-    if (ctx->view_tex_width[view] != viewport[2]
-            || ctx->view_tex_height[view] != viewport[3]) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, viewport[2], viewport[3], 0,
-                GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        ctx->view_tex_width[view] = viewport[2];
-        ctx->view_tex_height[view] = viewport[3];
+    if (overlay) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, ctx->overlay_tex);
+        glUniform4f(pipe->loc_overlay_rect,
+                ctx->overlay_rect[0], ctx->overlay_rect[1],
+                ctx->overlay_rect[2], ctx->overlay_rect[3]);
+        glUniform1f(pipe->loc_overlay_shift, ctx->overlay_disparity / 2.0f);
+    }
+    if (ghostbust) {
+        glUniform3f(pipe->loc_crosstalk,
+                ctx->crosstalk_r * ctx->ghostbust,
+                ctx->crosstalk_g * ctx->ghostbust,
+                ctx->crosstalk_b * ctx->ghostbust);
+    }
+    if (pipe->masked) {
+        // The filters step by one output pixel, or by one texel of views
+        // that have a lower resolution than the output.
+        GLfloat step[2][2];
+        for (i = 0; i < 2; i++) {
+            GLfloat w = size[i][0] * scale[i][0];
+            GLfloat h = size[i][1] * scale[i][1];
+            step[i][0] = 1.0f / (w < viewport[2] ? w : viewport[2]);
+            step[i][1] = 1.0f / (h < viewport[3] ? h : viewport[3]);
+        }
+        glUniform2f(pipe->loc_step[0], step[0][0], step[0][1]);
+        glUniform2f(pipe->loc_step[1], step[1][0], step[1][1]);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, pipe->mask_tex);
     }
 
-    /* Copy the GL_READ_BUFFER content to our view texture */
-    //glPixelTransferf(GL_RED_SCALE, 1.0f);
-    //glPixelTransferf(GL_GREEN_SCALE, 1.0f);
-    //glPixelTransferf(GL_BLUE_SCALE, 1.0f);
-    //glPixelTransferf(GL_RED_BIAS, 0.0f);
-    //glPixelTransferf(GL_GREEN_BIAS, 0.0f);
-    //glPixelTransferf(GL_BLUE_BIAS, 0.0f);
-    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-            viewport[0], viewport[1], viewport[2], viewport[3]);
-
-    /* Restore GL state */
-    glBindTexture(GL_TEXTURE_2D, texture_binding_2d_bak);
-
-    ctx->have_view[view] = 1;
+    /* Render */
+    switch (pipe->path) {
+    case GLS_DRAW_FULL:
+        trace_begin(ctx, "draw");
+        if (pipe->channel >= 0.0f)
+            glUniform1f(pipe->loc_channel, pipe->channel);
+        draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+        trace_end(ctx, "draw");
+        break;
+    case GLS_DRAW_QUAD_BUFFER:
+        trace_begin(ctx, "draw back left");
+        glUniform1f(pipe->loc_channel, 0.0f);
+#if !GLS_USE_GLES
+        glDrawBuffer(GL_BACK_LEFT);
+#endif
+        draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+        trace_end(ctx, "draw back left");
+        trace_begin(ctx, "draw back right");
+        glUniform1f(pipe->loc_channel, 1.0f);
+#if !GLS_USE_GLES
+        glDrawBuffer(GL_BACK_RIGHT);
+#endif
+        draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+        trace_end(ctx, "draw back right");
+        break;
+    case GLS_DRAW_ALTERNATING:
+        if (ctx->display_frame_counter % 2 == 0) {
+            trace_begin(ctx, "draw left view");
+            glUniform1f(pipe->loc_channel, 0.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw left view");
+        } else {
+            trace_begin(ctx, "draw right view");
+            glUniform1f(pipe->loc_channel, 1.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw right view");
+        }
+        break;
+    case GLS_DRAW_LEFT_RIGHT:
+        {
+            int hw = viewport[2] / 2;
+            trace_begin(ctx, "draw left half");
+            glViewport(viewport[0], viewport[1], hw, viewport[3]);
+            glUniform1f(pipe->loc_channel, 0.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw left half");
+            trace_begin(ctx, "draw right half");
+            glViewport(viewport[0] + hw, viewport[1], viewport[2] - hw, viewport[3]);
+            glUniform1f(pipe->loc_channel, 1.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw right half");
+        }
+        break;
+    case GLS_DRAW_TOP_BOTTOM:
+        {
+            int hh = viewport[3] / 2;
+            trace_begin(ctx, "draw top half");
+            glViewport(viewport[0], viewport[1] + hh, viewport[2], viewport[3] - hh);
+            glUniform1f(pipe->loc_channel, 0.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw top half");
+            trace_begin(ctx, "draw bottom half");
+            glViewport(viewport[0], viewport[1], viewport[2], hh);
+            glUniform1f(pipe->loc_channel, 1.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw bottom half");
+        }
+        break;
+    case GLS_DRAW_HDMI_FRAME_PACK:
+        {
+            // HDMI frame packing mode has left view top, right view bottom, plus a
+            // blank area separating the two. 720p uses 30 blank lines (total: 720
+            // + 30 + 720 = 1470), 1080p uses 45 (total: 10280 + 45 + 1080 = 2205).
+            // In both cases, the blank area is 30/1470 = 45/2205 = 1/49 of the
+            // total height. See the document "High-Definition Multimedia Interface
+            // Specification Version 1.4a Extraction of 3D Signaling Portion" from
+            // hdmi.org.
+            int blank_lines = viewport[3] / 49;
+            int hh = (viewport[3] - blank_lines) / 2;
+            glViewport(viewport[0], viewport[1] + hh, viewport[2], blank_lines);
+            glClear(GL_COLOR_BUFFER_BIT);
+            trace_begin(ctx, "draw top half");
+            glViewport(viewport[0], viewport[1] + hh + blank_lines, viewport[2], viewport[3] - hh - blank_lines);
+            glUniform1f(pipe->loc_channel, 0.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw top half");
+            trace_begin(ctx, "draw bottom half");
+            glViewport(viewport[0], viewport[1], viewport[2], hh);
+            glUniform1f(pipe->loc_channel, 1.0f);
+            draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
+            trace_end(ctx, "draw bottom half");
+        }
+        break;
+    case GLS_DRAW_HMD:
+        {
+            int hw = viewport[2] / 2;
+            if (ctx->hmd_mesh_width != viewport[2] || ctx->hmd_mesh_height != viewport[3])
+                create_hmd_mesh(ctx, viewport[2], viewport[3]);
+            trace_begin(ctx, "draw left half");
+            glViewport(viewport[0], viewport[1], hw, viewport[3]);
+            glUniform1f(pipe->loc_channel, 0.0f);
+            draw_hmd_mesh(ctx, 0);
+            trace_end(ctx, "draw left half");
+            trace_begin(ctx, "draw right half");
+            glViewport(viewport[0] + hw, viewport[1], viewport[2] - hw, viewport[3]);
+            glUniform1f(pipe->loc_channel, 1.0f);
+            draw_hmd_mesh(ctx, 1);
+            trace_end(ctx, "draw right half");
+        }
+        break;
+    }
 }
 
-void glsDrawSubmittedViews(GLScontext* ctx, GLSmode mode, GLboolean swap_views)
+/* Set the state that draw_quad() needs, after the caller saved it */
+static void init_draw_state(GLScontext* ctx)
 {
-    GLuint left_tex = 0, right_tex = 0;
-    if (ctx->have_view[0])
-        left_tex = ctx->view_tex[0];
-    if (ctx->have_view[1])
-        right_tex = ctx->view_tex[1];
-    glsDrawViews(ctx, mode, swap_views, left_tex, right_tex);
+    (void)ctx;
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+#if !GLS_USE_GLES
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glDisable(GL_ALPHA_TEST);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_FOG);
+    glDisable(GL_NORMALIZE);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_EDGE_FLAG_ARRAY);
+    glDisableClientState(GL_FOG_COORD_ARRAY);
+    glDisableClientState(GL_INDEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_SECONDARY_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_TEXTURE_2D);
+#endif
 }
 
-void glsDrawViews(GLScontext* ctx, GLSmode mode, GLboolean swap_views,
+/* Compose with a pipeline; the common part of glsDrawViews() and
+ * glsDrawViewsWithPipeline() */
+static void draw_views_with_pipeline(GLScontext* ctx, GLSpipeline* pipe,
         GLuint left_tex, GLuint right_tex)
 {
+    const GLboolean keep_state = ((pipe->flags & GLS_PIPELINE_KEEP_STATE) != 0);
     GLuint view_textures[2] = { left_tex, right_tex };
     GLint viewport[4];
-    GLint current_program_bak;
-    GLint active_texture_bak;
+    GLint current_program_bak = 0;
+    GLint active_texture_bak = GL_TEXTURE0;
+#if GLS_USE_GLES
+    GLS_state state_bak;
+#else
+    GLint draw_framebuffer_bak = 0;
+    GLint read_framebuffer_bak = 0;
+    GLboolean use_cache;
+#endif
     GLint left, right;
 
     if (view_textures[0] == 0 && view_textures[1] == 0) {
@@ -564,276 +4395,453 @@ void glsDrawViews(GLScontext* ctx, GLSmode mode, GLboolean swap_views,
 
     /* Backup GL state */
     glGetIntegerv(GL_VIEWPORT, viewport);
-    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture_bak);
-    glPushAttrib(GL_ALL_ATTRIB_BITS);
-    glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
+    if (!keep_state) {
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture_bak);
+#if GLS_USE_GLES
+        save_state(&state_bak, pipe->path == GLS_DRAW_HMD ? 4 : 1);
+#else
+        glPushAttrib(GL_ALL_ATTRIB_BITS);
+        glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+#endif
+    }
+
+#if !GLS_USE_GLES
+    /* Check whether to use the composition cache. It does not help for
+     * modes that change the view every frame or that render into more than
+     * one draw buffer. */
+    use_cache = (ctx->cache_enabled
+            && pipe->path != GLS_DRAW_QUAD_BUFFER
+            && pipe->path != GLS_DRAW_ALTERNATING
+            && gl_have(ctx, GLS_GL_FRAMEBUFFER_OBJECT));
+    if (use_cache) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer_bak);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer_bak);
+    }
+#endif
 
     /* Determine left and right view indices */
     left = (view_textures[0] == 0 ? 1 : 0);
     right = (left == 0 ? 1 : 0);
     if (view_textures[right] == 0)
         right = left;
-    if (swap_views) {
+    if (pipe->swap_views) {
         GLint tmp = left;
         left = right;
         right = tmp;
     }
-    if ((mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_CHECKERBOARD)
-            && (ctx->viewport_screen_y + viewport[1]) % 2 == 0) {
+    // Windows move, so the screen position is checked in each frame
+    if (pipe->screen_parity_y && (ctx->viewport_screen_y + viewport[1]) % 2 == 0) {
         GLint tmp = left;
         left = right;
         right = tmp;
     }
-    if ((mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD)
-            && (ctx->viewport_screen_x + viewport[0]) % 2 == 1) {
+    if (pipe->screen_parity_x && (ctx->viewport_screen_x + viewport[0]) % 2 == 1) {
         GLint tmp = left;
         left = right;
         right = tmp;
     }
 
     /* Initialize GL things */
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_ALPHA_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_SCISSOR_TEST);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_LIGHTING);
-    glDisable(GL_BLEND);
-    glDisable(GL_FOG);
-    glDisable(GL_NORMALIZE);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_EDGE_FLAG_ARRAY);
-    glDisableClientState(GL_FOG_COORD_ARRAY);
-    glDisableClientState(GL_INDEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_SECONDARY_COLOR_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glEnable(GL_TEXTURE_2D);
-    if (mode == GLS_MODE_EVEN_ODD_ROWS && ctx->even_odd_rows_mask_tex == 0) {
-        GLubyte even_odd_rows_mask[4] = { 0xff, 0xff, 0x00, 0x00 };
-        glGenTextures(1, &ctx->even_odd_rows_mask_tex);
-        glBindTexture(GL_TEXTURE_2D, ctx->even_odd_rows_mask_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, 2, 2, 0,
-                GL_LUMINANCE, GL_UNSIGNED_BYTE, even_odd_rows_mask);
-    }
-    if (mode == GLS_MODE_EVEN_ODD_COLUMNS && ctx->even_odd_columns_mask_tex == 0) {
-        GLubyte even_odd_columns_mask[4] = { 0xff, 0x00, 0xff, 0x00 };
-        glGenTextures(1, &ctx->even_odd_columns_mask_tex);
-        glBindTexture(GL_TEXTURE_2D, ctx->even_odd_columns_mask_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, 2, 2, 0,
-                GL_LUMINANCE, GL_UNSIGNED_BYTE, even_odd_columns_mask);
+    init_draw_state(ctx);
+#if GLS_USE_GLES
+    // OpenGL ES 2.0 has no glBlitFramebuffer(), so there is no composition cache
+    discard_framebuffer(ctx, viewport, GL_FALSE);
+#else
+    if (use_cache) {
+        /* Compose into the cache only if something changed, and present the
+         * cached result. */
+        GLS_composition_key key;
+        memset(&key, 0, sizeof(key));
+        key.mode = pipe->mode;
+        key.left = left;
+        key.right = right;
+        key.view_tex[0] = view_textures[0];
+        key.view_tex[1] = view_textures[1];
+        key.view_generation[0] = ctx->view_generation[0];
+        key.view_generation[1] = ctx->view_generation[1];
+        key.width = viewport[2];
+        key.height = viewport[3];
+        key.parallax_adjust = ctx->parallax_adjust;
+        key.crosstalk[0] = ctx->crosstalk_r;
+        key.crosstalk[1] = ctx->crosstalk_g;
+        key.crosstalk[2] = ctx->crosstalk_b;
+        key.ghostbust = ctx->ghostbust;
+        key.lut_tex[0] = ctx->lut_tex[0];
+        key.lut_tex[1] = ctx->lut_tex[1];
+        key.lut_tex[2] = ctx->lut_tex[2];
+        key.overlay_tex = ctx->overlay_tex;
+        if (ctx->overlay_tex != 0) {
+            key.overlay_alpha_mode = ctx->overlay_alpha_mode;
+            memcpy(key.overlay_rect, ctx->overlay_rect, sizeof(key.overlay_rect));
+            key.overlay_disparity = ctx->overlay_disparity;
+        }
+        if (!ctx->cache_valid || memcmp(&key, &ctx->cache_key, sizeof(key)) != 0) {
+            const GLint cache_viewport[4] = { 0, 0, viewport[2], viewport[3] };
+            GLint regions[2][4];
+            int region_count = 0;
+            if (ctx->cache_valid) {
+                // If only view contents changed, update only their regions
+                GLS_composition_key k = key;
+                k.view_generation[0] = ctx->cache_key.view_generation[0];
+                k.view_generation[1] = ctx->cache_key.view_generation[1];
+                if (memcmp(&k, &ctx->cache_key, sizeof(k)) == 0)
+                    region_count = dirty_output_regions(ctx, pipe->mode, viewport, regions);
+            }
+            trace_begin(ctx, "compose into cache");
+            if (ctx->cache_tex == 0) {
+                glGenTextures(1, &ctx->cache_tex);
+                glGenFramebuffers(1, &ctx->cache_fbo);
+                ctx->cache_tex_alloc_width = -1;
+                ctx->cache_tex_alloc_height = -1;
+            }
+            if (ctx->cache_tex_alloc_width < viewport[2]
+                    || ctx->cache_tex_alloc_height < viewport[3]) {
+                GLint w = pool_size(viewport[2]);
+                GLint h = pool_size(viewport[3]);
+                glBindTexture(GL_TEXTURE_2D, ctx->cache_tex);
+                glTexImage2D(GL_TEXTURE_2D, 0, GLS_RGBA_INTERNAL_FORMAT, w, h, 0,
+                        GLS_RGBA_FORMAT, GLS_RGBA_TYPE, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, ctx->cache_fbo);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                        GL_TEXTURE_2D, ctx->cache_tex, 0);
+                label_object(ctx, GL_TEXTURE, ctx->cache_tex, "gls composition cache");
+                label_object(ctx, GL_FRAMEBUFFER, ctx->cache_fbo, "gls composition cache");
+                ctx->cache_tex_alloc_width = w;
+                ctx->cache_tex_alloc_height = h;
+            }
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->cache_fbo);
+            glViewport(0, 0, viewport[2], viewport[3]);
+            if (region_count == 0) {
+                draw_views(ctx, pipe, view_textures, left, right, cache_viewport);
+            } else {
+                int i;
+                glEnable(GL_SCISSOR_TEST);
+                for (i = 0; i < region_count; i++) {
+                    if (regions[i][2] <= 0 || regions[i][3] <= 0)
+                        continue;
+                    glScissor(regions[i][0], regions[i][1], regions[i][2], regions[i][3]);
+                    draw_views(ctx, pipe, view_textures, left, right, cache_viewport);
+                }
+                glDisable(GL_SCISSOR_TEST);
+            }
+            memset(ctx->view_dirty, 0, sizeof(ctx->view_dirty));
+            ctx->cache_key = key;
+            ctx->cache_valid = GL_TRUE;
+            trace_end(ctx, "compose into cache");
+        }
+        trace_begin(ctx, "present cache");
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, ctx->cache_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_bak);
+        glBlitFramebuffer(0, 0, viewport[2], viewport[3],
+                viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+                GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_bak);
+        trace_end(ctx, "present cache");
+    } else
+#endif
+    {
+        draw_views(ctx, pipe, view_textures, left, right, viewport);
     }
-    if (mode == GLS_MODE_CHECKERBOARD && ctx->checkerboard_mask_tex == 0) {
-        GLubyte checkerboard_mask[4] = { 0xff, 0x00, 0x00, 0xff };
-        glGenTextures(1, &ctx->checkerboard_mask_tex);
-        glBindTexture(GL_TEXTURE_2D, ctx->checkerboard_mask_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, 2, 2, 0,
-                GL_LUMINANCE, GL_UNSIGNED_BYTE, checkerboard_mask);
-    }
-    if (ctx->prg == 0 || ctx->prg_mode != mode
-            || ctx->prg_ghostbust != (ctx->ghostbust > 0.0f)) {
-        const char* ghostbust_val = ctx->ghostbust > 0.0f
-            ? "ghostbust_enabled" : "ghostbust_disabled";
-        const char* mode_val =
-              mode == GLS_MODE_EVEN_ODD_ROWS ? "mode_even_odd_rows"
-            : mode == GLS_MODE_EVEN_ODD_COLUMNS ? "mode_even_odd_columns"
-            : mode == GLS_MODE_CHECKERBOARD ? "mode_checkerboard"
-            : mode == GLS_MODE_RED_CYAN_MONOCHROME ? "mode_red_cyan_monochrome"
-            : mode == GLS_MODE_RED_CYAN_HALF_COLOR ? "mode_red_cyan_half_color"
-            : mode == GLS_MODE_RED_CYAN_FULL_COLOR ? "mode_red_cyan_full_color"
-            : mode == GLS_MODE_RED_CYAN_DUBOIS ? "mode_red_cyan_dubois"
-            : mode == GLS_MODE_GREEN_MAGENTA_MONOCHROME ? "mode_green_magenta_monochrome"
-            : mode == GLS_MODE_GREEN_MAGENTA_HALF_COLOR ? "mode_green_magenta_half_color"
-            : mode == GLS_MODE_GREEN_MAGENTA_FULL_COLOR ? "mode_green_magenta_full_color"
-            : mode == GLS_MODE_GREEN_MAGENTA_DUBOIS ? "mode_green_magenta_dubois"
-            : mode == GLS_MODE_AMBER_BLUE_MONOCHROME ? "mode_amber_blue_monochrome"
-            : mode == GLS_MODE_AMBER_BLUE_HALF_COLOR ? "mode_amber_blue_half_color"
-            : mode == GLS_MODE_AMBER_BLUE_FULL_COLOR ? "mode_amber_blue_full_color"
-            : mode == GLS_MODE_AMBER_BLUE_DUBOIS ? "mode_amber_blue_dubois"
-            : mode == GLS_MODE_RED_GREEN_MONOCHROME ? "mode_red_green_monochrome"
-            : mode == GLS_MODE_RED_BLUE_MONOCHROME ? "mode_red_blue_monochrome"
-            : "mode_onechannel";
-        char* shader_src = strdup(GLS_GLSL_STR);
-        GLuint shader;
-        if (shader_src)
-            str_replace(&shader_src, "$ghostbust", ghostbust_val);
-        if (shader_src)
-            str_replace(&shader_src, "$mode", mode_val);
-        if (!shader_src)
-            oom_abort();
-        shader = compile_fragment_shader(ctx, shader_src);
-        free(shader_src);
-        ctx->prg = glCreateProgram();
-        glAttachShader(ctx->prg, shader);
-        link_program(ctx, ctx->prg);
-        ctx->prg_mode = mode;
-        ctx->prg_ghostbust = (ctx->ghostbust > 0.0f);
-    }
-    glUseProgram(ctx->prg);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, view_textures[left]);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, view_textures[right]);
-    glUniform1i(glGetUniformLocation(ctx->prg, "rgb_l"), 0);
-    glUniform1i(glGetUniformLocation(ctx->prg, "rgb_r"), 1);
-    glUniform1f(glGetUniformLocation(ctx->prg, "parallax_adjust"),
-            ctx->parallax_adjust);
-    if (mode != GLS_MODE_RED_CYAN_MONOCHROME
-            && mode != GLS_MODE_RED_CYAN_HALF_COLOR
-            && mode != GLS_MODE_RED_CYAN_FULL_COLOR
-            && mode != GLS_MODE_RED_CYAN_DUBOIS
-            && mode != GLS_MODE_GREEN_MAGENTA_MONOCHROME
-            && mode != GLS_MODE_GREEN_MAGENTA_HALF_COLOR
-            && mode != GLS_MODE_GREEN_MAGENTA_FULL_COLOR
-            && mode != GLS_MODE_GREEN_MAGENTA_DUBOIS
-            && mode != GLS_MODE_AMBER_BLUE_MONOCHROME
-            && mode != GLS_MODE_AMBER_BLUE_HALF_COLOR
-            && mode != GLS_MODE_AMBER_BLUE_FULL_COLOR
-            && mode != GLS_MODE_AMBER_BLUE_DUBOIS
-            && mode != GLS_MODE_RED_BLUE_MONOCHROME
-            && mode != GLS_MODE_RED_GREEN_MONOCHROME
-            && ctx->ghostbust > 0.0f) {
-        glUniform3f(glGetUniformLocation(ctx->prg, "crosstalk"),
-                ctx->crosstalk_r * ctx->ghostbust,
-                ctx->crosstalk_g * ctx->ghostbust,
-                ctx->crosstalk_b * ctx->ghostbust);
+
+    /* Restore GL state */
+    if (!keep_state) {
+#if GLS_USE_GLES
+        restore_state(&state_bak);
+#else
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+        glPopClientAttrib();
+        glPopAttrib();
+#endif
+        glActiveTexture(active_texture_bak);
+        glUseProgram(current_program_bak);
     }
-    if (mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_EVEN_ODD_COLUMNS
-            || mode == GLS_MODE_CHECKERBOARD) {
-        glUniform1i(glGetUniformLocation(ctx->prg, "mask_tex"), 2);
-        glUniform1f(glGetUniformLocation(ctx->prg, "step_x"), 1.0f / viewport[2]);
-        glUniform1f(glGetUniformLocation(ctx->prg, "step_y"), 1.0f / viewport[3]);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void glsDrawViews(GLScontext* ctx, GLSmode mode, GLboolean swap_views,
+        GLuint left_tex, GLuint right_tex)
+{
+    GLSpipeline* pipe = &ctx->draw_pipeline;
+
+    trace_begin(ctx, "glsDrawViews");
+    if (pipe->mode != mode || pipe->swap_views != (swap_views != GL_FALSE))
+        init_pipeline(pipe, mode, swap_views != GL_FALSE, 0);
+    draw_views_with_pipeline(ctx, pipe, left_tex, right_tex);
+    trace_end(ctx, "glsDrawViews");
+}
+
+GLSpipeline* glsCreatePipeline(GLScontext* ctx, GLSmode mode, GLboolean swap_views,
+        GLbitfield flags)
+{
+    GLSpipeline* pipe = calloc(1, sizeof(GLSpipeline));
+    GLint current_program_bak;
+    GLint left = (swap_views ? 1 : 0);
+
+    if (!pipe)
+        oom_abort();
+    init_pipeline(pipe, mode, swap_views != GL_FALSE, flags);
+    pipe->prg = 0;
+    // Build the program for the current settings now, so that the first
+    // frame does not have to
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
+    build_pipeline_program(ctx, pipe,
+            pipe->ghostbust_mode && ctx->ghostbust > 0.0f,
+            pipeline_luts(ctx, left, 1 - left),
+            ctx->overlay_tex != 0 ? 1 + ctx->overlay_alpha_mode : 0);
+    glUseProgram(current_program_bak);
+    return pipe;
+}
+
+void glsDestroyPipeline(GLScontext* ctx, GLSpipeline* pipeline)
+{
+    if (pipeline) {
+        GLint current_program;
+        // With GLS_PIPELINE_KEEP_STATE, the program may still be in use
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
+        if (pipeline->prg != 0 && (GLuint)current_program == pipeline->prg)
+            glUseProgram(0);
+        delete_program(ctx, pipeline->prg);
+        free(pipeline);
     }
+}
 
-    /* Render */
-    if (mode == GLS_MODE_QUAD_BUFFER_STEREO) {
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 0.0f);
-        glDrawBuffer(GL_BACK_LEFT);
-        draw_quad(ctx, viewport[2], viewport[3]);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 1.0f);
-        glDrawBuffer(GL_BACK_RIGHT);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_EVEN_ODD_ROWS) {
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, ctx->even_odd_rows_mask_tex);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_EVEN_ODD_COLUMNS) {
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, ctx->even_odd_columns_mask_tex);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_CHECKERBOARD) {
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, ctx->checkerboard_mask_tex);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_RED_CYAN_MONOCHROME
-            || mode == GLS_MODE_RED_CYAN_HALF_COLOR
-            || mode == GLS_MODE_RED_CYAN_FULL_COLOR
-            || mode == GLS_MODE_RED_CYAN_DUBOIS
-            || mode == GLS_MODE_GREEN_MAGENTA_MONOCHROME
-            || mode == GLS_MODE_GREEN_MAGENTA_HALF_COLOR
-            || mode == GLS_MODE_GREEN_MAGENTA_FULL_COLOR
-            || mode == GLS_MODE_GREEN_MAGENTA_DUBOIS
-            || mode == GLS_MODE_AMBER_BLUE_MONOCHROME
-            || mode == GLS_MODE_AMBER_BLUE_HALF_COLOR
-            || mode == GLS_MODE_AMBER_BLUE_FULL_COLOR
-            || mode == GLS_MODE_AMBER_BLUE_DUBOIS
-            || mode == GLS_MODE_RED_GREEN_MONOCHROME
-            || mode == GLS_MODE_RED_BLUE_MONOCHROME) {
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_MONO_LEFT
-            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 0)) {
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 0.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_MONO_RIGHT
-            || (mode == GLS_MODE_ALTERNATING && ctx->display_frame_counter % 2 == 1)) {
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 1.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_LEFT_RIGHT) {
-        int hw = viewport[2] / 2;
-        glViewport(viewport[0], viewport[1], hw, viewport[3]);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 0.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-        glViewport(viewport[0] + hw, viewport[1], viewport[2] - hw, viewport[3]);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 1.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_TOP_BOTTOM) {
-        int hh = viewport[3] / 2;
-        glViewport(viewport[0], viewport[1] + hh, viewport[2], viewport[3] - hh);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 0.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-        glViewport(viewport[0], viewport[1], viewport[2], hh);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 1.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-    } else if (mode == GLS_MODE_HDMI_FRAME_PACK) {
-        // HDMI frame packing mode has left view top, right view bottom, plus a
-        // blank area separating the two. 720p uses 30 blank lines (total: 720
-        // + 30 + 720 = 1470), 1080p uses 45 (total: 10280 + 45 + 1080 = 2205).
-        // In both cases, the blank area is 30/1470 = 45/2205 = 1/49 of the
-        // total height. See the document "High-Definition Multimedia Interface
-        // Specification Version 1.4a Extraction of 3D Signaling Portion" from
-        // hdmi.org.
-        int blank_lines = viewport[3] / 49;
-        int hh = (viewport[3] - blank_lines) / 2;
-        glViewport(viewport[0], viewport[1] + hh, viewport[2], blank_lines);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glViewport(viewport[0], viewport[1] + hh + blank_lines, viewport[2], viewport[3] - hh - blank_lines);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 0.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
-        glViewport(viewport[0], viewport[1], viewport[2], hh);
-        glUniform1f(glGetUniformLocation(ctx->prg, "channel"), 1.0f);
-        draw_quad(ctx, viewport[2], viewport[3]);
+void glsDrawViewsWithPipeline(GLScontext* ctx, GLSpipeline* pipeline,
+        GLuint left_tex, GLuint right_tex)
+{
+    trace_begin(ctx, "glsDrawViewsWithPipeline");
+    draw_views_with_pipeline(ctx, pipeline, left_tex, right_tex);
+    trace_end(ctx, "glsDrawViewsWithPipeline");
+}
+
+/* Write the mask of a masked mode into the stencil bit of direct rendering:
+ * the bit is set where the composition would place its left texture. */
+static void write_stencil_mask(GLScontext* ctx, GLSmode mode, const GLint viewport[4])
+{
+    GLSpipeline* pipe = &ctx->stencil_pipeline;
+    GLint current_program_bak;
+    GLint active_texture_bak;
+#if GLS_USE_GLES
+    GLS_state state_bak;
+    GLboolean color_writemask_bak[4];
+    GLboolean depth_writemask_bak;
+    GLint stencil_writemask_bak;
+    GLint stencil_clear_value_bak;
+#endif
+
+    trace_begin(ctx, "write stencil mask");
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program_bak);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture_bak);
+#if GLS_USE_GLES
+    save_state(&state_bak, 1);
+    glGetBooleanv(GL_COLOR_WRITEMASK, color_writemask_bak);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_writemask_bak);
+    glGetIntegerv(GL_STENCIL_WRITEMASK, &stencil_writemask_bak);
+    glGetIntegerv(GL_STENCIL_CLEAR_VALUE, &stencil_clear_value_bak);
+#else
+    glPushAttrib(GL_ALL_ATTRIB_BITS);
+    glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+#endif
+
+    init_draw_state(ctx);
+    if (pipe->prg == 0) {
+        // One program serves all masked modes; only the mask texture differs
+        init_pipeline(pipe, GLS_MODE_EVEN_ODD_ROWS, GL_FALSE, 0);
+        pipe->mode_define = "mode_stencil_mask";
+        build_pipeline_program(ctx, pipe, 0, 0, 0);
+    } else {
+        glUseProgram(pipe->prg);
     }
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, mask_texture(ctx, mode));
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glStencilMask(ctx->view_stencil_bit);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, ctx->view_stencil_bit, ctx->view_stencil_bit);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    draw_quad(ctx, pipe->loc_mask_scale, viewport[2], viewport[3]);
 
-    /* Restore GL state */
+#if GLS_USE_GLES
+    glClearStencil(stencil_clear_value_bak);
+    glStencilMask(stencil_writemask_bak);
+    glDepthMask(depth_writemask_bak);
+    glColorMask(color_writemask_bak[0], color_writemask_bak[1],
+            color_writemask_bak[2], color_writemask_bak[3]);
+    restore_state(&state_bak);
+#else
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
     glMatrixMode(GL_MODELVIEW);
     glPopMatrix();
     glPopClientAttrib();
     glPopAttrib();
+#endif
     glActiveTexture(active_texture_bak);
     glUseProgram(current_program_bak);
-    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    trace_end(ctx, "write stencil mask");
+}
+
+void glsSetViewStencilBit(GLScontext* ctx, GLuint stencil_bit)
+{
+    ctx->view_stencil_bit = stencil_bit;
+}
+
+GLboolean glsBeginView(GLScontext* ctx, GLSmode mode, GLboolean swap_views, GLSview view)
+{
+    GLS_view_state* bak = &ctx->view_state_bak;
+    const GLboolean masked = (mode == GLS_MODE_EVEN_ODD_ROWS
+            || mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD);
+    GLint viewport[4];
+    GLint region[4];
+    GLint place;                // 0 where the left view goes, 1 where the right view goes
+
+    if (ctx->view_begun)
+        glsEndView(ctx);
+    if (masked) {
+        GLint stencil_bits;
+        if (ctx->view_stencil_bit == 0)
+            return GL_FALSE;
+        glGetIntegerv(GL_STENCIL_BITS, &stencil_bits);
+        if (stencil_bits <= 0)
+            return GL_FALSE;
+    } else if (mode != GLS_MODE_LEFT_RIGHT
+            && mode != GLS_MODE_TOP_BOTTOM
+            && mode != GLS_MODE_HDMI_FRAME_PACK
+#if !GLS_USE_GLES
+            && mode != GLS_MODE_QUAD_BUFFER_STEREO
+#endif
+            ) {
+        return GL_FALSE;
+    }
+
+    trace_begin(ctx, "glsBeginView");
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    place = ((view == GLS_VIEW_LEFT) == (swap_views == GL_FALSE) ? 0 : 1);
+    // The masked modes follow the screen, like the composition does
+    if ((mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_CHECKERBOARD)
+            && (ctx->viewport_screen_y + viewport[1]) % 2 == 0)
+        place = 1 - place;
+    if ((mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD)
+            && (ctx->viewport_screen_x + viewport[0]) % 2 == 1)
+        place = 1 - place;
+
+    /* The output region of the view; the same as in draw_views() */
+    region[0] = viewport[0];
+    region[1] = viewport[1];
+    region[2] = viewport[2];
+    region[3] = viewport[3];
+    if (mode == GLS_MODE_LEFT_RIGHT) {
+        GLint hw = viewport[2] / 2;
+        region[0] = (place == 0 ? viewport[0] : viewport[0] + hw);
+        region[2] = (place == 0 ? hw : viewport[2] - hw);
+    } else if (mode == GLS_MODE_TOP_BOTTOM || mode == GLS_MODE_HDMI_FRAME_PACK) {
+        GLint blank_lines = (mode == GLS_MODE_HDMI_FRAME_PACK ? viewport[3] / 49 : 0);
+        GLint hh = (viewport[3] - blank_lines) / 2;
+        region[1] = (place == 0 ? viewport[1] + hh + blank_lines : viewport[1]);
+        region[3] = (place == 0 ? viewport[3] - hh - blank_lines : hh);
+    }
+
+    /* Backup GL state */
+    bak->masked = masked;
+#if GLS_USE_GLES
+    memcpy(bak->viewport, viewport, sizeof(bak->viewport));
+    glGetIntegerv(GL_SCISSOR_BOX, bak->scissor_box);
+    bak->scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    if (masked) {
+        bak->stencil_test = glIsEnabled(GL_STENCIL_TEST);
+        glGetIntegerv(GL_STENCIL_FUNC, &bak->stencil_func);
+        glGetIntegerv(GL_STENCIL_REF, &bak->stencil_ref);
+        glGetIntegerv(GL_STENCIL_VALUE_MASK, &bak->stencil_value_mask);
+        glGetIntegerv(GL_STENCIL_FAIL, &bak->stencil_fail);
+        glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, &bak->stencil_pass_depth_fail);
+        glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, &bak->stencil_pass_depth_pass);
+    }
+#else
+    glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT | GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+#endif
+    ctx->view_begun = GL_TRUE;
+
+    if (mode == GLS_MODE_HDMI_FRAME_PACK) {
+        // Keep the blank area between the views black; see draw_views()
+        GLint blank_lines = viewport[3] / 49;
+        GLint hh = (viewport[3] - blank_lines) / 2;
+        GLfloat clear_color_bak[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color_bak);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(viewport[0], viewport[1] + hh, viewport[2], blank_lines);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(clear_color_bak[0], clear_color_bak[1], clear_color_bak[2], clear_color_bak[3]);
+    }
+#if !GLS_USE_GLES
+    if (mode == GLS_MODE_QUAD_BUFFER_STEREO)
+        glDrawBuffer(place == 0 ? GL_BACK_LEFT : GL_BACK_RIGHT);
+#endif
+    if (masked) {
+        write_stencil_mask(ctx, mode, viewport);
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_EQUAL, place == 0 ? ctx->view_stencil_bit : 0, ctx->view_stencil_bit);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+    glViewport(region[0], region[1], region[2], region[3]);
+    glScissor(region[0], region[1], region[2], region[3]);
+    glEnable(GL_SCISSOR_TEST);
+    trace_end(ctx, "glsBeginView");
+    return GL_TRUE;
+}
+
+void glsEndView(GLScontext* ctx)
+{
+    GLS_view_state* bak = &ctx->view_state_bak;
+
+    if (!ctx->view_begun)
+        return;
+    trace_begin(ctx, "glsEndView");
+#if GLS_USE_GLES
+    glViewport(bak->viewport[0], bak->viewport[1], bak->viewport[2], bak->viewport[3]);
+    glScissor(bak->scissor_box[0], bak->scissor_box[1], bak->scissor_box[2], bak->scissor_box[3]);
+    if (!bak->scissor_test)
+        glDisable(GL_SCISSOR_TEST);
+    if (bak->masked) {
+        glStencilFunc(bak->stencil_func, bak->stencil_ref, bak->stencil_value_mask);
+        glStencilOp(bak->stencil_fail, bak->stencil_pass_depth_fail, bak->stencil_pass_depth_pass);
+        if (!bak->stencil_test)
+            glDisable(GL_STENCIL_TEST);
+    }
+#else
+    (void)bak;
+    glPopAttrib();
+#endif
+    ctx->view_begun = GL_FALSE;
+    trace_end(ctx, "glsEndView");
 }
 
 void glsDrawDLP3dReadySyncMarker(GLScontext* ctx, GLSmode mode)
 {
-    const unsigned int R = 0xffu << 16u;
-    const unsigned int G = 0xffu << 8u;
-    const unsigned int B = 0xffu;
     GLint viewport[4];
-    GLfloat raster_pos_bak[4];
-    size_t required_size;
-    GLint i;
+#if GLS_USE_GLES
+    GLfloat color_clear_value_bak[4];
+    GLint scissor_box_bak[4];
+    GLboolean dither_bak, scissor_test_bak;
+#endif
 
     /* DLP 3-D Ready Sync: draw colored lines to allow the projector
      * to identify the stereo mode and the left / right views automatically. */
@@ -844,49 +4852,77 @@ void glsDrawDLP3dReadySyncMarker(GLScontext* ctx, GLSmode mode)
         return;
     }
 
+#if GLS_USE_THREADS
+    if (ctx->compositor) {
+        // The compositor thread draws the marker with the next frame
+        ctx->compositor->dlp_marker = GL_TRUE;
+        ctx->compositor->dlp_mode = mode;
+        return;
+    }
+#endif
+
+    trace_begin(ctx, "glsDrawDLP3dReadySyncMarker");
+
     /* Get current viewport */
     glGetIntegerv(GL_VIEWPORT, viewport);
 
     if (viewport[0] != 0 || viewport[1] != 0) {
         // The sync marker only makes sense in full screen mode.
+        trace_end(ctx, "glsDrawDLP3dReadySyncMarker");
         return;
     }
 
     /* Backup GL state */
-    glGetFloatv(GL_CURRENT_RASTER_POSITION, raster_pos_bak);
-
-    /* Manage the buffer for pixel data */
-    required_size = viewport[2] * sizeof(unsigned int);
-    if (ctx->dlp_3d_ready_sync_buf_size < required_size) {
-        ctx->dlp_3d_ready_sync_buf = realloc(ctx->dlp_3d_ready_sync_buf, required_size);
-        ctx->dlp_3d_ready_sync_buf_size = required_size;
-    }
-    if (!ctx->dlp_3d_ready_sync_buf)
-        oom_abort();
+#if GLS_USE_GLES
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, color_clear_value_bak);
+    glGetIntegerv(GL_SCISSOR_BOX, scissor_box_bak);
+    dither_bak = glIsEnabled(GL_DITHER);
+    scissor_test_bak = glIsEnabled(GL_SCISSOR_TEST);
+#else
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_SCISSOR_BIT);
+#endif
 
-    /* Draw the marker */
+    /* Draw the marker: each line is a scissored clear, so that no pixel data
+     * needs to be prepared and transferred. */
+    glDisable(GL_DITHER);
+    glEnable(GL_SCISSOR_TEST);
     if (mode == GLS_MODE_LEFT_RIGHT) {
-        unsigned int color = (ctx->display_frame_counter % 2 == 0 ? R : G | B);
-        for (i = 0; i < viewport[2]; i++)
-            ctx->dlp_3d_ready_sync_buf[i] = color;
-        glWindowPos2i(0, 0);
-        glDrawPixels(viewport[2], 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, ctx->dlp_3d_ready_sync_buf);
+        if (ctx->display_frame_counter % 2 == 0)
+            glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
+        else
+            glClearColor(0.0f, 1.0f, 1.0f, 0.0f);
+        glScissor(0, 0, viewport[2], 1);
+        glClear(GL_COLOR_BUFFER_BIT);
     } else if (mode == GLS_MODE_TOP_BOTTOM) {
-        unsigned int color = (ctx->display_frame_counter % 2 == 0 ? B : R | G);
-        for (i = 0; i < viewport[2]; i++)
-            ctx->dlp_3d_ready_sync_buf[i] = color;
-        glWindowPos2i(0, 0);
-        glDrawPixels(viewport[2], 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, ctx->dlp_3d_ready_sync_buf);
-        glWindowPos2i(0, viewport[3] / 2);
-        glDrawPixels(viewport[2], 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, ctx->dlp_3d_ready_sync_buf);
+        if (ctx->display_frame_counter % 2 == 0)
+            glClearColor(0.0f, 0.0f, 1.0f, 0.0f);
+        else
+            glClearColor(1.0f, 1.0f, 0.0f, 0.0f);
+        glScissor(0, 0, viewport[2], 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glScissor(0, viewport[3] / 2, viewport[2], 1);
+        glClear(GL_COLOR_BUFFER_BIT);
     } else if (mode == GLS_MODE_ALTERNATING) {
-        unsigned int color = (ctx->display_frame_counter % 4 < 2 ? G : R | B);
-        for (i = 0; i < viewport[2]; i++)
-            ctx->dlp_3d_ready_sync_buf[i] = color;
-        glWindowPos2i(0, 0);
-        glDrawPixels(viewport[2], 1, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, ctx->dlp_3d_ready_sync_buf);
+        if (ctx->display_frame_counter % 4 < 2)
+            glClearColor(0.0f, 1.0f, 0.0f, 0.0f);
+        else
+            glClearColor(1.0f, 0.0f, 1.0f, 0.0f);
+        glScissor(0, 0, viewport[2], 1);
+        glClear(GL_COLOR_BUFFER_BIT);
     }
 
     /* Restore GL state */
-    glWindowPos3f(raster_pos_bak[0], raster_pos_bak[1], raster_pos_bak[2]);
+#if GLS_USE_GLES
+    glClearColor(color_clear_value_bak[0], color_clear_value_bak[1],
+            color_clear_value_bak[2], color_clear_value_bak[3]);
+    glScissor(scissor_box_bak[0], scissor_box_bak[1],
+            scissor_box_bak[2], scissor_box_bak[3]);
+    if (dither_bak)
+        glEnable(GL_DITHER);
+    if (!scissor_test_bak)
+        glDisable(GL_SCISSOR_TEST);
+#else
+    glPopAttrib();
+#endif
+    trace_end(ctx, "glsDrawDLP3dReadySyncMarker");
 }
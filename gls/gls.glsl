@@ -46,28 +46,125 @@
 // mode_even_odd_rows
 // mode_even_odd_columns
 // mode_checkerboard
+// mode_stencil_mask
+// mode_hmd
 #define $mode
 
 // ghostbust_enabled
 // ghostbust_disabled
 #define $ghostbust
 
+// upsample_bicubic
+// upsample_linear
+#define $upsample
+
+// lut_left_enabled
+// lut_left_disabled
+#define $lut_left
+// lut_right_enabled
+// lut_right_disabled
+#define $lut_right
+// lut_output_enabled
+// lut_output_disabled
+#define $lut_output
+
+// overlay_none
+// overlay_straight
+// overlay_premultiplied
+#define $overlay
+
+// OpenGL ES gets the texture coordinates from the vertex shader gls-quad.glsl,
+// desktop OpenGL from the fixed function pipeline, and Vulkan from
+// gls-vulkan.vert. Vulkan shaders are compiled with #version 450.
+#if defined(VULKAN)
+layout(location = 0) in vec2 texcoord;
+layout(location = 0) out vec4 frag_color;
+#  define texcoord_l texcoord
+#  define texcoord_r texcoord
+#  define sample_2d(tex, p) texture(tex, p)
+#  define sample_3d(tex, p) texture(tex, p)
+#  define rgb_l_size vec2(textureSize(rgb_l, 0))
+#  define rgb_r_size vec2(textureSize(rgb_r, 0))
+#elif defined(GL_ES)
+#  if defined(GL_FRAGMENT_PRECISION_HIGH)
+precision highp float;
+#  else
+precision mediump float;
+#  endif
+varying vec2 texcoord_l;
+varying vec2 texcoord_r;
+varying vec2 texcoord_mask;
+#  define frag_color gl_FragColor
+#  define sample_2d(tex, p) texture2D(tex, p)
+#  define sample_3d(tex, p) texture3D(tex, p)
+#else
+#  define texcoord_l gl_TexCoord[0].xy
+#  define texcoord_r gl_TexCoord[1].xy
+#  define texcoord_mask gl_TexCoord[2].xy
+#  define frag_color gl_FragColor
+#  define sample_2d(tex, p) texture2D(tex, p)
+#  define sample_3d(tex, p) texture3D(tex, p)
+#endif
+
+#if defined(VULKAN)
+// The Vulkan backend supports the modes, parallax adjustment, and ghostbusting
+// (which is always enabled and disabled by zero crosstalk). The layout of the
+// parameters matches GLS_vk_parameters in gls-vulkan.c.
+layout(set = 0, binding = 0) uniform sampler2D rgb_l;
+layout(set = 0, binding = 1) uniform sampler2D rgb_r;
+layout(push_constant) uniform parameters
+{
+    vec2 rgb_l_scale;
+    vec2 rgb_r_scale;
+    vec2 step_l;
+    vec2 step_r;
+    vec3 crosstalk;
+    float parallax_adjust;
+    float channel;
+};
+#else
+
 uniform sampler2D rgb_l;
 uniform sampler2D rgb_r;
+uniform vec2 rgb_l_scale;  // used part of the textures
+uniform vec2 rgb_r_scale;
+uniform vec2 rgb_l_size;   // size of the textures in texels
+uniform vec2 rgb_r_size;
 uniform float parallax_adjust;
 
-#if defined(ghostbust_enabled) && (defined(mode_onechannel) || defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard))
+#if defined(lut_left_enabled)
+uniform sampler3D lut_l_tex;
+uniform vec2 lut_l_range;   // scale and offset to the texel centers
+#endif
+#if defined(lut_right_enabled)
+uniform sampler3D lut_r_tex;
+uniform vec2 lut_r_range;
+#endif
+#if defined(lut_output_enabled)
+uniform sampler3D lut_output_tex;
+uniform vec2 lut_output_range;
+#endif
+
+#if !defined(overlay_none)
+uniform sampler2D overlay_tex;
+uniform vec4 overlay_rect;      // x, y, width, height in view coordinates
+uniform float overlay_shift;    // half of the disparity
+#endif
+
+#if defined(ghostbust_enabled) && (defined(mode_onechannel) || defined(mode_hmd) || defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard))
 uniform vec3 crosstalk;
 #endif
 
-#if defined(mode_onechannel)
+#if defined(mode_onechannel) || defined(mode_hmd)
 uniform float channel;  // 0.0 for left, 1.0 for right
 #endif
 
-#if defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard)
+#if defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard) || defined(mode_stencil_mask)
 uniform sampler2D mask_tex;
-uniform float step_x;
-uniform float step_y;
+uniform vec2 step_l;    // filter steps in each view
+uniform vec2 step_r;
+#endif
+
 #endif
 
 
@@ -80,7 +177,7 @@ float rgb_to_lum(vec3 rgb)
 }
 #endif
 
-#if defined(mode_onechannel) || defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard)
+#if defined(mode_onechannel) || defined(mode_hmd) || defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard)
 #  if defined(ghostbust_enabled)
 vec3 ghostbust(vec3 original, vec3 other)
 {
@@ -91,14 +188,108 @@ vec3 ghostbust(vec3 original, vec3 other)
 #  endif
 #endif
 
+// Scale view coordinates to the used part of a texture, and clamp them to the
+// centers of its outermost texels, so that neither the border nor the unused
+// part of a pooled texture is filtered in
+vec2 view_texcoord(vec2 texcoord, vec2 size, vec2 scale)
+{
+    vec2 lo = 0.5 / size;
+    return clamp(texcoord * scale, lo, scale - lo);
+}
+
+#if defined(upsample_bicubic)
+// Catmull-Rom interpolation for views that were rendered at a lower
+// resolution, with 9 bilinear lookups instead of 16 nearest ones. Lookups are
+// clamped to the used part of the texture.
+vec3 bicubic(sampler2D tex, vec2 texcoord, vec2 size, vec2 scale)
+{
+    vec2 p = texcoord * size;
+    vec2 t1 = floor(p - 0.5) + 0.5;
+    vec2 f = p - t1;
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+    vec2 lo = 0.5 / size;
+    vec2 hi = scale - lo;
+    vec2 t0 = clamp((t1 - 1.0) / size, lo, hi);
+    vec2 t12 = clamp((t1 + w2 / w12) / size, lo, hi);
+    vec2 t3 = clamp((t1 + 2.0) / size, lo, hi);
+    return (sample_2d(tex, vec2(t0.x, t0.y)).rgb * w0.x
+            + sample_2d(tex, vec2(t12.x, t0.y)).rgb * w12.x
+            + sample_2d(tex, vec2(t3.x, t0.y)).rgb * w3.x) * w0.y
+        + (sample_2d(tex, vec2(t0.x, t12.y)).rgb * w0.x
+            + sample_2d(tex, vec2(t12.x, t12.y)).rgb * w12.x
+            + sample_2d(tex, vec2(t3.x, t12.y)).rgb * w3.x) * w12.y
+        + (sample_2d(tex, vec2(t0.x, t3.y)).rgb * w0.x
+            + sample_2d(tex, vec2(t12.x, t3.y)).rgb * w12.x
+            + sample_2d(tex, vec2(t3.x, t3.y)).rgb * w3.x) * w3.y;
+}
 vec3 tex_l(vec2 texcoord)
 {
-    return texture2D(rgb_l, texcoord + vec2(parallax_adjust, 0.0)).rgb;
+    return bicubic(rgb_l, view_texcoord(texcoord + vec2(parallax_adjust, 0.0), rgb_l_size, rgb_l_scale), rgb_l_size, rgb_l_scale);
 }
 vec3 tex_r(vec2 texcoord)
 {
-    return texture2D(rgb_r, texcoord - vec2(parallax_adjust, 0.0)).rgb;
+    return bicubic(rgb_r, view_texcoord(texcoord - vec2(parallax_adjust, 0.0), rgb_r_size, rgb_r_scale), rgb_r_size, rgb_r_scale);
+}
+#else
+vec3 tex_l(vec2 texcoord)
+{
+    return sample_2d(rgb_l, view_texcoord(texcoord + vec2(parallax_adjust, 0.0), rgb_l_size, rgb_l_scale)).rgb;
 }
+vec3 tex_r(vec2 texcoord)
+{
+    return sample_2d(rgb_r, view_texcoord(texcoord - vec2(parallax_adjust, 0.0), rgb_r_size, rgb_r_scale)).rgb;
+}
+#endif
+
+// The overlay is blended over each view at its position in that view
+#if !defined(overlay_none)
+vec3 overlay(vec3 rgb, vec2 texcoord, float shift)
+{
+    vec2 p = (texcoord - overlay_rect.xy - vec2(shift, 0.0)) / overlay_rect.zw;
+    vec4 o = sample_2d(overlay_tex, clamp(p, 0.0, 1.0));
+    float inside = step(0.0, p.x) * step(p.x, 1.0) * step(0.0, p.y) * step(p.y, 1.0);
+#  if defined(overlay_straight)
+    return mix(rgb, o.rgb, o.a * inside);
+#  else
+    return rgb * (1.0 - o.a * inside) + o.rgb * inside;
+#  endif
+}
+#  define overlay_l(rgb, texcoord) overlay(rgb, texcoord, -overlay_shift)
+#  define overlay_r(rgb, texcoord) overlay(rgb, texcoord, overlay_shift)
+#else
+#  define overlay_l(rgb, texcoord) rgb
+#  define overlay_r(rgb, texcoord) rgb
+#endif
+
+// Color lookup tables, applied to each view after filtering and to the result
+#if defined(lut_left_enabled)
+vec3 color_l(vec3 rgb)
+{
+    return sample_3d(lut_l_tex, clamp(rgb, 0.0, 1.0) * lut_l_range.x + lut_l_range.y).rgb;
+}
+#else
+#  define color_l(rgb) rgb
+#endif
+#if defined(lut_right_enabled)
+vec3 color_r(vec3 rgb)
+{
+    return sample_3d(lut_r_tex, clamp(rgb, 0.0, 1.0) * lut_r_range.x + lut_r_range.y).rgb;
+}
+#else
+#  define color_r(rgb) rgb
+#endif
+#if defined(lut_output_enabled)
+vec3 color_output(vec3 rgb)
+{
+    return sample_3d(lut_output_tex, clamp(rgb, 0.0, 1.0) * lut_output_range.x + lut_output_range.y).rgb;
+}
+#else
+#  define color_output(rgb) rgb
+#endif
 
 void main()
 {
@@ -107,10 +298,28 @@ void main()
 
 #if defined(mode_onechannel)
 
-    l = tex_l(gl_TexCoord[0].xy);
-    r = tex_r(gl_TexCoord[1].xy);
+    l = color_l(overlay_l(tex_l(texcoord_l), texcoord_l));
+    r = color_r(overlay_r(tex_r(texcoord_r), texcoord_r));
     result = ghostbust(mix(l, r, channel), mix(r, l, channel));
 
+#elif defined(mode_hmd)
+
+    // The lens distortion mesh gives each color channel its own texture
+    // coordinates: red in texcoord_l, green in texcoord_r, and blue in
+    // texcoord_mask. Channels that fall outside of the view are black.
+    vec2 tc_red = texcoord_l;
+    vec2 tc_green = texcoord_r;
+    vec2 tc_blue = texcoord_mask;
+    vec3 inside = vec3(
+            step(0.0, tc_red.x) * step(tc_red.x, 1.0) * step(0.0, tc_red.y) * step(tc_red.y, 1.0),
+            step(0.0, tc_green.x) * step(tc_green.x, 1.0) * step(0.0, tc_green.y) * step(tc_green.y, 1.0),
+            step(0.0, tc_blue.x) * step(tc_blue.x, 1.0) * step(0.0, tc_blue.y) * step(tc_blue.y, 1.0));
+    l = vec3(tex_l(tc_red).r, tex_l(tc_green).g, tex_l(tc_blue).b);
+    r = vec3(tex_r(tc_red).r, tex_r(tc_green).g, tex_r(tc_blue).b);
+    l = color_l(overlay_l(l, tc_green));
+    r = color_r(overlay_r(r, tc_green));
+    result = ghostbust(mix(l, r, channel), mix(r, l, channel)) * inside;
+
 #elif defined(mode_even_odd_rows) || defined(mode_even_odd_columns) || defined(mode_checkerboard)
 
     /* This implementation of the masked modes works around many different problems and therefore may seem strange.
@@ -125,41 +334,65 @@ void main()
      *    drivers seem to use extremely low precision arithmetic in the shaders; too low for reliable pixel
      *    position computations.
      */
-    float m = texture2D(mask_tex, gl_TexCoord[2].xy).x;
+# if defined(VULKAN)
+    // Vulkan computes integer pixel positions reliably. Left is on even rows
+    // and columns of the framebuffer; gls-vulkan.c swaps the views to match
+    // the screen.
+    ivec2 p = ivec2(gl_FragCoord.xy);
+#  if defined(mode_even_odd_rows)
+    float m = float(1 - (p.y & 1));
+#  elif defined(mode_even_odd_columns)
+    float m = float(1 - (p.x & 1));
+#  else
+    float m = float(1 - ((p.x + p.y) & 1));
+#  endif
+# else
+    float m = sample_2d(mask_tex, texcoord_mask).x;
+# endif
 # if defined(mode_even_odd_rows)
-    vec3 rgb0_l = tex_l(gl_TexCoord[0].xy - vec2(0.0, step_y));
-    vec3 rgb1_l = tex_l(gl_TexCoord[0].xy);
-    vec3 rgb2_l = tex_l(gl_TexCoord[0].xy + vec2(0.0, step_y));
+    vec3 rgb0_l = tex_l(texcoord_l - vec2(0.0, step_l.y));
+    vec3 rgb1_l = tex_l(texcoord_l);
+    vec3 rgb2_l = tex_l(texcoord_l + vec2(0.0, step_l.y));
     vec3 rgbc_l = (rgb0_l + 2.0 * rgb1_l + rgb2_l) / 4.0;
-    vec3 rgb0_r = tex_r(gl_TexCoord[1].xy - vec2(0.0, step_y));
-    vec3 rgb1_r = tex_r(gl_TexCoord[1].xy);
-    vec3 rgb2_r = tex_r(gl_TexCoord[1].xy + vec2(0.0, step_y));
+    vec3 rgb0_r = tex_r(texcoord_r - vec2(0.0, step_r.y));
+    vec3 rgb1_r = tex_r(texcoord_r);
+    vec3 rgb2_r = tex_r(texcoord_r + vec2(0.0, step_r.y));
     vec3 rgbc_r = (rgb0_r + 2.0 * rgb1_r + rgb2_r) / 4.0;
 # elif defined(mode_even_odd_columns)
-    vec3 rgb0_l = tex_l(gl_TexCoord[0].xy - vec2(step_x, 0.0));
-    vec3 rgb1_l = tex_l(gl_TexCoord[0].xy);
-    vec3 rgb2_l = tex_l(gl_TexCoord[0].xy + vec2(step_x, 0.0));
+    vec3 rgb0_l = tex_l(texcoord_l - vec2(step_l.x, 0.0));
+    vec3 rgb1_l = tex_l(texcoord_l);
+    vec3 rgb2_l = tex_l(texcoord_l + vec2(step_l.x, 0.0));
     vec3 rgbc_l = (rgb0_l + 2.0 * rgb1_l + rgb2_l) / 4.0;
-    vec3 rgb0_r = tex_r(gl_TexCoord[1].xy - vec2(step_x, 0.0));
-    vec3 rgb1_r = tex_r(gl_TexCoord[1].xy);
-    vec3 rgb2_r = tex_r(gl_TexCoord[1].xy + vec2(step_x, 0.0));
+    vec3 rgb0_r = tex_r(texcoord_r - vec2(step_r.x, 0.0));
+    vec3 rgb1_r = tex_r(texcoord_r);
+    vec3 rgb2_r = tex_r(texcoord_r + vec2(step_r.x, 0.0));
     vec3 rgbc_r = (rgb0_r + 2.0 * rgb1_r + rgb2_r) / 4.0;
 # elif defined(mode_checkerboard)
-    vec3 rgb0_l = tex_l(gl_TexCoord[0].xy - vec2(0.0, step_y));
-    vec3 rgb1_l = tex_l(gl_TexCoord[0].xy - vec2(step_x, 0.0));
-    vec3 rgb2_l = tex_l(gl_TexCoord[0].xy);
-    vec3 rgb3_l = tex_l(gl_TexCoord[0].xy + vec2(step_x, 0.0));
-    vec3 rgb4_l = tex_l(gl_TexCoord[0].xy + vec2(0.0, step_y));
+    vec3 rgb0_l = tex_l(texcoord_l - vec2(0.0, step_l.y));
+    vec3 rgb1_l = tex_l(texcoord_l - vec2(step_l.x, 0.0));
+    vec3 rgb2_l = tex_l(texcoord_l);
+    vec3 rgb3_l = tex_l(texcoord_l + vec2(step_l.x, 0.0));
+    vec3 rgb4_l = tex_l(texcoord_l + vec2(0.0, step_l.y));
     vec3 rgbc_l = (rgb0_l + rgb1_l + 4.0 * rgb2_l + rgb3_l + rgb4_l) / 8.0;
-    vec3 rgb0_r = tex_r(gl_TexCoord[1].xy - vec2(0.0, step_y));
-    vec3 rgb1_r = tex_r(gl_TexCoord[1].xy - vec2(step_x, 0.0));
-    vec3 rgb2_r = tex_r(gl_TexCoord[1].xy);
-    vec3 rgb3_r = tex_r(gl_TexCoord[1].xy + vec2(step_x, 0.0));
-    vec3 rgb4_r = tex_r(gl_TexCoord[1].xy + vec2(0.0, step_y));
+    vec3 rgb0_r = tex_r(texcoord_r - vec2(0.0, step_r.y));
+    vec3 rgb1_r = tex_r(texcoord_r - vec2(step_r.x, 0.0));
+    vec3 rgb2_r = tex_r(texcoord_r);
+    vec3 rgb3_r = tex_r(texcoord_r + vec2(step_r.x, 0.0));
+    vec3 rgb4_r = tex_r(texcoord_r + vec2(0.0, step_r.y));
     vec3 rgbc_r = (rgb0_r + rgb1_r + 4.0 * rgb2_r + rgb3_r + rgb4_r) / 8.0;
 # endif
+    rgbc_l = color_l(overlay_l(rgbc_l, texcoord_l));
+    rgbc_r = color_r(overlay_r(rgbc_r, texcoord_r));
     result = ghostbust(mix(rgbc_r, rgbc_l, m), mix(rgbc_l, rgbc_r, m));
 
+#elif defined(mode_stencil_mask)
+
+    // Marks the pixels of the mask in the stencil buffer for glsBeginView();
+    // the color buffer is not written.
+    if (sample_2d(mask_tex, texcoord_mask).x < 0.5)
+        discard;
+    result = vec3(0.0);
+
 #elif defined(mode_red_cyan_dubois) || defined(mode_green_magenta_dubois) || defined(mode_amber_blue_dubois)
 
     // The Dubois anaglyph method is generally the highest quality anaglyph method.
@@ -167,8 +400,8 @@ void main()
     // This method depends on the characteristics of the display device and the anaglyph glasses.
     // According to the author, the matrices below are intended to be applied to linear RGB values,
     // and are designed for CRT displays.
-    l = tex_l(gl_TexCoord[0].xy);
-    r = tex_r(gl_TexCoord[1].xy);
+    l = color_l(overlay_l(tex_l(texcoord_l), texcoord_l));
+    r = color_r(overlay_r(tex_r(texcoord_r), texcoord_r));
 # if defined(mode_red_cyan_dubois)
     // Source of this matrix: http://www.site.uottawa.ca/~edubois/anaglyph/LeastSquaresHowToPhotoshop.pdf
     mat3 m0 = mat3(
@@ -204,8 +437,8 @@ void main()
 
 #else // lower quality anaglyph methods
 
-    l = tex_l(gl_TexCoord[0].xy);
-    r = tex_r(gl_TexCoord[1].xy);
+    l = color_l(overlay_l(tex_l(texcoord_l), texcoord_l));
+    r = color_r(overlay_r(tex_r(texcoord_r), texcoord_r));
 # if defined(mode_red_cyan_monochrome)
     result = vec3(rgb_to_lum(l), rgb_to_lum(r), rgb_to_lum(r));
 # elif defined(mode_red_cyan_half_color)
@@ -232,5 +465,5 @@ void main()
 
 #endif
 
-    gl_FragColor = vec4(result, 1.0);
+    frag_color = vec4(color_output(result), 1.0);
 }
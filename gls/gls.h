@@ -74,6 +74,18 @@
  * glsDrawViews(ctx, GLS_MODE_RED_CYAN_DUBOIS, GL_FALSE, left_texture, right_texture);
  * \endcode
  *
+ * Or, in the modes that place each view in a region or draw buffer of its own,
+ * render the views directly into the output, without any copy:
+ * \code
+ * if (glsBeginView(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE, GLS_VIEW_LEFT)) {
+ *     // ... clear and render left view ...
+ *     glsEndView(ctx);
+ *     glsBeginView(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE, GLS_VIEW_RIGHT);
+ *     // ... clear and render right view ...
+ *     glsEndView(ctx);
+ * }
+ * \endcode
+ *
  * Cleanup:
  * \code
  * glsDestroyContext(ctx);
@@ -90,34 +102,48 @@
  *
  * See http://paulbourke.net/stereographics/stereorender/
  * for more information on this topic.
+ *
+ * \section gles OpenGL ES
+ *
+ * libgls-gles is a build of libgls for OpenGL ES 2.0 (and later) with EGL.
+ * Define GLS_USE_GLES to 1 before including the header file, or use the
+ * pkg-config file gls-gles.pc. The composition works as with desktop OpenGL,
+ * but the features that need more than OpenGL ES 2.0 are not available:
+ * composition caching, view texture rings, the compositor thread, view
+ * synthesis and reprojection, dynamic resolution, color lookup tables,
+ * quad-buffer stereo, and the matrix stack functions glsFrustum(),
+ * glsPerspective() and glsLookAt(), which are not declared; use
+ * glsFrustumMatricesf() and the related functions instead. Uploaded views
+ * must be GL_RGBA.
+ *
+ * With OpenGL ES 3.0 or GL_EXT_discard_framebuffer, the composition tells
+ * tiled GPUs which parts of the window it does not need, so that they are not
+ * loaded into tile memory: the color buffer when the viewport covers the
+ * whole window, and for glsDrawSubmittedViews() also the depth and stencil
+ * buffers, which still hold the content of the last submitted view.
+ *
+ * \section vulkan Vulkan
+ *
+ * libgls-vulkan composes views of Vulkan renderers, in the same modes as
+ * glsDrawViews(), from the same shader source. It records the composition
+ * into a command buffer of the application; see gls-vulkan.h and the
+ * pkg-config file gls-vulkan.pc. Ghostbusting is supported, but parallax
+ * adjustment, upsampling, color lookup tables, overlays, and the head-mounted
+ * display mode are not.
  */
 
 #ifndef GLS_H
 #define GLS_H
 
-#include <GL/gl.h>
-
-/* GLS_EXPORT: Declare functions as part of the library API.
- * (You only need to define GLS_STATIC for a static GLS library
- * if you use Microsoft compilers). */
-#if (defined _WIN32 || defined __WIN32__) && !defined __CYGWIN__
-#   ifdef GLS_BUILD
-#       ifdef DLL_EXPORT
-#           define GLS_EXPORT __declspec(dllexport)
-#       else
-#           define GLS_EXPORT
-#       endif
-#   else
-#       if defined _MSVC && !defined GLS_STATIC
-#           define GLS_EXPORT __declspec(dllimport)
-#       else
-#           define GLS_EXPORT
-#       endif
-#   endif
+/* Define GLS_USE_GLES to 1 when using a libgls that was built for OpenGL ES */
+#if defined(GLS_USE_GLES) && GLS_USE_GLES
+#   include <GLES2/gl2.h>
 #else
-#   define GLS_EXPORT
+#   include <GL/gl.h>
 #endif
 
+#include <gls/gls_mode.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -133,79 +159,15 @@ extern "C" {
 typedef struct GLS_context GLScontext;
 
 /**
- * \brief       GLS stereoscopic display modes.
+ * \brief      Double precision floating point type of the libgls interface.
  *
- * See http://www.site.uottawa.ca/~edubois/anaglyph/ for more information
- * about the Dubois anaglyph modes.
+ * This is GLdouble with desktop OpenGL. OpenGL ES does not define GLdouble.
  */
-typedef enum {
-    GLS_MODE_QUAD_BUFFER_STEREO        = 0,
-    /**< OpenGL quad buffered stereo. This mode can only be used if the
-     * application created an OpenGL context with quad buffered stereo
-     * support. */
-    GLS_MODE_ALTERNATING               = 1,
-    /**< Left and right view alternating for each display output frame. This
-     * allows to use active stereo displays without OpenGL quad buffer support.
-     * Note that this requires that you can render your scene at the display
-     * framerate, which is at least at 120 Hz for active stereo displays.
-     * Note also that this mode may be unreliable and may swap left/right eyes
-     * occasionally, depending on your system, graphics hardware, and driver. */
-    GLS_MODE_MONO_LEFT                 = 2,
-    /**< Left view only. */
-    GLS_MODE_MONO_RIGHT                = 3,
-    /**< Right view only. */
-    GLS_MODE_LEFT_RIGHT                = 4,
-    /**< Left view in left half of viewport, right view in right half.
-     * Used by some 3D TVs and displays. */
-    GLS_MODE_TOP_BOTTOM                = 5,
-    /**< Left view in top half of viewport, right view in bottom half.
-     * Used by some 3D TVs and displays. */
-    GLS_MODE_HDMI_FRAME_PACK           = 6,
-    /**< HDMI Frame packing (left view in top half, right view in bottom half,
-     * separated by 1/49 of the viewport height).
-     *
-     * This mode only makes sens if you are forcing your display into the
-     * corresponding HDMI 3D mode. A description how to do this on GNU/Linux can
-     * be found here:
-     * http://lists.nongnu.org/archive/html/bino-list/2011-03/msg00033.html */
-    GLS_MODE_EVEN_ODD_ROWS             = 7,
-    /**< Left view in even pixel rows, right view in odd pixel rows.
-     * Used by some 3D TVs and displays. */
-    GLS_MODE_EVEN_ODD_COLUMNS          = 8,
-    /**< Left view in even pixel columns, right view in odd pixel columns.
-     * Used by some 3D TVs and displays. */
-    GLS_MODE_CHECKERBOARD              = 9,
-    /**< Left and right view pixels in a checkerboard pattern.
-     * Used by some 3D TVs and displays. */
-    GLS_MODE_RED_CYAN_MONOCHROME      = 10,
-    /**< Red/cyan anaglyph glasses, monochrome method. */
-    GLS_MODE_RED_CYAN_HALF_COLOR      = 11,
-    /**< Red/cyan anaglyph glasses, half color method. */
-    GLS_MODE_RED_CYAN_FULL_COLOR      = 12,
-    /**< Red/cyan anaglyph glasses, full color method. */
-    GLS_MODE_RED_CYAN_DUBOIS          = 13,
-    /**< Red/cyan anaglyph glasses, high quality Dubois method (recommended). */
-    GLS_MODE_GREEN_MAGENTA_MONOCHROME = 14,
-    /**< Green/magenta anaglyph glasses, monochrome method. */
-    GLS_MODE_GREEN_MAGENTA_HALF_COLOR = 15,
-    /**< Green/magenta anaglyph glasses, half color method. */
-    GLS_MODE_GREEN_MAGENTA_FULL_COLOR = 16,
-    /**< Green/magenta anaglyph glasses, full color method. */
-    GLS_MODE_GREEN_MAGENTA_DUBOIS     = 17,
-    /**< Green/magenta anaglyph glasses, high quality Dubois method (recommended). */
-    GLS_MODE_AMBER_BLUE_MONOCHROME    = 18,
-    /**< Amber/blue anaglyph glasses, monochrome method. */
-    GLS_MODE_AMBER_BLUE_HALF_COLOR    = 19,
-    /**< Amber/blue anaglyph glasses, half color method. */
-    GLS_MODE_AMBER_BLUE_FULL_COLOR    = 20,
-    /**< Amber/blue anaglyph glasses, full color method. */
-    GLS_MODE_AMBER_BLUE_DUBOIS        = 21,
-    /**< Amber/blue anaglyph glasses, high quality Dubois method (recommended). */
-    GLS_MODE_RED_GREEN_MONOCHROME     = 22,
-    /**< Red/green anaglyph glasses, monochrome method. */
-    GLS_MODE_RED_BLUE_MONOCHROME      = 23,
-    /**< Red/blue anaglyph glasses, monochrome method. */
-} GLSmode;
+#if defined(GLS_USE_GLES) && GLS_USE_GLES
+typedef double GLSdouble;
+#else
+typedef GLdouble GLSdouble;
+#endif
 
 /**
  * \brief       GLS stereoscopic view.
@@ -215,6 +177,78 @@ typedef enum {
     GLS_VIEW_RIGHT = 1  /**< Right view. */
 } GLSview;
 
+/**
+ * \brief       Interpretation of the alpha channel of an overlay.
+ *
+ * See glsSetOverlay().
+ */
+typedef enum {
+    GLS_ALPHA_STRAIGHT      = 0, /**< Colors are not multiplied with alpha. */
+    GLS_ALPHA_PREMULTIPLIED = 1  /**< Colors are already multiplied with alpha. */
+} GLSalphaMode;
+
+/**
+ * \brief       Flags for glsCreatePipeline().
+ */
+typedef enum {
+    GLS_PIPELINE_KEEP_STATE = 0x1
+    /**< Do not save and restore the OpenGL state around the composition.
+     * The current program, the bound textures and buffers, the vertex
+     * arrays, the active texture unit, enabled capabilities, and (with
+     * desktop OpenGL) the matrices are left changed. Only the viewport is
+     * restored. Use this if the application sets its own state after each
+     * composition anyway. */
+} GLSpipelineFlag;
+
+/**
+ * \brief       A prebuilt composition pipeline.
+ *
+ * See glsCreatePipeline().
+ */
+typedef struct GLS_pipeline GLSpipeline;
+
+/**
+ * \brief       Frame pacing callback.
+ * \param ctx   The GLS context.
+ * \param droppedFrames     Number of frames that were never displayed.
+ * \param duplicatedFrames  Number of display frames that showed the previous frame again.
+ * \param userData          The pointer passed to glsSetFramePacingCallback().
+ *
+ * See glsSetFramePacingCallback().
+ */
+typedef void (*GLSframePacingCallback)(GLScontext* ctx,
+        GLint droppedFrames, GLint duplicatedFrames, void* userData);
+
+/**
+ * \brief       Trace callback.
+ * \param ctx   The GLS context.
+ * \param name  Name of the piece of work, e.g. "glsDrawViews" or "draw left half".
+ * \param begin GL_TRUE when the work begins, GL_FALSE when it ends.
+ * \param userData  The pointer passed to glsSetTraceCallback().
+ *
+ * See glsSetTraceCallback().
+ */
+typedef void (*GLStraceCallback)(GLScontext* ctx,
+        const char* name, GLboolean begin, void* userData);
+
+/**
+ * \brief       Callback that makes the compositor's OpenGL context current.
+ * \param current       GL_TRUE to make the context current, GL_FALSE to release it.
+ * \param userData      The pointer passed to glsStartCompositor().
+ * \return              Whether the context could be made current.
+ *
+ * See glsStartCompositor().
+ */
+typedef GLboolean (*GLSmakeCurrentCallback)(GLboolean current, void* userData);
+
+/**
+ * \brief       Callback that swaps the buffers of the compositor's drawable.
+ * \param userData      The pointer passed to glsStartCompositor().
+ *
+ * See glsStartCompositor().
+ */
+typedef void (*GLSswapBuffersCallback)(void* userData);
+
 /**
  * \name Version information
  */
@@ -249,7 +283,11 @@ const char* glsVersion(GLint *major, GLint *minor, GLint *patch);
  *
  * Creates a new GLS context. If you use multiple OpenGL contexts,
  * you need a GLS context for each of them. If something goes wrong,
- * this function returns a NULL pointer.
+ * this function returns a NULL pointer. This includes the case that
+ * no OpenGL context is current, or that it does not provide OpenGL 2.0.
+ *
+ * The OpenGL functions that libgls needs are looked up when they are first
+ * needed. GLS contexts for OpenGL contexts on the same driver share them.
  */
 extern GLS_EXPORT
 GLScontext* glsCreateContext();
@@ -271,6 +309,7 @@ void glsDestroyContext(GLScontext* ctx);
 
 /*@{*/
 
+#if !(defined(GLS_USE_GLES) && GLS_USE_GLES)
 /**
  * \brief               Stereoscopic variant of glFrustum().
  * \param left          Left clipping plane.
@@ -309,9 +348,9 @@ void glsDestroyContext(GLScontext* ctx);
  * for more information on how to set up stereoscopic views.
  */
 extern GLS_EXPORT
-void glsFrustum(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
-        GLdouble zNear, GLdouble zFar,
-        GLdouble focalLength, GLdouble eyeSeparation, GLSview view);
+void glsFrustum(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSview view);
 
 /**
  * \brief               Stereoscopic variant of gluPerspective().
@@ -349,8 +388,8 @@ void glsFrustum(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
  * for more information on how to set up stereoscopic views.
  */
 extern GLS_EXPORT
-void glsPerspective(GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdouble zFar,
-        GLdouble focalLength, GLdouble eyeSeparation, GLSview view);
+void glsPerspective(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSview view);
 
 /**
  * \brief               Stereoscopic variant of gluLookAt().
@@ -383,10 +422,129 @@ void glsPerspective(GLdouble fovy, GLdouble aspect, GLdouble zNear, GLdouble zFa
  * See http://paulbourke.net/stereographics/stereorender/
  * for more information on how to set up stereoscopic views.
  */
-void glsLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ,
-        GLdouble centerX, GLdouble centerY, GLdouble centerZ,
-        GLdouble upX, GLdouble upY, GLdouble upZ,
-        GLdouble eyeSeparation, GLSview view);
+void glsLookAt(GLSdouble eyeX, GLSdouble eyeY, GLSdouble eyeZ,
+        GLSdouble centerX, GLSdouble centerY, GLSdouble centerZ,
+        GLSdouble upX, GLSdouble upY, GLSdouble upZ,
+        GLSdouble eyeSeparation, GLSview view);
+#endif
+
+/**
+ * \brief               Compute the projection matrices of glsFrustum() for both views.
+ * \param left          Left clipping plane.
+ * \param right         Right clipping plane.
+ * \param bottom        Bottom clipping plane.
+ * \param top           Top clipping plane.
+ * \param zNear         Near plane.
+ * \param zFar          Far plane.
+ * \param focalLength   Focal length.
+ * \param eyeSeparation Eye separation, typically 1/30 of focal length.
+ * \param matrices      The left view matrix followed by the right view matrix.
+ *
+ * This computes the matrices that glsFrustum() would multiply onto the
+ * current matrix, in double precision and in OpenGL's column-major order,
+ * without touching the OpenGL matrix stack. Applications that use their own
+ * matrices, e.g. in a uniform buffer, can use the result directly.
+ */
+extern GLS_EXPORT
+void glsFrustumMatricesd(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSdouble matrices[32]);
+
+/**
+ * \brief               Single precision variant of glsFrustumMatricesd().
+ */
+extern GLS_EXPORT
+void glsFrustumMatricesf(GLSdouble left, GLSdouble right, GLSdouble bottom, GLSdouble top,
+        GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLfloat matrices[32]);
+
+/**
+ * \brief               Compute the projection matrices of glsPerspective() for both views.
+ * \param fovy          Field of view angle, in degrees.
+ * \param aspect        Aspect ratio of window.
+ * \param zNear         Near plane.
+ * \param zFar          Far plane.
+ * \param focalLength   Focal length.
+ * \param eyeSeparation Eye separation, typically 1/30 of focal length.
+ * \param matrices      The left view matrix followed by the right view matrix.
+ *
+ * See glsFrustumMatricesd().
+ */
+extern GLS_EXPORT
+void glsPerspectiveMatricesd(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLSdouble matrices[32]);
+
+/**
+ * \brief               Single precision variant of glsPerspectiveMatricesd().
+ */
+extern GLS_EXPORT
+void glsPerspectiveMatricesf(GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation, GLfloat matrices[32]);
+
+/**
+ * \brief               Compute the modelview matrices of glsLookAt() for both views.
+ * \param eye           Position of the eye.
+ * \param center        Position of the reference point.
+ * \param up            Up vector.
+ * \param eyeSeparation Eye separation, typically 1/30 of focal length.
+ * \param matrices      The left view matrix followed by the right view matrix.
+ *
+ * See glsFrustumMatricesd().
+ */
+extern GLS_EXPORT
+void glsLookAtMatricesd(const GLSdouble eye[3], const GLSdouble center[3],
+        const GLSdouble up[3], GLSdouble eyeSeparation, GLSdouble matrices[32]);
+
+/**
+ * \brief               Single precision variant of glsLookAtMatricesd().
+ *
+ * The computation is done in double precision.
+ */
+extern GLS_EXPORT
+void glsLookAtMatricesf(const GLfloat eye[3], const GLfloat center[3],
+        const GLfloat up[3], GLfloat eyeSeparation, GLfloat matrices[32]);
+
+/**
+ * \brief               Compute the projection matrices of many cameras.
+ * \param count         Number of cameras.
+ * \param left          Left clipping plane of each camera.
+ * \param right         Right clipping plane of each camera.
+ * \param bottom        Bottom clipping plane of each camera.
+ * \param top           Top clipping plane of each camera.
+ * \param zNear         Near plane of each camera.
+ * \param zFar          Far plane of each camera.
+ * \param focalLength   Focal length of each camera.
+ * \param eyeSeparation Eye separation of each camera.
+ * \param matrices      32 values per camera: its left and right view matrix.
+ *
+ * This is glsFrustumMatricesf() for \a count cameras, e.g. for the screens of a
+ * multi-wall display. Each parameter is a separate array, so that the
+ * computation can use SIMD instructions, and it is done in single precision.
+ * The output matrices of all cameras are consecutive, so that they can be
+ * uploaded into a buffer object at once.
+ */
+extern GLS_EXPORT
+void glsFrustumMatricesArrayf(GLsizei count,
+        const GLfloat* left, const GLfloat* right,
+        const GLfloat* bottom, const GLfloat* top,
+        const GLfloat* zNear, const GLfloat* zFar,
+        const GLfloat* focalLength, const GLfloat* eyeSeparation,
+        GLfloat* matrices);
+
+/**
+ * \brief               Compute the modelview matrices of many cameras.
+ * \param count         Number of cameras.
+ * \param eye           3 values per camera: the position of the eye.
+ * \param center        3 values per camera: the position of the reference point.
+ * \param up            3 values per camera: the up vector.
+ * \param eyeSeparation Eye separation of each camera.
+ * \param matrices      32 values per camera: its left and right view matrix.
+ *
+ * This is glsLookAtMatricesf() for \a count cameras; see glsFrustumMatricesArrayf().
+ */
+extern GLS_EXPORT
+void glsLookAtMatricesArrayf(GLsizei count, const GLfloat* eye, const GLfloat* center,
+        const GLfloat* up, const GLfloat* eyeSeparation, GLfloat* matrices);
 
 /*@}*/
 
@@ -461,6 +619,361 @@ void glsSetViewportScreenCoords(GLScontext* ctx, GLint x, GLint y);
 extern GLS_EXPORT
 void glsSetCrosstalkGhostbusting(GLScontext* ctx, GLfloat r, GLfloat g, GLfloat b, GLfloat ghostbust);
 
+/**
+ * \brief               Set a color lookup table for the composed output.
+ * \param ctx           The GLS context.
+ * \param lut           A 3D texture, or 0 to disable.
+ * \param size          The width, height, and depth of the texture.
+ *
+ * The composition looks up each output color in this table, e.g. to correct
+ * the colors of a specific display device. This happens in the composition
+ * pass itself, so it costs no extra pass over the output. The texture is
+ * indexed by red (width), green (height), and blue (depth) and should use
+ * linear filtering and GL_CLAMP_TO_EDGE wrapping.
+ *
+ * The cached composition (see glsSetCompositionCaching()) is discarded when
+ * this function is called, so call it again after changing the texture
+ * content.
+ */
+extern GLS_EXPORT
+void glsSetColorLUT(GLScontext* ctx, GLuint lut, GLint size);
+
+/**
+ * \brief               Set a color lookup table for one view.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \param lut           A 3D texture, or 0 to disable.
+ * \param size          The width, height, and depth of the texture.
+ *
+ * This works like glsSetColorLUT(), but the table is applied to the colors of
+ * one view before the views are combined, e.g. to compensate for the tint of
+ * one glasses lens. For the Dubois anaglyph modes, whose matrices expect
+ * linear light, view tables can convert to linear RGB and the output table
+ * back. The table stays with its view when the views are swapped.
+ */
+extern GLS_EXPORT
+void glsSetViewColorLUT(GLScontext* ctx, GLSview view, GLuint lut, GLint size);
+
+/**
+ * \brief               Set a 2D overlay that is placed at a given depth.
+ * \param ctx           The GLS context.
+ * \param tex           A 2D RGBA texture, e.g. with subtitles or a HUD, or 0 to disable.
+ * \param rect          The overlay area (x, y, width, height) in view coordinates.
+ * \param disparity     The horizontal disparity, as a fraction of the view width.
+ * \param alphaMode     The interpretation of the alpha channel of \a tex.
+ *
+ * The composition blends the overlay over both views, shifted horizontally by
+ * half the disparity in opposite directions. With a disparity of 0, the overlay
+ * appears on the screen plane, a negative disparity brings it in front of the
+ * screen, and a positive disparity moves it behind the screen. View coordinates
+ * range from (0,0) at the bottom left to (1,1) at the top right of each view.
+ *
+ * The overlay is sampled once per view and pixel in the composition pass,
+ * which avoids rendering it into each view. It is blended before the view
+ * color lookup tables are applied (see glsSetViewColorLUT()).
+ *
+ * The cached composition (see glsSetCompositionCaching()) is discarded when
+ * this function is called, so call it again after changing the texture
+ * content.
+ */
+extern GLS_EXPORT
+void glsSetOverlay(GLScontext* ctx, GLuint tex, const GLfloat rect[4],
+        GLfloat disparity, GLSalphaMode alphaMode);
+
+/**
+ * \brief               Set the lens model of the head-mounted display mode.
+ * \param ctx           The GLS context.
+ * \param distortion    The radial distortion coefficients k0 to k3.
+ * \param chromaticAberration The scale of the red and blue channel relative to green.
+ * \param lensCenterOffset The horizontal offset of each lens center from the
+ *                      center of its half of the display, toward the display
+ *                      center, as a fraction of half the width of that half.
+ *
+ * In \a GLS_MODE_HMD, the point that a display pixel shows is found by
+ * scaling its position relative to the lens center with
+ * k0 + k1 r^2 + k2 r^4 + k3 r^6, where r is the distance from the lens center
+ * in units of half the height of the display. This compensates the pincushion
+ * distortion of the lens with a barrel distortion for k1, k2, k3 > 0. The red
+ * and blue channels are additionally scaled to compensate the lateral
+ * chromatic aberration of the lens. Parts of the display that show points
+ * outside of a view stay black.
+ *
+ * The distortion is precomputed in a mesh when the lens model or the viewport
+ * size changes, so that the composition does not evaluate the polynomial per
+ * pixel. The default model, with k0 = 1, all other coefficients 0, no
+ * chromatic aberration (1, 1), and no offset, shows the views undistorted.
+ * The center of each view always appears at the lens center.
+ */
+extern GLS_EXPORT
+void glsSetHMDLens(GLScontext* ctx, const GLfloat distortion[4],
+        const GLfloat chromaticAberration[2], GLfloat lensCenterOffset);
+
+/**
+ * \brief               Set the camera for view synthesis.
+ * \param ctx           The GLS context.
+ * \param left          Left clipping plane.
+ * \param right         Right clipping plane.
+ * \param zNear         Near plane.
+ * \param zFar          Far plane.
+ * \param focalLength   Focal length.
+ * \param eyeSeparation Eye separation.
+ *
+ * Tells glsSubmitViewWithDepth() how the views are set up. Pass the same
+ * values that you pass to glsFrustum().
+ */
+extern GLS_EXPORT
+void glsSetViewSynthesisFrustum(GLScontext* ctx,
+        GLSdouble left, GLSdouble right, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation);
+
+/**
+ * \brief               Set the camera for view synthesis.
+ * \param ctx           The GLS context.
+ * \param fovy          Field of view angle, in degrees.
+ * \param aspect        Aspect ratio of window.
+ * \param zNear         Near plane.
+ * \param zFar          Far plane.
+ * \param focalLength   Focal length.
+ * \param eyeSeparation Eye separation.
+ *
+ * Tells glsSubmitViewWithDepth() how the views are set up. Pass the same
+ * values that you pass to glsPerspective().
+ */
+extern GLS_EXPORT
+void glsSetViewSynthesisPerspective(GLScontext* ctx,
+        GLSdouble fovy, GLSdouble aspect, GLSdouble zNear, GLSdouble zFar,
+        GLSdouble focalLength, GLSdouble eyeSeparation);
+
+/**
+ * \brief               Enable or disable reprojection of late views.
+ * \param ctx           The GLS context.
+ * \param enable        Whether to reproject late views.
+ *
+ * In \a GLS_MODE_ALTERNATING, the application renders only the view that
+ * glsIsViewRequired() asks for. If a frame is late, the display is already
+ * due for the other eye when the frame is swapped, and the wrong eye would
+ * be shown. With reprojection, glsDrawSubmittedViews() instead shows the
+ * most recent view of the eye that is due, warped to the current matrices
+ * of that eye (see glsSetViewMatrices()) using the depth buffer that was
+ * submitted with it. A late frame then shows a slightly distorted image
+ * instead of swapping the eyes: regions that were hidden in the old view are
+ * filled with the background next to them, and regions outside of it are
+ * black.
+ *
+ * While enabled, glsSubmitView(), glsSubmitViewRegion(), and
+ * glsSubmitViewWithDepth() keep a copy of each submitted view and of the
+ * depth buffer of the current viewport. With GLX_OML_sync_control, the
+ * display frame is predicted again when the frame is drawn, so that frames
+ * that became late during rendering are detected. Views from client memory
+ * are not reprojected, and neither are frames composed on a compositor
+ * thread (see glsStartCompositor()), since the application renders both
+ * views then.
+ *
+ * This requires OpenGL 3.0 or GL_ARB_framebuffer_object. By default,
+ * reprojection is disabled.
+ */
+extern GLS_EXPORT
+void glsSetReprojection(GLScontext* ctx, GLboolean enable);
+
+/**
+ * \brief               Enable or disable dynamic resolution.
+ * \param ctx           The GLS context.
+ * \param frameBudget   The GPU time available per frame in seconds, or 0 to disable.
+ * \param minScale      The smallest render scale to recommend, in (0,1].
+ *
+ * If enabled, GLS measures the GPU time between glsClear(), the submission of
+ * each view, and the end of glsDrawSubmittedViews() with timer queries, and
+ * recommends a render scale for each view (see glsGetRenderScale()) so that a
+ * frame takes about 80% of the budget. The scales are left alone while a frame
+ * takes between 70% and 90% of the budget, and they grow by at most 5% per
+ * frame. Results are read a few frames later, so the GPU is never waited for.
+ *
+ * The application renders each view into a viewport that is scaled by the
+ * recommended factor and submits it as usual. The composition then upsamples
+ * the views with a bicubic filter.
+ *
+ * Timestamps measure GPU time including idle periods, so a frame that is
+ * limited by the CPU also looks expensive. Composition on a compositor thread
+ * (see glsStartCompositor()) is not measured.
+ *
+ * This requires OpenGL 3.3 or GL_ARB_timer_query. By default, dynamic
+ * resolution is disabled.
+ */
+extern GLS_EXPORT
+void glsSetDynamicResolution(GLScontext* ctx, GLfloat frameBudget, GLfloat minScale);
+
+/**
+ * \brief               Render one view at a reduced resolution.
+ * \param ctx           The GLS context.
+ * \param reducedView   The view to reduce.
+ * \param scale         The render scale of the reduced view, in [0.25,1].
+ * \param alternateFrames Swap the reduced view every this many frames, or 0.
+ *
+ * Thanks to binocular suppression, the perceived quality of a stereo pair is
+ * mostly determined by the sharper view, so one view can be rendered with
+ * fewer pixels at little visible cost. glsGetRenderScale() includes the scale
+ * for the reduced view, and the composition upsamples it with a bicubic
+ * filter. Alternating the reduced view, counted in calls to glsClear(),
+ * avoids straining one eye over long sessions. This combines with dynamic
+ * resolution (see glsSetDynamicResolution()).
+ *
+ * A scale of 1 disables this, which is the default.
+ */
+extern GLS_EXPORT
+void glsSetAsymmetricResolution(GLScontext* ctx, GLSview reducedView, GLfloat scale,
+        GLint alternateFrames);
+
+/**
+ * \brief               Get the recommended render scale of a view.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \return              The factor for the width and height of the view's viewport.
+ *
+ * This is 1 unless dynamic or asymmetric resolution is enabled (see
+ * glsSetDynamicResolution() and glsSetAsymmetricResolution()). The value
+ * changes only in glsClear(). The views may have different sizes; the
+ * composition scales each of them to the output viewport.
+ */
+extern GLS_EXPORT
+GLfloat glsGetRenderScale(GLScontext* ctx, GLSview view);
+
+/**
+ * \brief               Enable or disable caching of the composed frame.
+ * \param ctx           The GLS context.
+ * \param enable        Whether to cache composed frames.
+ *
+ * If enabled, glsDrawViews() and glsDrawSubmittedViews() render the
+ * stereoscopic frame into an internal texture and copy it into the
+ * current GL_DRAW_BUFFER. As long as the views and the parameters
+ * that influence the result (mode, view swapping, viewport size, parity of the
+ * viewport screen coordinates, crosstalk and ghostbusting settings) do not
+ * change, the cached frame is presented again without composing it, which
+ * only costs one framebuffer blit. This helps applications with mostly static
+ * content, such as paused video or menus.
+ *
+ * Views submitted with glsSubmitView() are tracked automatically. If you
+ * pass your own textures to glsDrawViews(), you must call glsMarkViewDirty()
+ * whenever you change their content.
+ *
+ * Caching is not used for \a GLS_MODE_QUAD_BUFFER_STEREO and
+ * \a GLS_MODE_ALTERNATING. It requires OpenGL 3.0 or GL_ARB_framebuffer_object,
+ * and a draw framebuffer without multisampling.
+ *
+ * By default, caching is disabled.
+ */
+extern GLS_EXPORT
+void glsSetCompositionCaching(GLScontext* ctx, GLboolean enable);
+
+/**
+ * \brief               Release unused texture memory.
+ * \param ctx           The GLS context.
+ *
+ * To avoid reallocation while the viewport size changes (e.g. while the user
+ * resizes a window), libgls allocates its internal textures with some headroom
+ * and reuses them for smaller viewports. This function shrinks the textures to
+ * the size that is currently used. Call it when the viewport size has
+ * settled, before submitting the views of a frame: views submitted
+ * earlier in the current frame are discarded. The buffers for
+ * glsUploadView() and glsMapView() are released as well, unless they are
+ * currently mapped, and so are the copies of views kept for reprojection.
+ */
+extern GLS_EXPORT
+void glsTrim(GLScontext* ctx);
+
+/**
+ * \brief               Set the number of view texture pairs to cycle through.
+ * \param ctx           The GLS context.
+ * \param size          The number of view texture pairs (1-4).
+ *
+ * With a single pair, glsSubmitView() copies the next frame's views into the
+ * textures that the composition of the previous frame may still be reading
+ * on the GPU, and the driver has to synchronize implicitly. With more pairs,
+ * glsDrawSubmittedViews() continues with the next pair of the ring after
+ * each frame, and glsSubmitView() uses a fence to make sure that the GPU has
+ * finished reading it. A size of 3 allows the CPU to run two frames ahead
+ * of the GPU without stalls, which is important for tiled GPUs and drivers
+ * with deep command queues.
+ *
+ * Each additional pair costs texture memory, and regions submitted with
+ * glsSubmitViewRegion() can then only be reused if the textures are up to
+ * date, so that most submissions copy the whole view.
+ *
+ * This requires OpenGL 3.2 or GL_ARB_sync. The default size is 1.
+ */
+extern GLS_EXPORT
+void glsSetViewTextureRing(GLScontext* ctx, GLint size);
+
+/**
+ * \brief               Set a callback that reports frame pacing problems.
+ * \param ctx           The GLS context.
+ * \param callback      The callback, or NULL.
+ * \param userData      Pointer that is passed to the callback.
+ *
+ * If the GLX_OML_sync_control extension is available, glsClear() compares
+ * the number of display frames (vblanks) with the number of completed buffer
+ * swaps since the previous frame. If they differ, the callback is called:
+ * - duplicated frames are display frames that showed the previous image
+ *   again because a swap was late. In \a GLS_MODE_ALTERNATING, libgls
+ *   accounts for this when choosing the next view, so that the eyes
+ *   do not get swapped.
+ * - dropped frames are swaps that were replaced by a later swap before
+ *   they were displayed (only possible if swaps are not synchronized to vblank).
+ *
+ * Without GLX_OML_sync_control, the callback is never called.
+ */
+extern GLS_EXPORT
+void glsSetFramePacingCallback(GLScontext* ctx,
+        GLSframePacingCallback callback, void* userData);
+
+/**
+ * \brief               Annotate libgls work for OpenGL debuggers.
+ * \param ctx           The GLS context.
+ * \param enable        Whether to annotate.
+ *
+ * If enabled, libgls wraps its entry points and their passes (view copies,
+ * mask texture creation, shader compilation, and each composition draw) in
+ * GL_KHR_debug groups, and labels the objects it creates from now on. Tools
+ * such as apitrace then show where the time inside glsDrawViews() is spent.
+ *
+ * This has no effect if neither OpenGL 4.3 nor GL_KHR_debug is available.
+ * By default, annotations are disabled.
+ */
+extern GLS_EXPORT
+void glsSetDebugLabels(GLScontext* ctx, GLboolean enable);
+
+/**
+ * \brief               Set a callback that traces libgls work.
+ * \param ctx           The GLS context.
+ * \param callback      The callback, or NULL.
+ * \param userData      Pointer that is passed to the callback.
+ *
+ * The callback is called at the beginning and end of each libgls entry point
+ * and of each pass within it, with the same names that glsSetDebugLabels()
+ * uses. Begin and end calls are properly nested. Use this to forward the
+ * events to your own tracing system, e.g. Perfetto.
+ */
+extern GLS_EXPORT
+void glsSetTraceCallback(GLScontext* ctx,
+        GLStraceCallback callback, void* userData);
+
+/**
+ * \brief               Write a trace of libgls work to a file.
+ * \param ctx           The GLS context.
+ * \param filename      The file name, or NULL to stop tracing.
+ * \return              Whether the file could be opened.
+ *
+ * Records the same events as glsSetTraceCallback(), with CPU timestamps, in
+ * the Chrome trace event JSON format. The file can be loaded into
+ * chrome://tracing or Perfetto. The file is complete after tracing was
+ * stopped or the context was destroyed.
+ *
+ * The work of a compositor thread started with glsStartCompositor() is not
+ * written to the file, since the thread would have to share it; it is passed
+ * to the callback of glsSetTraceCallback(), which must then be thread-safe.
+ */
+extern GLS_EXPORT
+GLboolean glsSetTraceFile(GLScontext* ctx, const char* filename);
+
 /*@}*/
 
 /**
@@ -496,6 +1009,26 @@ void glsClear(GLScontext* ctx);
 extern GLS_EXPORT
 GLboolean glsIsViewRequired(GLScontext* ctx, GLSmode mode, GLboolean swapViews, GLSview view);
 
+/**
+ * \brief               Set the matrices that a view is rendered with.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \param projection    The projection matrix, or NULL for the current one.
+ * \param modelview     The modelview matrix, or NULL for the current one.
+ *
+ * The matrices are given in OpenGL's column-major order. NULL takes the
+ * matrix from the current GL_PROJECTION_MATRIX or GL_MODELVIEW_MATRIX, e.g.
+ * after setting them up with glsPerspective() and glsLookAt().
+ *
+ * This is only needed for reprojection (see glsSetReprojection()). Set the
+ * matrices of both views in every frame, even if a view is not required,
+ * and before submitting the view. Without matrices, late views are shown
+ * unchanged, which still keeps the right eye order.
+ */
+extern GLS_EXPORT
+void glsSetViewMatrices(GLScontext* ctx, GLSview view,
+        const GLfloat* projection, const GLfloat* modelview);
+
 /**
  * \brief               Submit a view to the current frame.
  * \param ctx           The GLS context.
@@ -507,10 +1040,130 @@ GLboolean glsIsViewRequired(GLScontext* ctx, GLSmode mode, GLboolean swapViews,
  *
  * The view is taken from the current viewport inside the
  * current GL_READ_BUFFER.
+ *
+ * If the current read framebuffer is multisampled, it is resolved directly
+ * into the internal view texture, so you do not need a separate resolve
+ * pass. This requires OpenGL 3.0 or GL_ARB_framebuffer_object. For
+ * portability, the read buffer should have the format GL_RGBA8, since some
+ * implementations can only resolve between identical formats. Whether the
+ * read framebuffer is multisampled is only looked up again when its binding
+ * or the viewport size changes. A framebuffer that is recreated under the
+ * same name with a new size is therefore noticed, but a switch between
+ * single-sampled and multisampled attachments of the same size is only
+ * noticed if a submission from another framebuffer comes in between.
  */
 extern GLS_EXPORT
 void glsSubmitView(GLScontext* ctx, GLSview view);
 
+/**
+ * \brief               Submit a changed region of a view to the current frame.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \param x             The x coordinate of the region, relative to the viewport.
+ * \param y             The y coordinate of the region, relative to the viewport.
+ * \param width         The width of the region.
+ * \param height        The height of the region.
+ *
+ * Like glsSubmitView(), but only the given region of the current viewport
+ * inside the current GL_READ_BUFFER is copied. The rest of the view is kept
+ * from the previous submission of this view. If there was none, or if the
+ * viewport size changed since then, the whole view is submitted.
+ *
+ * If composition caching is enabled (see glsSetCompositionCaching()), only
+ * the parts of the stereoscopic frame that are affected by the changed
+ * regions are composed again.
+ */
+extern GLS_EXPORT
+void glsSubmitViewRegion(GLScontext* ctx, GLSview view,
+        GLint x, GLint y, GLsizei width, GLsizei height);
+
+/**
+ * \brief               Submit a view and synthesize the other one from its depth.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ *
+ * Like glsSubmitView(), but the depth buffer of the current viewport is
+ * taken as well, and the other view is synthesized from the view and its
+ * depth (depth-image-based rendering). You only need to render the scene
+ * once per frame, and both views are available for glsDrawSubmittedViews().
+ *
+ * Each pixel is shifted by the parallax that its depth has for the other
+ * eye, using the camera given with glsSetViewSynthesisFrustum() or
+ * glsSetViewSynthesisPerspective(). Areas that are hidden in the submitted
+ * view are filled with the nearby background. The artifacts that this
+ * causes at depth edges are usually acceptable for anaglyph and interleaved
+ * modes, but visible on high quality displays. Parallax is limited to 8% of
+ * the view width.
+ *
+ * This requires OpenGL 3.0 or GL_ARB_framebuffer_object; otherwise, only the
+ * given view is submitted. If the read framebuffer is multisampled, its
+ * depth buffer must have the format GL_DEPTH24_STENCIL8.
+ */
+extern GLS_EXPORT
+void glsSubmitViewWithDepth(GLScontext* ctx, GLSview view);
+
+/**
+ * \brief               Submit a view from client memory to the current frame.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \param width         The width of the view.
+ * \param height        The height of the view.
+ * \param format        GL_RGB, GL_BGR, GL_RGBA, or GL_BGRA, with 8 bits per component.
+ * \param stride        The distance between rows in bytes, or 0 for packed rows.
+ * \param pixels        The pixels.
+ * \return              Whether the view was submitted. It is not if the format
+ *                      or size are not accepted, or if the view is mapped.
+ *
+ * Like glsSubmitView(), but the view comes from memory, e.g. from a software
+ * video decoder or a CPU renderer. As with glTexImage2D(), the first row is
+ * the bottom row. For images that are stored from top to bottom, pass a
+ * pointer to the last row and a negative stride.
+ *
+ * The pixels are copied into a ring of pixel buffer objects, from which the
+ * view texture is updated asynchronously, so that this function returns
+ * without waiting for the transfer. With OpenGL 4.4 or GL_ARB_buffer_storage,
+ * the buffers are persistently mapped; otherwise, they are orphaned for each
+ * upload. Without pixel buffer objects (OpenGL 2.1 or
+ * GL_ARB_pixel_buffer_object), the texture is updated directly. GL_BGRA is
+ * the fastest format on most implementations.
+ */
+extern GLS_EXPORT
+GLboolean glsUploadView(GLScontext* ctx, GLSview view,
+        GLsizei width, GLsizei height, GLenum format, GLsizei stride,
+        const void* pixels);
+
+/**
+ * \brief               Get memory to write a view into.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ * \param width         The width of the view.
+ * \param height        The height of the view.
+ * \param format        GL_RGB, GL_BGR, GL_RGBA, or GL_BGRA, with 8 bits per component.
+ * \param stride        Returns the distance between rows in bytes. May be NULL.
+ * \return              The memory, or NULL if the view is already mapped or
+ *                      the format or size are not accepted.
+ *
+ * The zero-copy variant of glsUploadView(): the returned memory is a mapped
+ * pixel buffer object, so that a decoder can write the view directly into
+ * it. The first row is the bottom row. The memory may be written by any
+ * thread, but no other libgls function may use the view until it is handed
+ * back with glsUnmapView().
+ */
+extern GLS_EXPORT
+void* glsMapView(GLScontext* ctx, GLSview view,
+        GLsizei width, GLsizei height, GLenum format, GLsizei* stride);
+
+/**
+ * \brief               Submit a view that was written into mapped memory.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ *
+ * Submits the view that was written into the memory returned by glsMapView()
+ * to the current frame. The memory must not be used afterwards.
+ */
+extern GLS_EXPORT
+void glsUnmapView(GLScontext* ctx, GLSview view);
+
 /**
  * \brief               Displays the submitted views in stereoscopic mode.
  * \param ctx           The GLS context.
@@ -524,6 +1177,19 @@ void glsSubmitView(GLScontext* ctx, GLSview view);
 extern GLS_EXPORT
 void glsDrawSubmittedViews(GLScontext* ctx, GLSmode mode, GLboolean swapViews);
 
+/**
+ * \brief               Mark the content of a view texture as changed.
+ * \param ctx           The GLS context.
+ * \param view          The view.
+ *
+ * Tells libgls that the texture that you pass to glsDrawViews() for the
+ * given view has new content. This is only necessary if composition caching
+ * is enabled; see glsSetCompositionCaching(). Views submitted with
+ * glsSubmitView() are marked automatically.
+ */
+extern GLS_EXPORT
+void glsMarkViewDirty(GLScontext* ctx, GLSview view);
+
 /**
  * \brief               Displays the given views in stereoscopic mode.
  * \param ctx           The GLS context.
@@ -542,6 +1208,113 @@ extern GLS_EXPORT
 void glsDrawViews(GLScontext* ctx, GLSmode mode, GLboolean swapViews,
         GLuint leftViewTexture, GLuint rightViewTexture);
 
+/**
+ * \brief               Create a composition pipeline.
+ * \param ctx           The GLS context.
+ * \param mode          The stereoscopic display mode.
+ * \param swapViews     Whether to swap left and right view.
+ * \param flags         A combination of \a GLSpipelineFlag values, or zero.
+ * \return              The pipeline.
+ *
+ * A pipeline fixes the mode and the view order, and builds the shader program
+ * for them up front, so that glsDrawViewsWithPipeline() does not have to
+ * check and set up anything that depends on the mode. Other settings such as
+ * ghostbusting, color lookup tables, and the overlay are still honored; if
+ * they require a different program, it is rebuilt once in the next call.
+ *
+ * glsDrawViews() uses an implicit pipeline for the mode of its last call, so
+ * there is no need to create pipelines unless you switch modes often or
+ * want to use \a GLS_PIPELINE_KEEP_STATE.
+ *
+ * Destroy all pipelines of a context with glsDestroyPipeline() before
+ * destroying the context.
+ */
+extern GLS_EXPORT
+GLSpipeline* glsCreatePipeline(GLScontext* ctx, GLSmode mode, GLboolean swapViews,
+        GLbitfield flags);
+
+/**
+ * \brief               Destroy a composition pipeline.
+ * \param ctx           The GLS context.
+ * \param pipeline      The pipeline.
+ */
+extern GLS_EXPORT
+void glsDestroyPipeline(GLScontext* ctx, GLSpipeline* pipeline);
+
+/**
+ * \brief               Displays the given views with a prebuilt pipeline.
+ * \param ctx           The GLS context.
+ * \param pipeline      The pipeline, from glsCreatePipeline().
+ * \param leftViewTexture  The texture containing the left view.
+ * \param rightViewTexture The texture containing the right view.
+ *
+ * Like glsDrawViews(), with the mode and view order of the pipeline.
+ * This always draws immediately; it is not handed to a compositor thread
+ * started with glsStartCompositor().
+ */
+extern GLS_EXPORT
+void glsDrawViewsWithPipeline(GLScontext* ctx, GLSpipeline* pipeline,
+        GLuint leftViewTexture, GLuint rightViewTexture);
+
+/**
+ * \brief               Set the stencil bit for direct rendering of the masked modes.
+ * \param ctx           The GLS context.
+ * \param stencilBit    The bit of the stencil buffer that libgls may use, e.g. 0x80, or zero.
+ *
+ * With a nonzero bit, glsBeginView() also supports \a GLS_MODE_EVEN_ODD_ROWS,
+ * \a GLS_MODE_EVEN_ODD_COLUMNS, and \a GLS_MODE_CHECKERBOARD, if the current
+ * framebuffer has a stencil buffer. It writes the mask of the mode into this
+ * bit, and restricts rendering to the pixels of the view with the stencil
+ * test. Unlike the composition, this does not filter the views, so fine
+ * details may flicker between rows or columns. Since glClear() ignores the
+ * stencil test, clear the output before the first view, not in each view.
+ * Do not change the stencil test or clear the stencil buffer while a view is
+ * rendered.
+ *
+ * The default is zero: the masked modes are composed from view textures.
+ */
+extern GLS_EXPORT
+void glsSetViewStencilBit(GLScontext* ctx, GLuint stencilBit);
+
+/**
+ * \brief               Begin to render a view directly into the output.
+ * \param ctx           The GLS context.
+ * \param mode          The stereoscopic display mode.
+ * \param swapViews     Whether to swap left and right view.
+ * \param view          The view.
+ * \return              Whether the view is rendered directly.
+ *
+ * In \a GLS_MODE_QUAD_BUFFER_STEREO, \a GLS_MODE_LEFT_RIGHT,
+ * \a GLS_MODE_TOP_BOTTOM, and \a GLS_MODE_HDMI_FRAME_PACK, the output
+ * consists of each view placed in a draw buffer or region of its own. For
+ * these modes, this function selects the back left or right draw buffer, or
+ * sets the viewport and the scissor box to the output region of the view,
+ * taking the current viewport as the output area. In
+ * \a GLS_MODE_HDMI_FRAME_PACK, it also clears the blank area between the
+ * views. The application then renders the view as usual, including
+ * glClear(), and calls glsEndView(). There is no view to submit, and no
+ * composition to draw. See glsSetViewStencilBit() for the masked modes.
+ *
+ * Parallax adjustment, ghostbusting, color lookup tables, overlays, and the
+ * other features of the composition do not apply to views rendered directly.
+ *
+ * If the mode does not support direct rendering, this function returns
+ * GL_FALSE and changes nothing; render and submit the view as usual instead.
+ * Quad-buffer stereo is not available with OpenGL ES.
+ */
+extern GLS_EXPORT
+GLboolean glsBeginView(GLScontext* ctx, GLSmode mode, GLboolean swapViews, GLSview view);
+
+/**
+ * \brief               End to render a view directly into the output.
+ * \param ctx           The GLS context.
+ *
+ * Restores the viewport, the scissor test, the draw buffer, and the stencil
+ * test that glsBeginView() changed.
+ */
+extern GLS_EXPORT
+void glsEndView(GLScontext* ctx);
+
 /**
  * \brief               Draw optional DLP 3D Ready Sync markers.
  * \param ctx           The GLS context.
@@ -563,6 +1336,78 @@ void glsDrawDLP3dReadySyncMarker(GLScontext* ctx, GLSmode mode);
 
 /*@}*/
 
+/**
+ * \name Asynchronous Composition
+ */
+
+/*@{*/
+
+/**
+ * \brief               Set the queue between application and compositor thread.
+ * \param ctx           The GLS context.
+ * \param depth         Number of frames that can wait for composition (1-8).
+ * \param latestOnly    Whether the compositor skips frames that are superseded.
+ *
+ * When the queue is full, glsDrawSubmittedViews() blocks until the compositor
+ * thread has finished a frame. A depth of 1 gives the lowest latency; a larger
+ * depth absorbs variations in rendering time at the cost of up to \a depth
+ * frames of additional latency. If \a latestOnly is set, the compositor
+ * always displays the newest frame in the queue and drops older ones, which
+ * keeps the latency low when rendering is faster than the display.
+ *
+ * This must be called before glsStartCompositor(). The default is a depth of 1
+ * without dropping frames.
+ */
+extern GLS_EXPORT
+void glsSetCompositorQueue(GLScontext* ctx, GLint depth, GLboolean latestOnly);
+
+/**
+ * \brief               Start composing frames on a separate thread.
+ * \param ctx           The GLS context.
+ * \param makeCurrent   Callback that makes the compositor's context current.
+ * \param swapBuffers   Callback that swaps the compositor's buffers.
+ * \param userData      Pointer that is passed to the callbacks.
+ * \return              Whether the compositor thread was started.
+ *
+ * The application must create a second OpenGL context that shares objects
+ * with the current one and can draw to the window. The compositor thread
+ * calls \a makeCurrent to bind this context, then composes frames,
+ * draws DLP 3D Ready Sync markers, and calls \a swapBuffers. This way,
+ * rendering the scene for the next frame overlaps with composition and
+ * buffer swap of the previous one.
+ *
+ * After this, glsDrawSubmittedViews() does not draw anything. It hands the
+ * submitted views to the compositor thread, together with the current
+ * viewport and options, and the application must not swap buffers itself.
+ * The views are handed over without copying, and fences ensure that each
+ * context waits for the other on the GPU, not on the CPU.
+ * glsDrawDLP3dReadySyncMarker() requests the marker for the next frame.
+ * glsDrawViews() still draws immediately.
+ *
+ * In \a GLS_MODE_ALTERNATING, both views are required for each frame.
+ * A trace callback set with glsSetTraceCallback() is also called from the
+ * compositor thread.
+ *
+ * This requires OpenGL 3.2 or GL_ARB_sync, and POSIX threads.
+ */
+extern GLS_EXPORT
+GLboolean glsStartCompositor(GLScontext* ctx,
+        GLSmakeCurrentCallback makeCurrent, GLSswapBuffersCallback swapBuffers,
+        void* userData);
+
+/**
+ * \brief               Stop the compositor thread.
+ * \param ctx           The GLS context.
+ *
+ * Frames that are still queued are discarded. Afterwards, the compositor's
+ * context is released (see glsStartCompositor()). This is done automatically
+ * by glsDestroyContext().
+ */
+extern GLS_EXPORT
+void glsStopCompositor(GLScontext* ctx);
+
+/*@}*/
+
 #ifdef __cplusplus
 }
 #endif
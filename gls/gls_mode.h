@@ -0,0 +1,139 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file gls_mode.h
+ * \brief The stereoscopic display modes.
+ *
+ * This header is included by gls.h and gls-vulkan.h. It does not include any
+ * OpenGL header, so that gls-vulkan.h can be used without OpenGL.
+ */
+
+#ifndef GLS_MODE_H
+#define GLS_MODE_H
+
+/* GLS_EXPORT: Declare functions as part of the library API.
+ * (You only need to define GLS_STATIC for a static GLS library
+ * if you use Microsoft compilers). */
+#if (defined _WIN32 || defined __WIN32__) && !defined __CYGWIN__
+#   ifdef GLS_BUILD
+#       ifdef DLL_EXPORT
+#           define GLS_EXPORT __declspec(dllexport)
+#       else
+#           define GLS_EXPORT
+#       endif
+#   else
+#       if defined _MSVC && !defined GLS_STATIC
+#           define GLS_EXPORT __declspec(dllimport)
+#       else
+#           define GLS_EXPORT
+#       endif
+#   endif
+#else
+#   define GLS_EXPORT
+#endif
+
+/**
+ * \brief       GLS stereoscopic display modes.
+ *
+ * See http://www.site.uottawa.ca/~edubois/anaglyph/ for more information
+ * about the Dubois anaglyph modes.
+ */
+typedef enum {
+    GLS_MODE_QUAD_BUFFER_STEREO        = 0,
+    /**< OpenGL quad buffered stereo. This mode can only be used if the
+     * application created an OpenGL context with quad buffered stereo
+     * support. */
+    GLS_MODE_ALTERNATING               = 1,
+    /**< Left and right view alternating for each display output frame. This
+     * allows to use active stereo displays without OpenGL quad buffer support.
+     * Note that this requires that you can render your scene at the display
+     * framerate, which is at least at 120 Hz for active stereo displays.
+     * Note also that this mode may be unreliable and may swap left/right eyes
+     * occasionally, depending on your system, graphics hardware, and driver.
+     * If the GLX_OML_sync_control extension is available, libgls predicts the
+     * display frame on which the next buffer swap will be shown and chooses the
+     * view accordingly; see glsSetFramePacingCallback(). */
+    GLS_MODE_MONO_LEFT                 = 2,
+    /**< Left view only. */
+    GLS_MODE_MONO_RIGHT                = 3,
+    /**< Right view only. */
+    GLS_MODE_LEFT_RIGHT                = 4,
+    /**< Left view in left half of viewport, right view in right half.
+     * Used by some 3D TVs and displays. */
+    GLS_MODE_TOP_BOTTOM                = 5,
+    /**< Left view in top half of viewport, right view in bottom half.
+     * Used by some 3D TVs and displays. */
+    GLS_MODE_HDMI_FRAME_PACK           = 6,
+    /**< HDMI Frame packing (left view in top half, right view in bottom half,
+     * separated by 1/49 of the viewport height).
+     *
+     * This mode only makes sens if you are forcing your display into the
+     * corresponding HDMI 3D mode. A description how to do this on GNU/Linux can
+     * be found here:
+     * http://lists.nongnu.org/archive/html/bino-list/2011-03/msg00033.html */
+    GLS_MODE_EVEN_ODD_ROWS             = 7,
+    /**< Left view in even pixel rows, right view in odd pixel rows.
+     * Used by some 3D TVs and displays. */
+    GLS_MODE_EVEN_ODD_COLUMNS          = 8,
+    /**< Left view in even pixel columns, right view in odd pixel columns.
+     * Used by some 3D TVs and displays. */
+    GLS_MODE_CHECKERBOARD              = 9,
+    /**< Left and right view pixels in a checkerboard pattern.
+     * Used by some 3D TVs and displays. */
+    GLS_MODE_RED_CYAN_MONOCHROME      = 10,
+    /**< Red/cyan anaglyph glasses, monochrome method. */
+    GLS_MODE_RED_CYAN_HALF_COLOR      = 11,
+    /**< Red/cyan anaglyph glasses, half color method. */
+    GLS_MODE_RED_CYAN_FULL_COLOR      = 12,
+    /**< Red/cyan anaglyph glasses, full color method. */
+    GLS_MODE_RED_CYAN_DUBOIS          = 13,
+    /**< Red/cyan anaglyph glasses, high quality Dubois method (recommended). */
+    GLS_MODE_GREEN_MAGENTA_MONOCHROME = 14,
+    /**< Green/magenta anaglyph glasses, monochrome method. */
+    GLS_MODE_GREEN_MAGENTA_HALF_COLOR = 15,
+    /**< Green/magenta anaglyph glasses, half color method. */
+    GLS_MODE_GREEN_MAGENTA_FULL_COLOR = 16,
+    /**< Green/magenta anaglyph glasses, full color method. */
+    GLS_MODE_GREEN_MAGENTA_DUBOIS     = 17,
+    /**< Green/magenta anaglyph glasses, high quality Dubois method (recommended). */
+    GLS_MODE_AMBER_BLUE_MONOCHROME    = 18,
+    /**< Amber/blue anaglyph glasses, monochrome method. */
+    GLS_MODE_AMBER_BLUE_HALF_COLOR    = 19,
+    /**< Amber/blue anaglyph glasses, half color method. */
+    GLS_MODE_AMBER_BLUE_FULL_COLOR    = 20,
+    /**< Amber/blue anaglyph glasses, full color method. */
+    GLS_MODE_AMBER_BLUE_DUBOIS        = 21,
+    /**< Amber/blue anaglyph glasses, high quality Dubois method (recommended). */
+    GLS_MODE_RED_GREEN_MONOCHROME     = 22,
+    /**< Red/green anaglyph glasses, monochrome method. */
+    GLS_MODE_RED_BLUE_MONOCHROME      = 23,
+    /**< Red/blue anaglyph glasses, monochrome method. */
+    GLS_MODE_HMD                      = 24,
+    /**< Head-mounted display: left view in the left half, right view in the
+     * right half, each predistorted for the lens in front of it. See
+     * glsSetHMDLens(). Not supported by glsBeginView() and libgls-vulkan. */
+} GLSmode;
+
+#endif
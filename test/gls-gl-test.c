@@ -0,0 +1,1249 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Test of libgls with desktop OpenGL.
+ *
+ * This program creates an OpenGL context for an EGL pbuffer, composes views
+ * in a number of modes and with the optional features, and checks the pixels
+ * of the result. It needs no window system: with Mesa, it runs on the
+ * surfaceless platform and llvmpipe. It exits with 77 (skipped) if no EGL
+ * display is available.
+ *
+ * With --fallback, it expects an OpenGL 2.1 context without the extensions
+ * for framebuffer objects, sync objects, timer queries and buffer storage,
+ * as Mesa provides with
+ *   MESA_GL_VERSION_OVERRIDE=2.1
+ *   MESA_EXTENSION_OVERRIDE="-GL_ARB_framebuffer_object ..."
+ * and checks that libgls does without them. It exits with 77 if the context
+ * does not look like that.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define GL_GLEXT_PROTOTYPES
+#include <gls/gls.h>
+
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static int failures = 0;
+
+static void check(int condition, const char* what, const char* feature)
+{
+    if (!condition) {
+        fprintf(stderr, "gls-gl-test: %s: %s\n", feature, what);
+        failures++;
+    }
+}
+
+/* Whether the pixel is mostly red (1), green (2), or blue (4) */
+static int color_at(int x, int y)
+{
+    unsigned char rgba[4];
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    return (rgba[0] > 128 ? 1 : 0) | (rgba[1] > 128 ? 2 : 0) | (rgba[2] > 128 ? 4 : 0);
+}
+
+/* Whether the pixel has the given color, up to rounding */
+static int pixel_is(int x, int y, int r, int g, int b)
+{
+    unsigned char rgba[4];
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    return abs(rgba[0] - r) <= 3 && abs(rgba[1] - g) <= 3 && abs(rgba[2] - b) <= 3;
+}
+
+static EGLDisplay get_display(void)
+{
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+        EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+            return display;
+    }
+#endif
+    {
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+            return display;
+    }
+    return EGL_NO_DISPLAY;
+}
+
+/* Whether the extension string of the current context contains a word */
+static int have_extension(const char* extension)
+{
+    const char* list = (const char*)glGetString(GL_EXTENSIONS);
+    size_t len = strlen(extension);
+    const char* p = list;
+
+    while (p && (p = strstr(p, extension))) {
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+            return 1;
+        p += len;
+    }
+    return 0;
+}
+
+/* Fill a rectangle of the current viewport with a color */
+static void fill(int x, int y, int w, int h, float r, float g, float b)
+{
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, w, h);
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+/* Render a single-colored view and submit it */
+static void submit(GLScontext* ctx, GLSview view, float r, float g, float b)
+{
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glsSubmitView(ctx, view);
+}
+
+static void test_modes(GLScontext* ctx)
+{
+    static const struct {
+        GLSmode mode;
+        const char* name;
+    } modes[] = {
+        { GLS_MODE_MONO_LEFT, "mono left" },
+        { GLS_MODE_MONO_RIGHT, "mono right" },
+        { GLS_MODE_LEFT_RIGHT, "left-right" },
+        { GLS_MODE_TOP_BOTTOM, "top-bottom" },
+        { GLS_MODE_RED_CYAN_FULL_COLOR, "red-cyan" },
+        { GLS_MODE_EVEN_ODD_ROWS, "even-odd rows" },
+        { GLS_MODE_EVEN_ODD_COLUMNS, "even-odd columns" },
+        { GLS_MODE_CHECKERBOARD, "checkerboard" }
+    };
+    GLuint app_tex;
+    size_t i;
+    int cached;
+
+    glGenTextures(1, &app_tex);
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        GLSmode mode = modes[i].mode;
+        const char* name = modes[i].name;
+        GLint binding;
+        int c[4];
+
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        // State that the composition must restore
+        glEnable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, app_tex);
+        glActiveTexture(GL_TEXTURE0);
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", name);
+        check(glIsEnabled(GL_BLEND), "GL_BLEND was not restored", name);
+        glActiveTexture(GL_TEXTURE1);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+        glActiveTexture(GL_TEXTURE0);
+        check(binding == (GLint)app_tex, "texture binding was not restored", name);
+        glDisable(GL_BLEND);
+
+        c[0] = color_at(WIDTH / 4, HEIGHT / 4);
+        c[1] = color_at(WIDTH / 4 + 1, HEIGHT / 4);
+        c[2] = color_at(WIDTH / 4, HEIGHT / 4 + 1);
+        c[3] = color_at(3 * WIDTH / 4, 3 * HEIGHT / 4);
+        switch (mode) {
+        case GLS_MODE_MONO_LEFT:
+            check(c[0] == 1 && c[3] == 1, "expected the left view", name);
+            break;
+        case GLS_MODE_MONO_RIGHT:
+            check(c[0] == 2 && c[3] == 2, "expected the right view", name);
+            break;
+        case GLS_MODE_LEFT_RIGHT:
+            check(c[0] == 1 && c[3] == 2, "expected left and right halves", name);
+            break;
+        case GLS_MODE_TOP_BOTTOM:
+            check(c[0] == 2 && c[3] == 1, "expected top and bottom halves", name);
+            break;
+        case GLS_MODE_RED_CYAN_FULL_COLOR:
+            check(c[0] == 3, "expected red from the left and green from the right view", name);
+            break;
+        case GLS_MODE_EVEN_ODD_ROWS:
+            check(c[0] != c[2] && c[0] == c[1] && (c[0] | c[2]) == 3, "expected alternating rows", name);
+            break;
+        case GLS_MODE_EVEN_ODD_COLUMNS:
+            check(c[0] != c[1] && c[0] == c[2] && (c[0] | c[1]) == 3, "expected alternating columns", name);
+            break;
+        default:
+            check(c[0] != c[1] && c[0] != c[2] && (c[0] | c[1]) == 3, "expected a checkerboard", name);
+            break;
+        }
+    }
+    glDeleteTextures(1, &app_tex);
+
+    // The cached composition is drawn again without new views
+    glsSetCompositionCaching(ctx, GL_TRUE);
+    for (cached = 0; cached < 2; cached++) {
+        if (!cached) {
+            glsClear(ctx);
+            submit(ctx, GLS_VIEW_LEFT, 0.0f, 0.0f, 1.0f);
+            submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        }
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "caching");
+        check(color_at(WIDTH / 4, HEIGHT / 2) == 4 && color_at(3 * WIDTH / 4, HEIGHT / 2) == 2,
+                "expected left and right halves", "caching");
+    }
+    glsSetCompositionCaching(ctx, GL_FALSE);
+}
+
+static void test_region(GLScontext* ctx)
+{
+    static const struct {
+        GLSmode mode;
+        const char* name;
+    } modes[] = {
+        { GLS_MODE_LEFT_RIGHT, "region left-right" },
+        { GLS_MODE_EVEN_ODD_ROWS, "region even-odd rows" }
+    };
+    static unsigned char cached[WIDTH * HEIGHT * 4], composed[WIDTH * HEIGHT * 4];
+    size_t i;
+    int j, differences;
+
+    glsSetCompositionCaching(ctx, GL_TRUE);
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        GLSmode mode = modes[i].mode;
+        const char* name = modes[i].name;
+
+        // The views have half the output size, so that a texel covers more
+        // than one output pixel
+        glsClear(ctx);
+        glViewport(0, 0, WIDTH / 2, HEIGHT / 2);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+        // Only the bottom left quarter of the blue read buffer is submitted
+        glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glViewport(0, 0, WIDTH / 2, HEIGHT / 2);
+        glsSubmitViewRegion(ctx, GLS_VIEW_LEFT, 0, 0, WIDTH / 4, HEIGHT / 4);
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", name);
+        if (mode == GLS_MODE_LEFT_RIGHT) {
+            check(color_at(WIDTH / 8, HEIGHT / 4) == 4, "expected the region in the left view", name);
+            check(color_at(3 * WIDTH / 8, 3 * HEIGHT / 4) == 1, "expected the old left view", name);
+            check(color_at(3 * WIDTH / 4, HEIGHT / 4) == 2, "expected the old right view", name);
+        } else {
+            check((color_at(WIDTH / 4, HEIGHT / 4) | color_at(WIDTH / 4, HEIGHT / 4 + 1)) == 6,
+                    "expected the region in the left view", name);
+            check((color_at(3 * WIDTH / 4, 3 * HEIGHT / 4) | color_at(3 * WIDTH / 4, 3 * HEIGHT / 4 + 1)) == 3,
+                    "expected the old left view", name);
+        }
+        // The partly updated cache must match a complete composition, also
+        // where the filter of the masked modes reaches across the region
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, cached);
+        glsSetCompositionCaching(ctx, GL_FALSE);
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+        glsSetCompositionCaching(ctx, GL_TRUE);
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, composed);
+        for (j = 0, differences = 0; j < WIDTH * HEIGHT * 4; j++)
+            differences += (abs(cached[j] - composed[j]) > 1);
+        check(differences == 0, "cached frame differs from the composition", name);
+    }
+    glsSetCompositionCaching(ctx, GL_FALSE);
+}
+
+static void test_mark_dirty(GLScontext* ctx)
+{
+    static const unsigned char colors[3][4] = { { 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 } };
+    GLuint views[2];
+    int i;
+
+    glGenTextures(2, views);
+    for (i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, views[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors[i]);
+    }
+    glsSetCompositionCaching(ctx, GL_TRUE);
+    glsDrawViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE, views[0], views[1]);
+    // The application's texture changes behind the back of libgls, so the
+    // cached frame is presented until the view is marked as changed
+    glBindTexture(GL_TEXTURE_2D, views[0]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, colors[2]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    for (i = 0; i < 2; i++) {
+        if (i == 1)
+            glsMarkViewDirty(ctx, GLS_VIEW_LEFT);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsDrawViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE, views[0], views[1]);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "mark dirty");
+        check(color_at(3 * WIDTH / 4, HEIGHT / 2) == 2, "expected the right view", "mark dirty");
+        check(color_at(WIDTH / 4, HEIGHT / 2) == (i == 0 ? 1 : 4),
+                i == 0 ? "expected the cached frame" : "expected a new composition", "mark dirty");
+    }
+    glsSetCompositionCaching(ctx, GL_FALSE);
+    glDeleteTextures(2, views);
+}
+
+static void test_trim(GLScontext* ctx)
+{
+    // Views and the composition cache are allocated for a large frame, then
+    // used at half the size, and trimmed
+    glsSetCompositionCaching(ctx, GL_TRUE);
+    glsClear(ctx);
+    submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+    submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+    glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+    glsClear(ctx);
+    glViewport(0, 0, WIDTH / 2, HEIGHT / 2);
+    submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+    submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+    glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+    glsTrim(ctx);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "trim");
+
+    // The trimmed views lost their content, so a region submission must
+    // copy the whole view. The viewport keeps the half size.
+    glsClear(ctx);
+    glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glsSubmitViewRegion(ctx, GLS_VIEW_LEFT, 0, 0, WIDTH / 8, HEIGHT / 8);
+    submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "trim");
+    check(color_at(WIDTH / 32, HEIGHT / 16) == 4 && color_at(3 * WIDTH / 16, 3 * HEIGHT / 8) == 4
+            && color_at(3 * WIDTH / 8, HEIGHT / 4) == 2,
+            "expected the views submitted after trimming", "trim");
+    // The same at the full size, which reallocates the trimmed textures
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glsClear(ctx);
+    submit(ctx, GLS_VIEW_LEFT, 0.0f, 1.0f, 0.0f);
+    submit(ctx, GLS_VIEW_RIGHT, 1.0f, 0.0f, 0.0f);
+    glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "trim");
+    check(color_at(WIDTH / 4, HEIGHT / 2) == 2 && color_at(3 * WIDTH / 4, HEIGHT / 2) == 1,
+            "expected the views at full size after trimming", "trim");
+    glsSetCompositionCaching(ctx, GL_FALSE);
+}
+
+static void test_upload(GLScontext* ctx)
+{
+    static unsigned char pixels[WIDTH * HEIGHT * 4];
+    int i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        pixels[4 * i + 0] = 0;
+        pixels[4 * i + 1] = 0;
+        pixels[4 * i + 2] = 255;
+        pixels[4 * i + 3] = 255;
+    }
+    glsClear(ctx);
+    check(glsUploadView(ctx, GLS_VIEW_LEFT, WIDTH, HEIGHT, GL_RGBA, 0, pixels),
+            "upload was not accepted", "upload");
+    glsDrawSubmittedViews(ctx, GLS_MODE_MONO_LEFT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "upload");
+    check(color_at(WIDTH / 2, HEIGHT / 2) == 4, "expected the uploaded view", "upload");
+}
+
+static void test_pipeline(GLScontext* ctx)
+{
+    static const struct {
+        GLSmode mode;
+        GLboolean swap;
+        const char* name;
+    } modes[] = {
+        { GLS_MODE_LEFT_RIGHT, GL_FALSE, "pipeline left-right" },
+        { GLS_MODE_LEFT_RIGHT, GL_TRUE, "pipeline left-right swapped" },
+        { GLS_MODE_RED_CYAN_FULL_COLOR, GL_FALSE, "pipeline red-cyan" },
+        { GLS_MODE_EVEN_ODD_ROWS, GL_FALSE, "pipeline even-odd rows" },
+        { GLS_MODE_CHECKERBOARD, GL_TRUE, "pipeline checkerboard swapped" }
+    };
+    static unsigned char pixels[2][WIDTH * HEIGHT * 4];
+    static unsigned char drawn[WIDTH * HEIGHT * 4], piped[WIDTH * HEIGHT * 4];
+    GLuint views[2];
+    size_t i;
+    int x, y, j, differences, keep_state;
+
+    // Gradients, so that a difference in filtering or placement shows
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            unsigned char* l = pixels[0] + 4 * (y * WIDTH + x);
+            unsigned char* r = pixels[1] + 4 * (y * WIDTH + x);
+            l[0] = 255 - 2 * x;
+            l[1] = 4 * y;
+            l[2] = 0;
+            l[3] = 255;
+            r[0] = 0;
+            r[1] = 255 - 4 * y;
+            r[2] = 2 * x;
+            r[3] = 255;
+        }
+    }
+    glGenTextures(2, views);
+    for (j = 0; j < 2; j++) {
+        glBindTexture(GL_TEXTURE_2D, views[j]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[j]);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // A pipeline must compose exactly what glsDrawViews() composes, with and
+    // without saving the state
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        const char* name = modes[i].name;
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsDrawViews(ctx, modes[i].mode, modes[i].swap, views[0], views[1]);
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, drawn);
+        for (keep_state = 0; keep_state < 2; keep_state++) {
+            GLSpipeline* pipe = glsCreatePipeline(ctx, modes[i].mode, modes[i].swap,
+                    keep_state ? GLS_PIPELINE_KEEP_STATE : 0);
+            GLint viewport[4], program;
+            glClear(GL_COLOR_BUFFER_BIT);
+            glEnable(GL_BLEND);
+            glsDrawViewsWithPipeline(ctx, pipe, views[0], views[1]);
+            check(glGetError() == GL_NO_ERROR, "OpenGL error", name);
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            check(viewport[0] == 0 && viewport[1] == 0 && viewport[2] == WIDTH && viewport[3] == HEIGHT,
+                    "viewport was not restored", name);
+            if (keep_state) {
+                // The state of the composition is left as it is
+                check(!glIsEnabled(GL_BLEND) && program != 0, "expected the state of the composition", name);
+            } else {
+                check(glIsEnabled(GL_BLEND) && program == 0, "state was not restored", name);
+            }
+            glDisable(GL_BLEND);
+            glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, piped);
+            for (j = 0, differences = 0; j < WIDTH * HEIGHT * 4; j++)
+                differences += (abs(drawn[j] - piped[j]) > 1);
+            check(differences == 0, keep_state ? "pipeline keeping the state differs from glsDrawViews()"
+                    : "pipeline differs from glsDrawViews()", name);
+            glsDestroyPipeline(ctx, pipe);
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            check(program == 0, "destroyed pipeline program is still in use", name);
+        }
+    }
+    glDeleteTextures(2, views);
+}
+
+static void test_multisample(GLScontext* ctx)
+{
+    GLuint fbo[2], rbo[2];
+    int i;
+
+    // The left view comes from a multisampled framebuffer, which must be
+    // resolved, and the right view from a single-sampled one, which is
+    // copied. Submitting twice checks that switching between them is noticed.
+    glGenFramebuffers(2, fbo);
+    glGenRenderbuffers(2, rbo);
+    for (i = 0; i < 2; i++) {
+        glBindRenderbuffer(GL_RENDERBUFFER, rbo[i]);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, i == 0 ? 4 : 0, GL_RGBA8, WIDTH, HEIGHT);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo[i]);
+    }
+    for (i = 0; i < 2; i++) {
+        glsClear(ctx);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[1]);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "multisampled views");
+        check(color_at(WIDTH / 4, HEIGHT / 2) == 1 && color_at(3 * WIDTH / 4, HEIGHT / 2) == 2,
+                "expected the resolved and the copied view", "multisampled views");
+    }
+    glDeleteFramebuffers(2, fbo);
+    glDeleteRenderbuffers(2, rbo);
+
+    // A framebuffer that is recreated with a new size often gets the same
+    // name. Here the same framebuffer gets a smaller, multisampled attachment
+    // instead of a single-sampled one.
+    glGenFramebuffers(1, fbo);
+    glGenRenderbuffers(2, rbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
+    for (i = 0; i < 2; i++) {
+        int w = (i == 0 ? WIDTH : WIDTH / 2);
+        int h = (i == 0 ? HEIGHT : HEIGHT / 2);
+        glBindRenderbuffer(GL_RENDERBUFFER, rbo[i]);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, i == 0 ? 0 : 4, GL_RGBA8, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo[i]);
+        glViewport(0, 0, w, h);
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 0.0f, 0.0f, 1.0f);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glsDrawSubmittedViews(ctx, GLS_MODE_MONO_LEFT, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "resized multisampled views");
+        check(color_at(WIDTH / 2, HEIGHT / 2) == 4, "expected the submitted view", "resized multisampled views");
+    }
+    glDeleteFramebuffers(1, fbo);
+    glDeleteRenderbuffers(2, rbo);
+}
+
+static void test_overlay(GLScontext* ctx)
+{
+    // A white overlay over the center of the views, shifted by 1/8 of the
+    // view width between them: the left view shows it 4 pixels further
+    // left than the screen plane, the right view 4 pixels further right
+    static const GLfloat rect[4] = { 0.25f, 0.25f, 0.5f, 0.5f };
+    static unsigned char white[4 * 4 * 4];
+    GLuint tex;
+    int view;
+
+    memset(white, 255, sizeof(white));
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glsSetOverlay(ctx, tex, rect, 0.125f, GLS_ALPHA_STRAIGHT);
+    for (view = 0; view < 2; view++) {
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 1.0f, 0.0f, 0.0f);
+        glsDrawSubmittedViews(ctx, view ? GLS_MODE_MONO_RIGHT : GLS_MODE_MONO_LEFT, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "overlay");
+        check(color_at(WIDTH / 2, HEIGHT / 2) == 7, "expected the overlay in the center", "overlay");
+        check(color_at(WIDTH / 2, HEIGHT / 8) == 1, "expected the view below the overlay", "overlay");
+        check(color_at(WIDTH / 4 - 2, HEIGHT / 2) == (view ? 1 : 7)
+                && color_at(3 * WIDTH / 4 + 2, HEIGHT / 2) == (view ? 7 : 1),
+                "expected the overlay shifted by the disparity", "overlay");
+    }
+    glsSetOverlay(ctx, 0, rect, 0.0f, GLS_ALPHA_STRAIGHT);
+    glDeleteTextures(1, &tex);
+}
+
+static void test_lut(GLScontext* ctx)
+{
+    // An output table that inverts the colors, and a view table that
+    // rotates the channels (r, g, b) -> (b, r, g)
+    enum { N = 17 };
+    static unsigned char invert[N * N * N * 3], rotate[N * N * N * 3];
+    GLuint luts[2];
+    int r, g, b, i;
+
+    for (b = 0; b < N; b++) {
+        for (g = 0; g < N; g++) {
+            for (r = 0; r < N; r++) {
+                unsigned char* p = invert + 3 * (r + N * (g + N * b));
+                unsigned char* q = rotate + 3 * (r + N * (g + N * b));
+                p[0] = 255 - r * 255 / (N - 1);
+                p[1] = 255 - g * 255 / (N - 1);
+                p[2] = 255 - b * 255 / (N - 1);
+                q[0] = b * 255 / (N - 1);
+                q[1] = r * 255 / (N - 1);
+                q[2] = g * 255 / (N - 1);
+            }
+        }
+    }
+    glGenTextures(2, luts);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_3D, luts[i]);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB8, N, N, N, 0, GL_RGB, GL_UNSIGNED_BYTE, i ? rotate : invert);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // Colors on the lattice of the tables, so that the interpolation is exact
+    glsSetColorLUT(ctx, luts[0], N);
+    glsSetViewColorLUT(ctx, GLS_VIEW_LEFT, luts[1], N);
+    glsClear(ctx);
+    submit(ctx, GLS_VIEW_LEFT, 0.25f, 0.5f, 0.75f);
+    submit(ctx, GLS_VIEW_RIGHT, 0.25f, 0.5f, 0.75f);
+    glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "color lookup tables");
+    check(pixel_is(WIDTH / 4, HEIGHT / 2, 64, 191, 128),
+            "expected the rotated and inverted color in the left view", "color lookup tables");
+    check(pixel_is(3 * WIDTH / 4, HEIGHT / 2, 191, 128, 64),
+            "expected the inverted color in the right view", "color lookup tables");
+    glsSetColorLUT(ctx, 0, 0);
+    glsSetViewColorLUT(ctx, GLS_VIEW_LEFT, 0, 0);
+    glDeleteTextures(2, luts);
+}
+
+static void test_asymmetric(GLScontext* ctx)
+{
+    GLSview view;
+    int w;
+
+    glsSetAsymmetricResolution(ctx, GLS_VIEW_LEFT, 0.5f, 0);
+    glsClear(ctx);
+    check(glsGetRenderScale(ctx, GLS_VIEW_LEFT) == 0.5f && glsGetRenderScale(ctx, GLS_VIEW_RIGHT) == 1.0f,
+            "unexpected render scales", "asymmetric resolution");
+    // Each view is red in its left and blue in its right half
+    for (view = GLS_VIEW_LEFT; view <= GLS_VIEW_RIGHT; view++) {
+        w = WIDTH * glsGetRenderScale(ctx, view);
+        glViewport(0, 0, w, HEIGHT * glsGetRenderScale(ctx, view));
+        fill(0, 0, w / 2, HEIGHT, 1.0f, 0.0f, 0.0f);
+        fill(w / 2, 0, w - w / 2, HEIGHT, 0.0f, 0.0f, 1.0f);
+        glsSubmitView(ctx, view);
+    }
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glsDrawSubmittedViews(ctx, GLS_MODE_EVEN_ODD_COLUMNS, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "asymmetric resolution");
+    // The reduced view is scaled up to the full viewport
+    check(color_at(WIDTH / 8, HEIGHT / 2) == 1 && color_at(WIDTH / 8 + 1, HEIGHT / 2) == 1
+            && color_at(7 * WIDTH / 8, HEIGHT / 2) == 4 && color_at(7 * WIDTH / 8 + 1, HEIGHT / 2) == 4,
+            "expected both views at full size", "asymmetric resolution");
+
+    // Alternating the reduced view
+    glsSetAsymmetricResolution(ctx, GLS_VIEW_LEFT, 0.5f, 1);
+    glsClear(ctx);
+    view = (glsGetRenderScale(ctx, GLS_VIEW_LEFT) < 1.0f ? GLS_VIEW_LEFT : GLS_VIEW_RIGHT);
+    glsClear(ctx);
+    check(glsGetRenderScale(ctx, view) == 1.0f && glsGetRenderScale(ctx, 1 - view) == 0.5f,
+            "expected the other view to be reduced", "asymmetric resolution");
+    glsSetAsymmetricResolution(ctx, GLS_VIEW_LEFT, 1.0f, 0);
+}
+
+static void test_view_edges(GLScontext* ctx)
+{
+    // A view that is smaller than the output is scaled up with linear
+    // filtering. The unused part of its pooled texture holds the previous,
+    // green frame; neither it nor the black border may bleed into the edges.
+    glsClear(ctx);
+    submit(ctx, GLS_VIEW_LEFT, 0.0f, 1.0f, 0.0f);
+    glsClear(ctx);
+    glViewport(0, 0, WIDTH / 2, HEIGHT / 2);
+    submit(ctx, GLS_VIEW_LEFT, 0.0f, 0.0f, 1.0f);
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glsDrawSubmittedViews(ctx, GLS_MODE_MONO_LEFT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "view edges");
+    check(pixel_is(0, 0, 0, 0, 255) && pixel_is(WIDTH - 1, HEIGHT - 1, 0, 0, 255),
+            "expected the edge color at the view edges", "view edges");
+}
+
+static void test_dynamic_resolution(GLScontext* ctx, int fallback)
+{
+    GLfloat scale = 1.0f;
+    int i;
+
+    // A budget that no frame can meet drives the scale down, unless timer
+    // queries are missing
+    glsSetDynamicResolution(ctx, 1e-6f, 0.5f);
+    for (i = 0; i < 8; i++) {
+        glsClear(ctx);
+        scale = glsGetRenderScale(ctx, GLS_VIEW_LEFT);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+        glFinish();
+    }
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "dynamic resolution");
+    if (fallback)
+        check(scale == 1.0f, "scale changed without timer queries", "dynamic resolution");
+    else
+        check(scale == 0.5f, "scale did not drop to the minimum", "dynamic resolution");
+    glsSetDynamicResolution(ctx, 0.0f, 0.5f);
+    glsClear(ctx);
+    check(glsGetRenderScale(ctx, GLS_VIEW_LEFT) == 1.0f, "scale was not reset", "dynamic resolution");
+}
+
+/* A 64x64 view with red increasing to the right and green increasing to the
+ * top; blue follows red in the left view and is mirrored in the right view */
+static GLuint create_gradient_view(GLSview view)
+{
+    static unsigned char pixels[64 * 64 * 4];
+    GLuint tex;
+    int x, y;
+
+    for (y = 0; y < 64; y++) {
+        for (x = 0; x < 64; x++) {
+            unsigned char* p = pixels + 4 * (y * 64 + x);
+            p[0] = 4 * x;
+            p[1] = 4 * y;
+            p[2] = (view == GLS_VIEW_LEFT ? 4 * x : 252 - 4 * x);
+            p[3] = 255;
+        }
+    }
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+static void test_hmd(GLScontext* ctx)
+{
+    static const GLfloat identity[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    static const GLfloat no_aberration[2] = { 1.0f, 1.0f };
+    static const GLfloat distortion[4] = { 1.0f, 0.25f, 0.05f, 0.0f };
+    static const GLfloat aberration[2] = { 0.97f, 1.03f };
+    static const GLfloat offset = 0.1f;
+    static unsigned char expected[WIDTH * HEIGHT * 4], result[WIDTH * HEIGHT * 4];
+    GLuint views[2];
+    GLint binding;
+    int variant, i, x, y, c;
+    int max_error, outside_errors, checked;
+
+    views[0] = create_gradient_view(GLS_VIEW_LEFT);
+    views[1] = create_gradient_view(GLS_VIEW_RIGHT);
+
+    // Without distortion, the mode is the same as left-right, also with
+    // ghostbusting, swapped views and caching
+    for (variant = 0; variant < 8; variant++) {
+        GLboolean swap = (variant & 2) ? GL_TRUE : GL_FALSE;
+        glsSetCompositionCaching(ctx, (variant & 4) ? GL_TRUE : GL_FALSE);
+        glsSetCrosstalkGhostbusting(ctx, 0.1f, 0.1f, 0.1f, (variant & 1) ? 1.0f : 0.0f);
+        glsDrawViews(ctx, GLS_MODE_LEFT_RIGHT, swap, views[0], views[1]);
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, expected);
+        glsDrawViews(ctx, GLS_MODE_HMD, swap, views[0], views[1]);
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, result);
+        max_error = 0;
+        for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+            if (abs(expected[i] - result[i]) > max_error)
+                max_error = abs(expected[i] - result[i]);
+        check(max_error <= 1, "identity lens differs from left-right", "head-mounted display");
+    }
+    glsSetCrosstalkGhostbusting(ctx, 0.0f, 0.0f, 0.0f, 0.0f);
+    glsSetCompositionCaching(ctx, GL_FALSE);
+
+    // With distortion, each channel of each display pixel shows the view at
+    // the position that the lens model gives; points outside are black
+    glsSetHMDLens(ctx, distortion, aberration, offset);
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glsDrawViews(ctx, GLS_MODE_HMD, GL_FALSE, views[0], views[1]);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "head-mounted display");
+    glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, result);
+    max_error = 0;
+    outside_errors = 0;
+    checked = 0;
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            int eye = (x >= WIDTH / 2);
+            float px = (x - eye * WIDTH / 2 + 0.5f) / (WIDTH / 2) * 2.0f - 1.0f;
+            float py = (y + 0.5f) / HEIGHT * 2.0f - 1.0f;
+            float center = (eye ? -offset : offset);
+            float aspect = (float)(WIDTH / 2) / HEIGHT;
+            float dx = (px - center) * aspect;
+            float r2 = dx * dx + py * py;
+            float f = distortion[0] + r2 * (distortion[1] + r2 * (distortion[2] + r2 * distortion[3]));
+            float scale[3];
+            scale[0] = f * aberration[0];
+            scale[1] = f;
+            scale[2] = f * aberration[1];
+            for (c = 0; c < 3; c++) {
+                float tx = ((px - center) * scale[c] + 1.0f) / 2.0f;
+                float ty = (py * scale[c] + 1.0f) / 2.0f;
+                int value = result[4 * (y * WIDTH + x) + c];
+                float v;
+                if (tx < -0.02f || tx > 1.02f || ty < -0.02f || ty > 1.02f) {
+                    outside_errors += (value != 0);
+                    continue;
+                }
+                // Skip the borders, where rounding decides between view and black
+                if (tx < 0.05f || tx > 0.95f || ty < 0.05f || ty > 0.95f)
+                    continue;
+                v = (c == 1 ? 4.0f * (ty * 64.0f - 0.5f) : 4.0f * (tx * 64.0f - 0.5f));
+                if (c == 2 && eye)
+                    v = 252.0f - v;
+                if ((int)fabsf(v - value) > max_error)
+                    max_error = (int)fabsf(v - value);
+                checked++;
+            }
+        }
+    }
+    check(checked > 2000, "too few pixels inside the views", "head-mounted display");
+    check(max_error <= 3, "pixels differ from the lens model", "head-mounted display");
+    check(outside_errors == 0, "pixels outside of the views are not black", "head-mounted display");
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &binding);
+    check(binding == 0 && !glIsEnabled(GL_VERTEX_ARRAY) && !glIsEnabled(GL_TEXTURE_COORD_ARRAY),
+            "vertex array state was not restored", "head-mounted display");
+
+    glsSetHMDLens(ctx, identity, no_aberration, 0.0f);
+    glDeleteTextures(2, views);
+}
+
+/* Clear, and render a plane at the given depth that is red left of x = 0 and
+ * green right of it */
+static void render_edge(GLfloat z)
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glBegin(GL_QUADS);
+    glColor3f(1.0f, 0.0f, 0.0f);
+    glVertex3f(-100.0f, -100.0f, z);
+    glVertex3f(0.0f, -100.0f, z);
+    glVertex3f(0.0f, 100.0f, z);
+    glVertex3f(-100.0f, 100.0f, z);
+    glColor3f(0.0f, 1.0f, 0.0f);
+    glVertex3f(0.0f, -100.0f, z);
+    glVertex3f(100.0f, -100.0f, z);
+    glVertex3f(100.0f, 100.0f, z);
+    glVertex3f(0.0f, 100.0f, z);
+    glEnd();
+    glDisable(GL_DEPTH_TEST);
+}
+
+/* Set the matrices of a view for a camera at the given x position, and
+ * optionally render the edge at z = -5, where one unit is 12.8 pixels wide */
+static void render_plane(GLScontext* ctx, GLSview view, double camera_x, int render)
+{
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(-0.5, 0.5, -0.25, 0.25, 1.0, 100.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslated(-camera_x, 0.0, 0.0);
+    glsSetViewMatrices(ctx, view, NULL, NULL);
+    if (render)
+        render_edge(-5.0f);
+    glLoadIdentity();
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+static void test_reprojection(GLScontext* ctx)
+{
+    GLSview due;
+    int frame;
+
+    glsSetReprojection(ctx, GL_TRUE);
+    // Two frames in time, with the camera at x = 0: the red-green edge is
+    // in the center
+    for (frame = 0; frame < 2; frame++) {
+        glsClear(ctx);
+        due = (glsIsViewRequired(ctx, GLS_MODE_ALTERNATING, GL_FALSE, GLS_VIEW_LEFT)
+                ? GLS_VIEW_LEFT : GLS_VIEW_RIGHT);
+        render_plane(ctx, 1 - due, 0.0, 0);
+        render_plane(ctx, due, 0.0, 1);
+        glsSubmitView(ctx, due);
+        glsDrawSubmittedViews(ctx, GLS_MODE_ALTERNATING, GL_FALSE);
+    }
+    check(color_at(WIDTH / 2 - 2, HEIGHT / 2) == 1 && color_at(WIDTH / 2 + 2, HEIGHT / 2) == 2,
+            "expected the edge in the center", "reprojection");
+    // A late frame with the camera moved to x = 0.625: the application still
+    // renders the other view, and the due view from two frames ago must be
+    // warped so that the edge moves 8 pixels to the left. The right border
+    // was not visible before and is black.
+    glsClear(ctx);
+    due = (glsIsViewRequired(ctx, GLS_MODE_ALTERNATING, GL_FALSE, GLS_VIEW_LEFT)
+            ? GLS_VIEW_LEFT : GLS_VIEW_RIGHT);
+    render_plane(ctx, due, 0.625, 0);
+    render_plane(ctx, 1 - due, 0.625, 1);
+    glsSubmitView(ctx, 1 - due);
+    glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glsDrawSubmittedViews(ctx, GLS_MODE_ALTERNATING, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "reprojection");
+    check(color_at(WIDTH / 2 - 9, HEIGHT / 2) == 1 && color_at(WIDTH / 2 - 7, HEIGHT / 2) == 2
+            && color_at(WIDTH / 2 + 8, HEIGHT / 2) == 2,
+            "expected the edge 8 pixels left of the center", "reprojection");
+    check(color_at(WIDTH - 10, HEIGHT / 2) == 2 && color_at(WIDTH - 7, HEIGHT / 2) == 0,
+            "expected a black right border of 8 pixels", "reprojection");
+    glsSetReprojection(ctx, GL_FALSE);
+}
+
+/* Render the edge at z = -16 for a stereo camera with a focal length of 8 and
+ * an eye separation of 1. The edge then has a disparity of 1/16 of the view
+ * width, i.e. 4 pixels: it is at x = 30 in the left and at x = 34 in the
+ * right view. */
+static void render_stereo_edge(GLSview view)
+{
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glsFrustum(-0.5, 0.5, -0.25, 0.25, 1.0, 100.0, 8.0, 1.0, view);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslated(view == GLS_VIEW_LEFT ? 0.5 : -0.5, 0.0, 0.0);
+    render_edge(-16.0f);
+    glLoadIdentity();
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+static void test_synthesis(GLScontext* ctx)
+{
+    GLSview view;
+
+    glsSetViewSynthesisFrustum(ctx, -0.5, 0.5, 1.0, 100.0, 8.0, 1.0);
+    for (view = GLS_VIEW_LEFT; view <= GLS_VIEW_RIGHT; view++) {
+        int x = (view == GLS_VIEW_LEFT ? 34 : 30);
+        glsClear(ctx);
+        render_stereo_edge(view);
+        glsSubmitViewWithDepth(ctx, view);
+        glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsDrawSubmittedViews(ctx, view == GLS_VIEW_LEFT ? GLS_MODE_MONO_RIGHT : GLS_MODE_MONO_LEFT,
+                GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", "view synthesis");
+        check(color_at(x - 1, HEIGHT / 2) == 1 && color_at(x, HEIGHT / 2) == 2,
+                "expected the edge shifted by 4 pixels", "view synthesis");
+        check(color_at(1, HEIGHT / 2) == 1 && color_at(WIDTH - 2, HEIGHT / 2) == 2,
+                "expected the edges of the view to be filled", "view synthesis");
+        // The synthesized view matches the rendered one
+        render_stereo_edge(1 - view);
+        check(color_at(x - 1, HEIGHT / 2) == 1 && color_at(x, HEIGHT / 2) == 2,
+                "the rendered view differs", "view synthesis");
+    }
+}
+
+/* The compositor thread's context, which shares objects with the main
+ * context, and the colors that it composed into the two halves */
+typedef struct
+{
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+    sem_t swapped;
+    int left, right;
+} Compositor;
+
+static GLboolean compositor_make_current(GLboolean current, void* data)
+{
+    Compositor* c = data;
+    if (current)
+        return eglMakeCurrent(c->display, c->surface, c->surface, c->context);
+    return eglMakeCurrent(c->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+static void compositor_swap_buffers(void* data)
+{
+    Compositor* c = data;
+    c->left = color_at(WIDTH / 4, HEIGHT / 2);
+    c->right = color_at(3 * WIDTH / 4, HEIGHT / 2);
+    sem_post(&c->swapped);
+}
+
+static void test_compositor(GLScontext* ctx, EGLDisplay display, EGLConfig config, EGLContext context)
+{
+    static const EGLint pbuffer_attribs[] = { EGL_WIDTH, WIDTH, EGL_HEIGHT, HEIGHT, EGL_NONE };
+    Compositor c;
+    struct timespec timeout;
+    GLboolean started;
+    int i;
+
+    c.display = display;
+    c.surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    c.context = eglCreateContext(display, config, context, NULL);
+    if (c.surface == EGL_NO_SURFACE || c.context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "gls-gl-test: cannot create a shared OpenGL context; compositor not tested\n");
+        return;
+    }
+    sem_init(&c.swapped, 0, 0);
+    started = glsStartCompositor(ctx, compositor_make_current, compositor_swap_buffers, &c);
+    check(started, "compositor did not start", "compositor");
+    // Each frame goes through the queues to the compositor thread and back
+    for (i = 0; i < 4 && started; i++) {
+        c.left = 0;
+        c.right = 0;
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        glsDrawSubmittedViews(ctx, GLS_MODE_LEFT_RIGHT, GL_FALSE);
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += 10;
+        while (sem_timedwait(&c.swapped, &timeout) != 0 && errno == EINTR)
+            ;
+        check(c.left == 1 && c.right == 2, "expected the composed frame", "compositor");
+    }
+    glsStopCompositor(ctx);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "compositor");
+    sem_destroy(&c.swapped);
+    eglDestroyContext(display, c.context);
+    eglDestroySurface(display, c.surface);
+}
+
+/* Check that a trace file is a complete JSON array of trace events in which
+ * begin and end events nest. Returns the number of events, or -1. */
+static int read_trace(const char* filename)
+{
+    char stack[32][64];
+    char line[256];
+    int depth = 0, events = 0, closed = 0, more = 1, valid = 1;
+    FILE* f = fopen(filename, "r");
+
+    if (!f)
+        return -1;
+    if (!fgets(line, sizeof(line), f) || strcmp(line, "[\n") != 0)
+        valid = 0;
+    while (valid && fgets(line, sizeof(line), f)) {
+        char name[64], phase;
+        double ts;
+        if (closed) {
+            valid = 0;
+        } else if (!more) {
+            // Only the closing bracket may follow the last event
+            valid = (strcmp(line, "]\n") == 0);
+            closed = 1;
+        } else if (sscanf(line, "{\"name\":\"%63[^\"]\",\"cat\":\"gls\",\"ph\":\"%c\",\"ts\":%lf,\"pid\":1,\"tid\":1",
+                    name, &phase, &ts) != 3) {
+            valid = 0;
+        } else {
+            more = (strcmp(strchr(line, '}'), "},\n") == 0);
+            if (!more && strcmp(strchr(line, '}'), "}\n") != 0)
+                valid = 0;
+            else if (phase == 'B' && depth < 32)
+                strcpy(stack[depth++], name);
+            else if (phase != 'E' || depth == 0 || strcmp(stack[--depth], name) != 0)
+                valid = 0;
+            events++;
+        }
+    }
+    fclose(f);
+    return (valid && closed && depth == 0 ? events : -1);
+}
+
+static void test_trace(GLScontext* ctx)
+{
+    char filename[] = "/tmp/gls-gl-test-trace-XXXXXX";
+    GLScontext* other;
+    int fd = mkstemp(filename);
+
+    if (fd < 0) {
+        fprintf(stderr, "gls-gl-test: cannot create a temporary file; trace file not tested\n");
+        return;
+    }
+    close(fd);
+
+    // The file is complete when tracing is stopped...
+    check(glsSetTraceFile(ctx, filename), "trace file was not opened", "trace file");
+    glsClear(ctx);
+    submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+    submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+    glsDrawSubmittedViews(ctx, GLS_MODE_EVEN_ODD_ROWS, GL_FALSE);
+    glsSetTraceFile(ctx, NULL);
+    check(read_trace(filename) >= 6, "expected nested events after stopping", "trace file");
+
+    // ...and when the context is destroyed
+    other = glsCreateContext();
+    check(glsSetTraceFile(other, filename), "trace file was not opened", "trace file");
+    glsClear(other);
+    submit(other, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+    glsDrawSubmittedViews(other, GLS_MODE_MONO_LEFT, GL_FALSE);
+    glsDestroyContext(other);
+    check(read_trace(filename) >= 4, "expected nested events after destroying the context", "trace file");
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "trace file");
+    remove(filename);
+}
+
+static void test_matrices(void)
+{
+    static const GLfloat eye[3] = { 1.0f, 2.0f, 3.0f };
+    static const GLfloat center[3] = { -1.0f, 0.5f, -2.0f };
+    static const GLfloat up[3] = { 0.1f, 1.0f, 0.0f };
+    // Enough cameras for a vectorized loop and its remainder
+    enum { CAMERAS = 7 };
+    GLfloat left[CAMERAS], right[CAMERAS], bottom[CAMERAS], top[CAMERAS];
+    GLfloat z_near[CAMERAS], z_far[CAMERAS], focal_length[CAMERAS], separation[CAMERAS];
+    GLfloat eyes[3 * CAMERAS], centers[3 * CAMERAS], ups[3 * CAMERAS];
+    GLfloat projections[32 * CAMERAS], modelviews[32 * CAMERAS];
+    GLfloat projection[32], modelview[32], m[16];
+    double err = 0.0, array_err = 0.0;
+    int view, i, j;
+
+    // The matrix stack functions must match the matrix output functions
+    glsPerspectiveMatricesf(60.0, 1.5, 0.5, 50.0, 4.0, 0.2, projection);
+    glsLookAtMatricesf(eye, center, up, 0.2f, modelview);
+    for (view = 0; view < 2; view++) {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glsPerspective(60.0, 1.5, 0.5, 50.0, 4.0, 0.2, view);
+        glGetFloatv(GL_PROJECTION_MATRIX, m);
+        for (i = 0; i < 16; i++)
+            err = fmax(err, fabs(m[i] - projection[16 * view + i]));
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glsLookAt(1.0, 2.0, 3.0, -1.0, 0.5, -2.0, 0.1, 1.0, 0.0, 0.2, view);
+        glGetFloatv(GL_MODELVIEW_MATRIX, m);
+        for (i = 0; i < 16; i++)
+            err = fmax(err, fabs(m[i] - modelview[16 * view + i]));
+    }
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "matrices");
+    check(err < 1e-5, "matrix stack and matrix output differ", "matrices");
+
+    // The array functions must match the functions for a single camera, up to
+    // the precision of their single precision computation
+    for (j = 0; j < CAMERAS; j++) {
+        left[j] = -0.5f - 0.1f * j;
+        right[j] = 0.4f + 0.05f * j;
+        bottom[j] = -0.3f - 0.02f * j;
+        top[j] = 0.35f + 0.03f * j;
+        z_near[j] = 0.5f + 0.1f * j;
+        z_far[j] = 50.0f + 10.0f * j;
+        focal_length[j] = 2.0f + 0.5f * j;
+        separation[j] = 0.06f + 0.01f * j;
+        for (i = 0; i < 3; i++) {
+            eyes[3 * j + i] = eye[i] + 0.5f * j;
+            centers[3 * j + i] = center[i] - 0.25f * j * (i + 1);
+            ups[3 * j + i] = up[i] + (i == 0 ? 0.05f * j : 0.0f);
+        }
+    }
+    glsFrustumMatricesArrayf(CAMERAS, left, right, bottom, top, z_near, z_far,
+            focal_length, separation, projections);
+    glsLookAtMatricesArrayf(CAMERAS, eyes, centers, ups, separation, modelviews);
+    for (j = 0; j < CAMERAS; j++) {
+        glsFrustumMatricesf(left[j], right[j], bottom[j], top[j], z_near[j], z_far[j],
+                focal_length[j], separation[j], projection);
+        glsLookAtMatricesf(eyes + 3 * j, centers + 3 * j, ups + 3 * j, separation[j], modelview);
+        for (i = 0; i < 32; i++) {
+            array_err = fmax(array_err, fabs(projections[32 * j + i] - projection[i]) / fmax(1.0, fabs(projection[i])));
+            array_err = fmax(array_err, fabs(modelviews[32 * j + i] - modelview[i]) / fmax(1.0, fabs(modelview[i])));
+        }
+    }
+    check(array_err < 1e-5, "array and single camera matrices differ", "matrices");
+}
+
+int main(int argc, char* argv[])
+{
+    static const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 16, EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+    static const EGLint pbuffer_attribs[] = { EGL_WIDTH, WIDTH, EGL_HEIGHT, HEIGHT, EGL_NONE };
+    static const char* const missing_extensions[] = {
+        "GL_ARB_framebuffer_object", "GL_ARB_sync", "GL_ARB_timer_query",
+        "GL_ARB_buffer_storage"
+    };
+    int fallback = (argc == 2 && strcmp(argv[1], "--fallback") == 0);
+    EGLDisplay display;
+    EGLConfig config;
+    EGLint config_count;
+    EGLSurface surface;
+    EGLContext context;
+    GLScontext* ctx;
+    size_t i;
+
+    display = get_display();
+    if (display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "gls-gl-test: no EGL display\n");
+        return 77;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)
+            || !eglChooseConfig(display, config_attribs, &config, 1, &config_count)
+            || config_count < 1) {
+        fprintf(stderr, "gls-gl-test: no OpenGL pbuffer configuration\n");
+        return 77;
+    }
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT
+            || !eglMakeCurrent(display, surface, surface, context)) {
+        fprintf(stderr, "gls-gl-test: cannot create an OpenGL context\n");
+        return 77;
+    }
+    if (fallback) {
+        int limited = (strncmp((const char*)glGetString(GL_VERSION), "2.1", 3) == 0);
+        for (i = 0; limited && i < sizeof(missing_extensions) / sizeof(missing_extensions[0]); i++)
+            limited = !have_extension(missing_extensions[i]);
+        if (!limited) {
+            fprintf(stderr, "gls-gl-test: the context has OpenGL %s or one of the extensions "
+                    "that the fallback test removes\n", glGetString(GL_VERSION));
+            return 77;
+        }
+    }
+    glViewport(0, 0, WIDTH, HEIGHT);
+
+    ctx = glsCreateContext();
+    check(ctx != NULL, "no GLS context", "loader");
+    if (!ctx)
+        return 1;
+    test_modes(ctx);
+    test_upload(ctx);
+    test_pipeline(ctx);
+    test_overlay(ctx);
+    test_lut(ctx);
+    test_asymmetric(ctx);
+    test_view_edges(ctx);
+    test_dynamic_resolution(ctx, fallback);
+    test_hmd(ctx);
+    test_matrices();
+    test_trace(ctx);
+    if (!fallback) {
+        // Multisampled views, composition caching, reprojection and view
+        // synthesis need framebuffer objects; trimming is tested with the
+        // composition cache
+        test_multisample(ctx);
+        test_region(ctx);
+        test_mark_dirty(ctx);
+        test_trim(ctx);
+        test_compositor(ctx, display, config, context);
+        test_reprojection(ctx);
+        test_synthesis(ctx);
+    }
+    if (fallback) {
+        // Without sync objects, the compositor thread cannot be used
+        check(!glsStartCompositor(ctx, NULL, NULL, NULL),
+                "compositor started without sync objects", "loader");
+    }
+    glsDestroyContext(ctx);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", "loader");
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    eglTerminate(display);
+    return (failures == 0 ? 0 : 1);
+}
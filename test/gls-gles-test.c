@@ -0,0 +1,286 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Test of the OpenGL ES build of libgls.
+ *
+ * This program creates an OpenGL ES 2.0 context for an EGL pbuffer, composes
+ * two single-colored views in a number of modes, and checks the pixels of the
+ * result and that libgls left the OpenGL state alone. It needs no window
+ * system: with Mesa, it runs on the surfaceless platform and llvmpipe.
+ * It exits with 77 (skipped) if no EGL display is available.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <gls/gls.h>
+
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static int failures = 0;
+
+static void check(int condition, const char* what, GLSmode mode)
+{
+    if (!condition) {
+        fprintf(stderr, "gls-gles-test: mode %d: %s\n", mode, what);
+        failures++;
+    }
+}
+
+/* Whether the pixel is mostly red (1), green (2), or blue (4) */
+static int color_at(int x, int y)
+{
+    unsigned char rgba[4];
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    return (rgba[0] > 128 ? 1 : 0) | (rgba[1] > 128 ? 2 : 0) | (rgba[2] > 128 ? 4 : 0);
+}
+
+static EGLDisplay get_display(void)
+{
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+        EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+            return display;
+    }
+#endif
+    {
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+            return display;
+    }
+    return EGL_NO_DISPLAY;
+}
+
+/* Render a single-colored view and submit it */
+static void submit(GLScontext* ctx, GLSview view, float r, float g, float b)
+{
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glsSubmitView(ctx, view);
+}
+
+int main(void)
+{
+    static const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 16, EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+    static const EGLint pbuffer_attribs[] = { EGL_WIDTH, WIDTH, EGL_HEIGHT, HEIGHT, EGL_NONE };
+    static const EGLint context_attribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    static const GLSmode modes[] = {
+        GLS_MODE_MONO_LEFT, GLS_MODE_MONO_RIGHT, GLS_MODE_LEFT_RIGHT,
+        GLS_MODE_TOP_BOTTOM, GLS_MODE_RED_CYAN_FULL_COLOR,
+        GLS_MODE_EVEN_ODD_ROWS, GLS_MODE_EVEN_ODD_COLUMNS, GLS_MODE_CHECKERBOARD
+    };
+    static unsigned char pixels[WIDTH * HEIGHT * 4];
+    EGLDisplay display;
+    EGLConfig config;
+    EGLint config_count;
+    EGLSurface surface;
+    EGLContext context;
+    GLScontext* ctx;
+    GLuint app_tex;
+    size_t i;
+
+    display = get_display();
+    if (display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "gls-gles-test: no EGL display\n");
+        return 77;
+    }
+    if (!eglBindAPI(EGL_OPENGL_ES_API)
+            || !eglChooseConfig(display, config_attribs, &config, 1, &config_count)
+            || config_count < 1) {
+        fprintf(stderr, "gls-gles-test: no OpenGL ES 2.0 pbuffer configuration\n");
+        return 77;
+    }
+    surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT
+            || !eglMakeCurrent(display, surface, surface, context)) {
+        fprintf(stderr, "gls-gles-test: cannot create an OpenGL ES 2.0 context\n");
+        return 77;
+    }
+    glViewport(0, 0, WIDTH, HEIGHT);
+
+    ctx = glsCreateContext();
+    glGenTextures(1, &app_tex);
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        GLSmode mode = modes[i];
+        GLint binding;
+        int c[4];
+
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        // State that the composition must restore
+        glEnable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, app_tex);
+        glActiveTexture(GL_TEXTURE0);
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", mode);
+        check(glIsEnabled(GL_BLEND), "GL_BLEND was not restored", mode);
+        glActiveTexture(GL_TEXTURE1);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &binding);
+        glActiveTexture(GL_TEXTURE0);
+        check(binding == (GLint)app_tex, "texture binding was not restored", mode);
+        glDisable(GL_BLEND);
+
+        c[0] = color_at(WIDTH / 4, HEIGHT / 4);
+        c[1] = color_at(WIDTH / 4 + 1, HEIGHT / 4);
+        c[2] = color_at(WIDTH / 4, HEIGHT / 4 + 1);
+        c[3] = color_at(3 * WIDTH / 4, 3 * HEIGHT / 4);
+        switch (mode) {
+        case GLS_MODE_MONO_LEFT:
+            check(c[0] == 1 && c[3] == 1, "expected the left view", mode);
+            break;
+        case GLS_MODE_MONO_RIGHT:
+            check(c[0] == 2 && c[3] == 2, "expected the right view", mode);
+            break;
+        case GLS_MODE_LEFT_RIGHT:
+            check(c[0] == 1 && c[3] == 2, "expected left and right halves", mode);
+            break;
+        case GLS_MODE_TOP_BOTTOM:
+            check(c[0] == 2 && c[3] == 1, "expected top and bottom halves", mode);
+            break;
+        case GLS_MODE_RED_CYAN_FULL_COLOR:
+            check(c[0] == 3, "expected red from the left and green from the right view", mode);
+            break;
+        case GLS_MODE_EVEN_ODD_ROWS:
+            check(c[0] != c[2] && c[0] == c[1] && (c[0] | c[2]) == 3, "expected alternating rows", mode);
+            break;
+        case GLS_MODE_EVEN_ODD_COLUMNS:
+            check(c[0] != c[1] && c[0] == c[2] && (c[0] | c[1]) == 3, "expected alternating columns", mode);
+            break;
+        default:
+            check(c[0] != c[1] && c[0] != c[2] && (c[0] | c[1]) == 3, "expected a checkerboard", mode);
+            break;
+        }
+    }
+
+    // Head-mounted display mode with a barrel distortion that moves the
+    // corners of each half outside of the views
+    {
+        static const GLfloat distortion[4] = { 1.0f, 0.5f, 0.0f, 0.0f };
+        static const GLfloat chromatic_aberration[2] = { 0.99f, 1.01f };
+        GLint enabled;
+
+        glsSetHMDLens(ctx, distortion, chromatic_aberration, 0.1f);
+        glsClear(ctx);
+        submit(ctx, GLS_VIEW_LEFT, 1.0f, 0.0f, 0.0f);
+        submit(ctx, GLS_VIEW_RIGHT, 0.0f, 1.0f, 0.0f);
+        glsDrawSubmittedViews(ctx, GLS_MODE_HMD, GL_FALSE);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", GLS_MODE_HMD);
+        glGetVertexAttribiv(1, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        check(!enabled, "vertex attribute array was not restored", GLS_MODE_HMD);
+        check(color_at(WIDTH / 4, HEIGHT / 2) == 1 && color_at(3 * WIDTH / 4, HEIGHT / 2) == 2,
+                "expected left and right halves", GLS_MODE_HMD);
+        check(color_at(0, 0) == 0 && color_at(WIDTH / 2, HEIGHT - 1) == 0,
+                "expected black corners", GLS_MODE_HMD);
+    }
+
+    // Views from client memory
+    for (i = 0; i < WIDTH * HEIGHT; i++) {
+        pixels[4 * i + 0] = 0;
+        pixels[4 * i + 1] = 0;
+        pixels[4 * i + 2] = 255;
+        pixels[4 * i + 3] = 255;
+    }
+    glsClear(ctx);
+    check(glsUploadView(ctx, GLS_VIEW_LEFT, WIDTH, HEIGHT, GL_RGBA, 0, pixels),
+            "upload was not accepted", GLS_MODE_MONO_LEFT);
+    glsDrawSubmittedViews(ctx, GLS_MODE_MONO_LEFT, GL_FALSE);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", GLS_MODE_MONO_LEFT);
+    check(color_at(WIDTH / 2, HEIGHT / 2) == 4, "expected the uploaded view", GLS_MODE_MONO_LEFT);
+
+    // Direct rendering into the output
+    for (i = 0; i < 3; i++) {
+        static const GLSmode direct_modes[3] = {
+            GLS_MODE_LEFT_RIGHT, GLS_MODE_TOP_BOTTOM, GLS_MODE_HDMI_FRAME_PACK
+        };
+        GLSmode mode = direct_modes[i];
+        GLint viewport[4];
+        int c[2];
+
+        glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        check(glsBeginView(ctx, mode, GL_FALSE, GLS_VIEW_LEFT), "no direct rendering", mode);
+        glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsEndView(ctx);
+        check(glsBeginView(ctx, mode, GL_FALSE, GLS_VIEW_RIGHT), "no direct rendering", mode);
+        glClearColor(0.0f, 1.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glsEndView(ctx);
+        check(glGetError() == GL_NO_ERROR, "OpenGL error", mode);
+        check(!glIsEnabled(GL_SCISSOR_TEST), "GL_SCISSOR_TEST was not restored", mode);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        check(viewport[2] == WIDTH && viewport[3] == HEIGHT, "viewport was not restored", mode);
+        c[0] = color_at(WIDTH / 4, HEIGHT / 4);
+        c[1] = color_at(3 * WIDTH / 4, 3 * HEIGHT / 4);
+        // The blank area of HDMI frame packing is less than a line here
+        if (mode == GLS_MODE_LEFT_RIGHT)
+            check(c[0] == 1 && c[1] == 2, "expected left and right halves", mode);
+        else
+            check(c[0] == 2 && c[1] == 1, "expected top and bottom halves", mode);
+    }
+    check(!glsBeginView(ctx, GLS_MODE_EVEN_ODD_ROWS, GL_FALSE, GLS_VIEW_LEFT),
+            "direct rendering without a stencil bit", GLS_MODE_EVEN_ODD_ROWS);
+    glsSetViewStencilBit(ctx, 0x80);
+    check(glsBeginView(ctx, GLS_MODE_EVEN_ODD_ROWS, GL_FALSE, GLS_VIEW_LEFT),
+            "no direct rendering", GLS_MODE_EVEN_ODD_ROWS);
+    check(glIsEnabled(GL_STENCIL_TEST), "no stencil test", GLS_MODE_EVEN_ODD_ROWS);
+    glsEndView(ctx);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", GLS_MODE_EVEN_ODD_ROWS);
+    check(!glIsEnabled(GL_STENCIL_TEST), "GL_STENCIL_TEST was not restored", GLS_MODE_EVEN_ODD_ROWS);
+
+    glsDrawDLP3dReadySyncMarker(ctx, GLS_MODE_LEFT_RIGHT);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", GLS_MODE_LEFT_RIGHT);
+    check(!glIsEnabled(GL_SCISSOR_TEST), "GL_SCISSOR_TEST was not restored", GLS_MODE_LEFT_RIGHT);
+
+    glDeleteTextures(1, &app_tex);
+    glsDestroyContext(ctx);
+    check(glGetError() == GL_NO_ERROR, "OpenGL error", GLS_MODE_MONO_LEFT);
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    eglTerminate(display);
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,423 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Profiling harness for the CPU overhead of libgls.
+ *
+ * This program is linked against a version of libgls that was built with the
+ * recording stub OpenGL implementation in gls-stub.c, so it runs without a
+ * GPU. For every stereoscopic mode, it renders a number of frames and
+ * reports the average number of OpenGL calls, state queries (which force a
+ * synchronization on threaded drivers), heap allocations, and CPU time for
+ * each libgls entry point. Optional limits turn it into a regression test.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gls/gls.h>
+
+#include "gls-stub.h"
+
+
+enum {
+    ENTRY_CLEAR,
+    ENTRY_SUBMIT_VIEW,
+    ENTRY_SUBMIT_VIEW_WITH_DEPTH,
+    ENTRY_UPLOAD_VIEW,
+    ENTRY_MAP_VIEW,
+    ENTRY_UNMAP_VIEW,
+    ENTRY_BEGIN_VIEW,
+    ENTRY_END_VIEW,
+    ENTRY_DRAW_VIEWS,
+    ENTRY_DRAW_VIEWS_WITH_PIPELINE,
+    ENTRY_DLP_MARKER,
+    ENTRY_COUNT
+};
+
+static const char* entry_names[ENTRY_COUNT] = {
+    "glsClear",
+    "glsSubmitView",
+    "glsSubmitViewWithDepth",
+    "glsUploadView",
+    "glsMapView",
+    "glsUnmapView",
+    "glsBeginView",
+    "glsEndView",
+    "glsDrawViews",
+    "glsDrawViewsWithPipeline",
+    "glsDrawDLP3dReadySyncMarker"
+};
+
+static const char* mode_names[] = {
+    "QUAD_BUFFER_STEREO", "ALTERNATING", "MONO_LEFT", "MONO_RIGHT",
+    "LEFT_RIGHT", "TOP_BOTTOM", "HDMI_FRAME_PACK", "EVEN_ODD_ROWS",
+    "EVEN_ODD_COLUMNS", "CHECKERBOARD", "RED_CYAN_MONOCHROME",
+    "RED_CYAN_HALF_COLOR", "RED_CYAN_FULL_COLOR", "RED_CYAN_DUBOIS",
+    "GREEN_MAGENTA_MONOCHROME", "GREEN_MAGENTA_HALF_COLOR",
+    "GREEN_MAGENTA_FULL_COLOR", "GREEN_MAGENTA_DUBOIS",
+    "AMBER_BLUE_MONOCHROME", "AMBER_BLUE_HALF_COLOR", "AMBER_BLUE_FULL_COLOR",
+    "AMBER_BLUE_DUBOIS", "RED_GREEN_MONOCHROME", "RED_BLUE_MONOCHROME",
+    "HMD"
+};
+#define MODE_COUNT ((int)(sizeof(mode_names) / sizeof(mode_names[0])))
+
+#define MAX_FUNCTIONS 256
+
+typedef struct {
+    unsigned long invocations;
+    unsigned long calls;
+    unsigned long queries;
+    unsigned long allocations;
+    double ns;
+    unsigned long function_calls[MAX_FUNCTIONS];
+} Stats;
+
+static Stats stats[ENTRY_COUNT];
+
+/* Views from client memory, as a video decoder would produce them */
+#define UPLOAD_WIDTH 640
+#define UPLOAD_HEIGHT 360
+static unsigned char upload_pixels[UPLOAD_WIDTH * UPLOAD_HEIGHT * 4];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void begin(void)
+{
+    gls_stub_reset();
+}
+
+static void end(int entry, double t0, int measure)
+{
+    double t1 = now_ns();
+    Stats* s = &stats[entry];
+    int i;
+
+    if (!measure)
+        return;
+    s->invocations++;
+    s->calls += gls_stub_calls();
+    s->queries += gls_stub_queries();
+    s->allocations += gls_stub_allocations();
+    s->ns += t1 - t0;
+    for (i = 0; i < gls_stub_function_count() && i < MAX_FUNCTIONS; i++)
+        s->function_calls[i] += gls_stub_function(i)->count;
+}
+
+/* Camera of the views, for reprojection */
+static GLfloat camera_eye[3] = { 0.0f, 0.0f, 5.0f };
+static const GLfloat camera_center[3] = { 0.0f, 0.0f, 0.0f };
+static const GLfloat camera_up[3] = { 0.0f, 1.0f, 0.0f };
+
+/* Whether views are rendered at the recommended render scale */
+static GLboolean scaled_views = GL_FALSE;
+
+/* Whether views are rendered directly into the output where possible */
+static GLboolean direct_views = GL_FALSE;
+
+static void frame(GLScontext* ctx, GLSmode mode, GLSpipeline* pipeline,
+        GLboolean upload, GLboolean synthesize, GLboolean late, int measure)
+{
+    GLfloat projection[32], modelview[32];
+    GLboolean direct = GL_FALSE;
+    double t0;
+    int v;
+
+    begin();
+    t0 = now_ns();
+    glsClear(ctx);
+    end(ENTRY_CLEAR, t0, measure);
+    // The camera moves a little in every frame
+    camera_eye[0] -= 0.01f;
+    glsPerspectiveMatricesf(50.0, 16.0 / 9.0, 0.1, 10.0, 5.0, 5.0 / 30.0, projection);
+    glsLookAtMatricesf(camera_eye, camera_center, camera_up, 5.0f / 30.0f, modelview);
+    for (v = 0; v < 2; v++) {
+        glsSetViewMatrices(ctx, v, projection + 16 * v, modelview + 16 * v);
+        if (scaled_views) {
+            // Render into a viewport of the recommended size
+            GLfloat scale = glsGetRenderScale(ctx, v);
+            gls_stub_viewport[2] = (GLint)(1920 * scale);
+            gls_stub_viewport[3] = (GLint)(1080 * scale);
+        }
+        // A late frame is displayed when the other view is due
+        if (!glsIsViewRequired(ctx, mode, GL_FALSE, late ? 1 - v : v))
+            continue;
+        if (direct_views) {
+            begin();
+            t0 = now_ns();
+            direct = glsBeginView(ctx, mode, GL_FALSE, v);
+            end(ENTRY_BEGIN_VIEW, t0, measure);
+            if (direct) {
+                // The view is rendered here, and needs no submission
+                begin();
+                t0 = now_ns();
+                glsEndView(ctx);
+                end(ENTRY_END_VIEW, t0, measure);
+                continue;
+            }
+        }
+        if (synthesize) {
+            // The right view is synthesized from the left view
+            if (v == GLS_VIEW_RIGHT && glsIsViewRequired(ctx, mode, GL_FALSE, GLS_VIEW_LEFT))
+                continue;
+            begin();
+            t0 = now_ns();
+            glsSubmitViewWithDepth(ctx, v);
+            end(ENTRY_SUBMIT_VIEW_WITH_DEPTH, t0, measure);
+        } else if (!upload) {
+            begin();
+            t0 = now_ns();
+            glsSubmitView(ctx, v);
+            end(ENTRY_SUBMIT_VIEW, t0, measure);
+        } else if (v == GLS_VIEW_LEFT) {
+            begin();
+            t0 = now_ns();
+            glsUploadView(ctx, v, UPLOAD_WIDTH, UPLOAD_HEIGHT, GL_BGRA, 0, upload_pixels);
+            end(ENTRY_UPLOAD_VIEW, t0, measure);
+        } else {
+            void* ptr;
+            begin();
+            t0 = now_ns();
+            ptr = glsMapView(ctx, v, UPLOAD_WIDTH, UPLOAD_HEIGHT, GL_BGRA, NULL);
+            end(ENTRY_MAP_VIEW, t0, measure);
+            if (!ptr)
+                abort();
+            memcpy(ptr, upload_pixels, sizeof(upload_pixels));
+            begin();
+            t0 = now_ns();
+            glsUnmapView(ctx, v);
+            end(ENTRY_UNMAP_VIEW, t0, measure);
+        }
+    }
+    gls_stub_viewport[2] = 1920;
+    gls_stub_viewport[3] = 1080;
+    begin();
+    t0 = now_ns();
+    if (direct) {
+        // The views are in place already
+    } else if (pipeline) {
+        // The application renders into its own textures; the stub does not
+        // check texture names
+        glsDrawViewsWithPipeline(ctx, pipeline, 2001, 2002);
+        end(ENTRY_DRAW_VIEWS_WITH_PIPELINE, t0, measure);
+    } else {
+        glsDrawSubmittedViews(ctx, mode, GL_FALSE);
+        end(ENTRY_DRAW_VIEWS, t0, measure);
+    }
+    begin();
+    t0 = now_ns();
+    glsDrawDLP3dReadySyncMarker(ctx, mode);
+    end(ENTRY_DLP_MARKER, t0, measure);
+}
+
+static void usage(void)
+{
+    printf("Usage: gls-profile [options]\n"
+            "Options:\n"
+            "  --frames N         Number of measured frames per mode (default 1000)\n"
+            "  --cache            Enable composition caching\n"
+            "  --no-extensions    Pretend that no OpenGL extensions are available\n"
+            "  --orphan           Pretend that GL_ARB_buffer_storage is not available\n"
+            "  --debug-labels     Enable GL_KHR_debug groups and object labels\n"
+            "  --view-ring N      Cycle through N view texture pairs\n"
+            "  --upload           Upload views from memory instead of copying them\n"
+            "  --synthesize       Synthesize the right view from the left view and depth\n"
+            "  --reproject        Reproject late views; every third frame is late\n"
+            "  --dynamic-resolution  Render views at the recommended render scale\n"
+            "  --asymmetric       Render the right view at 70%%, alternating every 10 frames\n"
+            "  --lut              Apply color lookup tables to the views and the output\n"
+            "  --overlay          Blend a subtitle overlay in front of the screen\n"
+            "  --pipeline         Draw application textures with a prebuilt pipeline\n"
+            "  --keep-state       Create the pipeline with GLS_PIPELINE_KEEP_STATE\n"
+            "  --direct           Render views directly into the output where possible\n"
+            "  --verbose          List OpenGL calls by function\n"
+            "  --max-calls N      Fail if an entry point makes more than N OpenGL calls\n"
+            "  --max-queries N    Fail if an entry point makes more than N state queries\n"
+            "  --max-allocs N     Fail if an entry point makes more than N heap allocations\n"
+            "All numbers are averages per call, measured after three warm-up frames.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int frames = 1000;
+    GLboolean cache = GL_FALSE;
+    GLboolean debug_labels = GL_FALSE;
+    int view_ring = 1;
+    GLboolean upload = GL_FALSE;
+    GLboolean synthesize = GL_FALSE;
+    GLboolean reproject = GL_FALSE;
+    GLboolean dynamic_resolution = GL_FALSE;
+    GLboolean asymmetric = GL_FALSE;
+    GLboolean lut = GL_FALSE;
+    GLboolean overlay = GL_FALSE;
+    GLboolean pipeline = GL_FALSE;
+    GLbitfield pipeline_flags = 0;
+    GLboolean verbose = GL_FALSE;
+    double max_calls = -1.0;
+    double max_queries = -1.0;
+    double max_allocs = -1.0;
+    int failures = 0;
+    int mode, e, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            cache = GL_TRUE;
+        } else if (strcmp(argv[i], "--no-extensions") == 0) {
+            gls_stub_extensions = GL_FALSE;
+        } else if (strcmp(argv[i], "--orphan") == 0) {
+            gls_stub_buffer_storage = GL_FALSE;
+        } else if (strcmp(argv[i], "--debug-labels") == 0) {
+            debug_labels = GL_TRUE;
+        } else if (strcmp(argv[i], "--view-ring") == 0 && i + 1 < argc) {
+            view_ring = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--upload") == 0) {
+            upload = GL_TRUE;
+        } else if (strcmp(argv[i], "--synthesize") == 0) {
+            synthesize = GL_TRUE;
+        } else if (strcmp(argv[i], "--reproject") == 0) {
+            reproject = GL_TRUE;
+        } else if (strcmp(argv[i], "--dynamic-resolution") == 0) {
+            dynamic_resolution = GL_TRUE;
+        } else if (strcmp(argv[i], "--asymmetric") == 0) {
+            asymmetric = GL_TRUE;
+        } else if (strcmp(argv[i], "--lut") == 0) {
+            lut = GL_TRUE;
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            overlay = GL_TRUE;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = GL_TRUE;
+        } else if (strcmp(argv[i], "--keep-state") == 0) {
+            pipeline_flags |= GLS_PIPELINE_KEEP_STATE;
+        } else if (strcmp(argv[i], "--direct") == 0) {
+            direct_views = GL_TRUE;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = GL_TRUE;
+        } else if (strcmp(argv[i], "--max-calls") == 0 && i + 1 < argc) {
+            max_calls = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-queries") == 0 && i + 1 < argc) {
+            max_queries = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-allocs") == 0 && i + 1 < argc) {
+            max_allocs = atof(argv[++i]);
+        } else {
+            usage();
+            return (strcmp(argv[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if (frames < 1)
+        frames = 1;
+
+    printf("%-26s %-28s %9s %9s %9s %9s\n",
+            "mode", "entry point", "GL calls", "queries", "allocs", "ns");
+    for (mode = 0; mode < MODE_COUNT; mode++) {
+        GLScontext* ctx = glsCreateContext();
+        GLSpipeline* pipe = NULL;
+        int f;
+
+        if (!ctx) {
+            fprintf(stderr, "gls-profile: cannot create GLS context\n");
+            return 1;
+        }
+        glsSetCompositionCaching(ctx, cache);
+        glsSetDebugLabels(ctx, debug_labels);
+        glsSetViewTextureRing(ctx, view_ring);
+        glsSetReprojection(ctx, reproject);
+        // The stub GPU takes 1 ms per timestamp, which exceeds a 2 ms budget
+        if (dynamic_resolution)
+            glsSetDynamicResolution(ctx, 0.002f, 0.5f);
+        if (asymmetric)
+            glsSetAsymmetricResolution(ctx, GLS_VIEW_RIGHT, 0.7f, 10);
+        scaled_views = (dynamic_resolution || asymmetric);
+        if (direct_views)
+            glsSetViewStencilBit(ctx, 0x80);
+        if (lut) {
+            // The stub does not check texture names
+            glsSetViewColorLUT(ctx, GLS_VIEW_LEFT, 1001, 17);
+            glsSetViewColorLUT(ctx, GLS_VIEW_RIGHT, 1002, 17);
+            glsSetColorLUT(ctx, 1003, 33);
+        }
+        if (overlay) {
+            const GLfloat subtitle_rect[4] = { 0.1f, 0.05f, 0.8f, 0.1f };
+            glsSetOverlay(ctx, 1004, subtitle_rect, -0.01f, GLS_ALPHA_PREMULTIPLIED);
+        }
+        if (pipeline)
+            pipe = glsCreatePipeline(ctx, mode, GL_FALSE, pipeline_flags);
+        memset(stats, 0, sizeof(stats));
+        // Warm-up frames create textures, shaders, and caches.
+        frame(ctx, mode, pipe, upload, synthesize, GL_FALSE, 0);
+        frame(ctx, mode, pipe, upload, synthesize, GL_FALSE, 0);
+        frame(ctx, mode, pipe, upload, synthesize, reproject, 0);
+        for (f = 0; f < frames; f++)
+            frame(ctx, mode, pipe, upload, synthesize, reproject && f % 3 == 2, 1);
+        glsDestroyPipeline(ctx, pipe);
+        glsDestroyContext(ctx);
+
+        for (e = 0; e < ENTRY_COUNT; e++) {
+            const Stats* s = &stats[e];
+            double n = (s->invocations > 0 ? s->invocations : 1);
+            double calls = s->calls / n;
+            double queries = s->queries / n;
+            double allocs = s->allocations / n;
+            if (s->invocations == 0)
+                continue;
+            printf("%-26s %-28s %9.1f %9.1f %9.1f %9.0f\n", mode_names[mode], entry_names[e],
+                    calls, queries, allocs, s->ns / n);
+            if (verbose) {
+                for (i = 0; i < gls_stub_function_count() && i < MAX_FUNCTIONS; i++) {
+                    if (s->function_calls[i] > 0) {
+                        const GLSstubCall* c = gls_stub_function(i);
+                        printf("    %-30s %9.1f%s\n", c->name, s->function_calls[i] / n,
+                                c->is_query ? "  (query)" : "");
+                    }
+                }
+            }
+            if (max_calls >= 0.0 && calls > max_calls) {
+                fprintf(stderr, "gls-profile: %s in mode %s: %.1f OpenGL calls (limit %.1f)\n",
+                        entry_names[e], mode_names[mode], calls, max_calls);
+                failures++;
+            }
+            if (max_queries >= 0.0 && queries > max_queries) {
+                fprintf(stderr, "gls-profile: %s in mode %s: %.1f state queries (limit %.1f)\n",
+                        entry_names[e], mode_names[mode], queries, max_queries);
+                failures++;
+            }
+            if (max_allocs >= 0.0 && allocs > max_allocs) {
+                fprintf(stderr, "gls-profile: %s in mode %s: %.1f heap allocations (limit %.1f)\n",
+                        entry_names[e], mode_names[mode], allocs, max_allocs);
+                failures++;
+            }
+        }
+    }
+    return (failures > 0 ? 1 : 0);
+}
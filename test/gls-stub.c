@@ -0,0 +1,1176 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <GL/gl.h>
+#include <GL/glext.h>
+#if GLS_USE_GLX
+# define GLX_GLXEXT_PROTOTYPES 1
+# include <GL/glx.h>
+# include <GL/glxext.h>
+#endif
+
+#include "gls-stub.h"
+
+
+/*
+ * Bookkeeping
+ */
+
+#define MAX_FUNCTIONS 256
+
+static GLSstubCall functions[MAX_FUNCTIONS];
+static int function_count = 0;
+static unsigned long calls = 0;
+static unsigned long queries = 0;
+static unsigned long allocations = 0;
+
+GLboolean gls_stub_extensions = GL_TRUE;
+GLboolean gls_stub_buffer_storage = GL_TRUE;
+GLint gls_stub_viewport[4] = { 0, 0, 1920, 1080 };
+
+static GLuint next_name = 1;
+
+/* Timestamp queries advance by one millisecond of fake GPU time each */
+#define MAX_QUERIES 64
+
+static GLuint64 query_results[MAX_QUERIES];
+static GLuint64 gpu_time = 0;
+
+/* Buffer objects need memory, since libgls writes into mapped buffers */
+#define MAX_BUFFERS 16
+
+typedef struct {
+    GLuint name;
+    void* data;
+} Buffer;
+
+static Buffer buffers[MAX_BUFFERS];
+static GLuint bound_unpack_buffer = 0;
+static GLuint bound_array_buffer = 0;
+static GLuint bound_element_array_buffer = 0;
+
+static Buffer* find_buffer(GLuint name)
+{
+    int i;
+    for (i = 0; i < MAX_BUFFERS; i++)
+        if (buffers[i].name == name)
+            return &buffers[i];
+    abort();
+}
+
+static Buffer* bound_buffer(GLenum target)
+{
+    return find_buffer(target == GL_ARRAY_BUFFER ? bound_array_buffer
+            : target == GL_ELEMENT_ARRAY_BUFFER ? bound_element_array_buffer
+            : bound_unpack_buffer);
+}
+
+static void record(const char* name, GLboolean is_query)
+{
+    int i;
+    // The names are string literals, so comparing pointers is enough
+    // to find known functions quickly.
+    for (i = 0; i < function_count; i++)
+        if (functions[i].name == name)
+            break;
+    if (i == function_count) {
+        if (function_count == MAX_FUNCTIONS)
+            abort();
+        functions[i].name = name;
+        functions[i].is_query = is_query;
+        functions[i].count = 0;
+        function_count++;
+    }
+    functions[i].count++;
+    calls++;
+    if (is_query)
+        queries++;
+}
+
+#define CALL(name) record(#name, GL_FALSE)
+#define QUERY(name) record(#name, GL_TRUE)
+
+void gls_stub_reset(void)
+{
+    int i;
+    for (i = 0; i < function_count; i++)
+        functions[i].count = 0;
+    calls = 0;
+    queries = 0;
+    allocations = 0;
+}
+
+unsigned long gls_stub_calls(void)
+{
+    return calls;
+}
+
+unsigned long gls_stub_queries(void)
+{
+    return queries;
+}
+
+unsigned long gls_stub_allocations(void)
+{
+    return allocations;
+}
+
+int gls_stub_function_count(void)
+{
+    return function_count;
+}
+
+const GLSstubCall* gls_stub_function(int i)
+{
+    return &functions[i];
+}
+
+void* gls_stub_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+void* gls_stub_realloc(void* ptr, size_t size)
+{
+    allocations++;
+    return realloc(ptr, size);
+}
+
+char* gls_stub_strdup(const char* s)
+{
+    allocations++;
+    return strdup(s);
+}
+
+
+/*
+ * OpenGL state queries
+ */
+
+const GLubyte* glGetString(GLenum name)
+{
+    QUERY(glGetString);
+    switch (name) {
+    case GL_VENDOR:
+        return (const GLubyte*)"libgls";
+    case GL_RENDERER:
+        return (const GLubyte*)"gls-stub";
+    case GL_VERSION:
+        return (const GLubyte*)(!gls_stub_extensions ? "2.0"
+                : !gls_stub_buffer_storage ? "4.3" : "4.6");
+    default:
+        return (const GLubyte*)"";
+    }
+}
+
+const GLubyte* glGetStringi(GLenum name, GLuint index)
+{
+    QUERY(glGetStringi);
+    (void)name;
+    (void)index;
+    return NULL;
+}
+
+void glGetIntegerv(GLenum pname, GLint* data)
+{
+    QUERY(glGetIntegerv);
+    switch (pname) {
+    case GL_VIEWPORT:
+        memcpy(data, gls_stub_viewport, sizeof(gls_stub_viewport));
+        break;
+    case GL_ACTIVE_TEXTURE:
+        data[0] = GL_TEXTURE0;
+        break;
+    case GL_STENCIL_BITS:
+        data[0] = 8;
+        break;
+    default:
+        data[0] = 0;
+        break;
+    }
+}
+
+void glGetFloatv(GLenum pname, GLfloat* data)
+{
+    QUERY(glGetFloatv);
+    switch (pname) {
+    case GL_MODELVIEW_MATRIX:
+    case GL_PROJECTION_MATRIX:
+        memset(data, 0, 16 * sizeof(GLfloat));
+        data[0] = data[5] = data[10] = data[15] = 1.0f;
+        break;
+    case GL_COLOR_CLEAR_VALUE:
+        memset(data, 0, 4 * sizeof(GLfloat));
+        break;
+    default:
+        data[0] = 0.0f;
+        break;
+    }
+}
+
+void glGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params)
+{
+    QUERY(glGetTexLevelParameteriv);
+    (void)target;
+    (void)level;
+    params[0] = (pname == GL_TEXTURE_WIDTH ? gls_stub_viewport[2]
+            : pname == GL_TEXTURE_HEIGHT ? gls_stub_viewport[3] : 0);
+}
+
+void glGetQueryObjectiv(GLuint id, GLenum pname, GLint* params)
+{
+    QUERY(glGetQueryObjectiv);
+    (void)id;
+    params[0] = (pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0);
+}
+
+void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params)
+{
+    QUERY(glGetQueryObjectui64v);
+    (void)pname;
+    params[0] = query_results[id % MAX_QUERIES];
+}
+
+GLboolean glIsProgram(GLuint program)
+{
+    QUERY(glIsProgram);
+    return program != 0;
+}
+
+GLint glGetUniformLocation(GLuint program, const GLchar* name)
+{
+    QUERY(glGetUniformLocation);
+    (void)program;
+    (void)name;
+    return 0;
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    QUERY(glGetShaderiv);
+    (void)shader;
+    params[0] = (pname == GL_COMPILE_STATUS ? GL_TRUE : 0);
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    QUERY(glGetShaderInfoLog);
+    (void)shader;
+    if (length)
+        *length = 0;
+    if (bufSize > 0)
+        infoLog[0] = '\0';
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    QUERY(glGetProgramiv);
+    (void)program;
+    params[0] = (pname == GL_LINK_STATUS ? GL_TRUE
+            : pname == GL_ATTACHED_SHADERS ? 1 : 0);
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    QUERY(glGetProgramInfoLog);
+    (void)program;
+    if (length)
+        *length = 0;
+    if (bufSize > 0)
+        infoLog[0] = '\0';
+}
+
+void glGetAttachedShaders(GLuint program, GLsizei maxCount, GLsizei* count, GLuint* shaders)
+{
+    QUERY(glGetAttachedShaders);
+    (void)program;
+    if (count)
+        *count = (maxCount > 0 ? 1 : 0);
+    if (maxCount > 0)
+        shaders[0] = 1;
+}
+
+
+/*
+ * Object management
+ */
+
+void glGenTextures(GLsizei n, GLuint* textures)
+{
+    GLsizei i;
+    CALL(glGenTextures);
+    for (i = 0; i < n; i++)
+        textures[i] = next_name++;
+}
+
+void glDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    CALL(glDeleteTextures);
+    (void)n;
+    (void)textures;
+}
+
+void glGenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+    GLsizei i;
+    CALL(glGenFramebuffers);
+    for (i = 0; i < n; i++)
+        framebuffers[i] = next_name++;
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+    CALL(glDeleteFramebuffers);
+    (void)n;
+    (void)framebuffers;
+}
+
+void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+{
+    GLsizei i;
+    CALL(glGenRenderbuffers);
+    for (i = 0; i < n; i++)
+        renderbuffers[i] = next_name++;
+}
+
+void glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+{
+    CALL(glDeleteRenderbuffers);
+    (void)n;
+    (void)renderbuffers;
+}
+
+void glGenBuffers(GLsizei n, GLuint* names)
+{
+    GLsizei i;
+    CALL(glGenBuffers);
+    for (i = 0; i < n; i++) {
+        names[i] = next_name++;
+        find_buffer(0)->name = names[i];
+    }
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint* names)
+{
+    GLsizei i;
+    CALL(glDeleteBuffers);
+    for (i = 0; i < n; i++) {
+        Buffer* b = find_buffer(names[i]);
+        free(b->data);
+        b->data = NULL;
+        b->name = 0;
+    }
+}
+
+void glGenQueries(GLsizei n, GLuint* ids)
+{
+    GLsizei i;
+    CALL(glGenQueries);
+    for (i = 0; i < n; i++)
+        ids[i] = next_name++;
+}
+
+void glDeleteQueries(GLsizei n, const GLuint* ids)
+{
+    CALL(glDeleteQueries);
+    (void)n;
+    (void)ids;
+}
+
+GLuint glCreateShader(GLenum type)
+{
+    CALL(glCreateShader);
+    (void)type;
+    return next_name++;
+}
+
+void glDeleteShader(GLuint shader)
+{
+    CALL(glDeleteShader);
+    (void)shader;
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    CALL(glShaderSource);
+    (void)shader;
+    (void)count;
+    (void)string;
+    (void)length;
+}
+
+void glCompileShader(GLuint shader)
+{
+    CALL(glCompileShader);
+    (void)shader;
+}
+
+GLuint glCreateProgram(void)
+{
+    CALL(glCreateProgram);
+    return next_name++;
+}
+
+void glDeleteProgram(GLuint program)
+{
+    CALL(glDeleteProgram);
+    (void)program;
+}
+
+void glAttachShader(GLuint program, GLuint shader)
+{
+    CALL(glAttachShader);
+    (void)program;
+    (void)shader;
+}
+
+void glLinkProgram(GLuint program)
+{
+    CALL(glLinkProgram);
+    (void)program;
+}
+
+
+/*
+ * State changes
+ */
+
+void glEnable(GLenum cap)
+{
+    CALL(glEnable);
+    (void)cap;
+}
+
+void glDisable(GLenum cap)
+{
+    CALL(glDisable);
+    (void)cap;
+}
+
+void glDisableClientState(GLenum array)
+{
+    CALL(glDisableClientState);
+    (void)array;
+}
+
+void glEnableClientState(GLenum array)
+{
+    CALL(glEnableClientState);
+    (void)array;
+}
+
+void glPushAttrib(GLbitfield mask)
+{
+    CALL(glPushAttrib);
+    (void)mask;
+}
+
+void glPopAttrib(void)
+{
+    CALL(glPopAttrib);
+}
+
+void glPushClientAttrib(GLbitfield mask)
+{
+    CALL(glPushClientAttrib);
+    (void)mask;
+}
+
+void glPopClientAttrib(void)
+{
+    CALL(glPopClientAttrib);
+}
+
+void glMatrixMode(GLenum mode)
+{
+    CALL(glMatrixMode);
+    (void)mode;
+}
+
+void glLoadIdentity(void)
+{
+    CALL(glLoadIdentity);
+}
+
+void glPushMatrix(void)
+{
+    CALL(glPushMatrix);
+}
+
+void glPopMatrix(void)
+{
+    CALL(glPopMatrix);
+}
+
+void glFrustum(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top,
+        GLdouble near_val, GLdouble far_val)
+{
+    CALL(glFrustum);
+    (void)left;
+    (void)right;
+    (void)bottom;
+    (void)top;
+    (void)near_val;
+    (void)far_val;
+}
+
+void glMultMatrixf(const GLfloat* m)
+{
+    CALL(glMultMatrixf);
+    (void)m;
+}
+
+void glMultMatrixd(const GLdouble* m)
+{
+    CALL(glMultMatrixd);
+    (void)m;
+}
+
+void glTranslated(GLdouble x, GLdouble y, GLdouble z)
+{
+    CALL(glTranslated);
+    (void)x;
+    (void)y;
+    (void)z;
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    CALL(glViewport);
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    CALL(glScissor);
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+void glDepthFunc(GLenum func)
+{
+    CALL(glDepthFunc);
+    (void)func;
+}
+
+void glDepthMask(GLboolean flag)
+{
+    CALL(glDepthMask);
+    (void)flag;
+}
+
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    CALL(glColorMask);
+    (void)red;
+    (void)green;
+    (void)blue;
+    (void)alpha;
+}
+
+void glStencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    CALL(glStencilFunc);
+    (void)func;
+    (void)ref;
+    (void)mask;
+}
+
+void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
+{
+    CALL(glStencilOp);
+    (void)fail;
+    (void)zfail;
+    (void)zpass;
+}
+
+void glStencilMask(GLuint mask)
+{
+    CALL(glStencilMask);
+    (void)mask;
+}
+
+void glClearStencil(GLint s)
+{
+    CALL(glClearStencil);
+    (void)s;
+}
+
+void glPolygonMode(GLenum face, GLenum mode)
+{
+    CALL(glPolygonMode);
+    (void)face;
+    (void)mode;
+}
+
+void glDrawBuffer(GLenum mode)
+{
+    CALL(glDrawBuffer);
+    (void)mode;
+}
+
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
+{
+    CALL(glClearColor);
+    (void)red;
+    (void)green;
+    (void)blue;
+    (void)alpha;
+}
+
+void glPixelStorei(GLenum pname, GLint param)
+{
+    CALL(glPixelStorei);
+    (void)pname;
+    (void)param;
+}
+
+void glActiveTexture(GLenum texture)
+{
+    CALL(glActiveTexture);
+    (void)texture;
+}
+
+void glBindTexture(GLenum target, GLuint texture)
+{
+    CALL(glBindTexture);
+    (void)target;
+    (void)texture;
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    CALL(glTexParameteri);
+    (void)target;
+    (void)pname;
+    (void)param;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    CALL(glBindFramebuffer);
+    (void)target;
+    (void)framebuffer;
+}
+
+void glBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+    CALL(glBindRenderbuffer);
+    (void)target;
+    (void)renderbuffer;
+}
+
+void glRenderbufferStorage(GLenum target, GLenum internalformat,
+        GLsizei width, GLsizei height)
+{
+    CALL(glRenderbufferStorage);
+    (void)target;
+    (void)internalformat;
+    (void)width;
+    (void)height;
+}
+
+void glFramebufferRenderbuffer(GLenum target, GLenum attachment,
+        GLenum renderbuffertarget, GLuint renderbuffer)
+{
+    CALL(glFramebufferRenderbuffer);
+    (void)target;
+    (void)attachment;
+    (void)renderbuffertarget;
+    (void)renderbuffer;
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget,
+        GLuint texture, GLint level)
+{
+    CALL(glFramebufferTexture2D);
+    (void)target;
+    (void)attachment;
+    (void)textarget;
+    (void)texture;
+    (void)level;
+}
+
+void glUseProgram(GLuint program)
+{
+    CALL(glUseProgram);
+    (void)program;
+}
+
+void glUniform1i(GLint location, GLint v0)
+{
+    CALL(glUniform1i);
+    (void)location;
+    (void)v0;
+}
+
+void glUniform1f(GLint location, GLfloat v0)
+{
+    CALL(glUniform1f);
+    (void)location;
+    (void)v0;
+}
+
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    CALL(glUniform2f);
+    (void)location;
+    (void)v0;
+    (void)v1;
+}
+
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+    CALL(glUniform3f);
+    (void)location;
+    (void)v0;
+    (void)v1;
+    (void)v2;
+}
+
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    CALL(glUniform4f);
+    (void)location;
+    (void)v0;
+    (void)v1;
+    (void)v2;
+    (void)v3;
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+        const GLfloat* value)
+{
+    CALL(glUniformMatrix4fv);
+    (void)location;
+    (void)count;
+    (void)transpose;
+    (void)value;
+}
+
+
+/*
+ * Data transfer and drawing
+ */
+
+void glTexImage2D(GLenum target, GLint level, GLint internalFormat,
+        GLsizei width, GLsizei height, GLint border,
+        GLenum format, GLenum type, const GLvoid* pixels)
+{
+    CALL(glTexImage2D);
+    (void)target;
+    (void)level;
+    (void)internalFormat;
+    (void)width;
+    (void)height;
+    (void)border;
+    (void)format;
+    (void)type;
+    (void)pixels;
+}
+
+void glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+        GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    CALL(glCopyTexSubImage2D);
+    (void)target;
+    (void)level;
+    (void)xoffset;
+    (void)yoffset;
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+        GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+        GLbitfield mask, GLenum filter)
+{
+    CALL(glBlitFramebuffer);
+    (void)srcX0;
+    (void)srcY0;
+    (void)srcX1;
+    (void)srcY1;
+    (void)dstX0;
+    (void)dstY0;
+    (void)dstX1;
+    (void)dstY1;
+    (void)mask;
+    (void)filter;
+}
+
+void glClear(GLbitfield mask)
+{
+    CALL(glClear);
+    (void)mask;
+}
+
+void glClearDepth(GLdouble depth)
+{
+    CALL(glClearDepth);
+    (void)depth;
+}
+
+void glBegin(GLenum mode)
+{
+    CALL(glBegin);
+    (void)mode;
+}
+
+void glEnd(void)
+{
+    CALL(glEnd);
+}
+
+void glVertex2f(GLfloat x, GLfloat y)
+{
+    CALL(glVertex2f);
+    (void)x;
+    (void)y;
+}
+
+void glTexCoord2f(GLfloat s, GLfloat t)
+{
+    CALL(glTexCoord2f);
+    (void)s;
+    (void)t;
+}
+
+void glMultiTexCoord2f(GLenum target, GLfloat s, GLfloat t)
+{
+    CALL(glMultiTexCoord2f);
+    (void)target;
+    (void)s;
+    (void)t;
+}
+
+void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer)
+{
+    CALL(glVertexPointer);
+    (void)size;
+    (void)type;
+    (void)stride;
+    (void)pointer;
+}
+
+void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer)
+{
+    CALL(glTexCoordPointer);
+    (void)size;
+    (void)type;
+    (void)stride;
+    (void)pointer;
+}
+
+void glClientActiveTexture(GLenum texture)
+{
+    CALL(glClientActiveTexture);
+    (void)texture;
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices)
+{
+    CALL(glDrawElements);
+    (void)mode;
+    (void)count;
+    (void)type;
+    (void)indices;
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+        GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* pixels)
+{
+    CALL(glTexSubImage2D);
+    (void)target;
+    (void)level;
+    (void)xoffset;
+    (void)yoffset;
+    (void)width;
+    (void)height;
+    (void)format;
+    (void)type;
+    (void)pixels;
+}
+
+void glBindBuffer(GLenum target, GLuint buffer)
+{
+    CALL(glBindBuffer);
+    if (target == GL_PIXEL_UNPACK_BUFFER)
+        bound_unpack_buffer = buffer;
+    else if (target == GL_ARRAY_BUFFER)
+        bound_array_buffer = buffer;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER)
+        bound_element_array_buffer = buffer;
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    Buffer* b = bound_buffer(target);
+    CALL(glBufferData);
+    (void)usage;
+    free(b->data);
+    b->data = malloc(size);
+    if (data)
+        memcpy(b->data, data, size);
+}
+
+void glBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    Buffer* b = bound_buffer(target);
+    CALL(glBufferStorage);
+    (void)data;
+    (void)flags;
+    free(b->data);
+    b->data = malloc(size);
+}
+
+void* glMapBuffer(GLenum target, GLenum access)
+{
+    CALL(glMapBuffer);
+    (void)access;
+    return bound_buffer(target)->data;
+}
+
+void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    CALL(glMapBufferRange);
+    (void)length;
+    (void)access;
+    return (char*)bound_buffer(target)->data + offset;
+}
+
+GLboolean glUnmapBuffer(GLenum target)
+{
+    CALL(glUnmapBuffer);
+    (void)target;
+    return GL_TRUE;
+}
+
+void glQueryCounter(GLuint id, GLenum target)
+{
+    CALL(glQueryCounter);
+    (void)target;
+    gpu_time += 1000000;
+    query_results[id % MAX_QUERIES] = gpu_time;
+}
+
+void glFlush(void)
+{
+    CALL(glFlush);
+}
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags)
+{
+    CALL(glFenceSync);
+    (void)condition;
+    (void)flags;
+    return (GLsync)(size_t)next_name++;
+}
+
+void glWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    CALL(glWaitSync);
+    (void)sync;
+    (void)flags;
+    (void)timeout;
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    QUERY(glClientWaitSync);
+    (void)sync;
+    (void)flags;
+    (void)timeout;
+    return GL_ALREADY_SIGNALED;
+}
+
+void glDeleteSync(GLsync sync)
+{
+    CALL(glDeleteSync);
+    (void)sync;
+}
+
+void glPushDebugGroup(GLenum source, GLuint id, GLsizei length, const GLchar* message)
+{
+    CALL(glPushDebugGroup);
+    (void)source;
+    (void)id;
+    (void)length;
+    (void)message;
+}
+
+void glPopDebugGroup(void)
+{
+    CALL(glPopDebugGroup);
+}
+
+void glObjectLabel(GLenum identifier, GLuint name, GLsizei length, const GLchar* label)
+{
+    CALL(glObjectLabel);
+    (void)identifier;
+    (void)name;
+    (void)length;
+    (void)label;
+}
+
+
+/*
+ * GLX
+ */
+
+#if GLS_USE_GLX
+Display* glXGetCurrentDisplay(void)
+{
+    CALL(glXGetCurrentDisplay);
+    return NULL;
+}
+
+GLXDrawable glXGetCurrentDrawable(void)
+{
+    CALL(glXGetCurrentDrawable);
+    return 0;
+}
+
+Bool glXGetSyncValuesOML(Display* dpy, GLXDrawable drawable,
+        int64_t* ust, int64_t* msc, int64_t* sbc)
+{
+    QUERY(glXGetSyncValuesOML);
+    (void)dpy;
+    (void)drawable;
+    *ust = 0;
+    *msc = 0;
+    *sbc = 0;
+    return False;
+}
+
+int glXGetVideoSyncSGI(unsigned int* count)
+{
+    QUERY(glXGetVideoSyncSGI);
+    *count = 0;
+    return -1;
+}
+
+const char* glXQueryExtensionsString(Display* dpy, int screen)
+{
+    QUERY(glXQueryExtensionsString);
+    (void)dpy;
+    (void)screen;
+    return "";
+}
+#endif
+
+
+/*
+ * Function lookup for the loader of libgls
+ */
+
+typedef void (*GLSstubProc)(void);
+
+#define PROC(name) { #name, (GLSstubProc)name }
+
+static const struct {
+    const char* name;
+    GLSstubProc proc;
+} procs[] = {
+    PROC(glActiveTexture),
+    PROC(glAttachShader),
+    PROC(glBindBuffer),
+    PROC(glBindFramebuffer),
+    PROC(glBindRenderbuffer),
+    PROC(glBlitFramebuffer),
+    PROC(glBufferData),
+    PROC(glBufferStorage),
+    PROC(glClientActiveTexture),
+    PROC(glClientWaitSync),
+    PROC(glCompileShader),
+    PROC(glCreateProgram),
+    PROC(glCreateShader),
+    PROC(glDeleteBuffers),
+    PROC(glDeleteFramebuffers),
+    PROC(glDeleteProgram),
+    PROC(glDeleteQueries),
+    PROC(glDeleteRenderbuffers),
+    PROC(glDeleteShader),
+    PROC(glDeleteSync),
+    PROC(glFenceSync),
+    PROC(glFramebufferRenderbuffer),
+    PROC(glFramebufferTexture2D),
+    PROC(glGenBuffers),
+    PROC(glGenFramebuffers),
+    PROC(glGenQueries),
+    PROC(glGenRenderbuffers),
+    PROC(glGetAttachedShaders),
+    PROC(glGetProgramInfoLog),
+    PROC(glGetProgramiv),
+    PROC(glGetQueryObjectiv),
+    PROC(glGetQueryObjectui64v),
+    PROC(glGetShaderInfoLog),
+    PROC(glGetShaderiv),
+    PROC(glGetStringi),
+    PROC(glGetUniformLocation),
+    PROC(glIsProgram),
+    PROC(glLinkProgram),
+    PROC(glMapBuffer),
+    PROC(glMapBufferRange),
+    PROC(glMultiTexCoord2f),
+    PROC(glObjectLabel),
+    PROC(glPopDebugGroup),
+    PROC(glPushDebugGroup),
+    PROC(glQueryCounter),
+    PROC(glRenderbufferStorage),
+    PROC(glShaderSource),
+    PROC(glUniform1f),
+    PROC(glUniform1i),
+    PROC(glUniform2f),
+    PROC(glUniform3f),
+    PROC(glUniform4f),
+    PROC(glUniformMatrix4fv),
+    PROC(glUnmapBuffer),
+    PROC(glUseProgram),
+    PROC(glWaitSync),
+#if GLS_USE_GLX
+    PROC(glXGetSyncValuesOML),
+    PROC(glXGetVideoSyncSGI),
+#endif
+};
+
+GLSstubProc gls_stub_get_proc_address(const char* name)
+{
+    size_t i;
+    for (i = 0; i < sizeof(procs) / sizeof(procs[0]); i++)
+        if (strcmp(procs[i].name, name) == 0)
+            return procs[i].proc;
+    return NULL;
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A recording stub of the OpenGL entry points that libgls uses. It does not
+ * render anything; it only counts calls, so that the CPU overhead of libgls
+ * can be measured without a GPU. See gls-profile.c.
+ */
+
+#ifndef GLS_STUB_H
+#define GLS_STUB_H
+
+#include <GL/gl.h>
+
+typedef struct {
+    const char* name;           /* name of the OpenGL function */
+    GLboolean is_query;         /* whether it returns state (may force a sync) */
+    unsigned long count;        /* number of calls since gls_stub_reset() */
+} GLSstubCall;
+
+/* Whether the stub reports OpenGL 3.0 and the extensions used by libgls. */
+extern GLboolean gls_stub_extensions;
+
+/* Whether the stub reports OpenGL 4.4 buffer storage (persistent mapping). */
+extern GLboolean gls_stub_buffer_storage;
+
+/* The viewport that glGetIntegerv(GL_VIEWPORT) returns. */
+extern GLint gls_stub_viewport[4];
+
+/* Reset all counters. */
+void gls_stub_reset(void);
+
+/* Total number of OpenGL calls, state queries, and heap allocations
+ * since the last reset. */
+unsigned long gls_stub_calls(void);
+unsigned long gls_stub_queries(void);
+unsigned long gls_stub_allocations(void);
+
+/* Per-function call counts. Functions that were never called have count 0. */
+int gls_stub_function_count(void);
+const GLSstubCall* gls_stub_function(int i);
+
+#endif
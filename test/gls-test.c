@@ -151,7 +151,7 @@ void keyboard(unsigned char key, int x, int y)
         {
             int m = gls_mode;
             m++;
-            if (m > GLS_MODE_RED_BLUE_MONOCHROME)
+            if (m > GLS_MODE_HMD)
                 m = GLS_MODE_QUAD_BUFFER_STEREO;
             if (m == GLS_MODE_QUAD_BUFFER_STEREO && !glut_stereo)
                 m++;
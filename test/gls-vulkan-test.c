@@ -0,0 +1,491 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Test of libgls-vulkan.
+ *
+ * This program creates a Vulkan device without a window system, composes two
+ * single-colored views in a number of modes into an image, and checks the
+ * pixels of the result. With Mesa, it runs on lavapipe. It exits with 77
+ * (skipped) if no Vulkan device is available.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vulkan/vulkan.h>
+
+#include <gls/gls-vulkan.h>
+
+
+#define WIDTH 64
+#define HEIGHT 32
+
+static int failures = 0;
+
+static void check(int condition, const char* what, GLSmode mode)
+{
+    if (!condition) {
+        fprintf(stderr, "gls-vulkan-test: mode %d: %s\n", mode, what);
+        failures++;
+    }
+}
+
+static void fail(const char* what)
+{
+    fprintf(stderr, "gls-vulkan-test: %s\n", what);
+    exit(1);
+}
+
+static VkPhysicalDeviceMemoryProperties memory_properties;
+
+static VkDeviceMemory allocate(VkDevice device, VkMemoryRequirements requirements,
+        VkMemoryPropertyFlags properties)
+{
+    VkMemoryAllocateInfo info = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    VkDeviceMemory memory;
+    uint32_t i;
+
+    for (i = 0; i < memory_properties.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1u << i))
+                && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            break;
+    }
+    if (i == memory_properties.memoryTypeCount)
+        fail("no suitable memory type");
+    info.allocationSize = requirements.size;
+    info.memoryTypeIndex = i;
+    if (vkAllocateMemory(device, &info, NULL, &memory) != VK_SUCCESS)
+        fail("cannot allocate memory");
+    return memory;
+}
+
+static VkImage create_image(VkDevice device, VkImageUsageFlags usage,
+        VkDeviceMemory* memory, VkImageView* view)
+{
+    VkImageCreateInfo info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    VkImageViewCreateInfo view_info = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    VkMemoryRequirements requirements;
+    VkImage image;
+
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    info.extent.width = WIDTH;
+    info.extent.height = HEIGHT;
+    info.extent.depth = 1;
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(device, &info, NULL, &image) != VK_SUCCESS)
+        fail("cannot create an image");
+    vkGetImageMemoryRequirements(device, image, &requirements);
+    *memory = allocate(device, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vkBindImageMemory(device, image, *memory, 0);
+    view_info.image = image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = info.format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(device, &view_info, NULL, view) != VK_SUCCESS)
+        fail("cannot create an image view");
+    return image;
+}
+
+static void barrier(VkCommandBuffer cmd, VkImage image,
+        VkImageLayout old_layout, VkImageLayout new_layout,
+        VkAccessFlags src_access, VkAccessFlags dst_access,
+        VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+    VkImageMemoryBarrier b = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    b.srcAccessMask = src_access;
+    b.dstAccessMask = dst_access;
+    b.oldLayout = old_layout;
+    b.newLayout = new_layout;
+    b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.image = image;
+    b.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    b.subresourceRange.levelCount = 1;
+    b.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &b);
+}
+
+static void submit(VkQueue queue, VkCommandBuffer cmd)
+{
+    VkSubmitInfo info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    info.commandBufferCount = 1;
+    info.pCommandBuffers = &cmd;
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS
+            || vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS
+            || vkQueueWaitIdle(queue) != VK_SUCCESS)
+        fail("cannot submit commands");
+}
+
+static void begin(VkCommandBuffer cmd)
+{
+    VkCommandBufferBeginInfo info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(cmd, &info) != VK_SUCCESS)
+        fail("cannot begin a command buffer");
+}
+
+/* Begin a command buffer and a render pass instance that clears the target
+ * to blue */
+static void begin_render_pass(VkCommandBuffer cmd, VkRenderPass render_pass, VkFramebuffer framebuffer)
+{
+    VkClearValue clear_value = { { { 0.0f, 0.0f, 1.0f, 1.0f } } };
+    VkRenderPassBeginInfo info = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+
+    begin(cmd);
+    info.renderPass = render_pass;
+    info.framebuffer = framebuffer;
+    info.renderArea.extent.width = WIDTH;
+    info.renderArea.extent.height = HEIGHT;
+    info.clearValueCount = 1;
+    info.pClearValues = &clear_value;
+    vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+/* End the render pass instance, copy the target into the buffer, and wait
+ * for the result */
+static void end_render_pass(VkQueue queue, VkCommandBuffer cmd, VkImage target, VkBuffer buffer)
+{
+    VkBufferImageCopy region;
+
+    vkCmdEndRenderPass(cmd);
+    memset(&region, 0, sizeof(region));
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = WIDTH;
+    region.imageExtent.height = HEIGHT;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(cmd, target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+    submit(queue, cmd);
+}
+
+/* Whether the pixel is mostly red (1), green (2), or blue (4); rows are
+ * counted from the top */
+static const unsigned char* pixels;
+
+static int color_at(int x, int y)
+{
+    const unsigned char* rgba = pixels + 4 * (y * WIDTH + x);
+    return (rgba[0] > 128 ? 1 : 0) | (rgba[1] > 128 ? 2 : 0) | (rgba[2] > 128 ? 4 : 0);
+}
+
+int main(void)
+{
+    static const GLSmode modes[] = {
+        GLS_MODE_MONO_LEFT, GLS_MODE_MONO_RIGHT, GLS_MODE_LEFT_RIGHT,
+        GLS_MODE_TOP_BOTTOM, GLS_MODE_HDMI_FRAME_PACK, GLS_MODE_RED_CYAN_FULL_COLOR,
+        GLS_MODE_EVEN_ODD_ROWS, GLS_MODE_EVEN_ODD_COLUMNS, GLS_MODE_CHECKERBOARD,
+        GLS_MODE_EVEN_ODD_ROWS
+    };
+    VkApplicationInfo app_info = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
+    VkInstanceCreateInfo instance_info = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+    VkInstance instance;
+    VkPhysicalDevice physical_devices[8];
+    uint32_t physical_device_count = 8;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    uint32_t queue_family = 0;
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+    VkDeviceCreateInfo device_info = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+    VkDevice device;
+    VkQueue queue;
+    VkCommandPoolCreateInfo pool_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    VkCommandPool pool;
+    VkCommandBufferAllocateInfo cmd_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    VkCommandBuffer cmd;
+    VkImage view_images[2], target;
+    VkDeviceMemory view_memory[2], target_memory, buffer_memory;
+    VkImageView views[2], target_view;
+    VkBufferCreateInfo buffer_info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    VkBuffer buffer;
+    VkMemoryRequirements requirements;
+    VkAttachmentDescription attachment;
+    VkAttachmentReference attachment_ref = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass;
+    VkSubpassDependency dependency;
+    VkRenderPassCreateInfo render_pass_info = { VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+    VkRenderPass render_pass;
+    VkFramebufferCreateInfo framebuffer_info = { VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+    VkFramebuffer framebuffer;
+    VkRect2D area;
+    GLSvkContext* ctx;
+    void* mapped;
+    uint32_t i;
+
+    app_info.pApplicationName = "gls-vulkan-test";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    instance_info.pApplicationInfo = &app_info;
+    if (vkCreateInstance(&instance_info, NULL, &instance) != VK_SUCCESS) {
+        fprintf(stderr, "gls-vulkan-test: no Vulkan instance\n");
+        return 77;
+    }
+    vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices);
+    for (i = 0; i < physical_device_count && physical_device == VK_NULL_HANDLE; i++) {
+        VkQueueFamilyProperties families[8];
+        uint32_t family_count = 8;
+        uint32_t j;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_devices[i], &family_count, families);
+        for (j = 0; j < family_count; j++) {
+            if (families[j].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                physical_device = physical_devices[i];
+                queue_family = j;
+                break;
+            }
+        }
+    }
+    if (physical_device == VK_NULL_HANDLE) {
+        fprintf(stderr, "gls-vulkan-test: no Vulkan device with graphics\n");
+        vkDestroyInstance(instance, NULL);
+        return 77;
+    }
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+    queue_info.queueFamilyIndex = queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    if (vkCreateDevice(physical_device, &device_info, NULL, &device) != VK_SUCCESS)
+        fail("cannot create a device");
+    vkGetDeviceQueue(device, queue_family, 0, &queue);
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vkCreateCommandPool(device, &pool_info, NULL, &pool) != VK_SUCCESS)
+        fail("cannot create a command pool");
+    cmd_info.commandPool = pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(device, &cmd_info, &cmd) != VK_SUCCESS)
+        fail("cannot allocate a command buffer");
+
+    // The views: left red, right green
+    for (i = 0; i < 2; i++) {
+        view_images[i] = create_image(device,
+                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                &view_memory[i], &views[i]);
+    }
+    begin(cmd);
+    for (i = 0; i < 2; i++) {
+        VkClearColorValue color = { { i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, 0.0f, 1.0f } };
+        VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        barrier(cmd, view_images[i], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        vkCmdClearColorImage(cmd, view_images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+        barrier(cmd, view_images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+    submit(queue, cmd);
+
+    // The composition target, and a buffer to read it back
+    target = create_image(device,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            &target_memory, &target_view);
+    buffer_info.size = WIDTH * HEIGHT * 4;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &buffer_info, NULL, &buffer) != VK_SUCCESS)
+        fail("cannot create a buffer");
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    buffer_memory = allocate(device, requirements,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkBindBufferMemory(device, buffer, buffer_memory, 0);
+    if (vkMapMemory(device, buffer_memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+        fail("cannot map memory");
+    pixels = mapped;
+
+    // A render pass that clears to blue and leaves the result for a copy
+    memset(&attachment, 0, sizeof(attachment));
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    memset(&subpass, 0, sizeof(subpass));
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &attachment_ref;
+    memset(&dependency, 0, sizeof(dependency));
+    dependency.srcSubpass = 0;
+    dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+    if (vkCreateRenderPass(device, &render_pass_info, NULL, &render_pass) != VK_SUCCESS)
+        fail("cannot create a render pass");
+    framebuffer_info.renderPass = render_pass;
+    framebuffer_info.attachmentCount = 1;
+    framebuffer_info.pAttachments = &target_view;
+    framebuffer_info.width = WIDTH;
+    framebuffer_info.height = HEIGHT;
+    framebuffer_info.layers = 1;
+    if (vkCreateFramebuffer(device, &framebuffer_info, NULL, &framebuffer) != VK_SUCCESS)
+        fail("cannot create a framebuffer");
+
+    // Two frames in flight, although each frame is waited for here
+    ctx = glsVkCreateContext(device, render_pass, 0, VK_NULL_HANDLE, 2);
+    if (!ctx)
+        fail("cannot create a GLS Vulkan context");
+    area.offset.x = 0;
+    area.offset.y = 0;
+    area.extent.width = WIDTH;
+    area.extent.height = HEIGHT;
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        GLSmode mode = modes[i];
+        int c[4];
+
+        // The last pass checks that the rows follow the screen
+        glsVkSetFramebufferScreenCoords(ctx, 0, i == sizeof(modes) / sizeof(modes[0]) - 1 ? 1 : 0);
+        glsVkBeginFrame(ctx, i % 2);
+        begin_render_pass(cmd, render_pass, framebuffer);
+        glsVkCmdDrawViews(ctx, cmd, mode, VK_FALSE, views[0], views[1], &area);
+        end_render_pass(queue, cmd, target, buffer);
+
+        c[0] = color_at(WIDTH / 4, HEIGHT / 4);
+        c[1] = color_at(WIDTH / 4 + 1, HEIGHT / 4);
+        c[2] = color_at(WIDTH / 4, HEIGHT / 4 + 1);
+        c[3] = color_at(3 * WIDTH / 4, 3 * HEIGHT / 4);
+        switch (mode) {
+        case GLS_MODE_MONO_LEFT:
+            check(c[0] == 1 && c[3] == 1, "expected the left view", mode);
+            break;
+        case GLS_MODE_MONO_RIGHT:
+            check(c[0] == 2 && c[3] == 2, "expected the right view", mode);
+            break;
+        case GLS_MODE_LEFT_RIGHT:
+            check(c[0] == 1 && c[3] == 2, "expected left and right halves", mode);
+            break;
+        case GLS_MODE_TOP_BOTTOM:
+        case GLS_MODE_HDMI_FRAME_PACK:
+            check(c[0] == 1 && c[3] == 2, "expected top and bottom halves", mode);
+            break;
+        case GLS_MODE_RED_CYAN_FULL_COLOR:
+            check(c[0] == 3, "expected red from the left and green from the right view", mode);
+            break;
+        case GLS_MODE_EVEN_ODD_ROWS:
+            if (i == sizeof(modes) / sizeof(modes[0]) - 1)
+                check(c[0] == 2 && c[1] == 2 && c[2] == 1, "expected rows starting on an odd screen row", mode);
+            else
+                check(c[0] == 1 && c[1] == 1 && c[2] == 2, "expected alternating rows", mode);
+            break;
+        case GLS_MODE_EVEN_ODD_COLUMNS:
+            check(c[0] == 1 && c[1] == 2 && c[2] == 1, "expected alternating columns", mode);
+            break;
+        default:
+            check(c[0] == 1 && c[1] == 2 && c[2] == 2, "expected a checkerboard", mode);
+            break;
+        }
+    }
+    {
+        // A frame never updates the descriptor set of a pair of views that
+        // it composed before: compose the left view into the left half, and
+        // other pairs into the right half until the sets are used up
+        VkImageViewCreateInfo view_info = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+        VkImageView green_views[GLS_VK_MAX_VIEW_PAIRS];
+        VkRect2D half = area;
+        VkBool32 composed = VK_TRUE;
+
+        view_info.image = view_images[1];
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+        for (i = 0; i < GLS_VK_MAX_VIEW_PAIRS; i++) {
+            if (vkCreateImageView(device, &view_info, NULL, &green_views[i]) != VK_SUCCESS)
+                fail("cannot create an image view");
+        }
+        glsVkBeginFrame(ctx, 0);
+        begin_render_pass(cmd, render_pass, framebuffer);
+        half.extent.width = WIDTH / 2;
+        if (!glsVkCmdDrawViews(ctx, cmd, GLS_MODE_MONO_LEFT, VK_FALSE, views[0], views[1], &half))
+            composed = VK_FALSE;
+        half.offset.x = WIDTH / 2;
+        for (i = 0; i < GLS_VK_MAX_VIEW_PAIRS - 1; i++) {
+            if (!glsVkCmdDrawViews(ctx, cmd, GLS_MODE_MONO_LEFT, VK_FALSE, green_views[i], views[1], &half))
+                composed = VK_FALSE;
+        }
+        check(composed, "cannot compose the maximum number of view pairs", GLS_MODE_MONO_LEFT);
+        check(!glsVkCmdDrawViews(ctx, cmd, GLS_MODE_MONO_LEFT, VK_FALSE, green_views[i], views[1], &half),
+                "too many view pairs were not rejected", GLS_MODE_MONO_LEFT);
+        end_render_pass(queue, cmd, target, buffer);
+        check(color_at(WIDTH / 4, HEIGHT / 2) == 1 && color_at(3 * WIDTH / 4, HEIGHT / 2) == 2,
+                "expected the left view of each pair", GLS_MODE_MONO_LEFT);
+
+        // The other frame has its own descriptor sets
+        glsVkBeginFrame(ctx, 1);
+        begin_render_pass(cmd, render_pass, framebuffer);
+        check(glsVkCmdDrawViews(ctx, cmd, GLS_MODE_MONO_LEFT, VK_FALSE, green_views[i], views[1], &area),
+                "the next frame cannot compose", GLS_MODE_MONO_LEFT);
+        end_render_pass(queue, cmd, target, buffer);
+        check(color_at(WIDTH / 4, HEIGHT / 2) == 2, "expected the left view", GLS_MODE_MONO_LEFT);
+        for (i = 0; i < GLS_VK_MAX_VIEW_PAIRS; i++)
+            vkDestroyImageView(device, green_views[i], NULL);
+    }
+    // The head-mounted display mode has no lens distortion here
+    begin_render_pass(cmd, render_pass, framebuffer);
+    check(!glsVkCmdDrawViews(ctx, cmd, GLS_MODE_HMD, VK_FALSE, views[0], views[1], &area),
+            "mode was not rejected", GLS_MODE_HMD);
+    end_render_pass(queue, cmd, target, buffer);
+    vkDeviceWaitIdle(device);
+    glsVkDestroyContext(ctx);
+
+    vkDestroyFramebuffer(device, framebuffer, NULL);
+    vkDestroyRenderPass(device, render_pass, NULL);
+    vkUnmapMemory(device, buffer_memory);
+    vkDestroyBuffer(device, buffer, NULL);
+    vkFreeMemory(device, buffer_memory, NULL);
+    vkDestroyImageView(device, target_view, NULL);
+    vkDestroyImage(device, target, NULL);
+    vkFreeMemory(device, target_memory, NULL);
+    for (i = 0; i < 2; i++) {
+        vkDestroyImageView(device, views[i], NULL);
+        vkDestroyImage(device, view_images[i], NULL);
+        vkFreeMemory(device, view_memory[i], NULL);
+    }
+    vkDestroyCommandPool(device, pool, NULL);
+    vkDestroyDevice(device, NULL);
+    vkDestroyInstance(instance, NULL);
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Included by gls.c when libgls is built against the recording stub OpenGL
+ * implementation in test/gls-stub.c. The function loader of libgls looks up
+ * the stub functions, and the stub reports the OpenGL version that the
+ * profiling harness asks for.
+ */
+
+#ifndef GLS_STUB_GL_H
+#define GLS_STUB_GL_H
+
+#include <stddef.h>
+
+#define GLS_GL_GET_PROC_ADDRESS(name) gls_stub_get_proc_address(name)
+extern void (*gls_stub_get_proc_address(const char* name))(void);
+
+/* Count the heap allocations of libgls */
+extern void* gls_stub_malloc(size_t size);
+extern void* gls_stub_realloc(void* ptr, size_t size);
+extern char* gls_stub_strdup(const char* s);
+#define malloc gls_stub_malloc
+#define realloc gls_stub_realloc
+#define strdup gls_stub_strdup
+
+#endif
@@ -0,0 +1,1230 @@
+/*
+ * This file is part of libgls, a library for stereoscopic OpenGL rendering.
+ *
+ * Copyright (C) 2012, 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Offline conversion of stereoscopic images and videos.
+ *
+ * gls-convert reads stereo frames, either as two separate streams of left and
+ * right views or as one stream of packed frames, composes them in any
+ * GLSmode that can be stored in a file, and writes the result. Input files
+ * are memory-mapped. Supported file formats are PPM (P6, also several
+ * concatenated images), YUV4MPEG2 (8 bit, 4:2:0, 4:2:2, 4:4:4, mono),
+ * and raw RGB24 (which requires --input-size).
+ *
+ * Composition either uses libgls on an offscreen OpenGL context (EGL), with
+ * several frames in flight between upload, composition, and readback, or an
+ * equivalent CPU implementation that does not need a GPU at all.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if GLS_CONVERT_USE_EGL
+# include <EGL/egl.h>
+# include <EGL/eglext.h>
+# define GL_GLEXT_PROTOTYPES 1
+# include <GL/gl.h>
+# include <GL/glext.h>
+#endif
+
+#include <gls/gls.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+# define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+
+/* Mode names for the command line, in GLSmode order */
+static const char* mode_names[] = {
+    "quad-buffer-stereo", "alternating", "mono-left", "mono-right",
+    "left-right", "top-bottom", "hdmi-frame-pack", "even-odd-rows",
+    "even-odd-columns", "checkerboard", "red-cyan-monochrome",
+    "red-cyan-half-color", "red-cyan-full-color", "red-cyan-dubois",
+    "green-magenta-monochrome", "green-magenta-half-color",
+    "green-magenta-full-color", "green-magenta-dubois",
+    "amber-blue-monochrome", "amber-blue-half-color", "amber-blue-full-color",
+    "amber-blue-dubois", "red-green-monochrome", "red-blue-monochrome"
+};
+#define MODE_COUNT ((int)(sizeof(mode_names) / sizeof(mode_names[0])))
+
+
+/*
+ * File formats
+ */
+
+typedef enum {
+    FORMAT_RAW,
+    FORMAT_PPM,
+    FORMAT_Y4M
+} Format;
+
+typedef struct {
+    const char* name;
+    const unsigned char* data;  /* memory-mapped file */
+    size_t size;
+    size_t pos;                 /* start of the next frame */
+    Format format;
+    int width;
+    int height;
+    int chroma;                 /* Y4M: 420, 422, 444, or 0 for mono */
+    char framerate[32];         /* Y4M: e.g. "25:1" */
+    unsigned char* rgb;         /* converted frame, if conversion is necessary */
+} Input;
+
+typedef struct {
+    FILE* f;
+    Format format;
+    int width;
+    int height;
+    unsigned char* buf;
+} Output;
+
+/* A view inside a frame, with rows from top to bottom */
+typedef struct {
+    const unsigned char* data;  /* RGB24 */
+    size_t stride;
+    int width;
+    int height;
+} View;
+
+static Format format_from_name(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+    if (ext && (strcmp(ext, ".y4m") == 0 || strcmp(ext, ".Y4M") == 0))
+        return FORMAT_Y4M;
+    if (ext && (strcmp(ext, ".ppm") == 0 || strcmp(ext, ".PPM") == 0))
+        return FORMAT_PPM;
+    return FORMAT_RAW;
+}
+
+/* Read a decimal number from a header; skips whitespace and comments */
+static int header_number(const Input* in, size_t* pos)
+{
+    int n = 0;
+    for (;;) {
+        while (*pos < in->size && (in->data[*pos] == ' ' || in->data[*pos] == '\t'
+                    || in->data[*pos] == '\n' || in->data[*pos] == '\r'))
+            (*pos)++;
+        if (*pos < in->size && in->data[*pos] == '#') {
+            while (*pos < in->size && in->data[*pos] != '\n')
+                (*pos)++;
+        } else {
+            break;
+        }
+    }
+    if (*pos >= in->size || in->data[*pos] < '0' || in->data[*pos] > '9')
+        return -1;
+    while (*pos < in->size && in->data[*pos] >= '0' && in->data[*pos] <= '9') {
+        n = 10 * n + (in->data[*pos] - '0');
+        if (n > (1 << 16))
+            return -1;
+        (*pos)++;
+    }
+    return n;
+}
+
+static int parse_ppm_header(Input* in, size_t* pos, int* w, int* h)
+{
+    int maxval;
+    if (*pos + 2 > in->size || in->data[*pos] != 'P' || in->data[*pos + 1] != '6')
+        return -1;
+    *pos += 2;
+    *w = header_number(in, pos);
+    *h = header_number(in, pos);
+    maxval = header_number(in, pos);
+    if (*w < 1 || *h < 1 || maxval != 255 || *pos >= in->size)
+        return -1;
+    (*pos)++;   /* single whitespace character */
+    return 0;
+}
+
+static int parse_y4m_header(Input* in)
+{
+    const char* colorspace = "420jpeg";
+    size_t end, p;
+    char token[64];
+
+    for (end = 0; end < in->size && in->data[end] != '\n'; end++)
+        ;
+    if (end == in->size || in->size < 10 || memcmp(in->data, "YUV4MPEG2 ", 10) != 0)
+        return -1;
+    strcpy(in->framerate, "25:1");
+    p = 10;
+    while (p < end) {
+        size_t len = 0;
+        while (p < end && in->data[p] == ' ')
+            p++;
+        while (p + len < end && in->data[p + len] != ' ' && len < sizeof(token) - 1)
+            len++;
+        memcpy(token, in->data + p, len);
+        token[len] = '\0';
+        p += len;
+        if (token[0] == 'W')
+            in->width = atoi(token + 1);
+        else if (token[0] == 'H')
+            in->height = atoi(token + 1);
+        else if (token[0] == 'F' && len < sizeof(in->framerate))
+            strcpy(in->framerate, token + 1);
+        else if (token[0] == 'C')
+            colorspace = (strncmp(token + 1, "420", 3) == 0 ? "420"
+                    : strcmp(token + 1, "422") == 0 ? "422"
+                    : strcmp(token + 1, "444") == 0 ? "444"
+                    : strcmp(token + 1, "mono") == 0 ? "mono" : NULL);
+        if (!colorspace)
+            return -1;
+    }
+    in->chroma = (strcmp(colorspace, "420") == 0 || strcmp(colorspace, "420jpeg") == 0 ? 420
+            : strcmp(colorspace, "422") == 0 ? 422
+            : strcmp(colorspace, "444") == 0 ? 444 : 0);
+    in->pos = end + 1;
+    return (in->width > 0 && in->height > 0 ? 0 : -1);
+}
+
+static int input_open(Input* in, const char* name, int width, int height)
+{
+    struct stat st;
+    void* data;
+    int fd;
+
+    memset(in, 0, sizeof(Input));
+    in->name = name;
+    fd = open(name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "gls-convert: %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    in->size = st.st_size;
+    data = (in->size > 0 ? mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "gls-convert: %s: cannot map file\n", name);
+        return -1;
+    }
+    in->data = data;
+    // The file is read sequentially, exactly once
+    posix_madvise(data, in->size, POSIX_MADV_SEQUENTIAL);
+
+    if (in->size >= 10 && memcmp(in->data, "YUV4MPEG2 ", 10) == 0) {
+        in->format = FORMAT_Y4M;
+        if (parse_y4m_header(in) != 0) {
+            fprintf(stderr, "gls-convert: %s: unsupported YUV4MPEG2 stream\n", name);
+            return -1;
+        }
+        in->rgb = malloc((size_t)in->width * in->height * 3);
+    } else if (in->size >= 2 && in->data[0] == 'P' && in->data[1] == '6') {
+        size_t pos = 0;
+        in->format = FORMAT_PPM;
+        if (parse_ppm_header(in, &pos, &in->width, &in->height) != 0) {
+            fprintf(stderr, "gls-convert: %s: unsupported PPM image\n", name);
+            return -1;
+        }
+    } else {
+        in->format = FORMAT_RAW;
+        in->width = width;
+        in->height = height;
+        if (width < 1 || height < 1) {
+            fprintf(stderr, "gls-convert: %s: raw input requires --input-size\n", name);
+            return -1;
+        }
+    }
+    if (in->format == FORMAT_Y4M && !in->rgb) {
+        fprintf(stderr, "gls-convert: out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void input_close(Input* in)
+{
+    if (in->data)
+        munmap((void*)in->data, in->size);
+    free(in->rgb);
+}
+
+static unsigned char clamp_byte(float v)
+{
+    return (v <= 0.0f ? 0 : v >= 255.0f ? 255 : (unsigned char)(v + 0.5f));
+}
+
+/* Get the next frame as RGB24 with rows from top to bottom. Returns NULL
+ * at the end of the input. RGB data is not copied. */
+static const unsigned char* input_frame(Input* in)
+{
+    size_t frame_size = (size_t)in->width * in->height * 3;
+    const unsigned char* frame;
+
+    if (in->format == FORMAT_RAW) {
+        if (in->pos + frame_size > in->size)
+            return NULL;
+        frame = in->data + in->pos;
+        in->pos += frame_size;
+        return frame;
+    } else if (in->format == FORMAT_PPM) {
+        size_t pos = in->pos;
+        int w, h;
+        while (pos < in->size && (in->data[pos] == ' ' || in->data[pos] == '\n'
+                    || in->data[pos] == '\r' || in->data[pos] == '\t'))
+            pos++;
+        if (pos >= in->size)
+            return NULL;
+        if (parse_ppm_header(in, &pos, &w, &h) != 0 || w != in->width || h != in->height) {
+            fprintf(stderr, "gls-convert: %s: all images must have the same size\n", in->name);
+            return NULL;
+        }
+        if (pos + frame_size > in->size)
+            return NULL;
+        in->pos = pos + frame_size;
+        return in->data + pos;
+    } else {
+        int cw = (in->chroma == 444 ? in->width : (in->width + 1) / 2);
+        int ch = (in->chroma == 420 ? (in->height + 1) / 2 : in->height);
+        size_t y_size = (size_t)in->width * in->height;
+        size_t c_size = (in->chroma == 0 ? 0 : (size_t)cw * ch);
+        const unsigned char *y_plane, *u_plane, *v_plane;
+        int x, y;
+        size_t pos = in->pos;
+
+        if (pos + 5 > in->size || memcmp(in->data + pos, "FRAME", 5) != 0)
+            return NULL;
+        while (pos < in->size && in->data[pos] != '\n')
+            pos++;
+        pos++;
+        if (pos + y_size + 2 * c_size > in->size)
+            return NULL;
+        y_plane = in->data + pos;
+        u_plane = y_plane + y_size;
+        v_plane = u_plane + c_size;
+        in->pos = pos + y_size + 2 * c_size;
+        // BT.601, limited range
+        for (y = 0; y < in->height; y++) {
+            const unsigned char* yr = y_plane + (size_t)y * in->width;
+            int cy = (in->chroma == 420 ? y / 2 : y);
+            unsigned char* rgb = in->rgb + (size_t)y * in->width * 3;
+            for (x = 0; x < in->width; x++) {
+                float lum = 1.164f * (yr[x] - 16);
+                float u = 0.0f, v = 0.0f;
+                if (in->chroma != 0) {
+                    int cx = (in->chroma == 444 ? x : x / 2);
+                    u = u_plane[(size_t)cy * cw + cx] - 128.0f;
+                    v = v_plane[(size_t)cy * cw + cx] - 128.0f;
+                }
+                rgb[3 * x + 0] = clamp_byte(lum + 1.596f * v);
+                rgb[3 * x + 1] = clamp_byte(lum - 0.392f * u - 0.813f * v);
+                rgb[3 * x + 2] = clamp_byte(lum + 2.017f * u);
+            }
+        }
+        return in->rgb;
+    }
+}
+
+static int output_open(Output* out, const char* name, int width, int height,
+        const char* framerate)
+{
+    out->f = (strcmp(name, "-") == 0 ? stdout : fopen(name, "wb"));
+    if (!out->f) {
+        fprintf(stderr, "gls-convert: %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    out->format = format_from_name(name);
+    out->width = width;
+    out->height = height;
+    out->buf = malloc((size_t)width * height * 3);
+    if (!out->buf) {
+        fprintf(stderr, "gls-convert: out of memory\n");
+        return -1;
+    }
+    if (out->format == FORMAT_Y4M) {
+        // 4:4:4, so that row and column interleaving survives
+        fprintf(out->f, "YUV4MPEG2 W%d H%d F%s Ip A1:1 C444\n", width, height, framerate);
+    }
+    return 0;
+}
+
+/* Write a frame. Rows are given from bottom to top if stride is negative. */
+static int output_frame(Output* out, const unsigned char* data, long stride, int bytes_per_pixel)
+{
+    size_t n = (size_t)out->width * out->height;
+    int x, y;
+
+    if (out->format == FORMAT_Y4M) {
+        unsigned char* yp = out->buf;
+        unsigned char* up = yp + n;
+        unsigned char* vp = up + n;
+        for (y = 0; y < out->height; y++) {
+            const unsigned char* row = data + y * stride;
+            for (x = 0; x < out->width; x++) {
+                float r = row[bytes_per_pixel * x + 0];
+                float g = row[bytes_per_pixel * x + 1];
+                float b = row[bytes_per_pixel * x + 2];
+                size_t i = (size_t)y * out->width + x;
+                yp[i] = clamp_byte(16.0f + 0.257f * r + 0.504f * g + 0.098f * b);
+                up[i] = clamp_byte(128.0f - 0.148f * r - 0.291f * g + 0.439f * b);
+                vp[i] = clamp_byte(128.0f + 0.439f * r - 0.368f * g - 0.071f * b);
+            }
+        }
+        fputs("FRAME\n", out->f);
+        fwrite(out->buf, 1, 3 * n, out->f);
+    } else {
+        if (out->format == FORMAT_PPM)
+            fprintf(out->f, "P6\n%d %d\n255\n", out->width, out->height);
+        for (y = 0; y < out->height; y++) {
+            const unsigned char* row = data + y * stride;
+            if (bytes_per_pixel == 3) {
+                memcpy(out->buf + (size_t)y * out->width * 3, row, (size_t)out->width * 3);
+            } else {
+                unsigned char* dst = out->buf + (size_t)y * out->width * 3;
+                for (x = 0; x < out->width; x++) {
+                    dst[3 * x + 0] = row[bytes_per_pixel * x + 0];
+                    dst[3 * x + 1] = row[bytes_per_pixel * x + 1];
+                    dst[3 * x + 2] = row[bytes_per_pixel * x + 2];
+                }
+            }
+        }
+        fwrite(out->buf, 1, 3 * n, out->f);
+    }
+    return (ferror(out->f) ? -1 : 0);
+}
+
+static int output_close(Output* out)
+{
+    int ret = 0;
+    if (out->f && out->f != stdout)
+        ret = fclose(out->f);
+    else if (out->f)
+        ret = fflush(out->f);
+    free(out->buf);
+    return ret;
+}
+
+
+/*
+ * CPU composition. This follows gls.glsl and glsDrawViews(), so that the
+ * result matches that of the OpenGL path.
+ */
+
+typedef struct {
+    GLfloat crosstalk[3];       /* multiplied with the ghostbusting level */
+    GLboolean ghostbust;
+} Params;
+
+/* Fetch a texel; rows are counted from the bottom as in OpenGL, and
+ * texels outside of the view are black (GL_CLAMP_TO_BORDER). */
+static void fetch(const View* v, int x, int y, float rgb[3])
+{
+    if (x < 0 || y < 0 || x >= v->width || y >= v->height) {
+        rgb[0] = rgb[1] = rgb[2] = 0.0f;
+    } else {
+        const unsigned char* p = v->data + (size_t)(v->height - 1 - y) * v->stride + 3 * x;
+        rgb[0] = p[0] / 255.0f;
+        rgb[1] = p[1] / 255.0f;
+        rgb[2] = p[2] / 255.0f;
+    }
+}
+
+/* Like texture2D() with GL_LINEAR filtering, clamped to the outermost texel
+ * centers like view_texcoord() in gls.glsl */
+static float texel_coord(float s, int size)
+{
+    float x = s * size - 0.5f;
+    return x < 0.0f ? 0.0f : x > size - 1.0f ? size - 1.0f : x;
+}
+
+static void texture(const View* v, float s, float t, float rgb[3])
+{
+    float x = texel_coord(s, v->width);
+    float y = texel_coord(t, v->height);
+    int x0 = (int)floorf(x);
+    int y0 = (int)floorf(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    float a[3], b[3], c[3], d[3];
+    int i;
+
+    fetch(v, x0, y0, a);
+    fetch(v, x0 + 1, y0, b);
+    fetch(v, x0, y0 + 1, c);
+    fetch(v, x0 + 1, y0 + 1, d);
+    for (i = 0; i < 3; i++)
+        rgb[i] = (1.0f - fy) * ((1.0f - fx) * a[i] + fx * b[i])
+            + fy * ((1.0f - fx) * c[i] + fx * d[i]);
+}
+
+static float rgb_to_lum(const float rgb[3])
+{
+    return 0.299f * rgb[0] + 0.587f * rgb[1] + 0.114f * rgb[2];
+}
+
+static void mix(const float a[3], const float b[3], float m, float result[3])
+{
+    int i;
+    for (i = 0; i < 3; i++)
+        result[i] = a[i] * (1.0f - m) + b[i] * m;
+}
+
+static void ghostbust(const Params* p, const float original[3], const float other[3],
+        float result[3])
+{
+    int i;
+    for (i = 0; i < 3; i++)
+        result[i] = (p->ghostbust
+                ? original[i] + p->crosstalk[i] - (other[i] + original[i]) * p->crosstalk[i]
+                : original[i]);
+}
+
+/* Dubois matrices for red/cyan, green/magenta, and amber/blue; in column-major
+ * order like the GLSL mat3 constructors in gls.glsl. */
+static const float dubois[3][2][9] = {
+    { {  0.437f, -0.062f, -0.048f,  0.449f, -0.062f, -0.050f,  0.164f, -0.024f, -0.017f },
+      { -0.011f,  0.377f, -0.026f, -0.032f,  0.761f, -0.093f, -0.007f,  0.009f,  1.234f } },
+    { { -0.062f,  0.284f, -0.015f, -0.158f,  0.668f, -0.027f, -0.039f,  0.143f,  0.021f },
+      {  0.529f, -0.016f,  0.009f,  0.705f, -0.015f,  0.075f,  0.024f, -0.065f,  0.937f } },
+    { {  1.062f, -0.026f, -0.038f, -0.205f,  0.908f, -0.173f,  0.299f,  0.068f,  0.022f },
+      { -0.016f,  0.006f,  0.094f, -0.123f,  0.062f,  0.185f, -0.017f, -0.017f,  0.911f } }
+};
+
+/* Filter a view for the masked modes, to account for the masked out lines.
+ * Like libgls, the filter steps by one output pixel, or by one texel of views
+ * that have a lower resolution than the output. */
+static void masked_tex(GLSmode mode, const View* v, float s, float t,
+        float step_x, float step_y, float rgb[3])
+{
+    float a[3], b[3], c[3], d[3], e[3];
+    int i;
+
+    step_x = fmaxf(step_x, 1.0f / v->width);
+    step_y = fmaxf(step_y, 1.0f / v->height);
+    if (mode == GLS_MODE_EVEN_ODD_ROWS) {
+        texture(v, s, t - step_y, a);
+        texture(v, s, t, b);
+        texture(v, s, t + step_y, c);
+        for (i = 0; i < 3; i++)
+            rgb[i] = (a[i] + 2.0f * b[i] + c[i]) / 4.0f;
+    } else if (mode == GLS_MODE_EVEN_ODD_COLUMNS) {
+        texture(v, s - step_x, t, a);
+        texture(v, s, t, b);
+        texture(v, s + step_x, t, c);
+        for (i = 0; i < 3; i++)
+            rgb[i] = (a[i] + 2.0f * b[i] + c[i]) / 4.0f;
+    } else {
+        texture(v, s, t - step_y, a);
+        texture(v, s - step_x, t, b);
+        texture(v, s, t, c);
+        texture(v, s + step_x, t, d);
+        texture(v, s, t + step_y, e);
+        for (i = 0; i < 3; i++)
+            rgb[i] = (a[i] + b[i] + 4.0f * c[i] + d[i] + e[i]) / 8.0f;
+    }
+}
+
+/* Compute one output pixel. (s, t) are the texture coordinates within the
+ * sub-viewport, (x, y) the pixel coordinates within the whole viewport. */
+static void shade(GLSmode mode, const Params* p, const View* vl, const View* vr,
+        float channel, float s, float t, int x, int y, float step_x, float step_y,
+        float result[3])
+{
+    float l[3], r[3], a[3], b[3];
+
+    if (mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_EVEN_ODD_COLUMNS
+            || mode == GLS_MODE_CHECKERBOARD) {
+        // The 2x2 mask textures of libgls
+        float m = (mode == GLS_MODE_EVEN_ODD_ROWS ? (y % 2 == 0)
+                : mode == GLS_MODE_EVEN_ODD_COLUMNS ? (x % 2 == 0)
+                : ((x + y) % 2 == 0));
+        masked_tex(mode, vl, s, t, step_x, step_y, l);
+        masked_tex(mode, vr, s, t, step_x, step_y, r);
+        mix(r, l, m, a);
+        mix(l, r, m, b);
+        ghostbust(p, a, b, result);
+        return;
+    }
+
+    texture(vl, s, t, l);
+    texture(vr, s, t, r);
+    switch (mode) {
+    case GLS_MODE_RED_CYAN_DUBOIS:
+    case GLS_MODE_GREEN_MAGENTA_DUBOIS:
+    case GLS_MODE_AMBER_BLUE_DUBOIS:
+        {
+            const float (*m)[9] = dubois[mode == GLS_MODE_RED_CYAN_DUBOIS ? 0
+                : mode == GLS_MODE_GREEN_MAGENTA_DUBOIS ? 1 : 2];
+            int i;
+            for (i = 0; i < 3; i++)
+                result[i] = m[0][i] * l[0] + m[0][3 + i] * l[1] + m[0][6 + i] * l[2]
+                    + m[1][i] * r[0] + m[1][3 + i] * r[1] + m[1][6 + i] * r[2];
+        }
+        break;
+    case GLS_MODE_RED_CYAN_MONOCHROME:
+        result[0] = rgb_to_lum(l);
+        result[1] = rgb_to_lum(r);
+        result[2] = rgb_to_lum(r);
+        break;
+    case GLS_MODE_RED_CYAN_HALF_COLOR:
+        result[0] = rgb_to_lum(l);
+        result[1] = r[1];
+        result[2] = r[2];
+        break;
+    case GLS_MODE_RED_CYAN_FULL_COLOR:
+        result[0] = l[0];
+        result[1] = r[1];
+        result[2] = r[2];
+        break;
+    case GLS_MODE_GREEN_MAGENTA_MONOCHROME:
+        result[0] = rgb_to_lum(r);
+        result[1] = rgb_to_lum(l);
+        result[2] = rgb_to_lum(r);
+        break;
+    case GLS_MODE_GREEN_MAGENTA_HALF_COLOR:
+        result[0] = r[0];
+        result[1] = rgb_to_lum(l);
+        result[2] = r[2];
+        break;
+    case GLS_MODE_GREEN_MAGENTA_FULL_COLOR:
+        result[0] = r[0];
+        result[1] = l[1];
+        result[2] = r[2];
+        break;
+    case GLS_MODE_AMBER_BLUE_MONOCHROME:
+        result[0] = rgb_to_lum(l);
+        result[1] = rgb_to_lum(l);
+        result[2] = rgb_to_lum(r);
+        break;
+    case GLS_MODE_AMBER_BLUE_HALF_COLOR:
+        result[0] = rgb_to_lum(l);
+        result[1] = rgb_to_lum(l);
+        result[2] = r[2];
+        break;
+    case GLS_MODE_AMBER_BLUE_FULL_COLOR:
+        result[0] = l[0];
+        result[1] = l[1];
+        result[2] = r[2];
+        break;
+    case GLS_MODE_RED_GREEN_MONOCHROME:
+        result[0] = rgb_to_lum(l);
+        result[1] = rgb_to_lum(r);
+        result[2] = 0.0f;
+        break;
+    case GLS_MODE_RED_BLUE_MONOCHROME:
+        result[0] = rgb_to_lum(l);
+        result[1] = 0.0f;
+        result[2] = rgb_to_lum(r);
+        break;
+    default:
+        // All other modes show one view per sub-viewport
+        mix(l, r, channel, a);
+        mix(r, l, channel, b);
+        ghostbust(p, a, b, result);
+        break;
+    }
+}
+
+/* Compose a frame into an RGB24 image with rows from top to bottom */
+static void cpu_compose(GLSmode mode, const Params* p, const View* views[2],
+        unsigned char* out, int width, int height)
+{
+    // Like glsDrawViews() with the viewport at the screen origin
+    const int screen_x = 0, screen_y = 0;
+    const View* vl = views[0];
+    const View* vr = views[1];
+    int region[2][4];
+    float channel[2] = { 0.0f, 1.0f };
+    int region_count = 1;
+    int i, x, y;
+
+    if ((mode == GLS_MODE_EVEN_ODD_ROWS || mode == GLS_MODE_CHECKERBOARD)
+            && screen_y % 2 == 0) {
+        const View* tmp = vl;
+        vl = vr;
+        vr = tmp;
+    }
+    if ((mode == GLS_MODE_EVEN_ODD_COLUMNS || mode == GLS_MODE_CHECKERBOARD)
+            && screen_x % 2 == 1) {
+        const View* tmp = vl;
+        vl = vr;
+        vr = tmp;
+    }
+
+    /* Sub-viewports in OpenGL coordinates, with the view they show */
+    region[0][0] = 0;
+    region[0][1] = 0;
+    region[0][2] = width;
+    region[0][3] = height;
+    if (mode == GLS_MODE_MONO_RIGHT) {
+        channel[0] = 1.0f;
+    } else if (mode == GLS_MODE_LEFT_RIGHT) {
+        int hw = width / 2;
+        region[0][2] = hw;
+        region[1][0] = hw;
+        region[1][1] = 0;
+        region[1][2] = width - hw;
+        region[1][3] = height;
+        region_count = 2;
+    } else if (mode == GLS_MODE_TOP_BOTTOM || mode == GLS_MODE_HDMI_FRAME_PACK) {
+        int blank_lines = (mode == GLS_MODE_HDMI_FRAME_PACK ? height / 49 : 0);
+        int hh = (mode == GLS_MODE_HDMI_FRAME_PACK ? (height - blank_lines) / 2 : height / 2);
+        region[0][1] = hh + blank_lines;
+        region[0][3] = height - hh - blank_lines;
+        region[1][0] = 0;
+        region[1][1] = 0;
+        region[1][2] = width;
+        region[1][3] = hh;
+        region_count = 2;
+    }
+
+    memset(out, 0, (size_t)width * height * 3);
+    for (i = 0; i < region_count; i++) {
+        for (y = region[i][1]; y < region[i][1] + region[i][3]; y++) {
+            unsigned char* row = out + (size_t)(height - 1 - y) * width * 3;
+            float t = (y - region[i][1] + 0.5f) / region[i][3];
+            for (x = region[i][0]; x < region[i][0] + region[i][2]; x++) {
+                float s = (x - region[i][0] + 0.5f) / region[i][2];
+                float rgb[3];
+                shade(mode, p, vl, vr, channel[i], s, t, x, y,
+                        1.0f / width, 1.0f / height, rgb);
+                row[3 * x + 0] = clamp_byte(rgb[0] * 255.0f);
+                row[3 * x + 1] = clamp_byte(rgb[1] * 255.0f);
+                row[3 * x + 2] = clamp_byte(rgb[2] * 255.0f);
+            }
+        }
+    }
+}
+
+
+/*
+ * OpenGL composition on an offscreen context. Frames pass through a ring of
+ * slots: the views are uploaded through a pixel buffer object, composed by
+ * libgls into a framebuffer object, and read back into another pixel buffer
+ * object. A slot is only read back when it is needed again, so that several
+ * frames are in flight and neither upload nor readback stalls the pipeline.
+ */
+
+#if GLS_CONVERT_USE_EGL
+
+#define MAX_PIPELINE_DEPTH 8
+
+typedef struct {
+    GLuint view_tex[2];
+    GLuint upload_pbo;
+    GLuint fbo;
+    GLuint fbo_tex;
+    GLuint readback_pbo;
+    GLsync fence;
+} Slot;
+
+typedef struct {
+    EGLDisplay dpy;
+    EGLContext ctx;
+    EGLSurface surface;
+    GLScontext* gls;
+    Slot slots[MAX_PIPELINE_DEPTH];
+    int depth;
+    int next;
+    int view_width;
+    int view_height;
+    int width;
+    int height;
+} GLPath;
+
+static int gl_init(GLPath* g, int depth, int view_width, int view_height,
+        int width, int height, const Params* p)
+{
+    static const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    static const EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+    EGLConfig config;
+    EGLint n;
+    int i, v;
+
+    memset(g, 0, sizeof(GLPath));
+    g->depth = (depth < 1 ? 1 : depth > MAX_PIPELINE_DEPTH ? MAX_PIPELINE_DEPTH : depth);
+    g->view_width = view_width;
+    g->view_height = view_height;
+    g->width = width;
+    g->height = height;
+
+    /* Create an offscreen context; no window system is needed */
+    g->dpy = EGL_NO_DISPLAY;
+    get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+        g->dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (g->dpy == EGL_NO_DISPLAY)
+        g->dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (g->dpy == EGL_NO_DISPLAY || !eglInitialize(g->dpy, NULL, NULL)
+            || !eglBindAPI(EGL_OPENGL_API)
+            || !eglChooseConfig(g->dpy, config_attribs, &config, 1, &n) || n < 1)
+        return -1;
+    g->ctx = eglCreateContext(g->dpy, config, EGL_NO_CONTEXT, NULL);
+    if (g->ctx == EGL_NO_CONTEXT)
+        return -1;
+    g->surface = EGL_NO_SURFACE;
+    if (!eglMakeCurrent(g->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, g->ctx)) {
+        g->surface = eglCreatePbufferSurface(g->dpy, config, pbuffer_attribs);
+        if (g->surface == EGL_NO_SURFACE
+                || !eglMakeCurrent(g->dpy, g->surface, g->surface, g->ctx))
+            return -1;
+    }
+    g->gls = glsCreateContext();
+    if (!g->gls)
+        return -1;
+    glsSetCrosstalkGhostbusting(g->gls, p->crosstalk[0], p->crosstalk[1], p->crosstalk[2],
+            p->ghostbust ? 1.0f : 0.0f);
+
+    for (i = 0; i < g->depth; i++) {
+        Slot* s = &g->slots[i];
+        glGenTextures(2, s->view_tex);
+        for (v = 0; v < 2; v++) {
+            glBindTexture(GL_TEXTURE_2D, s->view_tex[v]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, view_width, view_height, 0,
+                    GL_RGB, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        }
+        glGenTextures(1, &s->fbo_tex);
+        glBindTexture(GL_TEXTURE_2D, s->fbo_tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &s->fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, s->fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                GL_TEXTURE_2D, s->fbo_tex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            return -1;
+        glGenBuffers(1, &s->upload_pbo);
+        glGenBuffers(1, &s->readback_pbo);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    return (glGetError() == GL_NO_ERROR ? 0 : -1);
+}
+
+/* Wait for the oldest frame in a slot and write it */
+static int gl_retire(GLPath* g, Slot* s, Output* out)
+{
+    const unsigned char* data;
+    int ret;
+
+    while (glClientWaitSync(s->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000)
+            == GL_TIMEOUT_EXPIRED)
+        ;
+    glDeleteSync(s->fence);
+    s->fence = 0;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s->readback_pbo);
+    data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)g->width * g->height * 4,
+            GL_MAP_READ_BIT);
+    if (!data)
+        return -1;
+    // OpenGL rows are from bottom to top
+    ret = output_frame(out, data + (size_t)(g->height - 1) * g->width * 4,
+            -4L * g->width, 4);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return ret;
+}
+
+static int gl_compose(GLPath* g, GLSmode mode, const View* views[2], Output* out)
+{
+    Slot* s = &g->slots[g->next];
+    size_t view_size = (size_t)g->view_width * g->view_height * 3;
+    unsigned char* ptr;
+    int v, y;
+
+    g->next = (g->next + 1) % g->depth;
+    if (s->fence && gl_retire(g, s, out) != 0)
+        return -1;
+
+    /* Upload: orphan the buffer so that the driver never has to wait */
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->upload_pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, 2 * view_size, NULL, GL_STREAM_DRAW);
+    ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, 2 * view_size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!ptr)
+        return -1;
+    for (v = 0; v < 2; v++) {
+        for (y = 0; y < g->view_height; y++) {
+            memcpy(ptr + v * view_size + (size_t)y * g->view_width * 3,
+                    views[v]->data + (size_t)(g->view_height - 1 - y) * views[v]->stride,
+                    (size_t)g->view_width * 3);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    for (v = 0; v < 2; v++) {
+        glBindTexture(GL_TEXTURE_2D, s->view_tex[v]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, g->view_width, g->view_height,
+                GL_RGB, GL_UNSIGNED_BYTE, (const GLvoid*)(v * view_size));
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    /* Compose */
+    glBindFramebuffer(GL_FRAMEBUFFER, s->fbo);
+    glViewport(0, 0, g->width, g->height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glsClear(g->gls);
+    glsDrawViews(g->gls, mode, GL_FALSE, s->view_tex[0], s->view_tex[1]);
+
+    /* Start the readback; it is finished in gl_retire() */
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s->readback_pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)g->width * g->height * 4, NULL, GL_STREAM_READ);
+    glReadPixels(0, 0, g->width, g->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    return (glGetError() == GL_NO_ERROR ? 0 : -1);
+}
+
+/* Write all frames that are still in flight, in order */
+static int gl_finish(GLPath* g, Output* out)
+{
+    int i;
+    for (i = 0; i < g->depth; i++) {
+        Slot* s = &g->slots[(g->next + i) % g->depth];
+        if (s->fence && gl_retire(g, s, out) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void gl_deinit(GLPath* g)
+{
+    int i;
+    if (g->gls) {
+        for (i = 0; i < g->depth; i++) {
+            Slot* s = &g->slots[i];
+            if (s->fence)
+                glDeleteSync(s->fence);
+            glDeleteTextures(2, s->view_tex);
+            glDeleteTextures(1, &s->fbo_tex);
+            glDeleteFramebuffers(1, &s->fbo);
+            glDeleteBuffers(1, &s->upload_pbo);
+            glDeleteBuffers(1, &s->readback_pbo);
+        }
+        glsDestroyContext(g->gls);
+    }
+    if (g->dpy != EGL_NO_DISPLAY) {
+        eglMakeCurrent(g->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (g->surface != EGL_NO_SURFACE)
+            eglDestroySurface(g->dpy, g->surface);
+        if (g->ctx != EGL_NO_CONTEXT)
+            eglDestroyContext(g->dpy, g->ctx);
+        eglTerminate(g->dpy);
+    }
+}
+
+#endif
+
+
+/*
+ * Main
+ */
+
+typedef enum {
+    LAYOUT_SEPARATE,
+    LAYOUT_LEFT_RIGHT,
+    LAYOUT_RIGHT_LEFT,
+    LAYOUT_TOP_BOTTOM,
+    LAYOUT_BOTTOM_TOP
+} Layout;
+
+static void usage(void)
+{
+    int i;
+    printf("Usage: gls-convert [options] --left LEFT --right RIGHT --output OUTPUT\n"
+            "       gls-convert [options] --input INPUT --input-layout LAYOUT --output OUTPUT\n"
+            "Options:\n"
+            "  --mode MODE          Output mode (default red-cyan-dubois)\n"
+            "  --input-layout L     Layout of packed input frames: left-right, right-left,\n"
+            "                       top-bottom, bottom-top\n"
+            "  --input-size WxH     Frame size of raw RGB24 input\n"
+            "  --output-size WxH    Output frame size (default: view size; for\n"
+            "                       hdmi-frame-pack, two views plus blank lines)\n"
+            "  --frames N           Convert at most N frames\n"
+            "  --crosstalk R,G,B    Crosstalk levels for ghostbusting (0-1)\n"
+            "  --ghostbust L        Ghostbusting level (0-1)\n"
+            "  --cpu                Compose on the CPU, without OpenGL\n"
+            "  --pipeline N         Frames in flight on the OpenGL path (default 3)\n"
+            "File formats are chosen by content (input) or extension (output):\n"
+            "  .ppm (P6), .y4m (YUV4MPEG2), anything else is raw RGB24. Use - for stdout.\n"
+            "Modes:\n");
+    for (i = 1; i < MODE_COUNT; i++)
+        printf("  %s\n", mode_names[i]);
+}
+
+static int parse_size(const char* s, int* w, int* h)
+{
+    return (sscanf(s, "%dx%d", w, h) == 2 && *w > 0 && *h > 0 ? 0 : -1);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* left_name = NULL;
+    const char* right_name = NULL;
+    const char* input_name = NULL;
+    const char* output_name = NULL;
+    Layout layout = LAYOUT_SEPARATE;
+    GLSmode mode = GLS_MODE_RED_CYAN_DUBOIS;
+    int input_width = 0, input_height = 0;
+    int width = 0, height = 0;
+    long max_frames = -1;
+    float crosstalk[3] = { 0.0f, 0.0f, 0.0f };
+    float ghostbust_level = 0.0f;
+    GLboolean use_cpu = GL_FALSE;
+    int pipeline_depth = 3;
+    Input inputs[2];
+    int input_count;
+    Output out;
+    Params params;
+    View views[2];
+    unsigned char* cpu_buf = NULL;
+    long frame;
+    int ret = 0;
+    int i;
+#if GLS_CONVERT_USE_EGL
+    GLPath gl;
+    GLboolean have_gl = GL_FALSE;
+#endif
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--left") == 0 && i + 1 < argc) {
+            left_name = argv[++i];
+        } else if (strcmp(argv[i], "--right") == 0 && i + 1 < argc) {
+            right_name = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input_name = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_name = argv[++i];
+        } else if (strcmp(argv[i], "--input-layout") == 0 && i + 1 < argc) {
+            i++;
+            layout = (strcmp(argv[i], "left-right") == 0 ? LAYOUT_LEFT_RIGHT
+                    : strcmp(argv[i], "right-left") == 0 ? LAYOUT_RIGHT_LEFT
+                    : strcmp(argv[i], "top-bottom") == 0 ? LAYOUT_TOP_BOTTOM
+                    : strcmp(argv[i], "bottom-top") == 0 ? LAYOUT_BOTTOM_TOP
+                    : LAYOUT_SEPARATE);
+            if (layout == LAYOUT_SEPARATE) {
+                fprintf(stderr, "gls-convert: invalid input layout %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            int m;
+            i++;
+            for (m = 0; m < MODE_COUNT; m++)
+                if (strcmp(argv[i], mode_names[m]) == 0)
+                    break;
+            if (m == MODE_COUNT) {
+                fprintf(stderr, "gls-convert: invalid mode %s\n", argv[i]);
+                return 1;
+            }
+            mode = (GLSmode)m;
+        } else if (strcmp(argv[i], "--input-size") == 0 && i + 1 < argc) {
+            if (parse_size(argv[++i], &input_width, &input_height) != 0) {
+                fprintf(stderr, "gls-convert: invalid size %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--output-size") == 0 && i + 1 < argc) {
+            if (parse_size(argv[++i], &width, &height) != 0) {
+                fprintf(stderr, "gls-convert: invalid size %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            max_frames = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--crosstalk") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%f,%f,%f", &crosstalk[0], &crosstalk[1], &crosstalk[2]) != 3) {
+                fprintf(stderr, "gls-convert: invalid crosstalk levels %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ghostbust") == 0 && i + 1 < argc) {
+            ghostbust_level = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--cpu") == 0) {
+            use_cpu = GL_TRUE;
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline_depth = atoi(argv[++i]);
+        } else {
+            usage();
+            return (strcmp(argv[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if (!output_name
+            || (layout == LAYOUT_SEPARATE && (!left_name || !right_name || input_name))
+            || (layout != LAYOUT_SEPARATE && (!input_name || left_name || right_name))) {
+        usage();
+        return 1;
+    }
+    if (mode == GLS_MODE_QUAD_BUFFER_STEREO) {
+        fprintf(stderr, "gls-convert: quad-buffer-stereo cannot be stored in a file\n");
+        return 1;
+    }
+
+    /* Open the input and determine the view size */
+    memset(inputs, 0, sizeof(inputs));
+    input_count = (layout == LAYOUT_SEPARATE ? 2 : 1);
+    for (i = 0; i < input_count; i++) {
+        const char* name = (layout == LAYOUT_SEPARATE ? (i == 0 ? left_name : right_name) : input_name);
+        if (input_open(&inputs[i], name, input_width, input_height) != 0) {
+            ret = 1;
+            goto exit;
+        }
+    }
+    views[0].width = views[1].width = inputs[0].width;
+    views[0].height = views[1].height = inputs[0].height;
+    if (layout == LAYOUT_SEPARATE) {
+        if (inputs[1].width != inputs[0].width || inputs[1].height != inputs[0].height) {
+            fprintf(stderr, "gls-convert: left and right views have different sizes\n");
+            ret = 1;
+            goto exit;
+        }
+    } else if (layout == LAYOUT_LEFT_RIGHT || layout == LAYOUT_RIGHT_LEFT) {
+        views[0].width = views[1].width = inputs[0].width / 2;
+    } else {
+        views[0].height = views[1].height = inputs[0].height / 2;
+    }
+    if (views[0].width < 1 || views[0].height < 1) {
+        fprintf(stderr, "gls-convert: the input frames are too small\n");
+        ret = 1;
+        goto exit;
+    }
+    if (width == 0) {
+        width = views[0].width;
+        height = views[0].height;
+        if (mode == GLS_MODE_HDMI_FRAME_PACK) {
+            // 1/49 of the height is blank, e.g. 1080 + 45 + 1080 = 2205
+            height = 2 * views[0].height * 49 / 48;
+        }
+    }
+
+    /* Open the output */
+    if (output_open(&out, output_name, width, height,
+                inputs[0].format == FORMAT_Y4M ? inputs[0].framerate : "25:1") != 0) {
+        ret = 1;
+        goto exit;
+    }
+
+    /* Choose the composition path */
+    params.crosstalk[0] = crosstalk[0] * ghostbust_level;
+    params.crosstalk[1] = crosstalk[1] * ghostbust_level;
+    params.crosstalk[2] = crosstalk[2] * ghostbust_level;
+    params.ghostbust = (ghostbust_level > 0.0f);
+#if GLS_CONVERT_USE_EGL
+    if (!use_cpu) {
+        have_gl = (gl_init(&gl, pipeline_depth, views[0].width, views[0].height,
+                    width, height, &params) == 0);
+        if (!have_gl) {
+            fprintf(stderr, "gls-convert: cannot use OpenGL; composing on the CPU\n");
+            gl_deinit(&gl);
+        }
+    }
+    if (!have_gl)
+#endif
+    {
+        (void)pipeline_depth;
+        (void)use_cpu;
+        cpu_buf = malloc((size_t)width * height * 3);
+        if (!cpu_buf) {
+            fprintf(stderr, "gls-convert: out of memory\n");
+            ret = 1;
+        }
+    }
+
+    /* Convert */
+    for (frame = 0; ret == 0 && (max_frames < 0 || frame < max_frames); frame++) {
+        const unsigned char* data[2];
+        const View* view_ptrs[2] = { &views[0], &views[1] };
+        GLSmode frame_mode = mode;
+
+        data[0] = input_frame(&inputs[0]);
+        data[1] = (input_count == 2 ? input_frame(&inputs[1]) : data[0]);
+        if (!data[0] || !data[1])
+            break;
+        for (i = 0; i < 2; i++)
+            views[i].stride = (size_t)inputs[input_count == 2 ? i : 0].width * 3;
+        if (layout == LAYOUT_SEPARATE) {
+            views[0].data = data[0];
+            views[1].data = data[1];
+        } else if (layout == LAYOUT_LEFT_RIGHT || layout == LAYOUT_RIGHT_LEFT) {
+            int first = (layout == LAYOUT_LEFT_RIGHT ? 0 : 1);
+            views[first].data = data[0];
+            views[1 - first].data = data[0] + (size_t)views[0].width * 3;
+        } else {
+            int first = (layout == LAYOUT_TOP_BOTTOM ? 0 : 1);
+            views[first].data = data[0];
+            views[1 - first].data = data[0] + (size_t)views[0].height * views[0].stride;
+        }
+        // Alternating output shows the left view in even frames
+        if (mode == GLS_MODE_ALTERNATING)
+            frame_mode = (frame % 2 == 0 ? GLS_MODE_MONO_LEFT : GLS_MODE_MONO_RIGHT);
+
+#if GLS_CONVERT_USE_EGL
+        if (have_gl) {
+            if (gl_compose(&gl, frame_mode, view_ptrs, &out) != 0) {
+                fprintf(stderr, "gls-convert: OpenGL composition failed\n");
+                ret = 1;
+                break;
+            }
+            continue;
+        }
+#endif
+        cpu_compose(frame_mode, &params, view_ptrs, cpu_buf, width, height);
+        if (output_frame(&out, cpu_buf, 3L * width, 3) != 0) {
+            fprintf(stderr, "gls-convert: %s: write error\n", output_name);
+            ret = 1;
+            break;
+        }
+    }
+#if GLS_CONVERT_USE_EGL
+    if (have_gl) {
+        if (ret == 0 && gl_finish(&gl, &out) != 0) {
+            fprintf(stderr, "gls-convert: %s: write error\n", output_name);
+            ret = 1;
+        }
+        gl_deinit(&gl);
+    }
+#endif
+    if (output_close(&out) != 0 && ret == 0) {
+        fprintf(stderr, "gls-convert: %s: write error\n", output_name);
+        ret = 1;
+    }
+
+exit:
+    free(cpu_buf);
+    for (i = 0; i < 2; i++)
+        input_close(&inputs[i]);
+    return ret;
+}